@@ -1,12 +1,16 @@
 #include <chrono>
+#include <cstdio>
+#include <deque>
 #include <iomanip>
 #include <iostream>
 #include <string>
 #include <utility>
 #include <vector>
+#include <malloc.h>
 
 #include "../src/commands/CommandHandler.hpp"
 #include "../src/db/RedisStore.hpp"
+#include "../src/persistence/Snapshot.hpp"
 #include "../tests/TestHelpers.hpp"
 
 struct BenchmarkResult {
@@ -36,6 +40,62 @@ BenchmarkResult benchSetGet(size_t iterations) {
     return {"SET+GET round-trip", iterations * 2, duration_ms};
 }
 
+BenchmarkResult benchIncr(size_t counters, size_t rounds) {
+    RedisStore store;
+    CommandHandler handler(store);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    for (size_t r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < counters; ++i) {
+            auto args = makeArgs(std::vector<std::string>{"INCR", "hits:" + std::to_string(i)});
+            bytes += handler.execute(args.views, 1).reply.size();
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double duration_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    return {"INCR counters", counters * rounds + (bytes == 0), duration_ms};
+}
+
+BenchmarkResult benchMget(size_t keys, size_t batch, size_t rounds) {
+    RedisStore store;
+    CommandHandler handler(store);
+    for (size_t i = 0; i < keys; ++i)
+        store.setString("page:" + std::to_string(i), std::string(32, 'x'));
+
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    for (size_t r = 0; r < rounds; ++r) {
+        std::vector<std::string> argv{"MGET"};
+        for (size_t i = 0; i < batch; ++i)
+            argv.push_back("page:" + std::to_string((r * batch + i) * 7919 % keys));
+        auto args = makeArgs(argv);
+        bytes += handler.execute(args.views, 1).reply.size();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double duration_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    return {"MGET x40 (keys)", batch * rounds + (bytes == 0), duration_ms};
+}
+
+BenchmarkResult benchAppend(size_t appends) {
+    RedisStore store;
+    CommandHandler handler(store);
+    std::string chunk(64, 'x');
+
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    for (size_t i = 0; i < appends; ++i) {
+        auto args = makeArgs(std::vector<std::string>{"APPEND", "log", chunk});
+        bytes += handler.execute(args.views, 1).reply.size();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double duration_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    return {"APPEND 64B to one key", appends + (bytes == 0), duration_ms};
+}
+
 BenchmarkResult benchListPushPop(size_t iterations) {
     RedisStore store;
     CommandHandler handler(store);
@@ -56,6 +116,25 @@ BenchmarkResult benchListPushPop(size_t iterations) {
     return {"List RPUSH+LPOP", iterations * 2, duration_ms};
 }
 
+BenchmarkResult benchLrangeFull(size_t elements, size_t rounds) {
+    RedisStore store;
+    CommandHandler handler(store);
+    List& list = store.getOrCreateList("jobs");
+    for (size_t i = 0; i < elements; ++i)
+        list.PushBack("job:" + std::to_string(i) + ":payload");
+
+    auto args = makeArgs(std::vector<std::string>{"LRANGE", "jobs", "0", "-1"});
+
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    for (size_t r = 0; r < rounds; ++r)
+        bytes += handler.execute(args.views, 1).reply.size();
+    auto end = std::chrono::steady_clock::now();
+
+    double duration_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    return {"LRANGE 0 -1 (elements)", elements * rounds + (bytes == 0), duration_ms};
+}
+
 BenchmarkResult benchStreamXadd(size_t iterations) {
     RedisStore store;
     CommandHandler handler(store);
@@ -73,12 +152,197 @@ BenchmarkResult benchStreamXadd(size_t iterations) {
     return {"Stream XADD", iterations, duration_ms};
 }
 
+BenchmarkResult benchStreamXagg(size_t entries, size_t rounds) {
+    RedisStore store;
+    CommandHandler handler(store);
+    Stream& stream = store.getOrCreateStream("telemetry");
+    for (size_t i = 0; i < entries; ++i) {
+        // One reading every 10 ms
+        stream.addStream(StreamID{1700000000000ULL + i * 10, 0},
+                         StreamFields{{"temp", std::to_string(200 + i % 97)}});
+    }
+
+    auto args = makeArgs(std::vector<std::string>{"XAGG", "telemetry", "-", "+", "temp", "60000",
+                                                  "AVG", "MIN", "MAX"});
+
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    for (size_t r = 0; r < rounds; ++r)
+        bytes += handler.execute(args.views, 1).reply.size();
+    auto end = std::chrono::steady_clock::now();
+
+    double duration_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    return {"XAGG 1-min buckets (entries)", entries * rounds + (bytes == 0), duration_ms};
+}
+
+BenchmarkResult benchSinter(size_t members, size_t rounds) {
+    // Two ID sets overlapping by a third; large enough limit to keep both intsets
+    Set::SetMaxIntsetEntries(members);
+    RedisStore store;
+    CommandHandler handler(store);
+    Set& a = store.getOrCreateSet("users:active");
+    Set& b = store.getOrCreateSet("users:paid");
+    for (size_t i = 0; i < members; ++i) {
+        a.add(std::to_string(i * 3));
+        b.add(std::to_string(i * 2));
+    }
+
+    auto args = makeArgs(std::vector<std::string>{"SINTERCARD", "2", "users:active", "users:paid"});
+
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    for (size_t r = 0; r < rounds; ++r)
+        bytes += handler.execute(args.views, 1).reply.size();
+    auto end = std::chrono::steady_clock::now();
+    Set::SetMaxIntsetEntries(512);
+
+    double duration_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    return {"SINTERCARD intsets (members)", 2 * members * rounds + (bytes == 0), duration_ms};
+}
+
+BenchmarkResult benchZrank(size_t members, size_t lookups) {
+    RedisStore store;
+    CommandHandler handler(store);
+    ZSet& board = store.getOrCreateZSet("leaderboard");
+    for (size_t i = 0; i < members; ++i)
+        board.insert("player:" + std::to_string(i), static_cast<double>((i * 7919) % members));
+
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    for (size_t i = 0; i < lookups; ++i) {
+        std::string member = "player:" + std::to_string((i * 104729) % members);
+        auto args = makeArgs(std::vector<std::string>{"ZRANK", "leaderboard", member});
+        bytes += handler.execute(args.views, 1).reply.size();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double duration_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    return {"ZRANK (1M members)", lookups + (bytes == 0), duration_ms};
+}
+
+BenchmarkResult benchSnapshotLoad(size_t keys) {
+    RedisStore store;
+    for (size_t i = 0; i < keys; ++i) {
+        store.setString("key:" + std::to_string(i), "value:" + std::to_string(i));
+    }
+
+    std::string blob = Snapshot::serialize(store, 64 * 1024);
+
+    RedisStore restored;
+    SnapshotLoadStats stats;
+    std::string err;
+    Snapshot::loadFromMemory(restored, blob.data(), blob.size(), 0, stats, err);
+
+    return {"Snapshot load (keys)", stats.keys, stats.seconds * 1000.0};
+}
+
+struct MemoryResult {
+    std::string name;
+    size_t elements;
+    size_t bytes;
+};
+
+// Live heap bytes according to the allocator (includes malloc headers).
+static size_t heapInUse() {
+    return mallinfo2().uordblks;
+}
+
+static std::string jobId(size_t i) {
+    // 32-byte ids, like the job queues that motivated the packed list
+    char buf[40];
+    std::snprintf(buf, sizeof(buf), "job:%010zu:%016zx", i,
+                  static_cast<size_t>(i * 0x9E3779B97F4A7C15ULL));
+    return buf;
+}
+
+std::vector<MemoryResult> benchListMemory(size_t elements) {
+    std::vector<MemoryResult> out;
+
+    {
+        size_t before = heapInUse();
+        std::deque<std::string> baseline;
+        for (size_t i = 0; i < elements; ++i)
+            baseline.push_back(jobId(i));
+        out.push_back({"std::deque<std::string>", elements, heapInUse() - before});
+    }
+
+    {
+        size_t before = heapInUse();
+        List list;
+        for (size_t i = 0; i < elements; ++i)
+            list.PushBack(jobId(i));
+        out.push_back({"List (quicklist)", elements, heapInUse() - before});
+    }
+
+    {
+        size_t before = heapInUse();
+        List list;
+        for (size_t i = 0; i < elements; ++i)
+            list.PushBack(std::to_string(1700000000000000ULL + i));
+        out.push_back({"List (numeric ids)", elements, heapInUse() - before});
+    }
+
+    {
+        // Append-only audit log read at the ends: interior nodes compressed
+        List::SetCompressDepth(1);
+        size_t before = heapInUse();
+        List list;
+        for (size_t i = 0; i < elements; ++i)
+            list.PushBack("audit user=svc-billing action=invoice.create status=ok seq=" +
+                          std::to_string(i));
+        size_t compressed = heapInUse() - before;
+        List::SetCompressDepth(0);
+
+        List raw;
+        before = heapInUse();
+        for (size_t i = 0; i < elements; ++i)
+            raw.PushBack("audit user=svc-billing action=invoice.create status=ok seq=" +
+                         std::to_string(i));
+        out.push_back({"List (audit log, raw)", elements, heapInUse() - before});
+        out.push_back({"List (audit log, depth 1)", elements, compressed});
+    }
+
+    return out;
+}
+
+// 10-field sensor readings, one per millisecond, as XADD stores them
+MemoryResult benchStreamMemory(size_t entries) {
+    static const char *names[] = {"sensor", "site", "temp", "humidity", "pressure",
+                                  "voltage", "current", "rssi", "battery", "status"};
+
+    size_t before = heapInUse();
+    Stream stream;
+    StreamFields fields(10);
+    for (size_t i = 0; i < entries; ++i) {
+        fields[0] = {names[0], "sensor-" + std::to_string(i % 64)};
+        fields[1] = {names[1], "plant-3"};
+        fields[2] = {names[2], std::to_string(200 + i % 50)};
+        fields[3] = {names[3], std::to_string(40 + i % 20)};
+        fields[4] = {names[4], std::to_string(101300 + i % 300)};
+        fields[5] = {names[5], std::to_string(3300 + i % 40)};
+        fields[6] = {names[6], std::to_string(120 + i % 30)};
+        fields[7] = {names[7], std::to_string(-60 - static_cast<int>(i % 30))};
+        fields[8] = {names[8], std::to_string(100 - i % 100)};
+        fields[9] = {names[9], "ok"};
+        stream.addStream(StreamID{1700000000000ULL + i, 0}, fields);
+    }
+    return {"Stream (10-field readings)", entries, heapInUse() - before};
+}
+
 int main() {
     const size_t iterations = 5000;
     std::vector<BenchmarkResult> results;
     results.push_back(benchSetGet(iterations));
     results.push_back(benchListPushPop(iterations));
+    results.push_back(benchLrangeFull(100000, 20));
     results.push_back(benchStreamXadd(iterations));
+    results.push_back(benchStreamXagg(1000000, 20));
+    results.push_back(benchIncr(1000, 200));
+    results.push_back(benchMget(1000000, 40, 5000));
+    results.push_back(benchAppend(200000));
+    results.push_back(benchSinter(100000, 50));
+    results.push_back(benchZrank(1000000, 100000));
+    results.push_back(benchSnapshotLoad(iterations * 20));
 
     std::cout << "Redis micro-benchmarks (" << iterations << " iterations)" << std::endl;
     std::cout << "------------------------------------------------------------" << std::endl;
@@ -95,5 +359,24 @@ int main() {
                   << std::endl;
     }
 
+    std::cout << std::endl << "List memory per element (1M elements)" << std::endl;
+    std::cout << "------------------------------------------------------------" << std::endl;
+    for (const auto& mem : benchListMemory(1000000)) {
+        std::cout << std::left << std::setw(30) << mem.name
+                  << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+                  << static_cast<double>(mem.bytes) / mem.elements << " B/elem"
+                  << std::setw(15) << std::setprecision(1)
+                  << mem.bytes / (1024.0 * 1024.0) << " MB" << std::endl;
+    }
+
+    std::cout << std::endl << "Stream memory per entry (1M entries)" << std::endl;
+    std::cout << "------------------------------------------------------------" << std::endl;
+    MemoryResult mem = benchStreamMemory(1000000);
+    std::cout << std::left << std::setw(30) << mem.name
+              << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+              << static_cast<double>(mem.bytes) / mem.elements << " B/entry"
+              << std::setw(15) << std::setprecision(1)
+              << mem.bytes / (1024.0 * 1024.0) << " MB" << std::endl;
+
     return 0;
 }
@@ -0,0 +1,934 @@
+#include "ClusterManager.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <netdb.h>
+#include <random>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../db/RedisStore.hpp"
+#include "../persistence/AppendOnlyFile.hpp"
+#include "../protocol/RESPParser.hpp"
+#include "../server/ServerConfig.hpp"
+#include "../utils/StringUtils.hpp"
+#include "../utils/time.cpp"
+
+namespace {
+
+constexpr uint64_t kPingPeriodMs = 1000;
+constexpr uint64_t kReconnectDelayMs = 1000;
+
+} // namespace
+
+ClusterManager::ClusterManager(RedisStore &str)
+    : store(str),
+      slots(CLUSTER_SLOTS, nullptr),
+      migratingTo(CLUSTER_SLOTS, nullptr),
+      importingFrom(CLUSTER_SLOTS, nullptr) {}
+
+ClusterManager::~ClusterManager() {
+    for (auto &[id, node] : nodes)
+        closeLink(*node);
+}
+
+std::string ClusterManager::newNodeId() {
+    static const char hex[] = "0123456789abcdef";
+    std::random_device rd;
+    std::mt19937_64 gen((static_cast<uint64_t>(rd()) << 32) ^ rd());
+
+    std::string id(40, '0');
+    for (char &c : id)
+        c = hex[gen() & 15];
+    return id;
+}
+
+/* =====================================================================
+   configure()
+   ---------------------------------------------------------------------
+   The node id must survive restarts, otherwise the other nodes would
+   see a stranger claiming the same address. It lives in the cluster
+   config file together with the slot map and epochs.
+   ===================================================================== */
+bool ClusterManager::configure(const ServerConfig &cfg, std::string &err) {
+    if (!cfg.clusterEnabled)
+        return true;
+
+    isEnabled = true;
+    configPath = cfg.dir + "/" + cfg.clusterConfigFile;
+    announceIp = cfg.clusterAnnounceIp;
+    nodeTimeout = cfg.clusterNodeTimeout;
+
+    std::ifstream probe(configPath);
+    if (probe.good()) {
+        if (!loadConfig(err))
+            return false;
+    } else {
+        ClusterNode *node = addNode(newNodeId(), announceIp, cfg.port);
+        node->myself = true;
+        me = node;
+        std::cout << "No cluster configuration found, I'm " << me->id << std::endl;
+    }
+
+    me->ip = announceIp;
+    me->port = cfg.port;
+    store.enableSlotIndex();
+    saveConfig();
+    return true;
+}
+
+ClusterNode *ClusterManager::findNode(std::string_view id) const {
+    auto it = nodes.find(std::string(id));
+    return it == nodes.end() ? nullptr : it->second.get();
+}
+
+ClusterNode *ClusterManager::addNode(const std::string &id, const std::string &ip,
+                                     int port) {
+    auto node = std::make_unique<ClusterNode>();
+    node->id = id;
+    node->ip = ip;
+    node->port = port;
+    node->createdAt = current_time_ms();
+
+    ClusterNode *raw = node.get();
+    nodes[id] = std::move(node);
+    return raw;
+}
+
+void ClusterManager::removeNode(ClusterNode *node) {
+    for (int j = 0; j < CLUSTER_SLOTS; ++j) {
+        if (slots[j] == node) slots[j] = nullptr;
+        if (migratingTo[j] == node) migratingTo[j] = nullptr;
+        if (importingFrom[j] == node) importingFrom[j] = nullptr;
+    }
+    closeLink(*node);
+    nodes.erase(node->id);
+}
+
+void ClusterManager::assignSlot(int slot, ClusterNode *node) {
+    if (slots[slot])
+        slots[slot]->slots.reset(slot);
+    slots[slot] = node;
+    if (node)
+        node->slots.set(slot);
+}
+
+/* =====================================================================
+   bumpEpoch()
+   ---------------------------------------------------------------------
+   Used when this node takes a slot without any election (end of a
+   migration, epoch collision): it simply moves to a fresh, highest
+   epoch, which makes its claims win everywhere.
+   ===================================================================== */
+void ClusterManager::bumpEpoch() {
+    ++epoch;
+    me->configEpoch = epoch;
+}
+
+/* ========================================================================== */
+/*                                  ROUTING                                   */
+/* ========================================================================== */
+
+std::string ClusterManager::route(const std::vector<std::string_view> &keys,
+                                  bool asking) {
+    if (!isEnabled || keys.empty())
+        return "";
+
+    int slot = keyHashSlot(keys[0]);
+    for (size_t i = 1; i < keys.size(); ++i) {
+        if (keyHashSlot(keys[i]) != slot)
+            return "-CROSSSLOT Keys in request don't hash to the same slot\r\n";
+    }
+
+    ClusterNode *owner = slots[slot];
+
+    // The target of a migration serves the slot only after ASKING
+    if (importingFrom[slot] && asking)
+        return "";
+
+    if (!owner)
+        return "-CLUSTERDOWN Hash slot not served\r\n";
+
+    if (owner != me)
+        return "-MOVED " + std::to_string(slot) + " " + owner->ip + ":" +
+               std::to_string(owner->port) + "\r\n";
+
+    if (ClusterNode *target = migratingTo[slot]) {
+        size_t missing = 0;
+        for (std::string_view key : keys) {
+            if (!store.getObject(std::string(key)))
+                ++missing;
+        }
+
+        if (missing == keys.size())
+            return "-ASK " + std::to_string(slot) + " " + target->ip + ":" +
+                   std::to_string(target->port) + "\r\n";
+        if (missing > 0)
+            return "-TRYAGAIN Multiple keys request during rehashing of slot\r\n";
+    }
+
+    return "";
+}
+
+/* ========================================================================== */
+/*                            CLUSTER SUBCOMMANDS                             */
+/* ========================================================================== */
+
+bool ClusterManager::meet(const std::string &ip, int port, std::string &err) {
+    for (const auto &[id, node] : nodes) {
+        if (node->ip == ip && node->port == port)
+            return true;   // already known or being met
+    }
+
+    if (port <= 0 || port > 65535) {
+        err = "Invalid node address specified: " + ip + ":" + std::to_string(port);
+        return false;
+    }
+
+    // Placeholder id until the first PONG tells us the real one
+    ClusterNode *node = addNode(newNodeId(), ip, port);
+    node->handshake = true;
+    return true;
+}
+
+bool ClusterManager::addSlots(const std::vector<int> &list, std::string &err) {
+    for (int slot : list) {
+        if (slots[slot]) {
+            err = "Slot " + std::to_string(slot) + " is already busy";
+            return false;
+        }
+    }
+
+    for (int slot : list) {
+        assignSlot(slot, me);
+        importingFrom[slot] = nullptr;
+    }
+    saveConfig();
+    return true;
+}
+
+bool ClusterManager::delSlots(const std::vector<int> &list, std::string &err) {
+    for (int slot : list) {
+        if (!slots[slot]) {
+            err = "Slot " + std::to_string(slot) + " is already unassigned";
+            return false;
+        }
+    }
+
+    for (int slot : list) {
+        assignSlot(slot, nullptr);
+        migratingTo[slot] = nullptr;
+        importingFrom[slot] = nullptr;
+    }
+    saveConfig();
+    return true;
+}
+
+bool ClusterManager::setSlot(int slot, std::string_view action,
+                             std::string_view node_id, std::string &err) {
+    if (equalsIgnoreCase(action, "STABLE")) {
+        migratingTo[slot] = nullptr;
+        importingFrom[slot] = nullptr;
+        saveConfig();
+        return true;
+    }
+
+    ClusterNode *node = findNode(node_id);
+    if (!node || node->handshake) {
+        err = "I don't know about node " + std::string(node_id);
+        return false;
+    }
+
+    if (equalsIgnoreCase(action, "MIGRATING")) {
+        if (slots[slot] != me) {
+            err = "I'm not the owner of hash slot " + std::to_string(slot);
+            return false;
+        }
+        if (node == me) {
+            err = "Can't migrate a slot to myself";
+            return false;
+        }
+        migratingTo[slot] = node;
+    } else if (equalsIgnoreCase(action, "IMPORTING")) {
+        if (slots[slot] == me) {
+            err = "I'm already the owner of hash slot " + std::to_string(slot);
+            return false;
+        }
+        if (node == me) {
+            err = "Can't import a slot from myself";
+            return false;
+        }
+        importingFrom[slot] = node;
+    } else if (equalsIgnoreCase(action, "NODE")) {
+        if (slots[slot] == me && node != me && store.countKeysInSlot(slot) > 0) {
+            err = "Can't assign hashslot " + std::to_string(slot) +
+                  " to a different node while I still hold keys for this hash slot.";
+            return false;
+        }
+
+        if (node == me && importingFrom[slot]) {
+            // Migration finished: claim the slot with a fresh epoch so
+            // the old owner (and everybody else) accepts the change.
+            importingFrom[slot] = nullptr;
+            bumpEpoch();
+        }
+        if (node != me)
+            migratingTo[slot] = nullptr;
+
+        assignSlot(slot, node);
+    } else {
+        err = "Invalid CLUSTER SETSLOT action or number of arguments";
+        return false;
+    }
+
+    saveConfig();
+    return true;
+}
+
+std::vector<ClusterManager::SlotRange> ClusterManager::slotRanges() const {
+    std::vector<SlotRange> ranges;
+
+    for (int j = 0; j < CLUSTER_SLOTS; ++j) {
+        if (!slots[j])
+            continue;
+        if (!ranges.empty() && ranges.back().node == slots[j] &&
+            ranges.back().end == j - 1) {
+            ranges.back().end = j;
+        } else {
+            ranges.push_back({j, j, slots[j]});
+        }
+    }
+    return ranges;
+}
+
+std::vector<const ClusterNode *> ClusterManager::nodeList() const {
+    std::vector<const ClusterNode *> list;
+    list.push_back(me);
+    for (const auto &[id, node] : nodes) {
+        if (node.get() != me && !node->handshake)
+            list.push_back(node.get());
+    }
+    return list;
+}
+
+bool ClusterManager::nodeReachable(const ClusterNode &node) const {
+    if (node.myself)
+        return true;
+    return node.pongReceived != 0 &&
+           current_time_ms() - node.pongReceived <= nodeTimeout;
+}
+
+std::string ClusterManager::slotsToString(const std::bitset<CLUSTER_SLOTS> &bits) {
+    std::string out;
+    for (int j = 0; j < CLUSTER_SLOTS; ++j) {
+        if (!bits.test(j))
+            continue;
+
+        int start = j;
+        while (j + 1 < CLUSTER_SLOTS && bits.test(j + 1))
+            ++j;
+
+        if (!out.empty())
+            out += ',';
+        out += std::to_string(start);
+        if (j != start)
+            out += "-" + std::to_string(j);
+    }
+    return out;
+}
+
+bool ClusterManager::slotsFromString(std::string_view s,
+                                     std::bitset<CLUSTER_SLOTS> &bits) {
+    bits.reset();
+    while (!s.empty()) {
+        size_t comma = s.find(',');
+        std::string_view part = s.substr(0, comma);
+        s = comma == std::string_view::npos ? std::string_view() : s.substr(comma + 1);
+
+        uint64_t start, end;
+        size_t dash = part.find('-');
+        if (dash == std::string_view::npos) {
+            if (!parseU64(part, start))
+                return false;
+            end = start;
+        } else if (!parseU64(part.substr(0, dash), start) ||
+                   !parseU64(part.substr(dash + 1), end)) {
+            return false;
+        }
+
+        if (start > end || end >= CLUSTER_SLOTS)
+            return false;
+        for (uint64_t j = start; j <= end; ++j)
+            bits.set(j);
+    }
+    return true;
+}
+
+/*
+ * One line per node, in the CLUSTER NODES layout:
+ *   <id> <ip:port@cport> <flags> <master> <ping-sent> <pong-recv>
+ *   <config-epoch> <link-state> <slot> ... [<slot>->-<id>] [<slot>-<-<id>]
+ */
+std::string ClusterManager::nodesDescription() const {
+    std::string out;
+    uint64_t now_unix = static_cast<uint64_t>(getUnixTimeMs());
+    uint64_t now = current_time_ms();
+
+    for (const ClusterNode *node : nodeList()) {
+        std::string flags = node->myself ? "myself,master" : "master";
+        if (!nodeReachable(*node))
+            flags += ",fail?";
+
+        bool connected = node->myself ||
+                         (node->linkFd != -1 && !node->linkConnecting);
+        uint64_t pong = node->pongReceived
+                            ? now_unix - (now - node->pongReceived)
+                            : 0;
+
+        out += node->id + " " + node->ip + ":" + std::to_string(node->port) +
+               "@" + std::to_string(node->port + 10000) + " " + flags + " - 0 " +
+               std::to_string(pong) + " " + std::to_string(node->configEpoch) +
+               (connected ? " connected" : " disconnected");
+
+        std::string ranges = slotsToString(node->slots);
+        for (char &c : ranges)
+            if (c == ',') c = ' ';
+        if (!ranges.empty())
+            out += " " + ranges;
+
+        if (node->myself) {
+            for (int j = 0; j < CLUSTER_SLOTS; ++j) {
+                if (migratingTo[j])
+                    out += " [" + std::to_string(j) + "->-" + migratingTo[j]->id + "]";
+                if (importingFrom[j])
+                    out += " [" + std::to_string(j) + "-<-" + importingFrom[j]->id + "]";
+            }
+        }
+        out += "\n";
+    }
+    return out;
+}
+
+std::string ClusterManager::info() const {
+    size_t assigned = 0;
+    size_t pfail = 0;
+    for (const ClusterNode *owner : slots) {
+        if (!owner)
+            continue;
+        ++assigned;
+        if (!nodeReachable(*owner))
+            ++pfail;
+    }
+
+    size_t known = nodeList().size();
+    size_t size = 0;
+    for (const ClusterNode *node : nodeList())
+        size += node->slots.any();
+
+    std::string out;
+    out += std::string("cluster_state:") +
+           (assigned == CLUSTER_SLOTS ? "ok" : "fail") + "\r\n";
+    out += "cluster_slots_assigned:" + std::to_string(assigned) + "\r\n";
+    out += "cluster_slots_ok:" + std::to_string(assigned - pfail) + "\r\n";
+    out += "cluster_slots_pfail:" + std::to_string(pfail) + "\r\n";
+    out += "cluster_slots_fail:0\r\n";
+    out += "cluster_known_nodes:" + std::to_string(known) + "\r\n";
+    out += "cluster_size:" + std::to_string(size) + "\r\n";
+    out += "cluster_current_epoch:" + std::to_string(epoch) + "\r\n";
+    out += "cluster_my_epoch:" + std::to_string(me->configEpoch) + "\r\n";
+    return out;
+}
+
+/* ========================================================================== */
+/*                                CLUSTER BUS                                 */
+/* ========================================================================== */
+
+std::vector<std::string> ClusterManager::busMessage(const char *type) const {
+    std::vector<std::string> msg = {
+        "CLUSTER", type, me->id, me->ip, std::to_string(me->port),
+        std::to_string(me->configEpoch), std::to_string(epoch),
+        slotsToString(me->slots)
+    };
+
+    for (const auto &[id, node] : nodes) {
+        if (node.get() == me || node->handshake)
+            continue;
+        msg.push_back(node->id);
+        msg.push_back(node->ip);
+        msg.push_back(std::to_string(node->port));
+    }
+    return msg;
+}
+
+void ClusterManager::processBusMessage(const std::vector<std::string_view> &args) {
+    processBusMessage(args, nullptr);
+}
+
+/* =====================================================================
+   processBusMessage()
+   ---------------------------------------------------------------------
+   args: CLUSTER PING|PONG <id> <ip> <port> <configEpoch> <currentEpoch>
+         <slots> [<id> <ip> <port>]...
+
+   A PONG on a handshake link reveals the real id of a node we MEET-ed
+   by address: the placeholder is renamed, or dropped if that node was
+   already known through gossip (or turns out to be ourselves).
+   ===================================================================== */
+ClusterNode *ClusterManager::processBusMessage(const std::vector<std::string_view> &args,
+                                               ClusterNode *link_node) {
+    uint64_t port, config_epoch, current_epoch;
+    std::bitset<CLUSTER_SLOTS> claimed;
+
+    if (args.size() < 8 || (args.size() - 8) % 3 != 0 ||
+        !parseU64(args[4], port) || !parseU64(args[5], config_epoch) ||
+        !parseU64(args[6], current_epoch) || !slotsFromString(args[7], claimed))
+        return link_node;
+
+    std::string sender_id(args[2]);
+    std::string sender_ip(args[3]);
+    bool changed = false;
+
+    if (sender_id == me->id) {
+        if (link_node && link_node->handshake)
+            removeNode(link_node);
+        return nullptr;
+    }
+
+    ClusterNode *sender = findNode(sender_id);
+
+    if (link_node && link_node->handshake) {
+        if (sender) {
+            removeNode(link_node);
+            link_node = nullptr;
+        } else {
+            // Re-key the placeholder under its real id, keeping the link
+            auto it = nodes.find(link_node->id);
+            std::unique_ptr<ClusterNode> owned = std::move(it->second);
+            nodes.erase(it);
+            owned->id = sender_id;
+            owned->handshake = false;
+            sender = owned.get();
+            nodes[sender_id] = std::move(owned);
+            link_node = sender;
+            changed = true;
+            std::cout << "Cluster handshake with " << sender_ip << ":" << port
+                      << " completed, node " << sender_id << std::endl;
+        }
+    }
+
+    if (!sender) {
+        sender = addNode(sender_id, sender_ip, static_cast<int>(port));
+        changed = true;
+    }
+
+    if (sender->ip != sender_ip || sender->port != static_cast<int>(port)) {
+        sender->ip = sender_ip;
+        sender->port = static_cast<int>(port);
+        changed = true;
+    }
+
+    sender->pongReceived = current_time_ms();
+
+    if (current_epoch > epoch) {
+        epoch = current_epoch;
+        changed = true;
+    }
+    if (sender->configEpoch != config_epoch) {
+        sender->configEpoch = config_epoch;
+        epoch = std::max(epoch, config_epoch);
+        changed = true;
+    }
+
+    // Two nodes must never share a config epoch, or slot conflicts between
+    // them could not be resolved. The one with the greater id moves on.
+    if (sender->configEpoch == me->configEpoch && me->id > sender->id) {
+        bumpEpoch();
+        changed = true;
+    }
+
+    if (claimed != sender->slots || claimed.any()) {
+        auto before = sender->slots;
+        updateSlotsFrom(sender, claimed);
+        changed = changed || before != sender->slots;
+    }
+
+    // Gossip: learn about nodes we have never heard of
+    for (size_t i = 8; i + 2 < args.size(); i += 3) {
+        std::string id(args[i]);
+        uint64_t gport;
+        if (id == me->id || findNode(id) || !parseU64(args[i + 2], gport))
+            continue;
+
+        bool pending_meet = false;
+        for (const auto &[nid, node] : nodes) {
+            if (node->handshake && node->ip == args[i + 1] &&
+                node->port == static_cast<int>(gport))
+                pending_meet = true;
+        }
+        if (pending_meet)
+            continue;
+
+        addNode(id, std::string(args[i + 1]), static_cast<int>(gport));
+        changed = true;
+    }
+
+    if (changed)
+        saveConfig();
+    return link_node;
+}
+
+/* =====================================================================
+   updateSlotsFrom()
+   ---------------------------------------------------------------------
+   A claim wins when the slot is free or the current owner has a lower
+   config epoch. Slots being imported are left alone: the import ends
+   with SETSLOT NODE, not with gossip. If this node loses a slot it
+   still has keys for, they are dropped: the cluster decided they are
+   not ours anymore.
+   ===================================================================== */
+void ClusterManager::updateSlotsFrom(ClusterNode *sender,
+                                     const std::bitset<CLUSTER_SLOTS> &claimed) {
+    for (int j = 0; j < CLUSTER_SLOTS; ++j) {
+        if (!claimed.test(j))
+            continue;
+
+        ClusterNode *owner = slots[j];
+        if (owner == sender || importingFrom[j])
+            continue;
+        if (owner && owner->configEpoch >= sender->configEpoch)
+            continue;
+
+        if (owner == me) {
+            for (const auto &key : store.getKeysInSlot(j, store.countKeysInSlot(j)))
+                store.del(key);
+            std::cout << "Slot " << j << " moved to " << sender->id << std::endl;
+        }
+
+        assignSlot(j, sender);
+        if (migratingTo[j] == sender)
+            migratingTo[j] = nullptr;
+    }
+}
+
+void ClusterManager::connectLink(ClusterNode &node) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo *res = nullptr;
+    std::string port = std::to_string(node.port);
+    if (::getaddrinfo(node.ip.c_str(), port.c_str(), &hints, &res) != 0 || !res) {
+        node.nextConnectAt = current_time_ms() + kReconnectDelayMs;
+        return;
+    }
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        ::freeaddrinfo(res);
+        node.nextConnectAt = current_time_ms() + kReconnectDelayMs;
+        return;
+    }
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    int rc = ::connect(fd, res->ai_addr, res->ai_addrlen);
+    ::freeaddrinfo(res);
+
+    if (rc != 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        node.nextConnectAt = current_time_ms() + kReconnectDelayMs;
+        return;
+    }
+
+    node.linkFd = fd;
+    node.linkConnecting = rc != 0;
+    node.linkIn.clear();
+    node.pingSent = 0;
+
+    if (!node.linkConnecting)
+        sendPing(node);
+}
+
+void ClusterManager::closeLink(ClusterNode &node) {
+    if (node.linkFd != -1)
+        ::close(node.linkFd);
+    node.linkFd = -1;
+    node.linkConnecting = false;
+    node.linkIn.clear();
+    node.pingSent = 0;
+    node.nextConnectAt = current_time_ms() + kReconnectDelayMs;
+}
+
+void ClusterManager::sendPing(ClusterNode &node) {
+    std::string out;
+    AppendOnlyFile::encodeCommand(out, busMessage("PING"));
+
+    // A few hundred bytes; if the socket cannot take them the link is
+    // in trouble and gets rebuilt.
+    ssize_t n = ::send(node.linkFd, out.data(), out.size(), MSG_NOSIGNAL);
+    if (n != static_cast<ssize_t>(out.size())) {
+        closeLink(node);
+        return;
+    }
+
+    node.pingSent = current_time_ms();
+    node.lastPingAt = node.pingSent;
+}
+
+ClusterNode *ClusterManager::readLink(ClusterNode &node) {
+    char buf[16 * 1024];
+    ssize_t n = ::read(node.linkFd, buf, sizeof(buf));
+
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return &node;
+    if (n <= 0) {
+        closeLink(node);
+        return &node;
+    }
+
+    node.linkIn.append(buf, static_cast<size_t>(n));
+
+    ClusterNode *current = &node;
+    size_t pos = 0;
+    bool malformed = false;
+
+    while (current && pos < current->linkIn.size()) {
+        size_t before = pos;
+        auto args = RESPParser::parseNext(current->linkIn, pos, malformed);
+        if (pos == before)
+            break;
+
+        if (args.size() >= 2 && equalsIgnoreCase(args[0], "CLUSTER") &&
+            equalsIgnoreCase(args[1], "PONG")) {
+            current->pingSent = 0;
+            // The node may be re-keyed (handshake) or removed here; the
+            // buffer moves along with it.
+            std::string pending = current->linkIn.substr(pos);
+            ClusterNode *next = processBusMessage(args, current);
+            if (next) {
+                next->linkIn = std::move(pending);
+                pos = 0;
+            }
+            current = next;
+        }
+    }
+
+    if (current) {
+        current->linkIn.erase(0, pos);
+        if (malformed)
+            closeLink(*current);
+    }
+    return current;
+}
+
+void ClusterManager::addFds(fd_set &read_fds, fd_set &write_fds, int &max_fd) const {
+    for (const auto &[id, node] : nodes) {
+        if (node->linkFd == -1)
+            continue;
+        FD_SET(node->linkFd, node->linkConnecting ? &write_fds : &read_fds);
+        max_fd = std::max(max_fd, node->linkFd);
+    }
+}
+
+void ClusterManager::handleFds(const fd_set &read_fds, const fd_set &write_fds) {
+    // Processing may rename or drop nodes, so walk a snapshot of the ids
+    std::vector<std::string> ids;
+    for (const auto &[id, node] : nodes)
+        ids.push_back(id);
+
+    for (const auto &id : ids) {
+        ClusterNode *node = findNode(id);
+        if (!node || node->linkFd == -1)
+            continue;
+
+        if (node->linkConnecting) {
+            if (!FD_ISSET(node->linkFd, &write_fds))
+                continue;
+
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (::getsockopt(node->linkFd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 ||
+                err != 0) {
+                closeLink(*node);
+                continue;
+            }
+            node->linkConnecting = false;
+            sendPing(*node);
+        } else if (FD_ISSET(node->linkFd, &read_fds)) {
+            readLink(*node);
+        }
+    }
+}
+
+void ClusterManager::cron() {
+    if (!isEnabled)
+        return;
+
+    uint64_t now = current_time_ms();
+    std::vector<ClusterNode *> expired;
+
+    for (auto &[id, node] : nodes) {
+        if (node.get() == me)
+            continue;
+
+        if (node->handshake && now - node->createdAt > nodeTimeout) {
+            expired.push_back(node.get());
+            continue;
+        }
+
+        if (node->linkFd == -1) {
+            if (now >= node->nextConnectAt)
+                connectLink(*node);
+            continue;
+        }
+
+        if (node->linkConnecting)
+            continue;
+
+        if (node->pingSent && now - node->pingSent > nodeTimeout / 2) {
+            closeLink(*node);   // no PONG: rebuild the link
+        } else if (!node->pingSent && now - node->lastPingAt >= kPingPeriodMs) {
+            sendPing(*node);
+        }
+    }
+
+    for (ClusterNode *node : expired) {
+        std::cout << "Cluster handshake with " << node->ip << ":" << node->port
+                  << " timed out" << std::endl;
+        removeNode(node);
+    }
+}
+
+/* ========================================================================== */
+/*                               CONFIG FILE                                  */
+/* ========================================================================== */
+
+/*
+ * Same shape as CLUSTER NODES, trimmed to what must survive a restart:
+ *   <id> <ip>:<port> <myself|master> <configEpoch> <slots> [<slot>->-<id>]...
+ *   vars currentEpoch <n>
+ */
+void ClusterManager::saveConfig() const {
+    if (!isEnabled)
+        return;
+
+    std::string out;
+    for (const ClusterNode *node : nodeList()) {
+        out += node->id + " " + node->ip + ":" + std::to_string(node->port) + " " +
+               (node->myself ? "myself" : "master") + " " +
+               std::to_string(node->configEpoch) + " " +
+               (node->slots.any() ? slotsToString(node->slots) : "-");
+
+        if (node->myself) {
+            for (int j = 0; j < CLUSTER_SLOTS; ++j) {
+                if (migratingTo[j])
+                    out += " [" + std::to_string(j) + "->-" + migratingTo[j]->id + "]";
+                if (importingFrom[j])
+                    out += " [" + std::to_string(j) + "-<-" + importingFrom[j]->id + "]";
+            }
+        }
+        out += "\n";
+    }
+    out += "vars currentEpoch " + std::to_string(epoch) + "\n";
+
+    std::string tmp = configPath + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Could not write cluster config " << tmp << "\n";
+        return;
+    }
+
+    bool ok = ::write(fd, out.data(), out.size()) == static_cast<ssize_t>(out.size()) &&
+              ::fsync(fd) == 0;
+    ::close(fd);
+
+    if (!ok || std::rename(tmp.c_str(), configPath.c_str()) != 0) {
+        std::cerr << "Could not write cluster config " << configPath << "\n";
+        ::unlink(tmp.c_str());
+    }
+}
+
+bool ClusterManager::loadConfig(std::string &err) {
+    std::ifstream in(configPath);
+    std::string line;
+
+    struct Pending { int slot; bool migrating; std::string id; };
+    std::vector<Pending> pending;
+
+    while (std::getline(in, line)) {
+        if (line.empty())
+            continue;
+
+        std::istringstream fields(line);
+        std::string id, addr, flags, epoch_str, slot_str;
+        fields >> id >> addr >> flags >> epoch_str;
+
+        if (id == "vars") {
+            if (addr == "currentEpoch" && !parseU64(flags, epoch)) {
+                err = "bad currentEpoch in " + configPath;
+                return false;
+            }
+            continue;
+        }
+
+        size_t colon = addr.rfind(':');
+        uint64_t port = 0, config_epoch = 0;
+        fields >> slot_str;
+        std::bitset<CLUSTER_SLOTS> bits;
+
+        if (colon == std::string::npos ||
+            !parseU64(addr.substr(colon + 1), port) ||
+            !parseU64(epoch_str, config_epoch) ||
+            (slot_str != "-" && !slotsFromString(slot_str, bits))) {
+            err = "bad line in " + configPath + ": " + line;
+            return false;
+        }
+
+        ClusterNode *node = addNode(id, addr.substr(0, colon), static_cast<int>(port));
+        node->configEpoch = config_epoch;
+        for (int j = 0; j < CLUSTER_SLOTS; ++j) {
+            if (bits.test(j))
+                assignSlot(j, node);
+        }
+
+        if (flags == "myself") {
+            node->myself = true;
+            me = node;
+        }
+
+        // [slot->-id] / [slot-<-id]
+        std::string extra;
+        while (fields >> extra) {
+            bool migrating = extra.find("->-") != std::string::npos;
+            size_t sep = extra.find(migrating ? "->-" : "-<-");
+            uint64_t slot;
+            if (extra.size() < 2 || sep == std::string::npos ||
+                !parseU64(std::string_view(extra).substr(1, sep - 1), slot) ||
+                slot >= CLUSTER_SLOTS) {
+                err = "bad slot state in " + configPath + ": " + extra;
+                return false;
+            }
+            pending.push_back({static_cast<int>(slot), migrating,
+                               extra.substr(sep + 3, extra.size() - sep - 4)});
+        }
+    }
+
+    if (!me) {
+        err = "no 'myself' node in " + configPath;
+        return false;
+    }
+
+    for (const auto &p : pending) {
+        ClusterNode *node = findNode(p.id);
+        if (!node)
+            continue;
+        (p.migrating ? migratingTo : importingFrom)[p.slot] = node;
+    }
+
+    std::cout << "Cluster config loaded, I'm " << me->id << std::endl;
+    return true;
+}
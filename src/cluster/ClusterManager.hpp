@@ -0,0 +1,204 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/select.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "HashSlot.hpp"
+
+class RedisStore;
+struct ServerConfig;
+
+/*
+------------------------------------------------------------------------------
+  CLUSTER MODE
+------------------------------------------------------------------------------
+
+Every node owns a set of the 16384 hash slots. A command whose keys hash
+to a slot served elsewhere is answered with
+
+    -MOVED <slot> <ip>:<port>     the slot lives there, update your map
+    -ASK <slot> <ip>:<port>       the slot is being migrated and this key
+                                  already moved; send ASKING + the command
+                                  to that node, just this once
+
+Slot migration (online):
+
+    target:  CLUSTER SETSLOT <slot> IMPORTING <source-id>
+    source:  CLUSTER SETSLOT <slot> MIGRATING <target-id>
+    source:  CLUSTER GETKEYSINSLOT <slot> <n>  +  MIGRATE ... KEYS ...
+             (repeated, one batch at a time, until the slot is empty)
+    both:    CLUSTER SETSLOT <slot> NODE <target-id>
+
+While MIGRATING, the source keeps serving keys it still has and answers
+ASK for the others; the target serves the slot only to clients that sent
+ASKING first, so no key is ever owned by two nodes at once.
+
+Cluster bus: nodes exchange "CLUSTER PING" / "PONG" messages over their
+regular client port, once per second per peer. Each message carries the
+sender's id, address, epochs and slot bitmap, plus the addresses of the
+other nodes it knows (gossip), so meeting one node is enough to join.
+Conflicting slot claims are resolved by config epoch: the higher one
+wins. A node that takes over a slot (SETSLOT NODE <myself>) bumps its
+epoch so its claim beats the previous owner's.
+
+Not implemented: replicas per shard, failure consensus and failover.
+Nodes that stop answering are only flagged (fail?) in CLUSTER NODES.
+------------------------------------------------------------------------------
+*/
+struct ClusterNode
+{
+    std::string id;
+    std::string ip;
+    int port = 0;
+    uint64_t configEpoch = 0;
+    bool myself = false;
+    bool handshake = false;           // met by address, real id unknown yet
+    std::bitset<CLUSTER_SLOTS> slots;
+    uint64_t pongReceived = 0;        // steady ms
+
+    // Outgoing bus link
+    int linkFd = -1;
+    bool linkConnecting = false;
+    std::string linkIn;
+    uint64_t pingSent = 0;            // 0 = no PING in flight
+    uint64_t lastPingAt = 0;
+    uint64_t nextConnectAt = 0;
+    uint64_t createdAt = 0;
+};
+
+class ClusterManager
+{
+public:
+    explicit ClusterManager(RedisStore &store);
+    ~ClusterManager();
+
+    ClusterManager(const ClusterManager &) = delete;
+    ClusterManager &operator=(const ClusterManager &) = delete;
+
+    /**
+     * Enables cluster mode if configured. Loads <dir>/<cluster-config-file>
+     * or creates a new node id and writes it.
+     */
+    bool configure(const ServerConfig &cfg, std::string &err);
+
+    bool enabled() const { return isEnabled; }
+    const ClusterNode &myself() const { return *me; }
+    uint64_t currentEpoch() const { return epoch; }
+
+    // ------------------------------------------------------------------
+    // Routing
+    // ------------------------------------------------------------------
+
+    /**
+     * Decides whether a command touching `keys` may run on this node.
+     * @param asking The client sent ASKING right before (or the command
+     *               implies it, like RESTORE-ASKING).
+     * @return "" to execute locally, otherwise the RESP error to send
+     *         (MOVED, ASK, CROSSSLOT, TRYAGAIN, CLUSTERDOWN).
+     */
+    std::string route(const std::vector<std::string_view> &keys, bool asking);
+
+    void setAsking(int fd) { askingClients.insert(fd); }
+    bool consumeAsking(int fd) { return askingClients.erase(fd) > 0; }
+    void onClientDisconnected(int fd) { askingClients.erase(fd); }
+
+    // ------------------------------------------------------------------
+    // CLUSTER subcommands (RESP encoding stays in CommandHandler)
+    // ------------------------------------------------------------------
+
+    bool meet(const std::string &ip, int port, std::string &err);
+    bool addSlots(const std::vector<int> &slots, std::string &err);
+    bool delSlots(const std::vector<int> &slots, std::string &err);
+
+    // action: IMPORTING | MIGRATING | NODE | STABLE
+    bool setSlot(int slot, std::string_view action, std::string_view node_id,
+                 std::string &err);
+
+    const ClusterNode *slotOwner(int slot) const { return slots[slot]; }
+
+    struct SlotRange
+    {
+        int start;
+        int end;
+        const ClusterNode *node;
+    };
+
+    // Contiguous runs of slots served by the same node, in slot order.
+    std::vector<SlotRange> slotRanges() const;
+
+    // Every known node, myself first.
+    std::vector<const ClusterNode *> nodeList() const;
+
+    bool nodeReachable(const ClusterNode &node) const;
+
+    std::string nodesDescription() const;   // CLUSTER NODES
+    std::string info() const;               // CLUSTER INFO
+
+    // ------------------------------------------------------------------
+    // Cluster bus
+    // ------------------------------------------------------------------
+
+    // "CLUSTER <type> <myid> <ip> <port> <configEpoch> <currentEpoch>
+    //  <slots> [<id> <ip> <port>]..." describing this node.
+    std::vector<std::string> busMessage(const char *type) const;
+
+    // Applies a PING or PONG header received from another node.
+    void processBusMessage(const std::vector<std::string_view> &args);
+
+    // Outgoing bus links for the event loop's select().
+    void addFds(fd_set &read_fds, fd_set &write_fds, int &max_fd) const;
+    void handleFds(const fd_set &read_fds, const fd_set &write_fds);
+
+    // Once per iteration: connects links, sends PINGs, drops dead links.
+    void cron();
+
+private:
+    RedisStore &store;
+
+    bool isEnabled = false;
+    std::string configPath;
+    std::string announceIp = "127.0.0.1";
+    uint64_t nodeTimeout = 15000;
+
+    uint64_t epoch = 0;    // currentEpoch
+    std::unordered_map<std::string, std::unique_ptr<ClusterNode>> nodes;
+    ClusterNode *me = nullptr;
+
+    std::vector<ClusterNode *> slots;            // owner per slot
+    std::vector<ClusterNode *> migratingTo;      // per slot, or nullptr
+    std::vector<ClusterNode *> importingFrom;    // per slot, or nullptr
+
+    std::unordered_set<int> askingClients;
+
+    ClusterNode *findNode(std::string_view id) const;
+    ClusterNode *addNode(const std::string &id, const std::string &ip, int port);
+    void removeNode(ClusterNode *node);
+    void assignSlot(int slot, ClusterNode *node);
+    void bumpEpoch();
+
+    // Returns the node the link belongs to afterwards (a handshake node is
+    // replaced by the real one), or nullptr if it was removed.
+    ClusterNode *processBusMessage(const std::vector<std::string_view> &args,
+                                   ClusterNode *link_node);
+    void updateSlotsFrom(ClusterNode *sender,
+                         const std::bitset<CLUSTER_SLOTS> &claimed);
+
+    void connectLink(ClusterNode &node);
+    void closeLink(ClusterNode &node);
+    void sendPing(ClusterNode &node);
+    ClusterNode *readLink(ClusterNode &node);
+
+    bool loadConfig(std::string &err);
+    void saveConfig() const;
+
+    static std::string newNodeId();
+    static std::string slotsToString(const std::bitset<CLUSTER_SLOTS> &bits);
+    static bool slotsFromString(std::string_view s, std::bitset<CLUSTER_SLOTS> &bits);
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/*
+------------------------------------------------------------------------------
+  HASH SLOTS
+------------------------------------------------------------------------------
+
+The keyspace is split into 16384 slots:
+
+    slot = CRC16(key) mod 16384
+
+CRC16 is the XMODEM variant (poly 0x1021, init 0), the same function
+Redis Cluster uses, so clients compute identical slots.
+
+Hash tags: if the key contains "{...}" with at least one character
+between the braces, only that part is hashed. "{user:1}:name" and
+"{user:1}:mail" therefore always live in the same slot, which is what
+makes multi-key commands possible in cluster mode.
+------------------------------------------------------------------------------
+*/
+constexpr int CLUSTER_SLOTS = 16384;
+
+uint16_t crc16(const char *buf, size_t len);
+
+// Slot of `key`, honoring {hashtag}.
+uint16_t keyHashSlot(std::string_view key);
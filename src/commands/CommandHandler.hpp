@@ -4,11 +4,26 @@
 #include <string_view>
 #include <vector>
 #include <unordered_map>
-#include <deque>
+#include <unordered_set>
+#include <functional>
+#include <list>
+#include <set>
+#include <sys/types.h>
 
 #include "../types/ExecResult.hpp"
 #include "../types/BlokedClient.hpp"
 #include "../db/RedisStore.hpp"
+#include "../server/ServerConfig.hpp"
+
+class AppendOnlyFile;
+class ClusterManager;
+class ReplicationManager;
+
+// Error replies shared by the handler files.
+inline constexpr const char *kWrongType =
+    "-WRONGTYPE Operation against a key holding the wrong kind of value\r\n";
+inline constexpr const char *kSyntaxError = "-ERR syntax error\r\n";
+inline constexpr const char *kNotInteger = "-ERR value is not an integer or out of range\r\n";
 
 /**
  * CommandHandler
@@ -39,8 +54,67 @@ public:
      * Responses are returned to clients who have previously made a request but whose time has passed.
      */
     void checkTimeouts();
-    void checkXReadTimeouts();
 
+    /**
+     * Output path for replies produced outside of execute()'s return
+     * value: blocked clients woken by another client's push, or timed
+     * out. Installed by the event loop, which appends to the client's
+     * reply buffer.
+     */
+    using Sender = std::function<void(int fd, std::string_view data)>;
+    void setSender(Sender send_fn);
+
+    /** True while `fd` waits in a blocking command (or WAIT); its later input must wait too. */
+    bool isBlocked(int fd) const;
+
+    /** Drops everything a closed connection was waiting on. */
+    void onClientDisconnected(int fd);
+
+    /**
+     * Reaps finished background children (BGSAVE, BGREWRITEAOF) without
+     * blocking and starts an automatic AOF rewrite when the file grew
+     * past the configured threshold. Called once per event-loop iteration.
+     */
+    void checkBackgroundJobs();
+
+    /** Runtime options (snapshot path, ...). */
+    void setConfig(const ServerConfig &cfg);
+
+    /**
+     * While loading, every command except PING/ECHO is answered with
+     * -LOADING so clients can connect before the dataset is ready.
+     */
+    void setLoading(bool on);
+    bool isLoading() const { return loading; }
+
+    /**
+     * Attaches the append-only file. From then on every successful write
+     * command is fed to it (see propagate()). Pass nullptr to detach.
+     */
+    void setAppendOnlyFile(AppendOnlyFile *file);
+
+    /**
+     * Attaches replication. Writes are then also streamed to replicas,
+     * and on a replica, writes from regular clients are refused with
+     * -READONLY (only the master link may modify the dataset).
+     */
+    void setReplication(ReplicationManager *manager);
+
+    /**
+     * Requests a BGREWRITEAOF as soon as no other child is running
+     * (e.g. after a replica replaced its dataset with a full resync).
+     */
+    void scheduleAofRewrite();
+
+    /**
+     * Attaches cluster mode. Before running a command, its keys (taken
+     * from the command table) are routed: keys served by another node
+     * get -MOVED / -ASK instead of an answer.
+     */
+    void setCluster(ClusterManager *manager);
+
+    /** Keys of a command according to the command table (routing, tests). */
+    std::vector<std::string_view> commandKeys(const std::vector<std::string_view> &args) const;
 
 private:
     // File descriptor of the currently executing client.
@@ -52,24 +126,112 @@ private:
      */
     using CmdFn = ExecResult (CommandHandler::*)(const std::vector<std::string_view> &);
 
+    /**
+     * Command flags.
+     *   CMD_WRITE    modifies the keyspace → logged to the AOF
+     *   CMD_LOADING  allowed while the dataset is still loading
+     *   CMD_ASKING   implies ASKING (served on a slot being imported)
+     */
+    enum CommandFlags : uint32_t {
+        CMD_WRITE   = 1u << 0,
+        CMD_LOADING = 1u << 1,
+        CMD_ASKING  = 1u << 2,
+    };
+
+    /** Extracts keys for commands whose key positions move (XREAD). */
+    using KeysFn = std::vector<std::string_view> (*)(const std::vector<std::string_view> &);
+
+    /**
+     * Key positions follow Redis' command table: argv[firstKey..lastKey]
+     * every keyStep, lastKey < 0 counting from the end. firstKey == 0
+     * means the command has no keys.
+     */
+    struct CommandSpec {
+        CmdFn fn;
+        uint32_t flags;
+        int firstKey = 0;
+        int lastKey = 0;
+        int keyStep = 0;
+        KeysFn keysFn = nullptr;
+    };
+
+    static std::vector<std::string_view> keysOf(const CommandSpec &spec,
+                                                const std::vector<std::string_view> &args);
+    static std::vector<std::string_view> xreadKeys(const std::vector<std::string_view> &args);
+    static std::vector<std::string_view> migrateKeys(const std::vector<std::string_view> &args);
+    static std::vector<std::string_view> numkeysKeys(const std::vector<std::string_view> &args);
+
     /**
      * Command dispatch table.
-     * Maps uppercase RESP command names to their handler functions.
+     * Maps uppercase RESP command names to their handler + flags.
+     */
+    std::unordered_map<std::string, CommandSpec> commandMap;
+
+    // --------------------------------------------------------------------
+    // Propagation (AOF, replicas)
+    // --------------------------------------------------------------------
+    AppendOnlyFile *aof = nullptr;
+
+    // Replacement argv for the running command (e.g. XADD with the
+    // resolved ID). Empty → the original argv is propagated.
+    std::vector<std::string> rewrittenArgv;
+    bool suppressPropagation = false;
+
+    // Extra commands produced while executing (BLPOP wake-ups). They are
+    // emitted after the command that caused them, preserving order.
+    std::vector<std::vector<std::string>> alsoPropagateQueue;
+
+    ReplicationManager *repl = nullptr;
+    ClusterManager *cluster = nullptr;
+
+    void rewriteArgv(std::vector<std::string> argv);
+    void alsoPropagate(std::vector<std::string> argv);
+    void propagate(const std::vector<std::string> &argv);
+
+    /**
+     * Blocking client registry used for BLPOP / BRPOP.
+     *   blockedClients:  key -> FIFO of fds waiting on it (first to block
+     *                    is the first to be served)
+     *   blockedByFd:     fd  -> what it waits for, and until when
+     *   blockedTimeouts: (deadline, fd) for clients with a timeout, list
+     *                    and stream waiters alike
+     *
+     * XREAD / XREADGROUP waiters have the same pair of indexes, so an
+     * XADD only visits the clients waiting on that stream.
      */
-    std::unordered_map<std::string, CmdFn> commandMap;
+    std::unordered_map<std::string, std::list<int>> blockedClients;
+    std::unordered_map<int, BlockedClient> blockedByFd;
+    std::set<std::pair<uint64_t, int>> blockedTimeouts;
+    std::unordered_map<std::string, std::list<int>> blockedXReadClients;
+    std::unordered_map<int, BlockedXReadClient> blockedXReadByFd;
 
     /**
-     * Blocking client registry used for BLPOP.
-     * Maps: list_name -> queue of client_fds waiting for elements.
-     * The order in the deque ensures FIFO wake-up semantics
-     * (first client to block is the first to be served).
+     * Keys that received elements while waiters were blocked on them.
+     * Handlers only signal; the waiters are served once the command is
+     * done (handleClientsBlockedOnKeys), so a push is never interleaved
+     * with the pops it triggers.
      */
-    std::unordered_map<std::string, std::deque<BlockedClient>> blockedClients;
-    std::vector<BlockedXReadClient> blockedXReadClients;
+    std::vector<std::string> readyKeys;
+    std::unordered_set<std::string> readyKeySet;
+
+    Sender send;
+
 
-    
     RedisStore &store;
 
+    ServerConfig config;
+    bool loading = false;
+
+    // Background child (BGSAVE or BGREWRITEAOF), one at a time.
+    enum class ChildType { NONE, SNAPSHOT, AOF_REWRITE };
+    pid_t childPid = -1;
+    ChildType childType = ChildType::NONE;
+    std::string rewriteTmpPath;
+    bool aofRewriteScheduled = false;
+
+    bool startAofRewrite(std::string &err);
+    void finishAofRewrite(bool child_ok);
+
     // --------------------------------------------------------------------
     // RESP Encoding Helpers
     // --------------------------------------------------------------------
@@ -83,6 +245,9 @@ private:
     /** RESP Integer: :123\r\n */
     std::string respInteger(long long n);
 
+    /** RESP Bulk String of an integer's text; 0..9999 come pre-encoded. */
+    std::string respBulkInteger(long long n);
+
     /** RESP Null Bulk String: $-1\r\n */
     std::string nullBulk();
 
@@ -92,18 +257,26 @@ private:
     /** RESP Array: *N\r\n ... */
     std::string respArray(const std::vector<std::string> &values);
 
-    std::string respXRange(
-        const std::vector<
-            std::pair<
-                std::string,
-                std::vector<std::pair<std::string, std::string>>>> &entries);
+    /** Appends $len\r\nvalue\r\n to `out` without temporaries. */
+    static void appendBulk(std::string &out, std::string_view value);
+
+    /**
+     * Encodes up to `count` entries of `it` (0 = all) straight from the
+     * stream nodes as [id, [field, value, ...]] items; returns how many.
+     * The caller writes the array header.
+     */
+    static size_t appendStreamRange(std::string &out, Stream::Iterator &it, size_t count);
+
+    /**
+     * Appends one XREAD reply block, [key, [entries after `from`...]].
+     * Returns false, leaving `out` alone, when there are none.
+     */
+    static bool appendXReadBlock(std::string &out, const std::string &key,
+                                 const Stream &stream, const StreamID &from);
 
     std::string respXRead(
         const std::string &stream_name,
-        const std::vector<
-            std::pair<
-                std::string,
-                std::vector<std::pair<std::string, std::string>>>> &entries);
+        const std::vector<std::pair<StreamID, StreamFields>> &entries);
 
     std::string wrapXReadBlocks(const std::vector<std::string>& blocks);
 
@@ -115,6 +288,16 @@ private:
     ExecResult handleSET(const std::vector<std::string_view> &args);
     ExecResult handleGET(const std::vector<std::string_view> &args);
     ExecResult handleTYPE(const std::vector<std::string_view> &args);
+    ExecResult handleMGET(const std::vector<std::string_view> &args);
+    ExecResult handleMSET(const std::vector<std::string_view> &args);
+    ExecResult handleAPPEND(const std::vector<std::string_view> &args);
+    ExecResult handleSETRANGE(const std::vector<std::string_view> &args);
+    ExecResult handleGETRANGE(const std::vector<std::string_view> &args);
+    ExecResult handleSTRLEN(const std::vector<std::string_view> &args);
+    ExecResult handleGETDEL(const std::vector<std::string_view> &args);
+    ExecResult handleGETEX(const std::vector<std::string_view> &args);
+    ExecResult handleINCR(const std::vector<std::string_view> &args);
+    ExecResult handleINCRBYFLOAT(const std::vector<std::string_view> &args);
 
     // --------------------------------------------------------------------
     // List Handlers (Redis-style list operations)
@@ -124,35 +307,208 @@ private:
     ExecResult handleLRANGE(const std::vector<std::string_view> &args);
     ExecResult handleLLEN(const std::vector<std::string_view> &args);
     ExecResult handleLPOP(const std::vector<std::string_view> &args);
+    ExecResult handleRPOP(const std::vector<std::string_view> &args);
+    ExecResult handleLTRIM(const std::vector<std::string_view> &args);
+    ExecResult handleLINDEX(const std::vector<std::string_view> &args);
+    ExecResult handleLSET(const std::vector<std::string_view> &args);
+    ExecResult handleLINSERT(const std::vector<std::string_view> &args);
+    ExecResult handleLREM(const std::vector<std::string_view> &args);
+    ExecResult handleLMOVE(const std::vector<std::string_view> &args);
+    ExecResult handleRPOPLPUSH(const std::vector<std::string_view> &args);
+    ExecResult listMove(const std::string &src, const std::string &dst,
+                        bool from_head, bool to_head);
+
+    /**
+     * Pops from the list at `src` and pushes onto `dst` (created if
+     * missing; the caller made sure it is not another type). Empty
+     * lists are left for the caller to delete. Returns the element.
+     */
+    std::string moveElement(List &src, const std::string &dst_key,
+                            bool from_head, bool to_head);
+
+    // LPOP/RPOP [count]: one element, or an array of up to count.
+    ExecResult popFromList(const std::vector<std::string_view> &args, bool head);
+
+    // Redis never keeps empty lists around: the key goes with the last element.
+    void deleteIfEmpty(const std::string &key, const List &list);
 
     // --------------------------------------------------------------------
     // Stream Handlers (Redis-style stream operations)
     // --------------------------------------------------------------------
     ExecResult handleXADD(const std::vector<std::string_view> &args);
     ExecResult handleXRANGE(const std::vector<std::string_view> &args);
+    ExecResult handleXREVRANGE(const std::vector<std::string_view> &args);
+    ExecResult streamRange(const std::vector<std::string_view> &args, bool reverse);
+    ExecResult handleXAGG(const std::vector<std::string_view> &args);
     ExecResult handleXREAD(const std::vector<std::string_view> &args);
+    ExecResult handleXTRIM(const std::vector<std::string_view> &args);
+    ExecResult handleXDEL(const std::vector<std::string_view> &args);
+    ExecResult handleXLEN(const std::vector<std::string_view> &args);
+    ExecResult handleXSETID(const std::vector<std::string_view> &args);
+
+    // Consumer groups
+    ExecResult handleXGROUP(const std::vector<std::string_view> &args);
+    ExecResult handleXREADGROUP(const std::vector<std::string_view> &args);
+    ExecResult handleXACK(const std::vector<std::string_view> &args);
+    ExecResult handleXPENDING(const std::vector<std::string_view> &args);
+    ExecResult handleXCLAIM(const std::vector<std::string_view> &args);
+    ExecResult handleXAUTOCLAIM(const std::vector<std::string_view> &args);
+
+    std::vector<std::pair<StreamID, StreamFields>> deliverNewEntries(
+        const std::string &key, Stream &stream, const std::string &group_name,
+        StreamGroup &group, const std::string &consumer_name, size_t count, bool noack);
+
+    /** [id, [field, value, ...]], or [id, nil] for an entry no longer in the stream. */
+    void appendStreamEntry(std::string &out, const StreamID &id, const StreamFields *fields);
+
+    // --------------------------------------------------------------------
+    // Hash Handlers
+    // --------------------------------------------------------------------
+    ExecResult handleHSET(const std::vector<std::string_view> &args);
+    ExecResult handleHSETNX(const std::vector<std::string_view> &args);
+    ExecResult handleHGET(const std::vector<std::string_view> &args);
+    ExecResult handleHMGET(const std::vector<std::string_view> &args);
+    ExecResult handleHGETALL(const std::vector<std::string_view> &args);
+    ExecResult handleHDEL(const std::vector<std::string_view> &args);
+    ExecResult handleHLEN(const std::vector<std::string_view> &args);
+    ExecResult handleHEXISTS(const std::vector<std::string_view> &args);
+    ExecResult handleHINCRBY(const std::vector<std::string_view> &args);
+    ExecResult handleHINCRBYFLOAT(const std::vector<std::string_view> &args);
+    ExecResult handleHSCAN(const std::vector<std::string_view> &args);
+    ExecResult handleHEXPIRE(const std::vector<std::string_view> &args);
+    ExecResult handleHTTL(const std::vector<std::string_view> &args);
+    ExecResult handleHPERSIST(const std::vector<std::string_view> &args);
+
+    /**
+     * The hash at `key` with its expired fields removed, or nullptr if
+     * there is none (`wrong_type` tells a key of another type apart).
+     */
+    Hash *lookupHash(const std::string &key, bool &wrong_type);
+
+    // Like lists, hashes never stay around empty.
+    void deleteIfEmpty(const std::string &key, const Hash &hash);
+
+    // --------------------------------------------------------------------
+    // Set Handlers
+    // --------------------------------------------------------------------
+    ExecResult handleSADD(const std::vector<std::string_view> &args);
+    ExecResult handleSREM(const std::vector<std::string_view> &args);
+    ExecResult handleSISMEMBER(const std::vector<std::string_view> &args);
+    ExecResult handleSMISMEMBER(const std::vector<std::string_view> &args);
+    ExecResult handleSCARD(const std::vector<std::string_view> &args);
+    ExecResult handleSMEMBERS(const std::vector<std::string_view> &args);
+    ExecResult handleSINTER(const std::vector<std::string_view> &args);
+    ExecResult handleSINTERCARD(const std::vector<std::string_view> &args);
+    ExecResult handleSINTERSTORE(const std::vector<std::string_view> &args);
+
+    /** The set at `key`, or nullptr (`wrong_type` tells a key of another type apart). */
+    Set *lookupSet(const std::string &key, bool &wrong_type);
+
+    /** Sets at `keys` in order (nullptr when missing); false on a key of another type. */
+    bool lookupSets(const std::vector<std::string_view> &keys, std::vector<const Set *> &sets);
+
+    void deleteIfEmpty(const std::string &key, const Set &set);
+
+    // --------------------------------------------------------------------
+    // Sorted Set Handlers
+    // --------------------------------------------------------------------
+    ExecResult handleZADD(const std::vector<std::string_view> &args);
+    ExecResult handleZINCRBY(const std::vector<std::string_view> &args);
+    ExecResult handleZSCORE(const std::vector<std::string_view> &args);
+    ExecResult handleZCARD(const std::vector<std::string_view> &args);
+    ExecResult handleZREM(const std::vector<std::string_view> &args);
+    ExecResult handleZRANGE(const std::vector<std::string_view> &args);
+    ExecResult handleZRANK(const std::vector<std::string_view> &args);
+    ExecResult handleZCOUNT(const std::vector<std::string_view> &args);
+    ExecResult handleZPOPMIN(const std::vector<std::string_view> &args);
+    ExecResult handleBZPOPMIN(const std::vector<std::string_view> &args);
+    ExecResult handleZREMRANGEBYSCORE(const std::vector<std::string_view> &args);
+
+    /** The sorted set at `key`, or nullptr (`wrong_type` tells a key of another type apart). */
+    ZSet *lookupZSet(const std::string &key, bool &wrong_type);
+
+    void deleteIfEmpty(const std::string &key, const ZSet &zset);
+
+    /** [member, (score,) ...] for ranks [from, to), from the top when `reverse`. */
+    static void appendZRange(std::string &out, const ZSet &zset, size_t from, size_t to,
+                             bool reverse, bool with_scores);
+
+    // --------------------------------------------------------------------
+    // Persistence Handlers
+    // --------------------------------------------------------------------
+    ExecResult handleSAVE(const std::vector<std::string_view> &args);
+    ExecResult handleBGSAVE(const std::vector<std::string_view> &args);
+    ExecResult handleBGREWRITEAOF(const std::vector<std::string_view> &args);
+
+    // --------------------------------------------------------------------
+    // Replication Handlers
+    // --------------------------------------------------------------------
+    ExecResult handleREPLICAOF(const std::vector<std::string_view> &args);
+    ExecResult handlePSYNC(const std::vector<std::string_view> &args);
+    ExecResult handleREPLCONF(const std::vector<std::string_view> &args);
+    ExecResult handleWAIT(const std::vector<std::string_view> &args);
+    ExecResult handleINFO(const std::vector<std::string_view> &args);
+
+    // --------------------------------------------------------------------
+    // Cluster / Keyspace Handlers
+    // --------------------------------------------------------------------
+    ExecResult handleCLUSTER(const std::vector<std::string_view> &args);
+    ExecResult handleASKING(const std::vector<std::string_view> &args);
+    ExecResult handleMIGRATE(const std::vector<std::string_view> &args);
+    ExecResult handleDUMP(const std::vector<std::string_view> &args);
+    ExecResult handleRESTORE(const std::vector<std::string_view> &args);
+    ExecResult handleDEL(const std::vector<std::string_view> &args);
 
     /**
-     * Blocking pop operation (BLPOP).
+     * Blocking pops (BLPOP / BRPOP key [key ...] timeout).
      *
      * Behavior:
-     *   • If the list is non-empty → pop immediately and return value.
-     *   • If the list is empty     → register the client as blocked.
-     *     (No response is sent; wake-up happens on future RPUSH/LPUSH)
+     *   • The first non-empty list among the keys → pop immediately.
+     *   • All empty → register the client as blocked on every key.
+     *     (No response is sent; wake-up happens after a later push)
      */
     ExecResult handleBLPOP(const std::vector<std::string_view> &args);
+    ExecResult handleBRPOP(const std::vector<std::string_view> &args);
+    ExecResult blockingPop(const std::vector<std::string_view> &args, bool head);
 
     /**
-     * Attempts to wake clients blocked on BLPOP.
-     * Called automatically after RPUSH/LPUSH.
-     * Pops one element per blocked client and sends a RESP array response.
-     *
-     * @param list_name Name of the list for which new elements were inserted.
+     * Blocking moves: BLMOVE src dst LEFT|RIGHT LEFT|RIGHT timeout and
+     * BRPOPLPUSH src dst timeout. The wake-up performs the whole move
+     * before replying, so the element is never in flight.
      */
-    void maybeWakeBlockedClients(const std::string &list_name);
-    void wakeBlockedXReadClients(
-    const std::string& stream_name,
-    const std::string& new_id);
+    ExecResult handleBLMOVE(const std::vector<std::string_view> &args);
+    ExecResult handleBRPOPLPUSH(const std::vector<std::string_view> &args);
+    ExecResult blockingMove(const std::vector<std::string_view> &args,
+                            bool from_head, bool to_head);
+
+    /** Parks the running client on `keys` (deduplicated) until woken. */
+    ExecResult blockClient(BlockedClient bc,
+                           std::vector<std::string_view>::const_iterator first,
+                           std::vector<std::string_view>::const_iterator last);
+
+    /** Marks `key` as having new elements if anyone is blocked on it. */
+    void signalKeyAsReady(const std::string &key);
+
+    /**
+     * Serves blocked clients for every signalled key, FIFO per key.
+     * Called by execute() after each command.
+     */
+    void handleClientsBlockedOnKeys();
+
+    /** First list (or sorted set) waiter on `key` in FIFO order, or -1. */
+    int nextWaiter(const std::string &key, bool zset) const;
+
+    /** Removes `fd` from every wait queue and from the timeout index. */
+    void unblockClient(int fd);
+
+    void sendToClient(int fd, std::string_view data);
+
+    /** Queues `bc` under each of its keys; the reply comes later. */
+    ExecResult blockOnStreams(BlockedXReadClient bc);
+
+    /** Serves the XREAD / XREADGROUP waiters of a stream that grew. */
+    void serveClientsBlockedOnStream(const std::string &key, Stream &stream);
 
-    void cleanup_empty_lists();
+    /** Serves the BZPOPMIN / BZPOPMAX waiters of a sorted set that grew. */
+    void serveClientsBlockedOnZSet(const std::string &key, ZSet &zset);
 };
@@ -0,0 +1,522 @@
+#include "CommandHandler.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../cluster/ClusterManager.hpp"
+#include "../persistence/AppendOnlyFile.hpp"
+#include "../persistence/Snapshot.hpp"
+#include "../utils/StringUtils.hpp"
+
+namespace {
+
+const char* kClusterDisabled = "-ERR This instance has cluster support disabled\r\n";
+
+bool parseSlot(std::string_view s, int& slot) {
+    long long v;
+    if (!parseLongLong(s, v) || v < 0 || v >= CLUSTER_SLOTS)
+        return false;
+    slot = static_cast<int>(v);
+    return true;
+}
+
+/*
+ * Blocking helpers for MIGRATE. Like Redis, MIGRATE holds the event loop
+ * for the duration of one batch; every step is bounded by `timeout_ms`.
+ */
+int connectWithTimeout(const std::string& host, const std::string& port,
+                       int timeout_ms) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* res = nullptr;
+    if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0 || !res)
+        return -1;
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        ::freeaddrinfo(res);
+        return -1;
+    }
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    int rc = ::connect(fd, res->ai_addr, res->ai_addrlen);
+    ::freeaddrinfo(res);
+
+    if (rc != 0) {
+        pollfd p{fd, POLLOUT, 0};
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (errno != EINPROGRESS || ::poll(&p, 1, timeout_ms) != 1 ||
+            ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+            ::close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+bool sendAll(int fd, const std::string& data, int timeout_ms) {
+    size_t off = 0;
+    while (off < data.size()) {
+        ssize_t n = ::send(fd, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+        if (n > 0) {
+            off += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        pollfd p{fd, POLLOUT, 0};
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) &&
+            ::poll(&p, 1, timeout_ms) == 1)
+            continue;
+        return false;
+    }
+    return true;
+}
+
+// Reads one "\r\n"-terminated reply line (RESTORE answers +OK or -ERR).
+bool readLine(int fd, std::string& buf, std::string& line, int timeout_ms) {
+    while (true) {
+        size_t eol = buf.find("\r\n");
+        if (eol != std::string::npos) {
+            line = buf.substr(0, eol);
+            buf.erase(0, eol + 2);
+            return true;
+        }
+
+        pollfd p{fd, POLLIN, 0};
+        if (::poll(&p, 1, timeout_ms) != 1)
+            return false;
+
+        char chunk[4096];
+        ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n <= 0)
+            return false;
+        buf.append(chunk, static_cast<size_t>(n));
+    }
+}
+
+} // namespace
+
+/**
+ * ----------------------------------------------------
+ * handleCLUSTER
+ * ----------------------------------------------------
+ * RESP command: CLUSTER <subcommand> [args...]
+ *
+ *   MYID | INFO | NODES | SLOTS | SHARDS
+ *   MEET ip port
+ *   ADDSLOTS slot... | ADDSLOTSRANGE start end ... | DELSLOTS slot...
+ *   SETSLOT slot IMPORTING|MIGRATING|NODE node-id | SETSLOT slot STABLE
+ *   KEYSLOT key | COUNTKEYSINSLOT slot | GETKEYSINSLOT slot count
+ *   PING ... (cluster bus, answered with PONG)
+ */
+ExecResult CommandHandler::handleCLUSTER(const std::vector<std::string_view>& args) {
+    if (!cluster || !cluster->enabled())
+        return ExecResult(kClusterDisabled, false, client_fd);
+
+    if (args.size() < 2)
+        return ExecResult("-ERR wrong number of arguments for 'CLUSTER'\r\n",
+                          false, client_fd);
+
+    std::string_view sub = args[1];
+    std::string err;
+    auto fail = [&](const std::string& msg) {
+        return ExecResult("-ERR " + msg + "\r\n", false, client_fd);
+    };
+
+    if (equalsIgnoreCase(sub, "PING")) {
+        cluster->processBusMessage(args);
+        std::string pong;
+        AppendOnlyFile::encodeCommand(pong, cluster->busMessage("PONG"));
+        return ExecResult(std::move(pong), false, client_fd);
+    }
+
+    if (equalsIgnoreCase(sub, "MYID"))
+        return ExecResult(respBulk(cluster->myself().id), false, client_fd);
+
+    if (equalsIgnoreCase(sub, "INFO"))
+        return ExecResult(respBulk(cluster->info()), false, client_fd);
+
+    if (equalsIgnoreCase(sub, "NODES"))
+        return ExecResult(respBulk(cluster->nodesDescription()), false, client_fd);
+
+    if (equalsIgnoreCase(sub, "MEET")) {
+        long long port;
+        if (args.size() != 4 || !parseLongLong(args[3], port))
+            return fail("Invalid node address specified");
+        if (!cluster->meet(std::string(args[2]), static_cast<int>(port), err))
+            return fail(err);
+        return ExecResult(simpleString("OK"), false, client_fd);
+    }
+
+    if (equalsIgnoreCase(sub, "ADDSLOTS") || equalsIgnoreCase(sub, "DELSLOTS") ||
+        equalsIgnoreCase(sub, "ADDSLOTSRANGE")) {
+        bool range = equalsIgnoreCase(sub, "ADDSLOTSRANGE");
+        if (args.size() < 3 || (range && args.size() % 2 != 0))
+            return fail("wrong number of arguments for 'CLUSTER " +
+                        std::string(sub) + "'");
+
+        std::vector<int> slots;
+        for (size_t i = 2; i < args.size(); i += range ? 2 : 1) {
+            int start, end;
+            if (!parseSlot(args[i], start) ||
+                (range && !parseSlot(args[i + 1], end)))
+                return fail("Invalid or out of range slot");
+            if (!range)
+                end = start;
+            if (start > end)
+                return fail("start slot number " + std::to_string(start) +
+                            " is greater than end slot number " + std::to_string(end));
+            for (int s = start; s <= end; ++s)
+                slots.push_back(s);
+        }
+
+        bool ok = equalsIgnoreCase(sub, "DELSLOTS") ? cluster->delSlots(slots, err)
+                                                    : cluster->addSlots(slots, err);
+        if (!ok)
+            return fail(err);
+        return ExecResult(simpleString("OK"), false, client_fd);
+    }
+
+    if (equalsIgnoreCase(sub, "SETSLOT")) {
+        int slot;
+        if (args.size() < 4 || !parseSlot(args[2], slot))
+            return fail("Invalid or out of range slot");
+
+        bool stable = equalsIgnoreCase(args[3], "STABLE");
+        if ((stable && args.size() != 4) || (!stable && args.size() != 5))
+            return fail("Invalid CLUSTER SETSLOT action or number of arguments");
+
+        if (!cluster->setSlot(slot, args[3], stable ? "" : args[4], err))
+            return fail(err);
+        return ExecResult(simpleString("OK"), false, client_fd);
+    }
+
+    if (equalsIgnoreCase(sub, "KEYSLOT")) {
+        if (args.size() != 3)
+            return fail("wrong number of arguments for 'CLUSTER KEYSLOT'");
+        return ExecResult(respInteger(keyHashSlot(args[2])), false, client_fd);
+    }
+
+    if (equalsIgnoreCase(sub, "COUNTKEYSINSLOT")) {
+        int slot;
+        if (args.size() != 3 || !parseSlot(args[2], slot))
+            return fail("Invalid slot");
+        return ExecResult(respInteger(static_cast<long long>(store.countKeysInSlot(slot))),
+                          false, client_fd);
+    }
+
+    if (equalsIgnoreCase(sub, "GETKEYSINSLOT")) {
+        int slot;
+        long long count;
+        if (args.size() != 4 || !parseSlot(args[2], slot))
+            return fail("Invalid slot");
+        if (!parseLongLong(args[3], count) || count < 0)
+            return fail("Invalid number of keys");
+        return ExecResult(respArray(store.getKeysInSlot(slot, static_cast<size_t>(count))),
+                          false, client_fd);
+    }
+
+    if (equalsIgnoreCase(sub, "SLOTS")) {
+        auto ranges = cluster->slotRanges();
+        std::string out = "*" + std::to_string(ranges.size()) + "\r\n";
+        for (const auto& r : ranges) {
+            out += "*3\r\n";
+            out += respInteger(r.start);
+            out += respInteger(r.end);
+            out += "*3\r\n";
+            out += respBulk(r.node->ip);
+            out += respInteger(r.node->port);
+            out += respBulk(r.node->id);
+        }
+        return ExecResult(std::move(out), false, client_fd);
+    }
+
+    if (equalsIgnoreCase(sub, "SHARDS")) {
+        auto ranges = cluster->slotRanges();
+        auto nodes = cluster->nodeList();
+
+        std::string out = "*" + std::to_string(nodes.size()) + "\r\n";
+        for (const ClusterNode* node : nodes) {
+            size_t owned = 0;
+            for (const auto& r : ranges)
+                owned += r.node == node;
+
+            out += "*4\r\n";
+            out += respBulk("slots");
+            out += "*" + std::to_string(owned * 2) + "\r\n";
+            for (const auto& r : ranges) {
+                if (r.node != node)
+                    continue;
+                out += respInteger(r.start);
+                out += respInteger(r.end);
+            }
+
+            out += respBulk("nodes");
+            out += "*1\r\n*12\r\n";
+            out += respBulk("id") + respBulk(node->id);
+            out += respBulk("port") + respInteger(node->port);
+            out += respBulk("ip") + respBulk(node->ip);
+            out += respBulk("endpoint") + respBulk(node->ip);
+            out += respBulk("role") + respBulk("master");
+            out += respBulk("health") +
+                   respBulk(cluster->nodeReachable(*node) ? "online" : "fail");
+        }
+        return ExecResult(std::move(out), false, client_fd);
+    }
+
+    return fail("unknown subcommand '" + std::string(sub) + "'");
+}
+
+/**
+ * ----------------------------------------------------
+ * handleASKING
+ * ----------------------------------------------------
+ * RESP command: ASKING
+ *
+ * Behavior:
+ *   The next command of this client may touch a slot this
+ *   node is importing (after an -ASK redirection).
+ */
+ExecResult CommandHandler::handleASKING(const std::vector<std::string_view>& args) {
+    if (args.size() != 1)
+        return ExecResult("-ERR wrong number of arguments for 'ASKING'\r\n",
+                          false, client_fd);
+
+    if (!cluster || !cluster->enabled())
+        return ExecResult(kClusterDisabled, false, client_fd);
+
+    cluster->setAsking(client_fd);
+    return ExecResult(simpleString("OK"), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleMIGRATE
+ * ----------------------------------------------------
+ * RESP command: MIGRATE host port key|"" 0 timeout
+ *                       [COPY] [REPLACE] [KEYS key...]
+ *
+ * Behavior:
+ *   Ships a batch of keys to another node with pipelined
+ *   RESTORE(-ASKING) commands and deletes every key the
+ *   target accepted (unless COPY). Blocks for at most
+ *   `timeout` ms per network step. Logged as DEL.
+ */
+ExecResult CommandHandler::handleMIGRATE(const std::vector<std::string_view>& args) {
+    if (args.size() < 6)
+        return ExecResult("-ERR wrong number of arguments for 'MIGRATE'\r\n",
+                          false, client_fd);
+
+    long long db, timeout;
+    if (!parseLongLong(args[4], db) || !parseLongLong(args[5], timeout))
+        return ExecResult("-ERR value is not an integer or out of range\r\n",
+                          false, client_fd);
+    if (db != 0)
+        return ExecResult("-ERR Target database must be 0\r\n", false, client_fd);
+    if (timeout <= 0)
+        timeout = 1000;
+
+    bool copy = false, replace = false;
+    for (size_t i = 6; i < args.size(); ++i) {
+        if (equalsIgnoreCase(args[i], "COPY")) {
+            copy = true;
+        } else if (equalsIgnoreCase(args[i], "REPLACE")) {
+            replace = true;
+        } else if (equalsIgnoreCase(args[i], "KEYS")) {
+            if (!args[3].empty())
+                return ExecResult("-ERR When using MIGRATE KEYS option, the key "
+                                  "argument must be set to the empty string\r\n",
+                                  false, client_fd);
+            break;
+        } else {
+            return ExecResult("-ERR syntax error\r\n", false, client_fd);
+        }
+    }
+
+    // Only keys that still exist travel
+    std::vector<std::string> keys;
+    std::string pipeline;
+    const char* restore_cmd =
+        (cluster && cluster->enabled()) ? "RESTORE-ASKING" : "RESTORE";
+
+    for (std::string_view k : migrateKeys(args)) {
+        std::string key(k);
+        RedisObj* obj = store.getObject(key);
+        if (!obj)
+            continue;
+
+        uint64_t expire_at = store.getExpireUnixMs(key);
+        std::vector<std::string> cmd = {restore_cmd, key,
+                                        std::to_string(expire_at),
+                                        Snapshot::dump(*obj), "ABSTTL"};
+        if (replace)
+            cmd.push_back("REPLACE");
+        AppendOnlyFile::encodeCommand(pipeline, cmd);
+        keys.push_back(std::move(key));
+    }
+
+    suppressPropagation = true;
+    if (keys.empty())
+        return ExecResult(simpleString("NOKEY"), false, client_fd);
+
+    int to = static_cast<int>(timeout);
+    int fd = connectWithTimeout(std::string(args[1]), std::string(args[2]), to);
+    if (fd < 0)
+        return ExecResult("-IOERR error or timeout connecting to the client\r\n",
+                          false, client_fd);
+
+    if (!sendAll(fd, pipeline, to)) {
+        ::close(fd);
+        return ExecResult("-IOERR error or timeout writing to target instance\r\n",
+                          false, client_fd);
+    }
+
+    std::string buf, line, error;
+    std::vector<std::string> moved;
+    for (const auto& key : keys) {
+        if (!readLine(fd, buf, line, to)) {
+            error = "-IOERR error or timeout reading to target instance\r\n";
+            break;
+        }
+        if (!line.empty() && line[0] == '-') {
+            if (error.empty())
+                error = "-ERR Target instance replied with error: " + line.substr(1) + "\r\n";
+        } else {
+            moved.push_back(key);
+        }
+    }
+    ::close(fd);
+
+    if (!copy && !moved.empty()) {
+        std::vector<std::string> del = {"DEL"};
+        for (const auto& key : moved) {
+            store.del(key);
+            del.push_back(key);
+        }
+        alsoPropagate(std::move(del));
+    }
+
+    if (!error.empty())
+        return ExecResult(std::move(error), false, client_fd);
+    return ExecResult(simpleString("OK"), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleDUMP
+ * ----------------------------------------------------
+ * RESP command: DUMP key
+ *
+ * Behavior:
+ *   Serialized value (type, payload, version, checksum)
+ *   as a bulk string, or null if the key is missing.
+ */
+ExecResult CommandHandler::handleDUMP(const std::vector<std::string_view>& args) {
+    if (args.size() != 2)
+        return ExecResult("-ERR wrong number of arguments for 'DUMP'\r\n",
+                          false, client_fd);
+
+    RedisObj* obj = store.getObject(std::string(args[1]));
+    if (!obj)
+        return ExecResult(nullBulk(), false, client_fd);
+
+    return ExecResult(respBulk(Snapshot::dump(*obj)), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleRESTORE
+ * ----------------------------------------------------
+ * RESP command: RESTORE key ttl payload [REPLACE] [ABSTTL]
+ *               RESTORE-ASKING (same, used by MIGRATE)
+ *
+ * Behavior:
+ *   Recreates a key from a DUMP payload. ttl is relative
+ *   ms (0 = none) or a Unix ms timestamp with ABSTTL.
+ *   Logged with an absolute TTL.
+ */
+ExecResult CommandHandler::handleRESTORE(const std::vector<std::string_view>& args) {
+    if (args.size() < 4)
+        return ExecResult("-ERR wrong number of arguments for 'RESTORE'\r\n",
+                          false, client_fd);
+
+    bool replace = false, absttl = false;
+    for (size_t i = 4; i < args.size(); ++i) {
+        if (equalsIgnoreCase(args[i], "REPLACE"))
+            replace = true;
+        else if (equalsIgnoreCase(args[i], "ABSTTL"))
+            absttl = true;
+        else
+            return ExecResult("-ERR syntax error\r\n", false, client_fd);
+    }
+
+    long long ttl;
+    if (!parseLongLong(args[2], ttl) || ttl < 0)
+        return ExecResult("-ERR Invalid TTL value, must be >= 0\r\n", false, client_fd);
+
+    std::string key(args[1]);
+    if (!replace && store.getObject(key))
+        return ExecResult("-BUSYKEY Target key name already exists.\r\n",
+                          false, client_fd);
+
+    RedisObj obj;
+    if (!Snapshot::restore(args[3], obj))
+        return ExecResult("-ERR DUMP payload version or checksum are wrong\r\n",
+                          false, client_fd);
+
+    uint64_t expire_at = 0;
+    if (ttl > 0)
+        expire_at = absttl ? static_cast<uint64_t>(ttl)
+                           : static_cast<uint64_t>(getUnixTimeMs() + ttl);
+
+    // Types a blocking command can wait for (BLPOP, BZPOPMIN, XREAD)
+    bool wakes_waiters = obj.type == RedisType::LIST || obj.type == RedisType::ZSET ||
+                         obj.type == RedisType::STREAM;
+    store.setObject(key, std::move(obj));
+    if (expire_at)
+        store.setExpireUnixMs(key, expire_at);
+
+    rewriteArgv({"RESTORE", key, std::to_string(expire_at), std::string(args[3]),
+                 "REPLACE", "ABSTTL"});
+
+    if (wakes_waiters)
+        signalKeyAsReady(key);
+
+    return ExecResult(simpleString("OK"), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleDEL
+ * ----------------------------------------------------
+ * RESP command: DEL key [key ...]
+ *
+ * Behavior:
+ *   Removes keys of any type. Returns how many existed.
+ */
+ExecResult CommandHandler::handleDEL(const std::vector<std::string_view>& args) {
+    if (args.size() < 2)
+        return ExecResult("-ERR wrong number of arguments for 'DEL'\r\n",
+                          false, client_fd);
+
+    long long removed = 0;
+    for (size_t i = 1; i < args.size(); ++i) {
+        std::string key(args[i]);
+        if (store.getObject(key) && store.del(key))
+            ++removed;
+    }
+
+    if (removed == 0)
+        suppressPropagation = true;
+
+    return ExecResult(respInteger(removed), false, client_fd);
+}
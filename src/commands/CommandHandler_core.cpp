@@ -1,10 +1,47 @@
 #include "CommandHandler.hpp"
+#include "../persistence/AppendOnlyFile.hpp"
+#include "../cluster/ClusterManager.hpp"
+#include "../replication/ReplicationManager.hpp"
+#include "../utils/StringUtils.hpp"
 
 #include <algorithm>
 #include <cctype>
+#include <charconv>
 #include <stdexcept>
 #include <unistd.h>
 
+namespace {
+
+/*
+ * Replies for the integers 0 .. kSharedIntegers - 1, encoded once. Counts,
+ * flags and most counters fall in this range, so their replies are copied
+ * rather than formatted (Redis keeps shared integer objects for the same
+ * reason; here the value itself is never allocated, only its reply).
+ */
+constexpr long long kSharedIntegers = 10000;
+
+struct SharedIntegers {
+    std::vector<std::string> integer;   // :n\r\n
+    std::vector<std::string> bulk;      // $len\r\nn\r\n
+
+    SharedIntegers() {
+        integer.reserve(kSharedIntegers);
+        bulk.reserve(kSharedIntegers);
+        for (long long n = 0; n < kSharedIntegers; ++n) {
+            std::string text = std::to_string(n);
+            integer.push_back(":" + text + "\r\n");
+            bulk.push_back("$" + std::to_string(text.size()) + "\r\n" + text + "\r\n");
+        }
+    }
+};
+
+const SharedIntegers& sharedIntegers() {
+    static const SharedIntegers shared;
+    return shared;
+}
+
+} // namespace
+
 /**
  * ----------------------------------------------------
  * Constructor
@@ -22,26 +59,139 @@ CommandHandler::CommandHandler(RedisStore& str)
     : client_fd(-1),
       store(str)
 {
+    // name → {handler, flags, firstKey, lastKey, keyStep[, keysFn]}
     commandMap = {
-        {"PING",  &CommandHandler::handlePING},
-        {"ECHO",  &CommandHandler::handleECHO},
-        {"SET",   &CommandHandler::handleSET},
-        {"GET",   &CommandHandler::handleGET},
-        {"RPUSH", &CommandHandler::handleRPUSH},
-        {"LPUSH", &CommandHandler::handleLPUSH},
-        {"LRANGE",&CommandHandler::handleLRANGE},
-        {"LLEN",  &CommandHandler::handleLLEN},
-        {"LPOP",  &CommandHandler::handleLPOP},
-        {"BLPOP", &CommandHandler::handleBLPOP},
-        {"TYPE", &CommandHandler::handleTYPE},
-        {"XADD", &CommandHandler::handleXADD},
-        {"XRANGE", &CommandHandler::handleXRANGE},
-        {"XREAD", &CommandHandler::handleXREAD}
+        {"PING",   {&CommandHandler::handlePING,   CMD_LOADING}},
+        {"ECHO",   {&CommandHandler::handleECHO,   CMD_LOADING}},
+        {"SET",    {&CommandHandler::handleSET,    CMD_WRITE, 1, 1, 1}},
+        {"GET",    {&CommandHandler::handleGET,    0,         1, 1, 1}},
+        {"MGET",   {&CommandHandler::handleMGET,   0,         1, -1, 1}},
+        {"MSET",   {&CommandHandler::handleMSET,   CMD_WRITE, 1, -1, 2}},
+        {"MSETNX", {&CommandHandler::handleMSET,   CMD_WRITE, 1, -1, 2}},
+        {"APPEND",   {&CommandHandler::handleAPPEND,   CMD_WRITE, 1, 1, 1}},
+        {"SETRANGE", {&CommandHandler::handleSETRANGE, CMD_WRITE, 1, 1, 1}},
+        {"GETRANGE", {&CommandHandler::handleGETRANGE, 0,         1, 1, 1}},
+        {"STRLEN",   {&CommandHandler::handleSTRLEN,   0,         1, 1, 1}},
+        {"GETDEL",   {&CommandHandler::handleGETDEL,   CMD_WRITE, 1, 1, 1}},
+        {"GETEX",    {&CommandHandler::handleGETEX,    CMD_WRITE, 1, 1, 1}},
+        {"INCR",   {&CommandHandler::handleINCR,   CMD_WRITE, 1, 1, 1}},
+        {"DECR",   {&CommandHandler::handleINCR,   CMD_WRITE, 1, 1, 1}},
+        {"INCRBY", {&CommandHandler::handleINCR,   CMD_WRITE, 1, 1, 1}},
+        {"DECRBY", {&CommandHandler::handleINCR,   CMD_WRITE, 1, 1, 1}},
+        {"INCRBYFLOAT", {&CommandHandler::handleINCRBYFLOAT, CMD_WRITE, 1, 1, 1}},
+        {"DEL",    {&CommandHandler::handleDEL,    CMD_WRITE, 1, -1, 1}},
+        {"RPUSH",  {&CommandHandler::handleRPUSH,  CMD_WRITE, 1, 1, 1}},
+        {"LPUSH",  {&CommandHandler::handleLPUSH,  CMD_WRITE, 1, 1, 1}},
+        {"LRANGE", {&CommandHandler::handleLRANGE, 0,         1, 1, 1}},
+        {"LLEN",   {&CommandHandler::handleLLEN,   0,         1, 1, 1}},
+        {"LPOP",   {&CommandHandler::handleLPOP,   CMD_WRITE, 1, 1, 1}},
+        {"RPOP",   {&CommandHandler::handleRPOP,   CMD_WRITE, 1, 1, 1}},
+        {"LTRIM",  {&CommandHandler::handleLTRIM,  CMD_WRITE, 1, 1, 1}},
+        {"LINDEX", {&CommandHandler::handleLINDEX, 0,         1, 1, 1}},
+        {"LSET",   {&CommandHandler::handleLSET,   CMD_WRITE, 1, 1, 1}},
+        {"LINSERT", {&CommandHandler::handleLINSERT, CMD_WRITE, 1, 1, 1}},
+        {"LREM",   {&CommandHandler::handleLREM,   CMD_WRITE, 1, 1, 1}},
+        {"BLPOP",  {&CommandHandler::handleBLPOP,  CMD_WRITE, 1, -2, 1}},
+        {"BRPOP",  {&CommandHandler::handleBRPOP,  CMD_WRITE, 1, -2, 1}},
+        {"LMOVE",      {&CommandHandler::handleLMOVE,      CMD_WRITE, 1, 2, 1}},
+        {"RPOPLPUSH",  {&CommandHandler::handleRPOPLPUSH,  CMD_WRITE, 1, 2, 1}},
+        {"BLMOVE",     {&CommandHandler::handleBLMOVE,     CMD_WRITE, 1, 2, 1}},
+        {"BRPOPLPUSH", {&CommandHandler::handleBRPOPLPUSH, CMD_WRITE, 1, 2, 1}},
+        {"TYPE",   {&CommandHandler::handleTYPE,   0,         1, 1, 1}},
+        {"XADD",   {&CommandHandler::handleXADD,   CMD_WRITE, 1, 1, 1}},
+        {"XRANGE", {&CommandHandler::handleXRANGE, 0,         1, 1, 1}},
+        {"XREVRANGE",  {&CommandHandler::handleXREVRANGE,  0,         1, 1, 1}},
+        {"XAGG",       {&CommandHandler::handleXAGG,       0,         1, 1, 1}},
+        {"XREAD",  {&CommandHandler::handleXREAD,  0,         0, 0, 0, &CommandHandler::xreadKeys}},
+        {"XTRIM",  {&CommandHandler::handleXTRIM,  CMD_WRITE, 1, 1, 1}},
+        {"XDEL",   {&CommandHandler::handleXDEL,   CMD_WRITE, 1, 1, 1}},
+        {"XLEN",   {&CommandHandler::handleXLEN,   0,         1, 1, 1}},
+        {"XSETID", {&CommandHandler::handleXSETID, CMD_WRITE, 1, 1, 1}},
+        {"XGROUP",     {&CommandHandler::handleXGROUP,     CMD_WRITE, 2, 2, 1}},
+        {"XREADGROUP", {&CommandHandler::handleXREADGROUP, CMD_WRITE, 0, 0, 0, &CommandHandler::xreadKeys}},
+        {"XACK",       {&CommandHandler::handleXACK,       CMD_WRITE, 1, 1, 1}},
+        {"XPENDING",   {&CommandHandler::handleXPENDING,   0,         1, 1, 1}},
+        {"XCLAIM",     {&CommandHandler::handleXCLAIM,     CMD_WRITE, 1, 1, 1}},
+        {"XAUTOCLAIM", {&CommandHandler::handleXAUTOCLAIM, CMD_WRITE, 1, 1, 1}},
+        {"HSET",         {&CommandHandler::handleHSET,         CMD_WRITE, 1, 1, 1}},
+        {"HMSET",        {&CommandHandler::handleHSET,         CMD_WRITE, 1, 1, 1}},
+        {"HSETNX",       {&CommandHandler::handleHSETNX,       CMD_WRITE, 1, 1, 1}},
+        {"HGET",         {&CommandHandler::handleHGET,         0,         1, 1, 1}},
+        {"HMGET",        {&CommandHandler::handleHMGET,        0,         1, 1, 1}},
+        {"HGETALL",      {&CommandHandler::handleHGETALL,      0,         1, 1, 1}},
+        {"HKEYS",        {&CommandHandler::handleHGETALL,      0,         1, 1, 1}},
+        {"HVALS",        {&CommandHandler::handleHGETALL,      0,         1, 1, 1}},
+        {"HDEL",         {&CommandHandler::handleHDEL,         CMD_WRITE, 1, 1, 1}},
+        {"HLEN",         {&CommandHandler::handleHLEN,         0,         1, 1, 1}},
+        {"HEXISTS",      {&CommandHandler::handleHEXISTS,      0,         1, 1, 1}},
+        {"HSTRLEN",      {&CommandHandler::handleHEXISTS,      0,         1, 1, 1}},
+        {"HINCRBY",      {&CommandHandler::handleHINCRBY,      CMD_WRITE, 1, 1, 1}},
+        {"HINCRBYFLOAT", {&CommandHandler::handleHINCRBYFLOAT, CMD_WRITE, 1, 1, 1}},
+        {"HSCAN",        {&CommandHandler::handleHSCAN,        0,         1, 1, 1}},
+        {"HEXPIRE",      {&CommandHandler::handleHEXPIRE,      CMD_WRITE, 1, 1, 1}},
+        {"HPEXPIRE",     {&CommandHandler::handleHEXPIRE,      CMD_WRITE, 1, 1, 1}},
+        {"HEXPIREAT",    {&CommandHandler::handleHEXPIRE,      CMD_WRITE, 1, 1, 1}},
+        {"HPEXPIREAT",   {&CommandHandler::handleHEXPIRE,      CMD_WRITE, 1, 1, 1}},
+        {"HTTL",         {&CommandHandler::handleHTTL,         0,         1, 1, 1}},
+        {"HPTTL",        {&CommandHandler::handleHTTL,         0,         1, 1, 1}},
+        {"HEXPIRETIME",  {&CommandHandler::handleHTTL,         0,         1, 1, 1}},
+        {"HPEXPIRETIME", {&CommandHandler::handleHTTL,         0,         1, 1, 1}},
+        {"HPERSIST",     {&CommandHandler::handleHPERSIST,     CMD_WRITE, 1, 1, 1}},
+        {"SADD",         {&CommandHandler::handleSADD,         CMD_WRITE, 1, 1, 1}},
+        {"SREM",         {&CommandHandler::handleSREM,         CMD_WRITE, 1, 1, 1}},
+        {"SISMEMBER",    {&CommandHandler::handleSISMEMBER,    0,         1, 1, 1}},
+        {"SMISMEMBER",   {&CommandHandler::handleSMISMEMBER,   0,         1, 1, 1}},
+        {"SCARD",        {&CommandHandler::handleSCARD,        0,         1, 1, 1}},
+        {"SMEMBERS",     {&CommandHandler::handleSMEMBERS,     0,         1, 1, 1}},
+        {"SINTER",       {&CommandHandler::handleSINTER,       0,         1, -1, 1}},
+        {"SUNION",       {&CommandHandler::handleSINTER,       0,         1, -1, 1}},
+        {"SDIFF",        {&CommandHandler::handleSINTER,       0,         1, -1, 1}},
+        {"SINTERCARD",   {&CommandHandler::handleSINTERCARD,   0,         0, 0, 0, &CommandHandler::numkeysKeys}},
+        {"SINTERSTORE",  {&CommandHandler::handleSINTERSTORE,  CMD_WRITE, 1, -1, 1}},
+        {"SUNIONSTORE",  {&CommandHandler::handleSINTERSTORE,  CMD_WRITE, 1, -1, 1}},
+        {"SDIFFSTORE",   {&CommandHandler::handleSINTERSTORE,  CMD_WRITE, 1, -1, 1}},
+        {"ZADD",         {&CommandHandler::handleZADD,         CMD_WRITE, 1, 1, 1}},
+        {"ZINCRBY",      {&CommandHandler::handleZINCRBY,      CMD_WRITE, 1, 1, 1}},
+        {"ZSCORE",       {&CommandHandler::handleZSCORE,       0,         1, 1, 1}},
+        {"ZCARD",        {&CommandHandler::handleZCARD,        0,         1, 1, 1}},
+        {"ZREM",         {&CommandHandler::handleZREM,         CMD_WRITE, 1, 1, 1}},
+        {"ZRANGE",       {&CommandHandler::handleZRANGE,       0,         1, 1, 1}},
+        {"ZRANK",        {&CommandHandler::handleZRANK,        0,         1, 1, 1}},
+        {"ZREVRANK",     {&CommandHandler::handleZRANK,        0,         1, 1, 1}},
+        {"ZCOUNT",       {&CommandHandler::handleZCOUNT,       0,         1, 1, 1}},
+        {"ZPOPMIN",      {&CommandHandler::handleZPOPMIN,      CMD_WRITE, 1, 1, 1}},
+        {"ZPOPMAX",      {&CommandHandler::handleZPOPMIN,      CMD_WRITE, 1, 1, 1}},
+        {"BZPOPMIN",     {&CommandHandler::handleBZPOPMIN,     CMD_WRITE, 1, -2, 1}},
+        {"BZPOPMAX",     {&CommandHandler::handleBZPOPMIN,     CMD_WRITE, 1, -2, 1}},
+        {"ZREMRANGEBYSCORE", {&CommandHandler::handleZREMRANGEBYSCORE, CMD_WRITE, 1, 1, 1}},
+        {"SAVE",   {&CommandHandler::handleSAVE,   0}},
+        {"BGSAVE", {&CommandHandler::handleBGSAVE, 0}},
+        {"BGREWRITEAOF", {&CommandHandler::handleBGREWRITEAOF, 0}},
+        {"REPLICAOF", {&CommandHandler::handleREPLICAOF, 0}},
+        {"SLAVEOF",  {&CommandHandler::handleREPLICAOF, 0}},
+        {"PSYNC",    {&CommandHandler::handlePSYNC,    0}},
+        {"REPLCONF", {&CommandHandler::handleREPLCONF, CMD_LOADING}},
+        {"WAIT",     {&CommandHandler::handleWAIT,     0}},
+        {"INFO",     {&CommandHandler::handleINFO,     CMD_LOADING}},
+        {"CLUSTER",  {&CommandHandler::handleCLUSTER,  CMD_LOADING}},
+        {"ASKING",   {&CommandHandler::handleASKING,   0}},
+        {"MIGRATE",  {&CommandHandler::handleMIGRATE,  CMD_WRITE, 0, 0, 0, &CommandHandler::migrateKeys}},
+        {"DUMP",     {&CommandHandler::handleDUMP,     0,         1, 1, 1}},
+        {"RESTORE",  {&CommandHandler::handleRESTORE,  CMD_WRITE, 1, 1, 1}},
+        {"RESTORE-ASKING", {&CommandHandler::handleRESTORE, CMD_WRITE | CMD_ASKING, 1, 1, 1}}
     };
     
 }
 
 
+void CommandHandler::setConfig(const ServerConfig& cfg) {
+    config = cfg;
+}
+
+void CommandHandler::setLoading(bool on) {
+    loading = on;
+}
+
 /**
  * ----------------------------------------------------
  * RESP Bulk String Encoder
@@ -82,9 +232,25 @@ std::string CommandHandler::simpleString(const std::string& s) {
  * RESP Integer: :123\r\n
 */
 std::string CommandHandler::respInteger(long long n) {
+    if (n >= 0 && n < kSharedIntegers)
+        return sharedIntegers().integer[static_cast<size_t>(n)];
     return ":" + std::to_string(n) + "\r\n";
 }
 
+/**
+ * RESP Bulk String holding an integer's text, for integer-encoded strings.
+*/
+std::string CommandHandler::respBulkInteger(long long n) {
+    if (n >= 0 && n < kSharedIntegers)
+        return sharedIntegers().bulk[static_cast<size_t>(n)];
+
+    char buf[24];
+    auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), n);
+    std::string out;
+    appendBulk(out, std::string_view(buf, static_cast<size_t>(ptr - buf)));
+    return out;
+}
+
 /**
  * RESP Null Bulk String: $-1\r\n
 */
@@ -99,6 +265,17 @@ std::string CommandHandler::respBulk(const std::string& value) {
     return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
 }
 
+void CommandHandler::appendBulk(std::string& out, std::string_view value) {
+    char len[24];
+    auto [ptr, ec] = std::to_chars(len, len + sizeof(len), value.size());
+
+    out += '$';
+    out.append(len, ptr);
+    out += "\r\n";
+    out.append(value);
+    out += "\r\n";
+}
+
 /**
  * RESP Array:
  *   *N\r\n
@@ -156,59 +333,188 @@ ExecResult CommandHandler::execute(const std::vector<std::string_view>& args,
     if (it == commandMap.end())
         return ExecResult("-ERR unknown command\r\n", false, client_fd);
 
+    const CommandSpec& spec = it->second;
+
+    // Dataset not ready yet → only liveness checks are served
+    if (loading && !(spec.flags & CMD_LOADING))
+        return ExecResult("-LOADING Redis is loading the dataset in memory\r\n",
+                          false, client_fd);
+
+    // Replicas mirror their master; only the master link may write
+    if ((spec.flags & CMD_WRITE) && repl && repl->isReplica() &&
+        client_fd != repl->masterLinkFd())
+        return ExecResult("-READONLY You can't write against a read only replica.\r\n",
+                          false, client_fd);
+
+    // Cluster: keys must belong to a slot this node serves. Commands from
+    // the master link and AOF replay (fd -1) are never redirected.
+    if (cluster && cluster->enabled() && client_fd >= 0 &&
+        !(repl && client_fd == repl->masterLinkFd())) {
+        bool asking = cluster->consumeAsking(client_fd) || (spec.flags & CMD_ASKING);
+        std::string redirect = cluster->route(keysOf(spec, args), asking);
+        if (!redirect.empty())
+            return ExecResult(std::move(redirect), false, client_fd);
+    }
+
+    rewrittenArgv.clear();
+    suppressPropagation = false;
+
     // Invoke handler via member-function pointer
-    return (this->*(it->second))(args);
+    ExecResult result = (this->*(spec.fn))(args);
+
+    // Log successful writes. A blocked client (should_write) has not
+    // changed anything yet; its eventual pop is logged on wake-up.
+    bool failed = !result.reply.empty() && result.reply[0] == '-';
+    if ((spec.flags & CMD_WRITE) && !failed && !result.should_write &&
+        !suppressPropagation) {
+        if (!rewrittenArgv.empty()) {
+            propagate(rewrittenArgv);
+        } else {
+            propagate(std::vector<std::string>(args.begin(), args.end()));
+        }
+    }
+
+    // Clients blocked on keys this command filled are served now, so
+    // their pops are logged right after the push that fed them
+    if (!readyKeys.empty())
+        handleClientsBlockedOnKeys();
+
+    for (const auto& extra : alsoPropagateQueue)
+        propagate(extra);
+    alsoPropagateQueue.clear();
+
+    return result;
 }
 
-std::string CommandHandler::respXRange(
-    const std::vector<
-        std::pair<
-            std::string,
-            std::vector<std::pair<std::string,std::string>>
-        >
-    >& entries
-) {
-    std::string out;
+void CommandHandler::setAppendOnlyFile(AppendOnlyFile* file) {
+    aof = file;
+}
 
-    // Outer array length = number of entries
-    out += "*" + std::to_string(entries.size()) + "\r\n";
+/**
+ * Replaces what gets logged for the running command, e.g.
+ * XADD with "*" resolved or SET PX turned into SET PXAT.
+ */
+void CommandHandler::rewriteArgv(std::vector<std::string> argv) {
+    rewrittenArgv = std::move(argv);
+}
 
-    for (const auto& entry : entries) {
-        const std::string& id = entry.first;
-        const auto& fields = entry.second;
+/**
+ * Queues an additional command to log after the running one
+ * (e.g. the LPOP performed when a BLPOP waiter is woken).
+ */
+void CommandHandler::alsoPropagate(std::vector<std::string> argv) {
+    alsoPropagateQueue.push_back(std::move(argv));
+}
 
-        // Each entry itself is:
-        // *2
-        //   $len id
-        //   *N fields
-        out += "*2\r\n";
+void CommandHandler::setCluster(ClusterManager* manager) {
+    cluster = manager;
+}
+
+/**
+ * Keys of a command, read from its table entry.
+ */
+std::vector<std::string_view> CommandHandler::keysOf(
+    const CommandSpec& spec, const std::vector<std::string_view>& args)
+{
+    if (spec.keysFn)
+        return spec.keysFn(args);
+
+    std::vector<std::string_view> keys;
+    if (spec.firstKey <= 0)
+        return keys;
+
+    int argc = static_cast<int>(args.size());
+    int last = spec.lastKey < 0 ? argc + spec.lastKey : spec.lastKey;
+    for (int i = spec.firstKey; i <= last && i < argc; i += spec.keyStep)
+        keys.push_back(args[i]);
+    return keys;
+}
 
-        // ID bulk
-        out += "$" + std::to_string(id.size()) + "\r\n" + id + "\r\n";
+std::vector<std::string_view> CommandHandler::commandKeys(
+    const std::vector<std::string_view>& args) const
+{
+    if (args.empty())
+        return {};
 
-        // Fields array
-        out += "*" + std::to_string(fields.size() * 2) + "\r\n";
+    std::string cmd(args[0]);
+    for (char& c : cmd)
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
 
-        for (const auto& kv : fields) {
-            const auto& field = kv.first;
-            const auto& value = kv.second;
+    auto it = commandMap.find(cmd);
+    return it == commandMap.end() ? std::vector<std::string_view>{}
+                                  : keysOf(it->second, args);
+}
 
-            out += "$" + std::to_string(field.size()) + "\r\n" + field + "\r\n";
-            out += "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+// XREAD [COUNT n] [BLOCK ms] STREAMS key... id...
+std::vector<std::string_view> CommandHandler::xreadKeys(
+    const std::vector<std::string_view>& args)
+{
+    std::vector<std::string_view> keys;
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (equalsIgnoreCase(args[i], "STREAMS")) {
+            size_t n = (args.size() - i - 1) / 2;
+            for (size_t k = 0; k < n; ++k)
+                keys.push_back(args[i + 1 + k]);
+            break;
         }
     }
+    return keys;
+}
 
-    return out;
+// MIGRATE host port key|"" db timeout [...] [KEYS key...]
+std::vector<std::string_view> CommandHandler::migrateKeys(
+    const std::vector<std::string_view>& args)
+{
+    std::vector<std::string_view> keys;
+    if (args.size() < 6)
+        return keys;
+
+    if (!args[3].empty()) {
+        keys.push_back(args[3]);
+        return keys;
+    }
+    for (size_t i = 6; i < args.size(); ++i) {
+        if (equalsIgnoreCase(args[i], "KEYS")) {
+            keys.assign(args.begin() + i + 1, args.end());
+            break;
+        }
+    }
+    return keys;
+}
+
+// SINTERCARD numkeys key... [LIMIT n]
+std::vector<std::string_view> CommandHandler::numkeysKeys(
+    const std::vector<std::string_view>& args)
+{
+    std::vector<std::string_view> keys;
+    long long n = 0;
+    if (args.size() < 2 ||
+        std::from_chars(args[1].data(), args[1].data() + args[1].size(), n).ec != std::errc() ||
+        n <= 0 || static_cast<size_t>(n) > args.size() - 2)
+        return keys;
+    keys.assign(args.begin() + 2, args.begin() + 2 + n);
+    return keys;
+}
+
+void CommandHandler::setReplication(ReplicationManager* manager) {
+    repl = manager;
+}
+
+bool CommandHandler::isBlocked(int fd) const {
+    return blockedByFd.count(fd) != 0 || blockedXReadByFd.count(fd) != 0 ||
+           (repl && repl->isWaiting(fd));
+}
+
+void CommandHandler::propagate(const std::vector<std::string>& argv) {
+    if (aof)
+        aof->feed(argv);
+    if (repl)
+        repl->feed(argv);
 }
 
 std::string CommandHandler::respXRead(
     const std::string& stream_name,
-    const std::vector<
-        std::pair<
-            std::string,
-            std::vector<std::pair<std::string,std::string>>
-        >
-    >& entries
+    const std::vector<std::pair<StreamID, StreamFields>>& entries
 ) {
     // Outer array of streams: *1
     std::string out = "*1\r\n";
@@ -221,12 +527,11 @@ std::string CommandHandler::respXRead(
     out += "*" + std::to_string(entries.size()) + "\r\n";
 
     for (const auto& e : entries) {
-        const std::string& id = e.first;
         const auto& fields = e.second;
 
         // Each entry is [id, field-array]
         out += "*2\r\n";
-        out += respBulk(id);
+        out += respBulk(e.first.toString());
 
         // Field array
         out += "*" + std::to_string(fields.size() * 2) + "\r\n";
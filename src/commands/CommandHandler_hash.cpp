@@ -0,0 +1,517 @@
+#include "./CommandHandler.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+#include "../utils/StringUtils.hpp"
+
+namespace {
+
+// "FIELDS numfields field [field ...]" closing the HEXPIRE family
+// starting at args[i]. Returns the error reply, or nullptr.
+const char* parseFields(const std::vector<std::string_view>& args, size_t i,
+                        std::vector<std::string_view>& fields) {
+    if (i >= args.size() || toUpper(args[i]) != "FIELDS")
+        return "-ERR Mandatory argument FIELDS is missing or not at the right position\r\n";
+
+    long long n;
+    if (i + 1 >= args.size() || !parseLongLong(args[i + 1], n))
+        return kNotInteger;
+    if (n <= 0)
+        return "-ERR Parameter `numFields` should be greater than 0\r\n";
+    if (static_cast<size_t>(n) != args.size() - i - 2)
+        return "-ERR The `numfields` parameter must match the number of arguments\r\n";
+
+    fields.assign(args.begin() + static_cast<std::ptrdiff_t>(i + 2), args.end());
+    return nullptr;
+}
+
+uint64_t nowUnixMs() {
+    return static_cast<uint64_t>(getUnixTimeMs());
+}
+
+} // namespace
+
+/*
+===============================================================================
+  Lookup
+-------------------------------------------------------------------------------
+  Every hash command goes through lookupHash(), which first drops the
+  fields that are past their HEXPIRE deadline (and the key with its
+  last field). Replicas and AOF replays do the same on their own
+  clock, so expired fields are not propagated.
+===============================================================================
+*/
+Hash* CommandHandler::lookupHash(const std::string& key, bool& wrong_type) {
+    wrong_type = false;
+
+    RedisObj* obj = store.getObject(key);
+    if (!obj)
+        return nullptr;
+    if (obj->type != RedisType::HASH) {
+        wrong_type = true;
+        return nullptr;
+    }
+
+    Hash& hash = std::get<Hash>(obj->value);
+    if (hash.expireFields(nowUnixMs()) && hash.empty()) {
+        store.del(key);
+        return nullptr;
+    }
+    return &hash;
+}
+
+void CommandHandler::deleteIfEmpty(const std::string& key, const Hash& hash) {
+    if (hash.empty())
+        store.del(key);
+}
+
+/**
+ * RESP command: HSET key field value [field value ...]
+ *               HMSET key field value [field value ...]
+ *
+ * HSET replies with the number of new fields, HMSET with +OK.
+ */
+ExecResult CommandHandler::handleHSET(const std::vector<std::string_view>& args) {
+    if (args.size() < 4 || args.size() % 2 != 0)
+        return ExecResult("-ERR wrong number of arguments for '" + toUpper(args[0]) + "'\r\n",
+                          false, client_fd);
+
+    std::string key(args[1]);
+    bool wrong;
+    lookupHash(key, wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    Hash& hash = store.getOrCreateHash(key);
+    long long added = 0;
+    for (size_t i = 2; i < args.size(); i += 2)
+        added += hash.set(args[i], args[i + 1]);
+
+    if (toUpper(args[0]) == "HMSET")
+        return ExecResult(simpleString("OK"), false, client_fd);
+    return ExecResult(respInteger(added), false, client_fd);
+}
+
+/** RESP command: HSETNX key field value */
+ExecResult CommandHandler::handleHSETNX(const std::vector<std::string_view>& args) {
+    if (args.size() != 4)
+        return ExecResult("-ERR wrong number of arguments for 'HSETNX'\r\n",
+                          false, client_fd);
+
+    std::string key(args[1]);
+    bool wrong;
+    Hash* hash = lookupHash(key, wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    if (hash && hash->contains(args[2])) {
+        suppressPropagation = true;
+        return ExecResult(respInteger(0), false, client_fd);
+    }
+
+    store.getOrCreateHash(key).set(args[2], args[3]);
+    return ExecResult(respInteger(1), false, client_fd);
+}
+
+/** RESP command: HGET key field */
+ExecResult CommandHandler::handleHGET(const std::vector<std::string_view>& args) {
+    if (args.size() != 3)
+        return ExecResult("-ERR wrong number of arguments for 'HGET'\r\n",
+                          false, client_fd);
+
+    bool wrong;
+    Hash* hash = lookupHash(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    std::string value;
+    if (!hash || !hash->get(args[2], value))
+        return ExecResult(nullBulk(), false, client_fd);
+    return ExecResult(respBulk(value), false, client_fd);
+}
+
+/** RESP command: HMGET key field [field ...] — nil for missing fields. */
+ExecResult CommandHandler::handleHMGET(const std::vector<std::string_view>& args) {
+    if (args.size() < 3)
+        return ExecResult("-ERR wrong number of arguments for 'HMGET'\r\n",
+                          false, client_fd);
+
+    bool wrong;
+    Hash* hash = lookupHash(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    std::string out = "*" + std::to_string(args.size() - 2) + "\r\n";
+    std::string value;
+    for (size_t i = 2; i < args.size(); ++i) {
+        if (hash && hash->get(args[i], value))
+            appendBulk(out, value);
+        else
+            out += "$-1\r\n";
+    }
+    return ExecResult(out, false, client_fd);
+}
+
+/**
+ * RESP commands: HGETALL key, HKEYS key, HVALS key
+ *
+ * Encoded straight from the hash (listpack items or table nodes).
+ */
+ExecResult CommandHandler::handleHGETALL(const std::vector<std::string_view>& args) {
+    if (args.size() != 2)
+        return ExecResult("-ERR wrong number of arguments for '" + toUpper(args[0]) + "'\r\n",
+                          false, client_fd);
+
+    bool wrong;
+    Hash* hash = lookupHash(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+    if (!hash)
+        return ExecResult("*0\r\n", false, client_fd);
+
+    std::string cmd = toUpper(args[0]);
+    bool keys = cmd != "HVALS";
+    bool values = cmd != "HKEYS";
+
+    std::string out = "*" + std::to_string(hash->size() * (keys + values)) + "\r\n";
+    hash->forEach([&](std::string_view field, std::string_view value) {
+        if (keys)
+            appendBulk(out, field);
+        if (values)
+            appendBulk(out, value);
+    });
+    return ExecResult(out, false, client_fd);
+}
+
+/** RESP command: HDEL key field [field ...] */
+ExecResult CommandHandler::handleHDEL(const std::vector<std::string_view>& args) {
+    if (args.size() < 3)
+        return ExecResult("-ERR wrong number of arguments for 'HDEL'\r\n",
+                          false, client_fd);
+
+    std::string key(args[1]);
+    bool wrong;
+    Hash* hash = lookupHash(key, wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    long long removed = 0;
+    for (size_t i = 2; hash && i < args.size(); ++i)
+        removed += hash->erase(args[i]);
+
+    if (removed == 0)
+        suppressPropagation = true;
+    else
+        deleteIfEmpty(key, *hash);
+    return ExecResult(respInteger(removed), false, client_fd);
+}
+
+/** RESP command: HLEN key */
+ExecResult CommandHandler::handleHLEN(const std::vector<std::string_view>& args) {
+    if (args.size() != 2)
+        return ExecResult("-ERR wrong number of arguments for 'HLEN'\r\n",
+                          false, client_fd);
+
+    bool wrong;
+    Hash* hash = lookupHash(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+    return ExecResult(respInteger(hash ? static_cast<long long>(hash->size()) : 0),
+                      false, client_fd);
+}
+
+/** RESP commands: HEXISTS key field, HSTRLEN key field */
+ExecResult CommandHandler::handleHEXISTS(const std::vector<std::string_view>& args) {
+    if (args.size() != 3)
+        return ExecResult("-ERR wrong number of arguments for '" + toUpper(args[0]) + "'\r\n",
+                          false, client_fd);
+
+    bool wrong;
+    Hash* hash = lookupHash(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    std::string value;
+    bool found = hash && hash->get(args[2], value);
+    if (toUpper(args[0]) == "HSTRLEN")
+        return ExecResult(respInteger(static_cast<long long>(value.size())), false, client_fd);
+    return ExecResult(respInteger(found), false, client_fd);
+}
+
+/**
+ * RESP command: HINCRBY key field increment
+ *
+ * A missing field counts as 0. Compact hashes store the result as an
+ * integer item, so counters never go through text in memory.
+ */
+ExecResult CommandHandler::handleHINCRBY(const std::vector<std::string_view>& args) {
+    if (args.size() != 4)
+        return ExecResult("-ERR wrong number of arguments for 'HINCRBY'\r\n",
+                          false, client_fd);
+
+    long long incr;
+    if (!parseLongLong(args[3], incr))
+        return ExecResult(kNotInteger, false, client_fd);
+
+    std::string key(args[1]);
+    bool wrong;
+    Hash* hash = lookupHash(key, wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    long long current = 0;
+    std::string value;
+    if (hash && hash->get(args[2], value) && !parseLongLong(value, current))
+        return ExecResult("-ERR hash value is not an integer\r\n", false, client_fd);
+
+    long long result;
+    if (__builtin_add_overflow(current, incr, &result))
+        return ExecResult("-ERR increment or decrement would overflow\r\n", false, client_fd);
+
+    store.getOrCreateHash(key).set(args[2], std::to_string(result));
+    return ExecResult(respInteger(result), false, client_fd);
+}
+
+/**
+ * RESP command: HINCRBYFLOAT key field increment
+ *
+ * Propagated as HSET with the result, so replicas and the AOF never
+ * redo the floating point arithmetic.
+ */
+ExecResult CommandHandler::handleHINCRBYFLOAT(const std::vector<std::string_view>& args) {
+    if (args.size() != 4)
+        return ExecResult("-ERR wrong number of arguments for 'HINCRBYFLOAT'\r\n",
+                          false, client_fd);
+
+    long double incr;
+    if (!parseLongDouble(args[3], incr))
+        return ExecResult("-ERR value is not a valid float\r\n", false, client_fd);
+
+    std::string key(args[1]);
+    bool wrong;
+    Hash* hash = lookupHash(key, wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    long double current = 0;
+    std::string value;
+    if (hash && hash->get(args[2], value) && !parseLongDouble(value, current))
+        return ExecResult("-ERR hash value is not a float\r\n", false, client_fd);
+
+    long double result = current + incr;
+    if (!std::isfinite(result))
+        return ExecResult("-ERR increment would produce NaN or Infinity\r\n", false, client_fd);
+
+    std::string text = formatLongDouble(result);
+    store.getOrCreateHash(key).set(args[2], text);
+    rewriteArgv({"HSET", key, std::string(args[2]), text});
+    return ExecResult(respBulk(text), false, client_fd);
+}
+
+/**
+ * RESP command: HSCAN key cursor [MATCH pattern] [COUNT count] [NOVALUES]
+ *
+ * Reply: [next cursor, [field, value, ...]]. Compact hashes come back
+ * whole with cursor 0; tables are walked about COUNT fields at a time.
+ */
+ExecResult CommandHandler::handleHSCAN(const std::vector<std::string_view>& args) {
+    if (args.size() < 3)
+        return ExecResult("-ERR wrong number of arguments for 'HSCAN'\r\n",
+                          false, client_fd);
+
+    uint64_t cursor;
+    auto [ptr, ec] = std::from_chars(args[2].data(), args[2].data() + args[2].size(), cursor);
+    if (ec != std::errc() || ptr != args[2].data() + args[2].size())
+        return ExecResult("-ERR invalid cursor\r\n", false, client_fd);
+
+    std::string_view pattern;
+    bool match = false, novalues = false;
+    long long count = 10;
+    for (size_t i = 3; i < args.size(); ++i) {
+        std::string opt = toUpper(args[i]);
+        if (opt == "MATCH" && i + 1 < args.size()) {
+            pattern = args[++i];
+            match = pattern != "*";
+        } else if (opt == "COUNT" && i + 1 < args.size()) {
+            if (!parseLongLong(args[++i], count))
+                return ExecResult(kNotInteger, false, client_fd);
+            if (count < 1)
+                return ExecResult(kSyntaxError, false, client_fd);
+        } else if (opt == "NOVALUES") {
+            novalues = true;
+        } else {
+            return ExecResult(kSyntaxError, false, client_fd);
+        }
+    }
+
+    bool wrong;
+    Hash* hash = lookupHash(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    std::string items;
+    size_t n = 0;
+    uint64_t next = 0;
+    if (hash) {
+        next = hash->scan(cursor, static_cast<size_t>(count),
+                          [&](std::string_view field, std::string_view value) {
+            if (match && !globMatch(pattern, field))
+                return;
+            appendBulk(items, field);
+            if (!novalues)
+                appendBulk(items, value);
+            n += novalues ? 1 : 2;
+        });
+    }
+
+    std::string out = "*2\r\n";
+    appendBulk(out, std::to_string(next));
+    out += "*" + std::to_string(n) + "\r\n";
+    out += items;
+    return ExecResult(out, false, client_fd);
+}
+
+/*
+===============================================================================
+  Per-field expiry
+-------------------------------------------------------------------------------
+    HEXPIRE      key seconds      [NX|XX|GT|LT] FIELDS n field ...
+    HPEXPIRE     key milliseconds [NX|XX|GT|LT] FIELDS n field ...
+    HEXPIREAT    key unix-seconds [NX|XX|GT|LT] FIELDS n field ...
+    HPEXPIREAT   key unix-ms      [NX|XX|GT|LT] FIELDS n field ...
+
+  All four are propagated as HPEXPIREAT with the absolute deadline, so
+  replaying the AOF later does not extend the fields' lifetime.
+===============================================================================
+*/
+ExecResult CommandHandler::handleHEXPIRE(const std::vector<std::string_view>& args) {
+    std::string cmd = toUpper(args[0]);
+    if (args.size() < 6)
+        return ExecResult("-ERR wrong number of arguments for '" + cmd + "'\r\n",
+                          false, client_fd);
+
+    long long when;
+    if (!parseLongLong(args[2], when) || when < 0)
+        return ExecResult(kNotInteger, false, client_fd);
+
+    bool seconds = cmd == "HEXPIRE" || cmd == "HEXPIREAT";
+    bool absolute = cmd == "HEXPIREAT" || cmd == "HPEXPIREAT";
+    uint64_t now = nowUnixMs();
+
+    long long deadline = when;
+    if ((seconds && __builtin_mul_overflow(deadline, 1000LL, &deadline)) ||
+        (!absolute && __builtin_add_overflow(deadline, static_cast<long long>(now), &deadline)))
+        return ExecResult("-ERR invalid expire time in '" + cmd + "' command\r\n",
+                          false, client_fd);
+
+    size_t i = 3;
+    Hash::ExpireCondition cond = Hash::ExpireCondition::NONE;
+    std::string opt = toUpper(args[i]);
+    if (opt == "NX" || opt == "XX" || opt == "GT" || opt == "LT") {
+        cond = opt == "NX" ? Hash::ExpireCondition::NX
+             : opt == "XX" ? Hash::ExpireCondition::XX
+             : opt == "GT" ? Hash::ExpireCondition::GT
+             : Hash::ExpireCondition::LT;
+        ++i;
+    }
+
+    std::vector<std::string_view> fields;
+    if (const char* err = parseFields(args, i, fields))
+        return ExecResult(err, false, client_fd);
+
+    std::string key(args[1]);
+    bool wrong;
+    Hash* hash = lookupHash(key, wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    std::string out = "*" + std::to_string(fields.size()) + "\r\n";
+    bool changed = false;
+    for (std::string_view field : fields) {
+        int code = hash ? hash->expireField(field, static_cast<uint64_t>(deadline), cond, now)
+                        : -2;
+        changed |= code > 0;
+        out += respInteger(code);
+    }
+
+    if (!changed) {
+        suppressPropagation = true;
+    } else {
+        std::vector<std::string> argv = {"HPEXPIREAT", key, std::to_string(deadline)};
+        for (size_t j = 3; j < args.size(); ++j)
+            argv.emplace_back(args[j]);
+        rewriteArgv(std::move(argv));
+        deleteIfEmpty(key, *hash);
+    }
+    return ExecResult(out, false, client_fd);
+}
+
+/**
+ * RESP commands: HTTL / HPTTL / HEXPIRETIME / HPEXPIRETIME key FIELDS n field ...
+ *
+ * Per field: -2 no such field, -1 no expiry time, otherwise the time
+ * left (HTTL, HPTTL) or the deadline (HEXPIRETIME, HPEXPIRETIME).
+ */
+ExecResult CommandHandler::handleHTTL(const std::vector<std::string_view>& args) {
+    std::string cmd = toUpper(args[0]);
+    if (args.size() < 5)
+        return ExecResult("-ERR wrong number of arguments for '" + cmd + "'\r\n",
+                          false, client_fd);
+
+    std::vector<std::string_view> fields;
+    if (const char* err = parseFields(args, 2, fields))
+        return ExecResult(err, false, client_fd);
+
+    bool wrong;
+    Hash* hash = lookupHash(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    bool ms = cmd[1] == 'P';
+    bool remaining = cmd.ends_with("TTL");
+    uint64_t now = nowUnixMs();
+
+    std::string out = "*" + std::to_string(fields.size()) + "\r\n";
+    for (std::string_view field : fields) {
+        long long t = hash ? hash->fieldExpireTime(field) : -2;
+        if (t >= 0) {
+            if (remaining)
+                t = static_cast<long long>(static_cast<uint64_t>(t) - std::min<uint64_t>(now, t));
+            if (!ms)
+                t = remaining ? (t + 500) / 1000 : t / 1000;
+        }
+        out += respInteger(t);
+    }
+    return ExecResult(out, false, client_fd);
+}
+
+/** RESP command: HPERSIST key FIELDS n field ... — codes -2 / -1 / 1 per field. */
+ExecResult CommandHandler::handleHPERSIST(const std::vector<std::string_view>& args) {
+    if (args.size() < 5)
+        return ExecResult("-ERR wrong number of arguments for 'HPERSIST'\r\n",
+                          false, client_fd);
+
+    std::vector<std::string_view> fields;
+    if (const char* err = parseFields(args, 2, fields))
+        return ExecResult(err, false, client_fd);
+
+    bool wrong;
+    Hash* hash = lookupHash(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    std::string out = "*" + std::to_string(fields.size()) + "\r\n";
+    bool changed = false;
+    for (std::string_view field : fields) {
+        int code = hash ? hash->persistField(field) : -2;
+        changed |= code == 1;
+        out += respInteger(code);
+    }
+
+    if (!changed)
+        suppressPropagation = true;
+    return ExecResult(out, false, client_fd);
+}
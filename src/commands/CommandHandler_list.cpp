@@ -1,8 +1,44 @@
 #include "CommandHandler.hpp"
 
-#include <unistd.h>
+#include <algorithm>
+#include <charconv>
+#include "../utils/StringUtils.hpp"
 #include "../utils/time.cpp"
 
+namespace {
+
+bool parseInt(std::string_view s, int& out) {
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && ptr == s.data() + s.size();
+}
+
+// LEFT / RIGHT argument of LMOVE and BLMOVE.
+bool parseWhere(std::string_view s, bool& head) {
+    std::string upper = toUpper(s);
+    if (upper != "LEFT" && upper != "RIGHT")
+        return false;
+    head = upper == "LEFT";
+    return true;
+}
+
+const char* whereName(bool head) {
+    return head ? "LEFT" : "RIGHT";
+}
+
+// Takes a waiter out of the per-key queues it was put in.
+void leaveWaitQueues(std::unordered_map<std::string, std::list<int>>& queues,
+                     const std::vector<std::string>& keys,
+                     const std::vector<std::list<int>::iterator>& positions) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto blk_it = queues.find(keys[i]);
+        blk_it->second.erase(positions[i]);
+        if (blk_it->second.empty())
+            queues.erase(blk_it);
+    }
+}
+
+} // namespace
+
 /**
  * ----------------------------------------------------
  * handleRPUSH
@@ -16,9 +52,9 @@
  * Return:
  *   RESP Integer → the new length of the list.
  *
- * Side-effect for BLPOP:
- *   After pushing elements, the function attempts to wake
- *   any clients that are blocked (waiting via BLPOP).
+ * Side-effect for BLPOP/BRPOP:
+ *   The key is signalled as ready; clients blocked on it are
+ *   served once this command has finished.
 */
 ExecResult CommandHandler::handleRPUSH(const std::vector<std::string_view>& args) {
     if (args.size() < 3)
@@ -36,8 +72,8 @@ ExecResult CommandHandler::handleRPUSH(const std::vector<std::string_view>& args
 
     int reply_len = list.Len();
 
-    // Notify any BLPOP waiters that new data is available
-    maybeWakeBlockedClients(list_name);
+    // Notify any BLPOP/BRPOP waiters that new data is available
+    signalKeyAsReady(list_name);
 
     return ExecResult(respInteger(reply_len), false, client_fd);
 }
@@ -53,7 +89,7 @@ ExecResult CommandHandler::handleRPUSH(const std::vector<std::string_view>& args
  *   Works symmetrically to RPUSH.
  *
  * Side-effect:
- *   May wake BLPOP waiters since new items became available.
+ *   May wake BLPOP/BRPOP waiters since new items became available.
 */
 ExecResult CommandHandler::handleLPUSH(const std::vector<std::string_view>& args) {
     if (args.size() < 3)
@@ -70,8 +106,8 @@ ExecResult CommandHandler::handleLPUSH(const std::vector<std::string_view>& args
 
     int reply_len = list.Len();
 
-    // Attempt to service blocked BLPOP clients
-    maybeWakeBlockedClients(list_name);
+    // Blocked BLPOP/BRPOP clients are served after this command
+    signalKeyAsReady(list_name);
 
     return ExecResult(respInteger(reply_len), false, client_fd);
 }
@@ -83,9 +119,10 @@ ExecResult CommandHandler::handleLPUSH(const std::vector<std::string_view>& args
  * RESP command: LRANGE <list> <start> <end>
  *
  * Behavior:
- *   Returns a slice of the list between the given indices.
- *   Negative indices are supported in Redis but not required
- *   for this implementation unless explicitly added.
+ *   Returns a slice of the list between the given indices
+ *   (negative indices count from the tail). Elements are
+ *   encoded straight from the list nodes into the reply,
+ *   without copying them into strings first.
  *
  * If the list does not exist, an empty RESP array is returned.
 */
@@ -105,12 +142,20 @@ ExecResult CommandHandler::handleLRANGE(const std::vector<std::string_view>& arg
 
     List& list = std::get<List>(obj->value);
 
-    int start = std::stoi(std::string(args[2]));
-    int end   = std::stoi(std::string(args[3]));
+    int start = 0;
+    int end = 0;
+    if (!parseInt(args[2], start) || !parseInt(args[3], end))
+        return ExecResult("-ERR value is not an integer or out of range\r\n",
+                          false, client_fd);
+
+    List::RangeIterator range = list.Range(start, end);
 
-    std::vector<std::string> elements = list.GetElementsInRange(start, end);
+    std::string out = "*" + std::to_string(range.Remaining()) + "\r\n";
+    std::string_view element;
+    while (range.Next(element))
+        appendBulk(out, element);
 
-    return ExecResult(respArray(elements), false, client_fd);
+    return ExecResult(std::move(out), false, client_fd);
 }
 
 
@@ -152,193 +197,653 @@ ExecResult CommandHandler::handleLLEN(const std::vector<std::string_view>& args)
  *   from the head of the list.
  *
  * If the list is empty or does not exist:
- *   Return RESP Null Bulk → "$-1\r\n"
+ *   Return RESP Null Bulk → "$-1\r\n" (Null Array with count)
  *
- * Count > 1:
- *   Returns a RESP Array of popped elements.
+ * With count:
+ *   Returns a RESP Array of up to count popped elements,
+ *   encoded in one pass and removed node by node.
 */
 ExecResult CommandHandler::handleLPOP(const std::vector<std::string_view>& args) {
-    if (args.size() < 2)
-        return ExecResult("-ERR wrong number of arguments for 'LPOP'\r\n",
+    return popFromList(args, true);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleRPOP
+ * ----------------------------------------------------
+ * RESP command: RPOP <list> [count]
+ *
+ * Behavior:
+ *   Same as LPOP, from the tail. With count the elements
+ *   are returned in pop order (last element first).
+*/
+ExecResult CommandHandler::handleRPOP(const std::vector<std::string_view>& args) {
+    return popFromList(args, false);
+}
+
+ExecResult CommandHandler::popFromList(const std::vector<std::string_view>& args,
+                                       bool head) {
+    const char* name = head ? "LPOP" : "RPOP";
+    if (args.size() < 2 || args.size() > 3)
+        return ExecResult(std::string("-ERR wrong number of arguments for '") + name + "'\r\n",
+                          false, client_fd);
+
+    long long count = 1;
+    bool with_count = args.size() == 3;
+    if (with_count && (!parseLongLong(args[2], count) || count < 0))
+        return ExecResult("-ERR value is out of range, must be positive\r\n",
                           false, client_fd);
 
     std::string list_name = std::string(args[1]);
 
     RedisObj* obj = store.getObject(list_name);
-    if (!obj || obj->type != RedisType::LIST)
-        return ExecResult(nullBulk(), false, client_fd);
+    if (obj && obj->type != RedisType::LIST)
+        return ExecResult(kWrongType, false, client_fd);
+
+    if (!obj || std::get<List>(obj->value).Empty()) {
+        suppressPropagation = true;
+        return ExecResult(with_count ? "*-1\r\n" : nullBulk(), false, client_fd);
+    }
 
     List& list = std::get<List>(obj->value);
 
     // LPOP key
-    if (args.size() == 2) {
-        std::string removed_element = list.POPFront();
-        if (removed_element.empty())
-            return ExecResult(nullBulk(), false, client_fd);
-
+    if (!with_count) {
+        std::string removed_element = head ? list.POPFront() : list.POPBack();
+        deleteIfEmpty(list_name, list);
         return ExecResult(valueReturnResp(removed_element), false, client_fd);
     }
 
-    // LPOP key count
-    int pop_size = std::stoi(std::string(args[2]));
-    std::vector<std::string> removed_elements;
-
-    for (int i = 0; i < pop_size; ++i) {
-        std::string removed_element = list.POPFront();
-        if (removed_element.empty())
-            break;
-        removed_elements.push_back(removed_element);
+    // LPOP key count: encode from the nodes, then drop them in one go
+    size_t n = std::min<size_t>(static_cast<size_t>(count), list.Len());
+    if (n == 0) {
+        // Range(0, -1) would be the whole list
+        suppressPropagation = true;
+        return ExecResult("*0\r\n", false, client_fd);
     }
 
-    return ExecResult(respArray(removed_elements), false, client_fd);
+    List::RangeIterator range = head ? list.Range(0, static_cast<int>(n) - 1)
+                                     : list.ReverseRange(-static_cast<int>(n), -1);
+
+    std::string out = "*" + std::to_string(range.Remaining()) + "\r\n";
+    std::string_view element;
+    while (range.Next(element))
+        appendBulk(out, element);
+
+    if (head)
+        list.TrimFront(n);
+    else
+        list.TrimBack(n);
+    deleteIfEmpty(list_name, list);
+    return ExecResult(std::move(out), false, client_fd);
 }
 
+/**
+ * ----------------------------------------------------
+ * handleLTRIM
+ * ----------------------------------------------------
+ * RESP command: LTRIM <list> <start> <stop>
+ *
+ * Behavior:
+ *   Keeps only the elements in [start, stop] (LRANGE
+ *   indices). Nodes outside the range are freed whole.
+*/
+ExecResult CommandHandler::handleLTRIM(const std::vector<std::string_view>& args) {
+    if (args.size() != 4)
+        return ExecResult("-ERR wrong number of arguments for 'LTRIM'\r\n",
+                          false, client_fd);
+
+    int start = 0;
+    int end = 0;
+    if (!parseInt(args[2], start) || !parseInt(args[3], end))
+        return ExecResult("-ERR value is not an integer or out of range\r\n",
+                          false, client_fd);
+
+    std::string list_name = std::string(args[1]);
+    RedisObj* obj = store.getObject(list_name);
+    if (obj && obj->type != RedisType::LIST)
+        return ExecResult(kWrongType, false, client_fd);
+
+    if (!obj) {
+        suppressPropagation = true;
+        return ExecResult(simpleString("OK"), false, client_fd);
+    }
+
+    List& list = std::get<List>(obj->value);
+    list.Trim(start, end);
+    deleteIfEmpty(list_name, list);
+
+    return ExecResult(simpleString("OK"), false, client_fd);
+}
 
 /**
  * ----------------------------------------------------
- * handleBLPOP  (Blocking POP)
+ * handleLINDEX
  * ----------------------------------------------------
- * RESP command: BLPOP <list> <timeout>
+ * RESP command: LINDEX <list> <index>
  *
  * Behavior:
- *   - If the list has elements → pop immediately and return result.
- *   - If the list is empty     → block the client until:
- *        (a) another client pushes data (via RPUSH/LPUSH), OR
- *        (b) timeout occurs (not implemented here; timeout always 0)
+ *   Element at index (negative counts from the tail), or
+ *   null when out of range. Walks from the nearer end.
+*/
+ExecResult CommandHandler::handleLINDEX(const std::vector<std::string_view>& args) {
+    if (args.size() != 3)
+        return ExecResult("-ERR wrong number of arguments for 'LINDEX'\r\n",
+                          false, client_fd);
+
+    long long index = 0;
+    if (!parseLongLong(args[2], index))
+        return ExecResult("-ERR value is not an integer or out of range\r\n",
+                          false, client_fd);
+
+    RedisObj* obj = store.getObject(std::string(args[1]));
+    if (!obj)
+        return ExecResult(nullBulk(), false, client_fd);
+    if (obj->type != RedisType::LIST)
+        return ExecResult(kWrongType, false, client_fd);
+
+    std::string value;
+    if (!std::get<List>(obj->value).Index(index, value))
+        return ExecResult(nullBulk(), false, client_fd);
+
+    return ExecResult(valueReturnResp(value), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleLSET
+ * ----------------------------------------------------
+ * RESP command: LSET <list> <index> <element>
  *
- * Timeout:
- *   In this stage, timeout is always "0", meaning "block indefinitely".
+ * Behavior:
+ *   Replaces the element at index in place.
+*/
+ExecResult CommandHandler::handleLSET(const std::vector<std::string_view>& args) {
+    if (args.size() != 4)
+        return ExecResult("-ERR wrong number of arguments for 'LSET'\r\n",
+                          false, client_fd);
+
+    long long index = 0;
+    if (!parseLongLong(args[2], index))
+        return ExecResult("-ERR value is not an integer or out of range\r\n",
+                          false, client_fd);
+
+    RedisObj* obj = store.getObject(std::string(args[1]));
+    if (!obj)
+        return ExecResult("-ERR no such key\r\n", false, client_fd);
+    if (obj->type != RedisType::LIST)
+        return ExecResult(kWrongType, false, client_fd);
+
+    if (!std::get<List>(obj->value).Set(index, args[3]))
+        return ExecResult("-ERR index out of range\r\n", false, client_fd);
+
+    return ExecResult(simpleString("OK"), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleLINSERT
+ * ----------------------------------------------------
+ * RESP command: LINSERT <list> BEFORE|AFTER <pivot> <element>
  *
- * Return Format:
- *   RESP Array:
- *      1) list name
- *      2) popped element
+ * Behavior:
+ *   Inserts next to the first occurrence of pivot.
  *
- * Example:
- *   BLPOP mylist 0  → blocks until RPUSH mylist value
+ * Return:
+ *   New length, -1 if pivot was not found, 0 if the
+ *   list does not exist.
 */
-ExecResult CommandHandler::handleBLPOP(const std::vector<std::string_view>& args) {
-    if (args.size() != 3) {
-        return ExecResult("-ERR wrong number of arguments for 'BLPOP'\r\n",
+ExecResult CommandHandler::handleLINSERT(const std::vector<std::string_view>& args) {
+    if (args.size() != 5)
+        return ExecResult("-ERR wrong number of arguments for 'LINSERT'\r\n",
                           false, client_fd);
+
+    bool after = equalsIgnoreCase(args[2], "AFTER");
+    if (!after && !equalsIgnoreCase(args[2], "BEFORE"))
+        return ExecResult("-ERR syntax error\r\n", false, client_fd);
+
+    RedisObj* obj = store.getObject(std::string(args[1]));
+    if (obj && obj->type != RedisType::LIST)
+        return ExecResult(kWrongType, false, client_fd);
+
+    if (!obj) {
+        suppressPropagation = true;
+        return ExecResult(respInteger(0), false, client_fd);
     }
 
-    std::string list_name = std::string(args[1]);
+    List& list = std::get<List>(obj->value);
+    if (!list.Insert(args[3], args[4], after)) {
+        suppressPropagation = true;
+        return ExecResult(respInteger(-1), false, client_fd);
+    }
 
-    // Önce mevcut list var mı, dolu mu kontrol et
+    return ExecResult(respInteger(list.Len()), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleLREM
+ * ----------------------------------------------------
+ * RESP command: LREM <list> <count> <element>
+ *
+ * Behavior:
+ *   Removes up to |count| occurrences of element, from
+ *   the head (count > 0), the tail (count < 0), or all of
+ *   them (count = 0). Nodes without a match are skipped
+ *   without being modified.
+ *
+ * Return:
+ *   Number of removed elements.
+*/
+ExecResult CommandHandler::handleLREM(const std::vector<std::string_view>& args) {
+    if (args.size() != 4)
+        return ExecResult("-ERR wrong number of arguments for 'LREM'\r\n",
+                          false, client_fd);
+
+    long long count = 0;
+    if (!parseLongLong(args[2], count))
+        return ExecResult("-ERR value is not an integer or out of range\r\n",
+                          false, client_fd);
+
+    std::string list_name = std::string(args[1]);
     RedisObj* obj = store.getObject(list_name);
-    if (obj && obj->type == RedisType::LIST) {
-        List& list = std::get<List>(obj->value);
+    if (obj && obj->type != RedisType::LIST)
+        return ExecResult(kWrongType, false, client_fd);
 
-        if (!list.Empty()) {
-            std::string value = list.POPFront();
-            std::vector<std::string> resp = { list_name, value };
-            return ExecResult(respArray(resp), false, client_fd);
-        }
+    size_t removed = 0;
+    if (obj) {
+        List& list = std::get<List>(obj->value);
+        removed = list.Remove(count, args[3]);
+        deleteIfEmpty(list_name, list);
     }
 
-    // Liste yoksa ya da boşsa → block this client
-    double timeout_sec = std::stod(std::string(args[2]));
-    uint64_t deadline = 0;
+    if (removed == 0)
+        suppressPropagation = true;
+
+    return ExecResult(respInteger(static_cast<long long>(removed)), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleLMOVE / handleRPOPLPUSH
+ * ----------------------------------------------------
+ * RESP command: LMOVE <src> <dst> LEFT|RIGHT LEFT|RIGHT
+ *               RPOPLPUSH <src> <dst>   (= RIGHT LEFT)
+ *
+ * Behavior:
+ *   Atomically pops an element from one end of <src> and
+ *   pushes it onto one end of <dst> (created if missing).
+ *   <src> == <dst> rotates the list.
+ *
+ * Return:
+ *   The moved element, or a Null Bulk String if <src>
+ *   does not exist.
+*/
+ExecResult CommandHandler::handleLMOVE(const std::vector<std::string_view>& args) {
+    if (args.size() != 5)
+        return ExecResult("-ERR wrong number of arguments for 'LMOVE'\r\n",
+                          false, client_fd);
+
+    bool from_head, to_head;
+    if (!parseWhere(args[3], from_head) || !parseWhere(args[4], to_head))
+        return ExecResult("-ERR syntax error\r\n", false, client_fd);
+
+    return listMove(std::string(args[1]), std::string(args[2]), from_head, to_head);
+}
+
+ExecResult CommandHandler::handleRPOPLPUSH(const std::vector<std::string_view>& args) {
+    if (args.size() != 3)
+        return ExecResult("-ERR wrong number of arguments for 'RPOPLPUSH'\r\n",
+                          false, client_fd);
 
-    if (timeout_sec > 0.0) {
-        deadline = current_time_ms() + static_cast<uint64_t>(timeout_sec * 1000.0);
+    return listMove(std::string(args[1]), std::string(args[2]), false, true);
+}
+
+ExecResult CommandHandler::listMove(const std::string& src, const std::string& dst,
+                                    bool from_head, bool to_head) {
+    RedisObj* obj = store.getObject(src);
+    if (!obj) {
+        suppressPropagation = true;
+        return ExecResult(nullBulk(), false, client_fd);
     }
 
-    blockedClients[list_name].push_back({ client_fd, deadline });
+    RedisObj* dst_obj = store.getObject(dst);
+    if (obj->type != RedisType::LIST || (dst_obj && dst_obj->type != RedisType::LIST))
+        return ExecResult(kWrongType, false, client_fd);
 
-    // No response now; EventLoop shouldn't write anything for this client.
-    // We'll respond either in maybeWakeBlockedClients or checkTimeouts.
-    return ExecResult("", true, client_fd);
+    List& list = std::get<List>(obj->value);
+    std::string value = moveElement(list, dst, from_head, to_head);
+    deleteIfEmpty(src, list);
+
+    // Blocking variants are logged as the plain move they performed
+    rewriteArgv({"LMOVE", src, dst, whereName(from_head), whereName(to_head)});
+    return ExecResult(respBulk(value), false, client_fd);
 }
 
+std::string CommandHandler::moveElement(List& src, const std::string& dst_key,
+                                        bool from_head, bool to_head) {
+    std::string value = from_head ? src.POPFront() : src.POPBack();
+
+    // Existing lists are taken as they are (getOrCreateList drops TTLs)
+    RedisObj* dst_obj = store.getObject(dst_key);
+    List& dst = dst_obj ? std::get<List>(dst_obj->value) : store.getOrCreateList(dst_key);
+    if (to_head)
+        dst.PushFront(value);
+    else
+        dst.PushBack(value);
 
+    signalKeyAsReady(dst_key);
+    return value;
+}
+
+void CommandHandler::deleteIfEmpty(const std::string& key, const List& list) {
+    if (list.Empty())
+        store.del(key);
+}
 /**
  * ----------------------------------------------------
- * maybeWakeBlockedClients
+ * handleBLPOP / handleBRPOP  (Blocking POP)
  * ----------------------------------------------------
- * Called automatically after a push operation (RPUSH/LPUSH)
- * on a list that may have blocked clients.
+ * RESP command: BLPOP <list> [list ...] <timeout>
+ *               BRPOP <list> [list ...] <timeout>
  *
  * Behavior:
- *   - For each waiting client (FIFO order)
- *       • Pop one element from the list
- *       • Build a BLPOP-style RESP array
- *       • Write response directly to the client's socket
+ *   - The first list (in argument order) that has elements
+ *     is popped immediately.
+ *   - If every list is empty or missing → block the client
+ *     on all of them until:
+ *        (a) another client pushes to one of them, OR
+ *        (b) the timeout (seconds, fractions allowed) expires;
+ *            0 blocks indefinitely.
+ *
+ * Return Format:
+ *   RESP Array:
+ *      1) list name
+ *      2) popped element
+ *   or a Null Array (*-1) on timeout.
  *
- * If all blocked clients are woken or list becomes empty,
- * remaining blocked waiters stay in the registry.
+ * Example:
+ *   BLPOP jobs:high jobs:low 0  → serves jobs:high first
 */
-void CommandHandler::maybeWakeBlockedClients(const std::string& list_name) {
-    auto blk_it = blockedClients.find(list_name);
-    if (blk_it == blockedClients.end())
-        return;
-
-    // List objesini RedisStore'dan al
-    RedisObj* obj = store.getObject(list_name);
-    if (!obj || obj->type != RedisType::LIST)
-        return;
+ExecResult CommandHandler::handleBLPOP(const std::vector<std::string_view>& args) {
+    return blockingPop(args, true);
+}
 
-    List& list = std::get<List>(obj->value);
-    auto& waiters = blk_it->second;
+ExecResult CommandHandler::handleBRPOP(const std::vector<std::string_view>& args) {
+    return blockingPop(args, false);
+}
 
-    // Serve blocked clients in FIFO order
-    while (!waiters.empty() && !list.Empty()) {
-        int blocked_fd = waiters.front().fd;
-        waiters.pop_front();
+ExecResult CommandHandler::blockingPop(const std::vector<std::string_view>& args, bool head) {
+    const char* name = head ? "BLPOP" : "BRPOP";
+    if (args.size() < 3)
+        return ExecResult(std::string("-ERR wrong number of arguments for '") + name + "'\r\n",
+                          false, client_fd);
 
-        std::string value = list.POPFront();
+    uint64_t deadline = 0;
+    if (const char* err = parseTimeout(args.back(), deadline))
+        return ExecResult(err, false, client_fd);
+
+    // Serve right away from the first non-empty list
+    for (size_t i = 1; i + 1 < args.size(); ++i) {
+        std::string list_name(args[i]);
+        RedisObj* obj = store.getObject(list_name);
+        if (!obj)
+            continue;
+        if (obj->type != RedisType::LIST)
+            return ExecResult(kWrongType, false, client_fd);
 
-        // RESP array: [list_name, value]
-        std::vector<std::string> resp = { list_name, value };
-        std::string payload = respArray(resp);
+        List& list = std::get<List>(obj->value);
+        if (list.Empty())
+            continue;
 
-        ::write(blocked_fd, payload.c_str(), payload.size());
+        std::string value = head ? list.POPFront() : list.POPBack();
+        deleteIfEmpty(list_name, list);
+        rewriteArgv({head ? "LPOP" : "RPOP", list_name});
+        return ExecResult(respArray({ list_name, value }), false, client_fd);
     }
 
-    // If no clients remain waiting, remove entry from map
-    if (waiters.empty()) {
-        blockedClients.erase(blk_it);
-    }
+    // Nothing to pop → block this client on every key
+    return blockClient(BlockedClient{ .fd = client_fd, .deadline_ms = deadline, .head = head },
+                       args.begin() + 1, args.end() - 1);
 }
 
-void CommandHandler::checkTimeouts() {
-    uint64_t now = current_time_ms();
+/**
+ * ----------------------------------------------------
+ * handleBLMOVE / handleBRPOPLPUSH
+ * ----------------------------------------------------
+ * RESP command: BLMOVE <src> <dst> LEFT|RIGHT LEFT|RIGHT <timeout>
+ *               BRPOPLPUSH <src> <dst> <timeout>   (= RIGHT LEFT)
+ *
+ * Behavior:
+ *   Like LMOVE when <src> has elements. Otherwise the client
+ *   blocks on <src>; the push that wakes it also performs the
+ *   move, so the element is on <dst> before the reply leaves
+ *   and a worker crash can never lose it in between.
+ *
+ * Return:
+ *   The moved element, or a Null Array (*-1) on timeout.
+*/
+ExecResult CommandHandler::handleBLMOVE(const std::vector<std::string_view>& args) {
+    if (args.size() != 6)
+        return ExecResult("-ERR wrong number of arguments for 'BLMOVE'\r\n",
+                          false, client_fd);
+
+    bool from_head, to_head;
+    if (!parseWhere(args[3], from_head) || !parseWhere(args[4], to_head))
+        return ExecResult("-ERR syntax error\r\n", false, client_fd);
 
-    for (auto &pair : blockedClients) {
-        auto &queue = pair.second;
+    return blockingMove(args, from_head, to_head);
+}
 
-        while (!queue.empty()) {
-            auto &bc = queue.front();
+ExecResult CommandHandler::handleBRPOPLPUSH(const std::vector<std::string_view>& args) {
+    if (args.size() != 4)
+        return ExecResult("-ERR wrong number of arguments for 'BRPOPLPUSH'\r\n",
+                          false, client_fd);
 
-            // deadline_ms == 0 → block indefinitely
-            if (bc.deadline_ms == 0 || bc.deadline_ms > now)
-                break;
+    return blockingMove(args, false, true);
+}
 
-            // Timeout expired → return RESP Null Array
-            std::string payload = "*-1\r\n";
-            ::write(bc.fd, payload.c_str(), payload.size());
+ExecResult CommandHandler::blockingMove(const std::vector<std::string_view>& args,
+                                        bool from_head, bool to_head) {
+    uint64_t deadline = 0;
+    if (const char* err = parseTimeout(args.back(), deadline))
+        return ExecResult(err, false, client_fd);
 
-            queue.pop_front();
-        }
+    std::string src(args[1]);
+    std::string dst(args[2]);
+
+    RedisObj* obj = store.getObject(src);
+    if (obj && obj->type != RedisType::LIST)
+        return ExecResult(kWrongType, false, client_fd);
+    if (obj && !std::get<List>(obj->value).Empty())
+        return listMove(src, dst, from_head, to_head);
+
+    BlockedClient bc{ .fd = client_fd, .deadline_ms = deadline, .head = from_head,
+                      .move = true, .target = std::move(dst), .targetHead = to_head };
+    return blockClient(std::move(bc), args.begin() + 1, args.begin() + 2);
+}
+
+/**
+ * Registers the running client as waiting on every key in
+ * [first, last). It gets no reply now; EventLoop writes
+ * nothing for it until the Sender delivers the wake-up or
+ * the timeout.
+*/
+ExecResult CommandHandler::blockClient(BlockedClient bc,
+                                       std::vector<std::string_view>::const_iterator first,
+                                       std::vector<std::string_view>::const_iterator last) {
+    for (auto it = first; it != last; ++it) {
+        std::string key(*it);
+        if (std::find(bc.keys.begin(), bc.keys.end(), key) != bc.keys.end())
+            continue;
+
+        auto& waiters = blockedClients[key];
+        bc.positions.push_back(waiters.insert(waiters.end(), client_fd));
+        bc.keys.push_back(std::move(key));
     }
 
-    cleanup_empty_lists();
+    if (bc.deadline_ms)
+        blockedTimeouts.insert({ bc.deadline_ms, client_fd });
+    blockedByFd[client_fd] = std::move(bc);
+
+    return ExecResult("", true, client_fd);
 }
 
 /**
  * ----------------------------------------------------
- * cleanup_empty_lists
+ * signalKeyAsReady
  * ----------------------------------------------------
- * Utility to remove entries from the blockedClients map
- * whose wait-queues are now empty after timeouts or wakeups.
+ * Called by every command that adds elements to a list
+ * (RPUSH, LPUSH, LMOVE, RESTORE), entries to a stream
+ * (XADD) or members to a sorted set (ZADD, ZINCRBY). Only keys somebody waits on
+ * are queued, each at most once per command.
 */
-void CommandHandler::cleanup_empty_lists() {
-    for (auto it = blockedClients.begin(); it != blockedClients.end(); ) {
-        if (it->second.empty()) {
-            it = blockedClients.erase(it);  
-        } else {
-            ++it;
+void CommandHandler::signalKeyAsReady(const std::string& key) {
+    if (!blockedClients.count(key) && !blockedXReadClients.count(key))
+        return;
+    if (readyKeySet.insert(key).second)
+        readyKeys.push_back(key);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleClientsBlockedOnKeys
+ * ----------------------------------------------------
+ * Runs after a command finished. For each signalled key
+ * (in signal order), waiters are served in FIFO order
+ * while the list has elements:
+ *
+ *   • pop one element from the end the client asked for
+ *     (BLMOVE: and push it onto the destination)
+ *   • send [key, value] (BLMOVE: the element) through the Sender
+ *   • take the client off every other key it waited on
+ *   • log the pop as LPOP/RPOP (or LMOVE) after the causing command
+ *
+ * A served client was blocked on several keys at most
+ * once, so no element is ever handed to a second waiter.
+*/
+void CommandHandler::handleClientsBlockedOnKeys() {
+    while (!readyKeys.empty()) {
+        std::vector<std::string> keys;
+        keys.swap(readyKeys);
+        readyKeySet.clear();
+
+        for (const std::string& key : keys) {
+            RedisObj* obj = store.getObject(key);
+            if (obj && obj->type == RedisType::STREAM) {
+                serveClientsBlockedOnStream(key, std::get<Stream>(obj->value));
+                continue;
+            }
+            if (obj && obj->type == RedisType::ZSET) {
+                serveClientsBlockedOnZSet(key, std::get<ZSet>(obj->value));
+                continue;
+            }
+
+            auto blk_it = blockedClients.find(key);
+            if (blk_it == blockedClients.end())
+                continue;
+            if (!obj || obj->type != RedisType::LIST)
+                continue;
+            List& list = std::get<List>(obj->value);
+
+            while (!list.Empty()) {
+                int fd = nextWaiter(key, false);
+                if (fd < 0)
+                    break;
+
+                const BlockedClient& waiter = blockedByFd.at(fd);
+                bool head = waiter.head;
+                bool move = waiter.move;
+                bool target_head = waiter.targetHead;
+                std::string target = waiter.target;
+                unblockClient(fd);
+
+                if (!move) {
+                    std::string value = head ? list.POPFront() : list.POPBack();
+                    alsoPropagate({head ? "LPOP" : "RPOP", key});
+                    sendToClient(fd, respArray({ key, value }));
+                    continue;
+                }
+
+                // The destination may have changed type while we waited
+                RedisObj* dst_obj = store.getObject(target);
+                if (dst_obj && dst_obj->type != RedisType::LIST) {
+                    sendToClient(fd, kWrongType);
+                    continue;
+                }
+
+                std::string value = moveElement(list, target, head, target_head);
+                alsoPropagate({"LMOVE", key, target, whereName(head), whereName(target_head)});
+                sendToClient(fd, respBulk(value));
+            }
+
+            deleteIfEmpty(key, list);
         }
     }
 }
+
+/**
+ * First client in `key`'s queue waiting for a list (or, with `zset`,
+ * for a sorted set), or -1. BLPOP and BZPOPMIN clients can share a
+ * key; each only takes what it asked for and keeps its place otherwise.
+ */
+int CommandHandler::nextWaiter(const std::string& key, bool zset) const {
+    auto it = blockedClients.find(key);
+    if (it == blockedClients.end())
+        return -1;
+    for (int fd : it->second) {
+        if (blockedByFd.at(fd).zset == zset)
+            return fd;
+    }
+    return -1;
+}
+
+void CommandHandler::unblockClient(int fd) {
+    uint64_t deadline_ms;
+
+    if (auto it = blockedByFd.find(fd); it != blockedByFd.end()) {
+        leaveWaitQueues(blockedClients, it->second.keys, it->second.positions);
+        deadline_ms = it->second.deadline_ms;
+        blockedByFd.erase(it);
+    } else if (auto xit = blockedXReadByFd.find(fd); xit != blockedXReadByFd.end()) {
+        leaveWaitQueues(blockedXReadClients, xit->second.keys, xit->second.positions);
+        deadline_ms = xit->second.deadline_ms;
+        blockedXReadByFd.erase(xit);
+    } else {
+        return;
+    }
+
+    if (deadline_ms)
+        blockedTimeouts.erase({ deadline_ms, fd });
+}
+
+void CommandHandler::sendToClient(int fd, std::string_view data) {
+    if (send)
+        send(fd, data);
+}
+
+void CommandHandler::setSender(Sender send_fn) {
+    send = std::move(send_fn);
+}
+
+void CommandHandler::onClientDisconnected(int fd) {
+    unblockClient(fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * checkTimeouts
+ * ----------------------------------------------------
+ * Answers blocked clients whose deadline passed with a
+ * Null Array. The timeout index is ordered by deadline,
+ * so only expired entries are visited.
+*/
+void CommandHandler::checkTimeouts() {
+    uint64_t now = current_time_ms();
+
+    while (!blockedTimeouts.empty() && blockedTimeouts.begin()->first <= now) {
+        int fd = blockedTimeouts.begin()->second;
+        unblockClient(fd);
+        sendToClient(fd, "*-1\r\n");
+    }
+}
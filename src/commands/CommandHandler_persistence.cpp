@@ -0,0 +1,210 @@
+#include "CommandHandler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../persistence/AppendOnlyFile.hpp"
+#include "../persistence/Snapshot.hpp"
+
+namespace {
+
+const char* childBusyError(bool rewriting) {
+    return rewriting
+        ? "-ERR Background append only file rewriting already in progress\r\n"
+        : "-ERR Background save already in progress\r\n";
+}
+
+} // namespace
+
+/**
+ * ----------------------------------------------------
+ * handleSAVE
+ * ----------------------------------------------------
+ * RESP command: SAVE
+ *
+ * Behavior:
+ *   Writes a snapshot of the whole keyspace synchronously.
+ *   The event loop is blocked until the file is on disk,
+ *   so BGSAVE is preferred on large datasets.
+ */
+ExecResult CommandHandler::handleSAVE(const std::vector<std::string_view>& args) {
+    if (args.size() != 1)
+        return ExecResult("-ERR wrong number of arguments for 'SAVE'\r\n",
+                          false, client_fd);
+
+    if (childPid != -1)
+        return ExecResult(childBusyError(childType == ChildType::AOF_REWRITE),
+                          false, client_fd);
+
+    std::string err;
+    if (!Snapshot::save(store, config.snapshotPath(), err))
+        return ExecResult("-ERR " + err + "\r\n", false, client_fd);
+
+    return ExecResult(simpleString("OK"), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleBGSAVE
+ * ----------------------------------------------------
+ * RESP command: BGSAVE
+ *
+ * Behavior:
+ *   Forks; the child serializes its copy-on-write view of
+ *   the keyspace and exits. The parent keeps serving clients
+ *   and reaps the child in checkBackgroundJobs().
+ */
+ExecResult CommandHandler::handleBGSAVE(const std::vector<std::string_view>& args) {
+    if (args.size() != 1)
+        return ExecResult("-ERR wrong number of arguments for 'BGSAVE'\r\n",
+                          false, client_fd);
+
+    if (childPid != -1)
+        return ExecResult(childBusyError(childType == ChildType::AOF_REWRITE),
+                          false, client_fd);
+
+    pid_t pid = ::fork();
+    if (pid < 0)
+        return ExecResult("-ERR fork failed\r\n", false, client_fd);
+
+    if (pid == 0) {
+        std::string err;
+        bool ok = Snapshot::save(store, config.snapshotPath(), err);
+        if (!ok)
+            std::cerr << "BGSAVE failed: " << err << "\n";
+        ::_exit(ok ? 0 : 1);
+    }
+
+    childPid = pid;
+    childType = ChildType::SNAPSHOT;
+    return ExecResult(simpleString("Background saving started"), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleBGREWRITEAOF
+ * ----------------------------------------------------
+ * RESP command: BGREWRITEAOF
+ *
+ * Behavior:
+ *   Forks a child that writes the minimal command stream
+ *   for the current dataset. Writes that arrive meanwhile
+ *   are buffered and appended before the atomic swap.
+ */
+ExecResult CommandHandler::handleBGREWRITEAOF(const std::vector<std::string_view>& args) {
+    if (args.size() != 1)
+        return ExecResult("-ERR wrong number of arguments for 'BGREWRITEAOF'\r\n",
+                          false, client_fd);
+
+    if (childPid != -1)
+        return ExecResult(childBusyError(childType == ChildType::AOF_REWRITE),
+                          false, client_fd);
+
+    std::string err;
+    if (!startAofRewrite(err))
+        return ExecResult("-ERR " + err + "\r\n", false, client_fd);
+
+    return ExecResult(simpleString("Background append only file rewriting started"),
+                      false, client_fd);
+}
+
+bool CommandHandler::startAofRewrite(std::string& err) {
+    // Push out everything logged before the fork, the child's view
+    // already contains it.
+    if (aof)
+        aof->flush();
+
+    std::string tmp = config.dir + "/temp-rewriteaof-" +
+                      std::to_string(::getpid()) + ".aof";
+
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        err = "fork failed";
+        return false;
+    }
+
+    if (pid == 0) {
+        std::string child_err;
+        bool ok = AppendOnlyFile::writeRewrite(store, tmp,
+                                               config.aofUseSnapshotPreamble,
+                                               child_err);
+        if (!ok)
+            std::cerr << "AOF rewrite failed: " << child_err << "\n";
+        ::_exit(ok ? 0 : 1);
+    }
+
+    if (aof)
+        aof->startRewrite();
+
+    childPid = pid;
+    childType = ChildType::AOF_REWRITE;
+    rewriteTmpPath = tmp;
+    return true;
+}
+
+void CommandHandler::finishAofRewrite(bool child_ok) {
+    std::string err;
+    bool ok = child_ok;
+
+    if (ok && aof) {
+        ok = aof->finishRewrite(rewriteTmpPath, config.aofPath(), err);
+    } else if (ok) {
+        // AOF disabled: the rewrite simply produces the file
+        ok = std::rename(rewriteTmpPath.c_str(), config.aofPath().c_str()) == 0;
+    } else if (aof) {
+        aof->abortRewrite();
+    }
+
+    if (!ok)
+        ::unlink(rewriteTmpPath.c_str());
+
+    std::cout << (ok ? "Background AOF rewrite finished successfully"
+                     : "Background AOF rewrite failed " + err) << std::endl;
+}
+
+void CommandHandler::scheduleAofRewrite() {
+    if (aof)
+        aofRewriteScheduled = true;
+}
+
+void CommandHandler::checkBackgroundJobs() {
+    if (childPid == -1) {
+        if (aofRewriteScheduled) {
+            aofRewriteScheduled = false;
+            std::string err;
+            if (!startAofRewrite(err))
+                std::cerr << "Scheduled AOF rewrite failed: " << err << "\n";
+            return;
+        }
+        if (aof && aof->needsRewrite(config.autoAofRewritePercentage,
+                                     config.autoAofRewriteMinSize)) {
+            std::cout << "Starting automatic rewriting of AOF on "
+                      << (aof->size() * 100 / std::max<uint64_t>(aof->baseSize(), 1) - 100)
+                      << "% growth" << std::endl;
+            std::string err;
+            if (!startAofRewrite(err))
+                std::cerr << "Automatic AOF rewrite failed: " << err << "\n";
+        }
+        return;
+    }
+
+    int status = 0;
+    pid_t done = ::waitpid(childPid, &status, WNOHANG);
+    if (done == 0)
+        return;   // still running
+
+    bool ok = done == childPid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+    if (childType == ChildType::AOF_REWRITE) {
+        finishAofRewrite(ok);
+    } else {
+        std::cout << (ok ? "Background saving terminated with success"
+                         : "Background saving error") << std::endl;
+    }
+
+    childPid = -1;
+    childType = ChildType::NONE;
+}
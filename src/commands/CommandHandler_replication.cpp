@@ -0,0 +1,174 @@
+#include "CommandHandler.hpp"
+
+#include "../replication/ReplicationManager.hpp"
+#include "../utils/StringUtils.hpp"
+
+/**
+ * ----------------------------------------------------
+ * handleREPLICAOF
+ * ----------------------------------------------------
+ * RESP command: REPLICAOF host port | REPLICAOF NO ONE
+ *
+ * Behavior:
+ *   Turns this server into a replica of host:port. The
+ *   handshake and the initial sync run from the event
+ *   loop; the reply only acknowledges the new role.
+ *   NO ONE promotes a replica back to master and keeps
+ *   its dataset.
+ */
+ExecResult CommandHandler::handleREPLICAOF(const std::vector<std::string_view>& args) {
+    if (args.size() != 3)
+        return ExecResult("-ERR wrong number of arguments for 'REPLICAOF'\r\n",
+                          false, client_fd);
+
+    if (!repl)
+        return ExecResult("-ERR replication is not available\r\n", false, client_fd);
+
+    if (equalsIgnoreCase(args[1], "NO") && equalsIgnoreCase(args[2], "ONE")) {
+        repl->replicaOfNoOne();
+        return ExecResult(simpleString("OK"), false, client_fd);
+    }
+
+    long long port = 0;
+    if (!parseLongLong(args[2], port) || port <= 0 || port > 65535)
+        return ExecResult("-ERR Invalid master port\r\n", false, client_fd);
+
+    repl->replicaOf(std::string(args[1]), static_cast<int>(port));
+    return ExecResult(simpleString("OK"), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handlePSYNC
+ * ----------------------------------------------------
+ * RESP command: PSYNC replid offset
+ *
+ * Behavior:
+ *   Sent by a replica at the end of its handshake.
+ *   Replies +CONTINUE plus the missing backlog bytes, or
+ *   +FULLRESYNC followed by a snapshot. From then on the
+ *   connection receives the replication stream.
+ */
+ExecResult CommandHandler::handlePSYNC(const std::vector<std::string_view>& args) {
+    if (args.size() != 3)
+        return ExecResult("-ERR wrong number of arguments for 'PSYNC'\r\n",
+                          false, client_fd);
+
+    if (!repl)
+        return ExecResult("-ERR replication is not available\r\n", false, client_fd);
+
+    return ExecResult(repl->psync(client_fd, args[1], args[2]), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleREPLCONF
+ * ----------------------------------------------------
+ * RESP command: REPLCONF listening-port <port>
+ *               REPLCONF capa <capability> [...]
+ *               REPLCONF ACK <offset>
+ *
+ * Behavior:
+ *   Handshake options are acknowledged with +OK. ACK
+ *   records how far the replica got and gets no reply,
+ *   so it never interleaves with the replication stream.
+ */
+ExecResult CommandHandler::handleREPLCONF(const std::vector<std::string_view>& args) {
+    if (args.size() < 3 || args.size() % 2 == 0)
+        return ExecResult("-ERR wrong number of arguments for 'REPLCONF'\r\n",
+                          false, client_fd);
+
+    if (equalsIgnoreCase(args[1], "ACK")) {
+        long long offset = 0;
+        if (repl && parseLongLong(args[2], offset) && offset >= 0)
+            repl->replconfAck(client_fd, static_cast<uint64_t>(offset));
+        return ExecResult("", false, client_fd);
+    }
+
+    if (equalsIgnoreCase(args[1], "GETACK"))
+        return ExecResult("", false, client_fd);   // handled on the master link
+
+    for (size_t i = 1; i < args.size(); i += 2) {
+        if (equalsIgnoreCase(args[i], "listening-port")) {
+            long long port = 0;
+            if (!parseLongLong(args[i + 1], port) || port <= 0 || port > 65535)
+                return ExecResult("-ERR Invalid listening-port\r\n", false, client_fd);
+            if (repl)
+                repl->replconfListeningPort(client_fd, static_cast<int>(port));
+        } else if (!equalsIgnoreCase(args[i], "capa") &&
+                   !equalsIgnoreCase(args[i], "ip-address")) {
+            return ExecResult("-ERR Unrecognized REPLCONF option: " +
+                              std::string(args[i]) + "\r\n", false, client_fd);
+        }
+    }
+
+    return ExecResult(simpleString("OK"), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleWAIT
+ * ----------------------------------------------------
+ * RESP command: WAIT numreplicas timeout
+ *
+ * Behavior:
+ *   Blocks until at least numreplicas replicas
+ *   acknowledged every write made so far, or until
+ *   timeout ms passed (0 = forever). Replies with the
+ *   number of replicas that did.
+ */
+ExecResult CommandHandler::handleWAIT(const std::vector<std::string_view>& args) {
+    if (args.size() != 3)
+        return ExecResult("-ERR wrong number of arguments for 'WAIT'\r\n",
+                          false, client_fd);
+
+    long long numreplicas = 0;
+    long long timeout = 0;
+    if (!parseLongLong(args[1], numreplicas) || !parseLongLong(args[2], timeout))
+        return ExecResult("-ERR value is not an integer or out of range\r\n",
+                          false, client_fd);
+
+    if (timeout < 0)
+        return ExecResult("-ERR timeout is negative\r\n", false, client_fd);
+
+    if (!repl)
+        return ExecResult(respInteger(0), false, client_fd);
+
+    if (repl->isReplica())
+        return ExecResult("-ERR WAIT cannot be used with replica instances\r\n",
+                          false, client_fd);
+
+    long long acked = repl->wait(client_fd, numreplicas,
+                                 static_cast<uint64_t>(timeout));
+    if (acked < 0)
+        return ExecResult("", true, client_fd);   // blocked
+
+    return ExecResult(respInteger(acked), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleINFO
+ * ----------------------------------------------------
+ * RESP command: INFO [section]
+ *
+ * Behavior:
+ *   Returns "field:value" lines as a bulk string.
+ *   Only the replication section exists for now.
+ */
+ExecResult CommandHandler::handleINFO(const std::vector<std::string_view>& args) {
+    if (args.size() > 2)
+        return ExecResult("-ERR syntax error\r\n", false, client_fd);
+
+    bool all = args.size() == 1 ||
+               equalsIgnoreCase(args[1], "all") ||
+               equalsIgnoreCase(args[1], "default") ||
+               equalsIgnoreCase(args[1], "everything");
+
+    std::string out;
+    if (all || equalsIgnoreCase(args[1], "replication")) {
+        out = repl ? repl->info() : "# Replication\r\nrole:master\r\nconnected_slaves:0\r\n";
+    }
+
+    return ExecResult(respBulk(out), false, client_fd);
+}
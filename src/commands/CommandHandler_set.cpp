@@ -0,0 +1,249 @@
+#include "./CommandHandler.hpp"
+
+#include "../utils/StringUtils.hpp"
+
+/*
+===============================================================================
+  Lookup
+-------------------------------------------------------------------------------
+  lookupSets() resolves every key of a multi-set command up front, so a
+  key of the wrong type fails the command before any work is done.
+  Missing keys come back as nullptr, which Set's multi-set operations
+  treat as the empty set.
+===============================================================================
+*/
+Set* CommandHandler::lookupSet(const std::string& key, bool& wrong_type) {
+    wrong_type = false;
+
+    RedisObj* obj = store.getObject(key);
+    if (!obj)
+        return nullptr;
+    if (obj->type != RedisType::SET) {
+        wrong_type = true;
+        return nullptr;
+    }
+    return &std::get<Set>(obj->value);
+}
+
+bool CommandHandler::lookupSets(const std::vector<std::string_view>& keys,
+                                std::vector<const Set*>& sets) {
+    sets.clear();
+    sets.reserve(keys.size());
+    for (std::string_view key : keys) {
+        bool wrong;
+        sets.push_back(lookupSet(std::string(key), wrong));
+        if (wrong)
+            return false;
+    }
+    return true;
+}
+
+void CommandHandler::deleteIfEmpty(const std::string& key, const Set& set) {
+    if (set.empty())
+        store.del(key);
+}
+
+/** RESP command: SADD key member [member ...] */
+ExecResult CommandHandler::handleSADD(const std::vector<std::string_view>& args) {
+    if (args.size() < 3)
+        return ExecResult("-ERR wrong number of arguments for 'SADD'\r\n",
+                          false, client_fd);
+
+    std::string key(args[1]);
+    bool wrong;
+    lookupSet(key, wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    Set& set = store.getOrCreateSet(key);
+    long long added = 0;
+    for (size_t i = 2; i < args.size(); ++i)
+        added += set.add(args[i]);
+
+    if (added == 0)
+        suppressPropagation = true;
+    return ExecResult(respInteger(added), false, client_fd);
+}
+
+/** RESP command: SREM key member [member ...] */
+ExecResult CommandHandler::handleSREM(const std::vector<std::string_view>& args) {
+    if (args.size() < 3)
+        return ExecResult("-ERR wrong number of arguments for 'SREM'\r\n",
+                          false, client_fd);
+
+    std::string key(args[1]);
+    bool wrong;
+    Set* set = lookupSet(key, wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    long long removed = 0;
+    for (size_t i = 2; set && i < args.size(); ++i)
+        removed += set->remove(args[i]);
+
+    if (removed == 0)
+        suppressPropagation = true;
+    else
+        deleteIfEmpty(key, *set);
+    return ExecResult(respInteger(removed), false, client_fd);
+}
+
+/** RESP command: SISMEMBER key member */
+ExecResult CommandHandler::handleSISMEMBER(const std::vector<std::string_view>& args) {
+    if (args.size() != 3)
+        return ExecResult("-ERR wrong number of arguments for 'SISMEMBER'\r\n",
+                          false, client_fd);
+
+    bool wrong;
+    Set* set = lookupSet(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+    return ExecResult(respInteger(set && set->contains(args[2])), false, client_fd);
+}
+
+/** RESP command: SMISMEMBER key member [member ...] — 1 or 0 per member. */
+ExecResult CommandHandler::handleSMISMEMBER(const std::vector<std::string_view>& args) {
+    if (args.size() < 3)
+        return ExecResult("-ERR wrong number of arguments for 'SMISMEMBER'\r\n",
+                          false, client_fd);
+
+    bool wrong;
+    Set* set = lookupSet(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    std::string out = "*" + std::to_string(args.size() - 2) + "\r\n";
+    for (size_t i = 2; i < args.size(); ++i)
+        out += set && set->contains(args[i]) ? ":1\r\n" : ":0\r\n";
+    return ExecResult(out, false, client_fd);
+}
+
+/** RESP command: SCARD key */
+ExecResult CommandHandler::handleSCARD(const std::vector<std::string_view>& args) {
+    if (args.size() != 2)
+        return ExecResult("-ERR wrong number of arguments for 'SCARD'\r\n",
+                          false, client_fd);
+
+    bool wrong;
+    Set* set = lookupSet(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+    return ExecResult(respInteger(set ? static_cast<long long>(set->size()) : 0),
+                      false, client_fd);
+}
+
+/** RESP command: SMEMBERS key — intsets come back in ascending order. */
+ExecResult CommandHandler::handleSMEMBERS(const std::vector<std::string_view>& args) {
+    if (args.size() != 2)
+        return ExecResult("-ERR wrong number of arguments for 'SMEMBERS'\r\n",
+                          false, client_fd);
+
+    bool wrong;
+    Set* set = lookupSet(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+    if (!set)
+        return ExecResult("*0\r\n", false, client_fd);
+
+    std::string out = "*" + std::to_string(set->size()) + "\r\n";
+    set->forEach([&](std::string_view member) { appendBulk(out, member); });
+    return ExecResult(out, false, client_fd);
+}
+
+/**
+ * RESP commands: SINTER key [key ...], SUNION key [key ...],
+ *                SDIFF key [key ...]
+ *
+ * A missing key is an empty set, so SINTER with one answers empty
+ * without looking at the others.
+ */
+ExecResult CommandHandler::handleSINTER(const std::vector<std::string_view>& args) {
+    if (args.size() < 2)
+        return ExecResult("-ERR wrong number of arguments for '" + toUpper(args[0]) + "'\r\n",
+                          false, client_fd);
+
+    std::vector<const Set*> sets;
+    if (!lookupSets({args.begin() + 1, args.end()}, sets))
+        return ExecResult(kWrongType, false, client_fd);
+
+    std::string cmd = toUpper(args[0]);
+    if (cmd == "SINTER")
+        return ExecResult(respArray(Set::intersect(std::move(sets))), false, client_fd);
+
+    Set result = cmd == "SUNION" ? Set::unite(sets) : Set::difference(sets);
+    std::string out = "*" + std::to_string(result.size()) + "\r\n";
+    result.forEach([&](std::string_view member) { appendBulk(out, member); });
+    return ExecResult(out, false, client_fd);
+}
+
+/**
+ * RESP command: SINTERCARD numkeys key [key ...] [LIMIT limit]
+ *
+ * Counts the intersection without building it; LIMIT stops the count
+ * (and the work) early.
+ */
+ExecResult CommandHandler::handleSINTERCARD(const std::vector<std::string_view>& args) {
+    if (args.size() < 3)
+        return ExecResult("-ERR wrong number of arguments for 'SINTERCARD'\r\n",
+                          false, client_fd);
+
+    long long numkeys;
+    if (!parseLongLong(args[1], numkeys) || numkeys <= 0)
+        return ExecResult("-ERR numkeys should be greater than 0\r\n", false, client_fd);
+    if (static_cast<size_t>(numkeys) > args.size() - 2)
+        return ExecResult("-ERR Number of keys can't be greater than number of args\r\n",
+                          false, client_fd);
+
+    size_t end = 2 + static_cast<size_t>(numkeys);
+    long long limit = 0;
+    if (end < args.size()) {
+        if (args.size() != end + 2 || toUpper(args[end]) != "LIMIT")
+            return ExecResult(kSyntaxError, false, client_fd);
+        if (!parseLongLong(args[end + 1], limit) || limit < 0)
+            return ExecResult("-ERR LIMIT can't be negative\r\n", false, client_fd);
+    }
+
+    std::vector<const Set*> sets;
+    if (!lookupSets({args.begin() + 2, args.begin() + static_cast<std::ptrdiff_t>(end)}, sets))
+        return ExecResult(kWrongType, false, client_fd);
+
+    size_t count = Set::intersectCount(std::move(sets), static_cast<size_t>(limit));
+    return ExecResult(respInteger(static_cast<long long>(count)), false, client_fd);
+}
+
+/**
+ * RESP commands: SINTERSTORE destination key [key ...]
+ *                SUNIONSTORE destination key [key ...]
+ *                SDIFFSTORE destination key [key ...]
+ *
+ * Replaces destination (whatever its type) with the result, or deletes
+ * it when the result is empty. Replies with the result's size.
+ */
+ExecResult CommandHandler::handleSINTERSTORE(const std::vector<std::string_view>& args) {
+    if (args.size() < 3)
+        return ExecResult("-ERR wrong number of arguments for '" + toUpper(args[0]) + "'\r\n",
+                          false, client_fd);
+
+    std::vector<const Set*> sets;
+    if (!lookupSets({args.begin() + 2, args.end()}, sets))
+        return ExecResult(kWrongType, false, client_fd);
+
+    std::string cmd = toUpper(args[0]);
+    Set result;
+    if (cmd == "SINTERSTORE") {
+        for (const std::string& member : Set::intersect(std::move(sets)))
+            result.add(member);
+    } else if (cmd == "SUNIONSTORE") {
+        result = Set::unite(sets);
+    } else {
+        result = Set::difference(sets);
+    }
+
+    std::string dest(args[1]);
+    long long size = static_cast<long long>(result.size());
+    if (size == 0)
+        store.del(dest);
+    else
+        store.setObject(dest, RedisObj{RedisType::SET, std::move(result)});
+    return ExecResult(respInteger(size), false, client_fd);
+}
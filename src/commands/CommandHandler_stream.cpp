@@ -1,170 +1,578 @@
 #include "./CommandHandler.hpp"
 
-#include <unistd.h>
+#include <algorithm>
+#include <charconv>
+#include <map>
+
+#include "../utils/StringUtils.hpp"
+
+namespace {
+
+const char* kInvalidStreamId =
+    "-ERR Invalid stream ID specified as stream command argument\r\n";
+
+// Trim clause of XADD and XTRIM:
+//   MAXLEN|MINID [=|~] threshold [LIMIT count]
+struct TrimSpec {
+    bool byLength = true;
+    bool approx = false;
+    uint64_t maxlen = 0;
+    StreamID minid;
+    uint64_t limit = 0;
+};
+
+// Parses the clause starting at args[i] (the MAXLEN / MINID word) and
+// leaves `i` just past it. Returns the error reply, or nullptr.
+const char* parseTrim(const std::vector<std::string_view>& args, size_t& i, TrimSpec& spec) {
+    spec.byLength = toUpper(args[i++]) == "MAXLEN";
+
+    if (i < args.size() && (args[i] == "=" || args[i] == "~"))
+        spec.approx = args[i++] == "~";
+
+    if (i >= args.size())
+        return kSyntaxError;
+
+    if (spec.byLength) {
+        long long n;
+        if (!parseLongLong(args[i], n))
+            return "-ERR value is not an integer or out of range\r\n";
+        if (n < 0)
+            return "-ERR The MAXLEN argument must be >= 0.\r\n";
+        spec.maxlen = static_cast<uint64_t>(n);
+    } else if (!StreamID::parse(args[i], spec.minid)) {
+        return kInvalidStreamId;
+    }
+    ++i;
+
+    // Bounds the work of one approximate trim (Redis: 100 x node size)
+    spec.limit = spec.approx ? 100 * Stream::kNodeMaxEntries : 0;
+
+    if (i + 1 < args.size() && toUpper(args[i]) == "LIMIT") {
+        long long n;
+        if (!parseLongLong(args[i + 1], n))
+            return "-ERR value is not an integer or out of range\r\n";
+        if (n < 0)
+            return "-ERR The LIMIT argument must be >= 0.\r\n";
+        if (!spec.approx)
+            return "-ERR syntax error, LIMIT cannot be used without the special ~ option\r\n";
+        spec.limit = static_cast<uint64_t>(n);
+        i += 2;
+    }
+    return nullptr;
+}
+
+uint64_t applyTrim(Stream& stream, const TrimSpec& spec) {
+    return spec.byLength ? stream.trimByLength(spec.maxlen, spec.approx, spec.limit)
+                         : stream.trimByMinId(spec.minid, spec.approx, spec.limit);
+}
+
+std::string noGroupError(const std::string& key, const std::string& group) {
+    return "-NOGROUP No such key '" + key + "' or consumer group '" + group + "'\r\n";
+}
+
+uint64_t nowUnixMs() {
+    return static_cast<uint64_t>(getUnixTimeMs());
+}
+
+// How XREADGROUP, XCLAIM and XAUTOCLAIM log an entry changing hands:
+// absolute time and count, so replicas and AOF replay end up with the
+// same pending entry whenever they run it.
+std::vector<std::string> xclaimArgv(const std::string& key, const std::string& group,
+                                    const std::string& consumer, const StreamID& id,
+                                    const StreamPendingEntry& entry, const StreamID& last_id) {
+    return {"XCLAIM", key, group, consumer, "0", id.toString(),
+            "TIME", std::to_string(entry.deliveryTime),
+            "RETRYCOUNT", std::to_string(entry.deliveryCount),
+            "FORCE", "JUSTID", "LASTID", last_id.toString()};
+}
+
+// Range bound of XRANGE: "-", "+", or an ID whose missing sequence
+// covers the whole millisecond ("5" is 5-0 as a start, 5-max as an end).
+bool parseRangeBound(std::string_view s, bool is_end, StreamID& out) {
+    if (s == "-") {
+        out = StreamID::min();
+        return true;
+    }
+    if (s == "+") {
+        out = StreamID::max();
+        return true;
+    }
+    return StreamID::parse(s, out, is_end ? UINT64_MAX : 0);
+}
+
+// Interval bound of XRANGE / XREVRANGE / XPENDING: a range bound, or
+// "(" and an ID to leave that ID out. Returns the error reply, or
+// nullptr on success.
+const char* parseIntervalBound(std::string_view s, bool is_end, StreamID& out) {
+    if (s.empty() || s[0] != '(')
+        return parseRangeBound(s, is_end, out) ? nullptr : kInvalidStreamId;
+
+    s.remove_prefix(1);
+    if (s == "-" || s == "+" || !StreamID::parse(s, out, is_end ? UINT64_MAX : 0))
+        return kInvalidStreamId;
+    if (!(is_end ? out.decrement() : out.increment()))
+        return is_end ? "-ERR invalid end ID for the interval\r\n"
+                      : "-ERR invalid start ID for the interval\r\n";
+    return nullptr;
+}
 
+} // namespace
+
+/**
+ * RESP command: XADD key [MAXLEN|MINID [=|~] threshold [LIMIT count]]
+ *                    <* | ms-* | ms-seq> field value [field value ...]
+ *
+ * Appends one entry, then trims the stream if asked to. The key is only
+ * created once the ID has been accepted.
+ *
+ * Replication: the resolved ID is logged, and a trim that removed
+ * anything is logged as the exact "MAXLEN = <length after>" it came
+ * to. Node boundaries differ between a stream built live and one
+ * rebuilt from a snapshot, so "~" would not trim the same entries on
+ * replay.
+ */
 ExecResult CommandHandler::handleXADD(const std::vector<std::string_view>& args) {
     if (args.size() < 5) 
         return ExecResult("-ERR wrong number of arguments for 'XADD'\r\n",
                           false, client_fd);
 
     std::string stream_name = std::string(args[1]);
-    Stream& stream = store.getOrCreateStream(stream_name);
-
-    std::string id = std::string(args[2]);
 
-    StreamIdType streamType = stream.returnStreamType(id);
+    size_t idx = 2;
+    TrimSpec trim;
+    bool trimming = false;
+    while (idx < args.size()) {
+        std::string opt = toUpper(args[idx]);
+        if (opt != "MAXLEN" && opt != "MINID")
+            break;
+        if (const char* err = parseTrim(args, idx, trim))
+            return ExecResult(err, false, client_fd);
+        trimming = true;
+    }
 
+    if (idx >= args.size() || (args.size() - idx - 1) < 2) {
+        return ExecResult("-ERR XADD requires field-value pairs\r\n", false, client_fd);
+    }
 
-    if (streamType == StreamIdType::INVALID) {
-        return ExecResult(
-            "-ERR The ID specified in XADD is equal or smaller than the target stream top item\r\n",
-            false, client_fd
-        );
+    if (((args.size() - idx - 1) % 2) != 0) {
+        return ExecResult("-ERR XADD field-value pairs are incomplete\r\n", false, client_fd);
     }
-    
+
+    RedisObj* obj = store.getObject(stream_name);
+    if (obj && obj->type != RedisType::STREAM)
+        return ExecResult(kWrongType, false, client_fd);
+
+    // IDs are checked against the existing stream, or a new one
+    Stream empty;
+    const Stream& current = obj ? std::get<Stream>(obj->value) : empty;
+
+    std::string_view id_arg = args[idx];
+    StreamIdType streamType = current.returnStreamType(id_arg);
+
+    if (streamType == StreamIdType::INVALID)
+        return ExecResult(kInvalidStreamId, false, client_fd);
+
+    // The ID is parsed once here; from now on it is (ms, seq)
+    StreamID id;
     std::string err;
-    if (streamType == StreamIdType::AUTO_SEQUENCE){
-        if (!stream.addSequenceToId(id, err)) {
+    if (streamType == StreamIdType::AUTO_SEQUENCE) {
+        StreamID prefix;   // "<ms>" of "<ms>-*"
+        if (!StreamID::parse(id_arg.substr(0, id_arg.find('-')), prefix))
+            return ExecResult(kInvalidStreamId, false, client_fd);
+        if (!current.addSequenceToId(prefix.ms, id, err)) {
             return ExecResult(err, false, client_fd);
         }
     } else if(streamType == StreamIdType::AUTO_GENERATED) {
-        if(!stream.createUniqueId(id, err)) {
+        if(!current.createUniqueId(id, err)) {
             return ExecResult(err, false, client_fd);
         }
     } else {
-        if (!stream.validateId(id, err)) {
+        if (!StreamID::parse(id_arg, id))
+            return ExecResult(kInvalidStreamId, false, client_fd);
+        if (!current.validateId(id, err)) {
             return ExecResult(err, false, client_fd);
         }
     }
 
-    std::vector<std::pair<std::string, std::string>> fields;
+    for (size_t i = idx + 1; i < args.size(); ++i) {
+        if (args[i].empty()) {
+            return ExecResult("-ERR XADD fields cannot be empty\r\n", false, client_fd);
+        }
+    }
+
+    Stream& stream = obj ? std::get<Stream>(obj->value) : store.getOrCreateStream(stream_name);
 
-    if ((args.size() - 3) < 2) {
-        return ExecResult("-ERR XADD requires field-value pairs\r\n", false, client_fd);
+    // Packed straight from the argument views into the tail node
+    std::vector<std::string_view> field_values(args.begin() + idx + 1, args.end());
+    stream.addStream(id, field_values);
+
+    uint64_t trimmed = trimming ? applyTrim(stream, trim) : 0;
+
+    // Log the resolved ID so replay produces the exact same entry
+    std::string id_str = id.toString();
+    std::vector<std::string> argv = {"XADD", stream_name};
+    if (trimmed > 0) {
+        argv.insert(argv.end(), {"MAXLEN", "=", std::to_string(stream.length())});
     }
+    argv.push_back(id_str);
+    argv.insert(argv.end(), field_values.begin(), field_values.end());
+    rewriteArgv(std::move(argv));
 
-    if (((args.size() - 3) % 2) != 0) {
-        return ExecResult("-ERR XADD field-value pairs are incomplete\r\n", false, client_fd);
+    signalKeyAsReady(stream_name);
+
+    return ExecResult(valueReturnResp(id_str),
+                          false, client_fd);
+}
+
+/**
+ * RESP command: XTRIM key MAXLEN|MINID [=|~] threshold [LIMIT count]
+ *
+ * Returns the number of entries removed. Logged like XADD's trim, as
+ * the exact length it came to, and not at all when nothing was removed.
+ */
+ExecResult CommandHandler::handleXTRIM(const std::vector<std::string_view>& args) {
+    if (args.size() < 4)
+        return ExecResult("-ERR wrong number of arguments for 'XTRIM'\r\n",
+                          false, client_fd);
+
+    size_t idx = 2;
+    std::string opt = toUpper(args[idx]);
+    if (opt != "MAXLEN" && opt != "MINID")
+        return ExecResult(kSyntaxError, false, client_fd);
+
+    TrimSpec trim;
+    if (const char* err = parseTrim(args, idx, trim))
+        return ExecResult(err, false, client_fd);
+    if (idx != args.size())
+        return ExecResult(kSyntaxError, false, client_fd);
+
+    std::string stream_name = std::string(args[1]);
+    RedisObj* obj = store.getObject(stream_name);
+    if (obj && obj->type != RedisType::STREAM)
+        return ExecResult(kWrongType, false, client_fd);
+
+    uint64_t trimmed = 0;
+    if (obj) {
+        Stream& stream = std::get<Stream>(obj->value);
+        trimmed = applyTrim(stream, trim);
+        if (trimmed > 0)
+            rewriteArgv({"XTRIM", stream_name, "MAXLEN", "=", std::to_string(stream.length())});
     }
 
-    for (int i = 3; i < args.size(); i += 2) {
-        const std::string& field = std::string(args[i]);
-        const std::string& value = std::string(args[i + 1]);
+    if (trimmed == 0)
+        suppressPropagation = true;
 
-       
-        if (field.empty() || value.empty()) {
-            return ExecResult("-ERR XADD fields cannot be empty\r\n", false, client_fd);
-        }
+    return ExecResult(respInteger(static_cast<long long>(trimmed)), false, client_fd);
+}
+
+/**
+ * RESP command: XDEL key id [id ...]
+ *
+ * Returns the number of entries deleted. The stream keeps its last ID
+ * (and the key stays, even when empty), so deleted IDs are never
+ * handed out again.
+ */
+ExecResult CommandHandler::handleXDEL(const std::vector<std::string_view>& args) {
+    if (args.size() < 3)
+        return ExecResult("-ERR wrong number of arguments for 'XDEL'\r\n",
+                          false, client_fd);
+
+    // All IDs are validated before anything is deleted
+    std::vector<StreamID> ids(args.size() - 2);
+    for (size_t i = 2; i < args.size(); ++i) {
+        if (!StreamID::parse(args[i], ids[i - 2]))
+            return ExecResult(kInvalidStreamId, false, client_fd);
+    }
+
+    RedisObj* obj = store.getObject(std::string(args[1]));
+    if (obj && obj->type != RedisType::STREAM)
+        return ExecResult(kWrongType, false, client_fd);
 
-        fields.push_back({field, value});
+    long long deleted = 0;
+    if (obj) {
+        Stream& stream = std::get<Stream>(obj->value);
+        for (const StreamID& id : ids)
+            deleted += stream.deleteEntry(id) ? 1 : 0;
     }
 
-    stream.addStream(id, fields);
+    if (deleted == 0)
+        suppressPropagation = true;
 
-    wakeBlockedXReadClients(stream_name, id);
+    return ExecResult(respInteger(deleted), false, client_fd);
+}
 
-    return ExecResult(valueReturnResp(id),
+ExecResult CommandHandler::handleXLEN(const std::vector<std::string_view>& args) {
+    if (args.size() != 2)
+        return ExecResult("-ERR wrong number of arguments for 'XLEN'\r\n",
                           false, client_fd);
+
+    RedisObj* obj = store.getObject(std::string(args[1]));
+    if (!obj)
+        return ExecResult(respInteger(0), false, client_fd);
+    if (obj->type != RedisType::STREAM)
+        return ExecResult(kWrongType, false, client_fd);
+
+    const Stream& stream = std::get<Stream>(obj->value);
+    return ExecResult(respInteger(static_cast<long long>(stream.length())), false, client_fd);
 }
 
-void CommandHandler::wakeBlockedXReadClients(
-    const std::string& stream_name,
-    const std::string& new_id
-) {
-    std::vector<BlockedXReadClient> stillBlocked;
+/**
+ * RESP command: XSETID key last-id
+ *
+ * Sets the ID XADD compares new IDs against. The AOF rewrite uses it
+ * to carry the last ID of a stream whose newest entries were deleted.
+ */
+ExecResult CommandHandler::handleXSETID(const std::vector<std::string_view>& args) {
+    if (args.size() != 3)
+        return ExecResult("-ERR wrong number of arguments for 'XSETID'\r\n",
+                          false, client_fd);
 
-    for (auto& bc : blockedXReadClients) {
-        if (bc.stream_name != stream_name) {
-            stillBlocked.push_back(bc);
-            continue;
-        }
+    StreamID id;
+    if (!StreamID::parse(args[2], id))
+        return ExecResult(kInvalidStreamId, false, client_fd);
+
+    RedisObj* obj = store.getObject(std::string(args[1]));
+    if (!obj)
+        return ExecResult("-ERR no such key\r\n", false, client_fd);
+    if (obj->type != RedisType::STREAM)
+        return ExecResult(kWrongType, false, client_fd);
+
+    std::string err;
+    if (!std::get<Stream>(obj->value).setLastId(id, err))
+        return ExecResult(err, false, client_fd);
+
+    return ExecResult("+OK\r\n", false, client_fd);
+}
 
-        RedisObj* obj = store.getObject(stream_name);
-        if (!obj || obj->type != RedisType::STREAM) {
+ExecResult CommandHandler::blockOnStreams(BlockedXReadClient bc) {
+    for (const std::string& key : bc.keys) {
+        auto& waiters = blockedXReadClients[key];
+        bc.positions.push_back(waiters.insert(waiters.end(), client_fd));
+    }
+
+    if (bc.deadline_ms)
+        blockedTimeouts.insert({ bc.deadline_ms, client_fd });
+    blockedXReadByFd[client_fd] = std::move(bc);
+
+    return ExecResult("", true, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * serveClientsBlockedOnStream
+ * ----------------------------------------------------
+ * Runs from handleClientsBlockedOnKeys once a command
+ * added entries to `key`. Only the clients queued on that
+ * key are visited, in the order they blocked:
+ *
+ *   • XREAD: everything after the ID it was waiting from.
+ *     Waiters that share that ID get the same reply, so it
+ *     is read and encoded once; each of them then gets a
+ *     copy of it in its output buffer.
+ *   • XREADGROUP: the first reader of a group takes the new
+ *     entries; the group's other readers keep waiting.
+ *
+ * A served client leaves the queues of all its keys, so
+ * one XREAD over several streams is answered once.
+*/
+void CommandHandler::serveClientsBlockedOnStream(const std::string& key, Stream& stream) {
+    auto blk_it = blockedXReadClients.find(key);
+    if (blk_it == blockedXReadClients.end())
+        return;
+
+    // Serving unblocks clients, which edits the queue
+    std::vector<int> fds(blk_it->second.begin(), blk_it->second.end());
+    std::map<StreamID, std::string> encoded;   // empty: nothing to send
+    StreamID last_id = stream.getLastId();
+
+    for (int fd : fds) {
+        auto it = blockedXReadByFd.find(fd);
+        if (it == blockedXReadByFd.end())
             continue;
-        }
+        BlockedXReadClient& bc = it->second;
+
+        if (!bc.group.empty()) {
+            StreamGroup* group = stream.findGroup(bc.group);
+            if (!group) {
+                std::string group_name = bc.group;
+                unblockClient(fd);
+                sendToClient(fd, noGroupError(key, group_name));
+                continue;
+            }
 
-        Stream& stream = std::get<Stream>(obj->value);
+            auto entries = deliverNewEntries(key, stream, bc.group, *group,
+                                             bc.consumer, bc.count, bc.noack);
+            if (entries.empty())
+                continue;
 
-        std::string err;
-        auto entries = stream.getPairsFromIdToEnd(err, bc.last_id);
-        if (!err.empty() || entries.empty()) {
+            unblockClient(fd);
+            sendToClient(fd, wrapXReadBlocks({ respXRead(key, entries) }));
             continue;
         }
 
-        // Encode response
-        std::string blockResp = wrapXReadBlocks({
-            respXRead(stream_name, entries)
-        });
+        size_t i = std::find(bc.keys.begin(), bc.keys.end(), key) - bc.keys.begin();
+        const StreamID& next_id = bc.next_ids[i];
+        if (last_id < next_id)
+            continue;
 
-        ::write(bc.fd, blockResp.c_str(), blockResp.size());
-        // Do not re-add → remove from block list
-    }
+        auto [enc_it, fresh] = encoded.try_emplace(next_id);
+        if (fresh) {
+            std::string reply = "*1\r\n";
+            if (appendXReadBlock(reply, key, stream, next_id))
+                enc_it->second = std::move(reply);
+        }
+        if (enc_it->second.empty())
+            continue;
 
-    blockedXReadClients = std::move(stillBlocked);
+        unblockClient(fd);
+        sendToClient(fd, enc_it->second);
+    }
 }
 
 
+/**
+ * RESP command: XRANGE key start end [COUNT n]
+ *               XREVRANGE key end start [COUNT n]
+ *
+ * Bounds are "-", "+", an ID (a bare millisecond covers all of it) or
+ * "(" and an ID to exclude it. XREVRANGE returns newest first.
+ *
+ * Entries are encoded straight from the stream nodes into the reply,
+ * so the work and the memory used are those of the entries returned;
+ * COUNT stops the walk.
+ */
 ExecResult CommandHandler::handleXRANGE(const std::vector<std::string_view>& args) {
-    if (args.size() != 4) {
-        return ExecResult("-ERR wrong number of arguments for 'XRANGE'\r\n",
+    return streamRange(args, false);
+}
+
+ExecResult CommandHandler::handleXREVRANGE(const std::vector<std::string_view>& args) {
+    return streamRange(args, true);
+}
+
+ExecResult CommandHandler::streamRange(const std::vector<std::string_view>& args, bool reverse) {
+    const char* name = reverse ? "XREVRANGE" : "XRANGE";
+    if (args.size() != 4 && args.size() != 6)
+        return ExecResult(std::string("-ERR wrong number of arguments for '") + name + "'\r\n",
                           false, client_fd);
-    }
 
-    std::string stream_name = std::string(args[1]);
-    std::string start_id    = std::string(args[2]);
-    std::string end_id      = std::string(args[3]);
+    StreamID start_id, end_id;
+    const char* err = parseIntervalBound(args[reverse ? 3 : 2], false, start_id);
+    if (!err)
+        err = parseIntervalBound(args[reverse ? 2 : 3], true, end_id);
+    if (err)
+        return ExecResult(err, false, client_fd);
 
-    // Stream yoksa → boş array dön (Redis davranışı)
-    RedisObj* obj = store.getObject(stream_name);
-    if (!obj) {
-        return ExecResult(respArray({}), false, client_fd);
+    long long count = -1;    // no COUNT
+    if (args.size() == 6) {
+        if (toUpper(args[4]) != "COUNT")
+            return ExecResult(kSyntaxError, false, client_fd);
+        if (!parseLongLong(args[5], count))
+            return ExecResult("-ERR value is not an integer or out of range\r\n",
+                              false, client_fd);
+        count = std::max(count, 0LL);
     }
 
-    if (obj->type != RedisType::STREAM) {
-        return ExecResult("-WRONGTYPE Key is not a stream\r\n",
-                          false, client_fd);
-    }
+    RedisObj* obj = store.getObject(std::string(args[1]));
+    if (obj && obj->type != RedisType::STREAM)
+        return ExecResult(kWrongType, false, client_fd);
+    if (!obj || count == 0)
+        return ExecResult("*0\r\n", false, client_fd);
 
-    Stream& stream = std::get<Stream>(obj->value);
+    Stream::Iterator it(std::get<Stream>(obj->value), start_id, end_id, reverse);
+    std::string body;
+    size_t n = appendStreamRange(body, it, count < 0 ? 0 : static_cast<size_t>(count));
 
-    std::string err;
+    return ExecResult("*" + std::to_string(n) + "\r\n" + body, false, client_fd);
+}
 
-    if (start_id == "-") {
-        auto entries = stream.getPairsFromStartToId(err, end_id);
-        std::string payload = respXRange(entries);
-        return ExecResult(payload, false, client_fd);
-    }
+/**
+ * RESP command: XAGG key start end field bucket-ms
+ *               [MIN | MAX | SUM | COUNT | AVG | FIRST | LAST ...]
+ *
+ * Behavior:
+ *   Aggregates the numeric values of `field` over the entries in
+ *   [start, end] (bounds as in XRANGE) into buckets of bucket-ms
+ *   milliseconds of entry ID time, aligned to multiples of bucket-ms.
+ *   Entries without the field or with a non-numeric value are skipped.
+ *   Without aggregators, all seven are returned in the order above.
+ *
+ * Return:
+ *   One [bucket start, value ...] array per non-empty bucket, oldest
+ *   first. COUNT is an integer, the other values are bulk strings.
+ */
+ExecResult CommandHandler::handleXAGG(const std::vector<std::string_view>& args) {
+    if (args.size() < 6)
+        return ExecResult("-ERR wrong number of arguments for 'XAGG'\r\n",
+                          false, client_fd);
 
-    if (end_id == "+") {
-        auto entries = stream.getPairsFromIdToEnd(err, start_id);
-        std::string payload = respXRange(entries);
-        return ExecResult(payload, false, client_fd);
-    }
+    StreamID start_id, end_id;
+    const char* err = parseIntervalBound(args[2], false, start_id);
+    if (!err)
+        err = parseIntervalBound(args[3], true, end_id);
+    if (err)
+        return ExecResult(err, false, client_fd);
 
-    auto entries = stream.getPairsInRange(err, start_id, end_id);
+    long long bucket_ms;
+    if (!parseLongLong(args[5], bucket_ms) || bucket_ms <= 0)
+        return ExecResult("-ERR bucket size must be a positive integer\r\n",
+                          false, client_fd);
 
-    if (!err.empty()) {
-        return ExecResult(err, false, client_fd);
+    static const std::vector<std::string> kAll = {
+        "MIN", "MAX", "SUM", "COUNT", "AVG", "FIRST", "LAST"
+    };
+    std::vector<std::string> aggs;
+    for (size_t i = 6; i < args.size(); ++i) {
+        std::string agg = toUpper(args[i]);
+        if (std::find(kAll.begin(), kAll.end(), agg) == kAll.end())
+            return ExecResult("-ERR unknown aggregator '" + std::string(args[i]) + "'\r\n",
+                              false, client_fd);
+        aggs.push_back(std::move(agg));
     }
-
-    // XRANGE output
-    std::string payload = respXRange(entries);
-    return ExecResult(payload, false, client_fd);
+    if (aggs.empty())
+        aggs = kAll;
+
+    RedisObj* obj = store.getObject(std::string(args[1]));
+    if (obj && obj->type != RedisType::STREAM)
+        return ExecResult(kWrongType, false, client_fd);
+    if (!obj)
+        return ExecResult("*0\r\n", false, client_fd);
+
+    auto buckets = std::get<Stream>(obj->value).aggregate(
+        start_id, end_id, args[4], static_cast<uint64_t>(bucket_ms));
+
+    std::string out = "*" + std::to_string(buckets.size()) + "\r\n";
+    for (const StreamBucket& b : buckets) {
+        out += "*" + std::to_string(aggs.size() + 1) + "\r\n";
+        out += respInteger(static_cast<long long>(b.start));
+        for (const std::string& agg : aggs) {
+            if (agg == "COUNT") {
+                out += respInteger(static_cast<long long>(b.count));
+                continue;
+            }
+            double v = agg == "MIN" ? b.min
+                     : agg == "MAX" ? b.max
+                     : agg == "SUM" ? b.sum
+                     : agg == "AVG" ? b.sum / static_cast<double>(b.count)
+                     : agg == "FIRST" ? b.first
+                     : b.last;
+            appendBulk(out, formatDouble(v));
+        }
+    }
+    return ExecResult(out, false, client_fd);
 }
 
 ExecResult CommandHandler::handleXREAD(const std::vector<std::string_view>& args) {
     //
     // XREAD [BLOCK ms] STREAMS key1 key2 ... id1 id2 ...
     //
-    int idx = 1;
+    size_t idx = 1;
     bool is_blocking = false;
     uint64_t block_timeout = 0;
 
     // -------------------------------------------------
     // 1) Parse BLOCK
     // -------------------------------------------------
-    if (idx < args.size() && (args[idx] == "BLOCK" || args[idx] == "block")) {
+    if (idx < args.size() && toUpper(args[idx]) == "BLOCK") {
         is_blocking = true;
 
         if (idx + 1 >= args.size())
@@ -182,54 +590,57 @@ ExecResult CommandHandler::handleXREAD(const std::vector<std::string_view>& args
     // -------------------------------------------------
     // 2) STREAMS keyword
     // -------------------------------------------------
-    if (idx >= args.size() || args[idx] != "streams")
+    if (idx >= args.size() || toUpper(args[idx]) != "STREAMS")
         return ExecResult("-ERR syntax error\r\n", false, client_fd);
 
     idx++;
 
-    int remaining = args.size() - idx;
+    size_t remaining = args.size() - idx;
     if (remaining < 2)
         return ExecResult("-ERR wrong number of arguments for 'XREAD'\r\n", false, client_fd);
 
     if (remaining % 2 != 0)
         return ExecResult("-ERR XREAD requires equal number of keys and IDs\r\n", false, client_fd);
 
-    int half = remaining / 2;
+    size_t half = remaining / 2;
 
     std::vector<std::string> stream_names;
-    std::vector<std::string> stream_ids;
+    std::vector<StreamID> stream_ids;
 
     stream_names.reserve(half);
     stream_ids.reserve(half);
 
-    for (int i = 0; i < half; i++)
+    for (size_t i = 0; i < half; i++)
         stream_names.push_back(std::string(args[idx + i]));
 
-    for (int i = 0; i < half; i++)
-        stream_ids.push_back(std::string(args[idx + half + i]));
-
     // -------------------------------------------------
-    // 3) Resolve "$" BEFORE immediate read
+    // 3) Parse IDs, resolving "$" BEFORE immediate read
     // -------------------------------------------------
-    for (int i = 0; i < half; i++) {
-        if (stream_ids[i] == "$") {
+    for (size_t i = 0; i < half; i++) {
+        std::string_view id_arg = args[idx + half + i];
+        StreamID id;
+
+        if (id_arg == "$") {
             RedisObj* obj = store.getObject(stream_names[i]);
 
             if (obj && obj->type == RedisType::STREAM) {
                 Stream& st = std::get<Stream>(obj->value);
-                stream_ids[i] = st.getLastId();  // empty stream → "0-0"
-            } else {
-                stream_ids[i] = "0-0";
+                id = st.getLastId();  // empty stream → 0-0
             }
+        } else if (!StreamID::parse(id_arg, id)) {
+            return ExecResult(kInvalidStreamId, false, client_fd);
         }
+
+        stream_ids.push_back(id);
     }
 
     // -------------------------------------------------
     // 4) Immediate read attempt
     // -------------------------------------------------
-    std::vector<std::string> results;
+    std::string blocks;
+    size_t num_blocks = 0;
 
-    for (int i = 0; i < half; i++) {
+    for (size_t i = 0; i < half; i++) {
 
         RedisObj* obj = store.getObject(stream_names[i]);
         if (!obj || obj->type != RedisType::STREAM)
@@ -237,22 +648,19 @@ ExecResult CommandHandler::handleXREAD(const std::vector<std::string_view>& args
 
         Stream& stream = std::get<Stream>(obj->value);
 
-        // exclusive read → increment id
-        std::string next_id = stream.incrementId(stream_ids[i]);
-
-        std::string err;
-        auto entries = stream.getPairsFromIdToEnd(err, next_id);
-
-        if (!err.empty())
-            return ExecResult(err, false, client_fd);
+        // exclusive read → increment id (nothing follows the last ID)
+        StreamID next_id = stream_ids[i];
+        if (!next_id.increment())
+            continue;
 
-        if (!entries.empty())
-            results.push_back(respXRead(stream_names[i], entries));
+        if (appendXReadBlock(blocks, stream_names[i], stream, next_id))
+            ++num_blocks;
     }
 
     // If data was found → return immediately
-    if (!results.empty()) {
-        return ExecResult(wrapXReadBlocks(results), false, client_fd);
+    if (num_blocks > 0) {
+        return ExecResult("*" + std::to_string(num_blocks) + "\r\n" + blocks,
+                          false, client_fd);
     }
 
     // -------------------------------------------------
@@ -263,48 +671,774 @@ ExecResult CommandHandler::handleXREAD(const std::vector<std::string_view>& args
     }
 
     // -------------------------------------------------
-    // 6) Blocking mode → register client
+    // 6) Blocking mode → register client under every key,
+    //    including streams that do not exist yet
     // -------------------------------------------------
     uint64_t now = current_time_ms();
-    uint64_t deadline = (block_timeout == 0 ? 0 : now + block_timeout);
+    BlockedXReadClient bc{ .fd = client_fd,
+                           .deadline_ms = block_timeout == 0 ? 0 : now + block_timeout };
+
+    for (size_t i = 0; i < half; i++) {
+        StreamID next_id = stream_ids[i];
+        if (!next_id.increment())
+            continue;   // nothing can follow the maximum ID
+        if (std::find(bc.keys.begin(), bc.keys.end(), stream_names[i]) != bc.keys.end())
+            continue;
 
-    for (int i = 0; i < half; i++) {
-        RedisObj* obj = store.getObject(stream_names[i]);
-        if (!obj || obj->type != RedisType::STREAM)
+        bc.keys.push_back(stream_names[i]);
+        bc.next_ids.push_back(next_id);
+    }
+
+    if (bc.keys.empty())
+        return ExecResult("*-1\r\n", false, client_fd);
+    return blockOnStreams(std::move(bc));   // do not send anything yet
+}
+
+
+
+
+// ---------------------------------------------------------------------
+// Consumer groups
+// ---------------------------------------------------------------------
+
+void CommandHandler::appendStreamEntry(std::string& out, const StreamID& id,
+                                       const StreamFields* fields) {
+    out += "*2\r\n";
+    appendBulk(out, id.toString());
+    if (!fields) {
+        out += "*-1\r\n";
+        return;
+    }
+    out += "*" + std::to_string(fields->size() * 2) + "\r\n";
+    for (const auto& [field, value] : *fields) {
+        appendBulk(out, field);
+        appendBulk(out, value);
+    }
+}
+
+size_t CommandHandler::appendStreamRange(std::string& out, Stream::Iterator& it, size_t count) {
+    StreamID id;
+    std::string_view field, value;
+    size_t n = 0;
+    while ((count == 0 || n < count) && it.next(id)) {
+        out += "*2\r\n";
+        appendBulk(out, id.toString());
+        out += "*" + std::to_string(it.fieldCount() * 2) + "\r\n";
+        while (it.nextField(field, value)) {
+            appendBulk(out, field);
+            appendBulk(out, value);
+        }
+        ++n;
+    }
+    return n;
+}
+
+bool CommandHandler::appendXReadBlock(std::string& out, const std::string& key,
+                                      const Stream& stream, const StreamID& from) {
+    Stream::Iterator it(stream, from, StreamID::max());
+    std::string body;
+    size_t n = appendStreamRange(body, it, 0);
+    if (n == 0)
+        return false;
+
+    out += "*2\r\n";
+    appendBulk(out, key);
+    out += "*" + std::to_string(n) + "\r\n";
+    out += body;
+    return true;
+}
+
+/**
+ * Serves XREADGROUP ">" on one stream: up to `count` entries after the
+ * group's last ID, which moves past them. Unless NOACK, each becomes
+ * pending for the consumer and is logged as a forced XCLAIM (NOACK
+ * reads only log the new last ID).
+ */
+std::vector<std::pair<StreamID, StreamFields>> CommandHandler::deliverNewEntries(
+    const std::string& key, Stream& stream, const std::string& group_name,
+    StreamGroup& group, const std::string& consumer_name, size_t count, bool noack
+) {
+    StreamID start = group.lastId;
+    if (!start.increment())
+        return {};
+
+    auto entries = stream.getPairsInRange(start, StreamID::max(), count);
+    if (entries.empty())
+        return entries;
+
+    bool created;
+    StreamConsumer& consumer = group.consumer(consumer_name, created);
+    if (created)
+        alsoPropagate({"XGROUP", "CREATECONSUMER", key, group_name, consumer_name});
+
+    uint64_t now = nowUnixMs();
+    consumer.seenTime = now;
+    group.lastId = entries.back().first;
+
+    if (noack) {
+        alsoPropagate({"XGROUP", "SETID", key, group_name, group.lastId.toString()});
+        return entries;
+    }
+
+    for (const auto& e : entries) {
+        group.addPending(e.first, consumer, now);
+        alsoPropagate(xclaimArgv(key, group_name, consumer_name, e.first,
+                                 *group.findPending(e.first), group.lastId));
+    }
+    return entries;
+}
+
+/**
+ * RESP command: XGROUP CREATE key group <id | $> [MKSTREAM]
+ *               XGROUP SETID key group <id | $>
+ *               XGROUP DESTROY key group
+ *               XGROUP CREATECONSUMER key group consumer
+ *               XGROUP DELCONSUMER key group consumer
+ *
+ * "$" is resolved to the stream's last ID before the command is
+ * logged. DESTROY answers the group's blocked readers with -NOGROUP;
+ * DELCONSUMER returns how many pending entries went with the consumer.
+ */
+ExecResult CommandHandler::handleXGROUP(const std::vector<std::string_view>& args) {
+    if (args.size() < 4)
+        return ExecResult("-ERR wrong number of arguments for 'XGROUP'\r\n",
+                          false, client_fd);
+
+    std::string sub = toUpper(args[1]);
+    std::string key(args[2]);
+    std::string group_name(args[3]);
+
+    bool mkstream = false;
+    size_t expected = (sub == "DESTROY") ? 4 : 5;
+    if (sub == "CREATE" && args.size() == 6 && toUpper(args[5]) == "MKSTREAM")
+        mkstream = true;
+    else if (sub != "CREATE" && sub != "SETID" && sub != "DESTROY" &&
+             sub != "CREATECONSUMER" && sub != "DELCONSUMER")
+        return ExecResult("-ERR unknown subcommand '" + std::string(args[1]) +
+                          "'. Try XGROUP HELP.\r\n", false, client_fd);
+    else if (args.size() != expected)
+        return ExecResult("-ERR wrong number of arguments for 'XGROUP|" + sub + "'\r\n",
+                          false, client_fd);
+
+    RedisObj* obj = store.getObject(key);
+    if (obj && obj->type != RedisType::STREAM)
+        return ExecResult(kWrongType, false, client_fd);
+    if (!obj && !mkstream)
+        return ExecResult("-ERR The XGROUP subcommand requires the key to exist. "
+                          "Note that for CREATE you may want to use the MKSTREAM option "
+                          "to create an empty stream automatically.\r\n", false, client_fd);
+
+    if (sub == "CREATE" || sub == "SETID") {
+        StreamID id;
+        if (args[4] == "$")
+            id = obj ? std::get<Stream>(obj->value).getLastId() : StreamID::min();
+        else if (!StreamID::parse(args[4], id))
+            return ExecResult(kInvalidStreamId, false, client_fd);
+
+        Stream& stream = obj ? std::get<Stream>(obj->value) : store.getOrCreateStream(key);
+        if (sub == "CREATE") {
+            if (!stream.createGroup(group_name, id))
+                return ExecResult("-BUSYGROUP Consumer Group name already exists\r\n",
+                                  false, client_fd);
+        } else {
+            StreamGroup* group = stream.findGroup(group_name);
+            if (!group)
+                return ExecResult("-NOGROUP No such consumer group '" + group_name +
+                                  "' for key name '" + key + "'\r\n", false, client_fd);
+            group->lastId = id;
+        }
+
+        std::vector<std::string> argv(args.begin(), args.end());
+        argv[4] = id.toString();
+        rewriteArgv(std::move(argv));
+        return ExecResult("+OK\r\n", false, client_fd);
+    }
+
+    Stream& stream = std::get<Stream>(obj->value);
+
+    if (sub == "DESTROY") {
+        if (!stream.destroyGroup(group_name)) {
+            suppressPropagation = true;
+            return ExecResult(respInteger(0), false, client_fd);
+        }
+
+        if (auto blk_it = blockedXReadClients.find(key); blk_it != blockedXReadClients.end()) {
+            std::vector<int> fds(blk_it->second.begin(), blk_it->second.end());
+            for (int fd : fds) {
+                if (blockedXReadByFd.at(fd).group != group_name)
+                    continue;
+                unblockClient(fd);
+                sendToClient(fd, noGroupError(key, group_name));
+            }
+        }
+        return ExecResult(respInteger(1), false, client_fd);
+    }
+
+    StreamGroup* group = stream.findGroup(group_name);
+    if (!group)
+        return ExecResult("-NOGROUP No such consumer group '" + group_name +
+                          "' for key name '" + key + "'\r\n", false, client_fd);
+
+    std::string consumer_name(args[4]);
+    if (sub == "CREATECONSUMER") {
+        bool created;
+        group->consumer(consumer_name, created).seenTime = nowUnixMs();
+        if (!created)
+            suppressPropagation = true;
+        return ExecResult(respInteger(created ? 1 : 0), false, client_fd);
+    }
+
+    // DELCONSUMER
+    int64_t pending = group->deleteConsumer(consumer_name);
+    if (pending < 0) {
+        suppressPropagation = true;
+        pending = 0;
+    }
+    return ExecResult(respInteger(pending), false, client_fd);
+}
+
+/**
+ * RESP command: XREADGROUP GROUP group consumer [COUNT n] [BLOCK ms] [NOACK]
+ *               STREAMS key [key ...] id [id ...]
+ *
+ * Behavior:
+ *   ">"   → entries never delivered to the group (see deliverNewEntries)
+ *   an ID → the consumer's own pending entries after it (its history);
+ *           entries deleted from the stream come back as [id, nil]
+ *
+ *   Only a read with ">" on every stream blocks, and only when none of
+ *   them has new entries. The waiter is parked with the XREAD ones and
+ *   competes with the group's other readers on the next XADD.
+ *
+ * Replication: nothing is logged for the command itself; deliveries
+ * are logged as XCLAIM (see deliverNewEntries).
+ */
+ExecResult CommandHandler::handleXREADGROUP(const std::vector<std::string_view>& args) {
+    if (args.size() < 7 || toUpper(args[1]) != "GROUP")
+        return ExecResult("-ERR wrong number of arguments for 'XREADGROUP'\r\n",
+                          false, client_fd);
+
+    suppressPropagation = true;
+
+    std::string group_name(args[2]);
+    std::string consumer_name(args[3]);
+
+    size_t count = 0;
+    bool is_blocking = false;
+    bool noack = false;
+    uint64_t block_timeout = 0;
+
+    size_t idx = 4;
+    for (; idx < args.size(); ++idx) {
+        std::string opt = toUpper(args[idx]);
+        if (opt == "STREAMS")
+            break;
+
+        if (opt == "NOACK") {
+            noack = true;
             continue;
+        }
+        if ((opt != "COUNT" && opt != "BLOCK") || idx + 1 >= args.size())
+            return ExecResult(kSyntaxError, false, client_fd);
+
+        long long n;
+        if (!parseLongLong(args[++idx], n))
+            return ExecResult(opt == "COUNT" ? "-ERR value is not an integer or out of range\r\n"
+                                             : "-ERR timeout is not an integer or out of range\r\n",
+                              false, client_fd);
+        if (opt == "COUNT") {
+            count = n > 0 ? static_cast<size_t>(n) : 0;
+        } else {
+            if (n < 0)
+                return ExecResult("-ERR timeout is negative\r\n", false, client_fd);
+            is_blocking = true;
+            block_timeout = static_cast<uint64_t>(n);
+        }
+    }
+
+    size_t remaining = idx < args.size() ? args.size() - idx - 1 : 0;
+    if (remaining == 0 || remaining % 2 != 0)
+        return ExecResult("-ERR Unbalanced 'xreadgroup' list of streams: for each stream key "
+                          "an ID or '>' must be specified.\r\n", false, client_fd);
+
+    size_t half = remaining / 2;
+    size_t keys_at = idx + 1;
+
+    // Everything is checked before any stream is read
+    std::vector<StreamID> ids(half);
+    std::vector<bool> fresh(half);
+    for (size_t i = 0; i < half; ++i) {
+        std::string key(args[keys_at + i]);
+        RedisObj* obj = store.getObject(key);
+        if (obj && obj->type != RedisType::STREAM)
+            return ExecResult(kWrongType, false, client_fd);
+        if (!obj || !std::get<Stream>(obj->value).findGroup(group_name))
+            return ExecResult("-NOGROUP No such key '" + key + "' or consumer group '" +
+                              group_name + "' in XREADGROUP with GROUP option\r\n",
+                              false, client_fd);
+
+        std::string_view id_arg = args[keys_at + half + i];
+        fresh[i] = id_arg == ">";
+        if (id_arg == "$")
+            return ExecResult("-ERR The $ ID is meaningless in the context of XREADGROUP: "
+                              "you want to read the history of this consumer by specifying "
+                              "a proper ID, or use the > ID to get new messages. The $ ID "
+                              "would just return an empty result set.\r\n", false, client_fd);
+        if (!fresh[i] && !StreamID::parse(id_arg, ids[i]))
+            return ExecResult(kInvalidStreamId, false, client_fd);
+    }
 
-        Stream& st = std::get<Stream>(obj->value);
+    std::vector<std::string> results;
+    bool history = false;
+
+    for (size_t i = 0; i < half; ++i) {
+        std::string key(args[keys_at + i]);
+        Stream& stream = std::get<Stream>(store.getObject(key)->value);
+        StreamGroup& group = *stream.findGroup(group_name);
+
+        if (fresh[i]) {
+            auto entries = deliverNewEntries(key, stream, group_name, group,
+                                             consumer_name, count, noack);
+            if (!entries.empty())
+                results.push_back(respXRead(key, entries));
+            continue;
+        }
 
-        std::string next_id = st.incrementId(stream_ids[i]);
+        // History: the consumer's pending entries after the given ID
+        history = true;
+        bool created;
+        StreamConsumer& consumer = group.consumer(consumer_name, created);
+        if (created)
+            alsoPropagate({"XGROUP", "CREATECONSUMER", key, group_name, consumer_name});
+        uint64_t now = nowUnixMs();
+        consumer.seenTime = now;
+
+        std::string body;
+        size_t n = 0;
+        StreamID after = ids[i];
+        if (after.increment()) {
+            for (auto it = consumer.pending.lower_bound(after);
+                 it != consumer.pending.end() && (count == 0 || n < count); ++it, ++n) {
+                auto entry = stream.getPairsInRange(it->first, it->first);
+                if (entry.empty()) {
+                    appendStreamEntry(body, it->first, nullptr);
+                    continue;
+                }
+                it->second->deliveryTime = now;
+                it->second->deliveryCount++;
+                appendStreamEntry(body, it->first, &entry[0].second);
+            }
+        }
 
-        blockedXReadClients.push_back({
-            client_fd,
-            deadline,
-            stream_names[i],
-            next_id
-        });
+        std::string block = "*1\r\n*2\r\n";
+        appendBulk(block, key);
+        block += "*" + std::to_string(n) + "\r\n" + body;
+        results.push_back(std::move(block));
     }
 
-    return ExecResult("", true, client_fd);  // do not send anything yet
+    if (!results.empty() || history)
+        return ExecResult(wrapXReadBlocks(results), false, client_fd);
+
+    if (!is_blocking)
+        return ExecResult("*-1\r\n", false, client_fd);
+
+    BlockedXReadClient bc{ .fd = client_fd,
+                           .deadline_ms = block_timeout == 0 ? 0 : current_time_ms() + block_timeout };
+    for (size_t i = 0; i < half; ++i) {
+        std::string key(args[keys_at + i]);
+        if (std::find(bc.keys.begin(), bc.keys.end(), key) == bc.keys.end())
+            bc.keys.push_back(std::move(key));
+    }
+    bc.group = group_name;
+    bc.consumer = consumer_name;
+    bc.count = count;
+    bc.noack = noack;
+    return blockOnStreams(std::move(bc));
 }
 
+/**
+ * RESP command: XACK key group id [id ...]
+ *
+ * Removes the IDs from the group's PEL and their consumers' indexes.
+ * Returns how many were pending.
+ */
+ExecResult CommandHandler::handleXACK(const std::vector<std::string_view>& args) {
+    if (args.size() < 4)
+        return ExecResult("-ERR wrong number of arguments for 'XACK'\r\n",
+                          false, client_fd);
 
+    std::vector<StreamID> ids(args.size() - 3);
+    for (size_t i = 3; i < args.size(); ++i) {
+        if (!StreamID::parse(args[i], ids[i - 3]))
+            return ExecResult(kInvalidStreamId, false, client_fd);
+    }
 
+    RedisObj* obj = store.getObject(std::string(args[1]));
+    if (obj && obj->type != RedisType::STREAM)
+        return ExecResult(kWrongType, false, client_fd);
 
-void CommandHandler::checkXReadTimeouts() {
-    uint64_t now = current_time_ms();
+    StreamGroup* group = obj ? std::get<Stream>(obj->value).findGroup(std::string(args[2]))
+                             : nullptr;
+    long long acked = 0;
+    if (group) {
+        for (const StreamID& id : ids)
+            acked += group->ack(id) ? 1 : 0;
+    }
+
+    if (acked == 0)
+        suppressPropagation = true;
+    return ExecResult(respInteger(acked), false, client_fd);
+}
+
+/**
+ * RESP command: XPENDING key group
+ *               XPENDING key group [IDLE ms] start end count [consumer]
+ *
+ * Summary form: [count, smallest ID, greatest ID, [[consumer, count]...]].
+ * Extended form: [id, consumer, idle ms, deliveries] for up to `count`
+ * pending entries in [start, end], from the group PEL or, with a
+ * consumer, from that consumer's own index.
+ */
+ExecResult CommandHandler::handleXPENDING(const std::vector<std::string_view>& args) {
+    if (args.size() < 3)
+        return ExecResult("-ERR wrong number of arguments for 'XPENDING'\r\n",
+                          false, client_fd);
+
+    std::string key(args[1]);
+    std::string group_name(args[2]);
+
+    bool extended = args.size() > 3;
+    uint64_t min_idle = 0;
+    size_t idx = 3;
+    if (extended && toUpper(args[idx]) == "IDLE") {
+        long long n;
+        if (idx + 1 >= args.size() || !parseLongLong(args[idx + 1], n))
+            return ExecResult("-ERR value is not an integer or out of range\r\n", false, client_fd);
+        min_idle = n > 0 ? static_cast<uint64_t>(n) : 0;
+        idx += 2;
+    }
+
+    StreamID start, end;
+    long long count = 0;
+    if (extended) {
+        if (args.size() - idx != 3 && args.size() - idx != 4)
+            return ExecResult(kSyntaxError, false, client_fd);
+        const char* err = parseIntervalBound(args[idx], false, start);
+        if (!err)
+            err = parseIntervalBound(args[idx + 1], true, end);
+        if (err)
+            return ExecResult(err, false, client_fd);
+        if (!parseLongLong(args[idx + 2], count))
+            return ExecResult("-ERR value is not an integer or out of range\r\n", false, client_fd);
+    }
+
+    RedisObj* obj = store.getObject(key);
+    if (obj && obj->type != RedisType::STREAM)
+        return ExecResult(kWrongType, false, client_fd);
+    StreamGroup* group = obj ? std::get<Stream>(obj->value).findGroup(group_name) : nullptr;
+    if (!group)
+        return ExecResult(noGroupError(key, group_name), false, client_fd);
+
+    const auto& pel = group->pel();
+
+    if (!extended) {
+        if (pel.empty())
+            return ExecResult("*4\r\n:0\r\n$-1\r\n$-1\r\n*-1\r\n", false, client_fd);
+
+        std::string out = "*4\r\n" + respInteger(static_cast<long long>(pel.size()));
+        appendBulk(out, pel.begin()->first.toString());
+        appendBulk(out, pel.rbegin()->first.toString());
+
+        std::string owners;
+        size_t n = 0;
+        for (const auto& [name, consumer] : group->consumers()) {
+            if (consumer.pending.empty())
+                continue;
+            owners += "*2\r\n";
+            appendBulk(owners, name);
+            appendBulk(owners, std::to_string(consumer.pending.size()));
+            ++n;
+        }
+        out += "*" + std::to_string(n) + "\r\n" + owners;
+        return ExecResult(out, false, client_fd);
+    }
 
-    for (auto it = blockedXReadClients.begin(); it != blockedXReadClients.end(); ) {
+    uint64_t now = nowUnixMs();
+    std::string body;
+    long long n = 0;
+
+    auto emit = [&](const StreamID& id, const StreamPendingEntry& entry) {
+        uint64_t idle = now > entry.deliveryTime ? now - entry.deliveryTime : 0;
+        if (idle < min_idle)
+            return;
+        body += "*4\r\n";
+        appendBulk(body, id.toString());
+        appendBulk(body, entry.consumer->name);
+        body += respInteger(static_cast<long long>(idle));
+        body += respInteger(static_cast<long long>(entry.deliveryCount));
+        ++n;
+    };
+
+    if (args.size() - idx == 4) {
+        StreamConsumer* consumer = group->findConsumer(std::string(args[idx + 3]));
+        if (consumer) {
+            for (auto it = consumer->pending.lower_bound(start);
+                 it != consumer->pending.end() && it->first <= end && n < count; ++it)
+                emit(it->first, *it->second);
+        }
+    } else {
+        for (auto it = pel.lower_bound(start); it != pel.end() && it->first <= end && n < count; ++it)
+            emit(it->first, it->second);
+    }
+
+    return ExecResult("*" + std::to_string(n) + "\r\n" + body, false, client_fd);
+}
+
+/**
+ * RESP command: XCLAIM key group consumer min-idle-time id [id ...]
+ *               [IDLE ms] [TIME unix-ms] [RETRYCOUNT n] [FORCE] [JUSTID]
+ *               [LASTID id]
+ *
+ * Behavior:
+ *   Pending entries idle for at least min-idle-time move to `consumer`
+ *   with a fresh delivery time (now, or as given by IDLE / TIME) and
+ *   one more delivery (RETRYCOUNT sets it; JUSTID leaves it). FORCE
+ *   creates the pending entry for IDs that are in the stream but in
+ *   no PEL. Entries gone from the stream are dropped from the PEL.
+ *
+ * Return:
+ *   The claimed entries (only their IDs with JUSTID).
+ */
+ExecResult CommandHandler::handleXCLAIM(const std::vector<std::string_view>& args) {
+    if (args.size() < 6)
+        return ExecResult("-ERR wrong number of arguments for 'XCLAIM'\r\n",
+                          false, client_fd);
+
+    std::string key(args[1]);
+    std::string group_name(args[2]);
+    std::string consumer_name(args[3]);
+
+    long long min_idle;
+    if (!parseLongLong(args[4], min_idle))
+        return ExecResult("-ERR Invalid min-idle-time argument for XCLAIM\r\n", false, client_fd);
+
+    // IDs run until the first argument that is not one
+    std::vector<StreamID> ids;
+    size_t idx = 5;
+    for (StreamID id; idx < args.size() && StreamID::parse(args[idx], id); ++idx)
+        ids.push_back(id);
+    if (ids.empty())
+        return ExecResult(kInvalidStreamId, false, client_fd);
+
+    uint64_t now = nowUnixMs();
+    uint64_t delivery_time = now;
+    long long retry_count = -1;
+    bool force = false, justid = false, has_last = false;
+    StreamID last_id;
+
+    for (; idx < args.size(); ++idx) {
+        std::string opt = toUpper(args[idx]);
+        if (opt == "FORCE") {
+            force = true;
+        } else if (opt == "JUSTID") {
+            justid = true;
+        } else if ((opt == "IDLE" || opt == "TIME" || opt == "RETRYCOUNT") && idx + 1 < args.size()) {
+            long long n;
+            if (!parseLongLong(args[++idx], n))
+                return ExecResult("-ERR Invalid " + opt + " option argument for XCLAIM\r\n",
+                                  false, client_fd);
+            n = std::max(n, 0LL);
+            if (opt == "IDLE")
+                delivery_time = now - std::min(static_cast<uint64_t>(n), now);
+            else if (opt == "TIME")
+                delivery_time = static_cast<uint64_t>(n);
+            else
+                retry_count = n;
+        } else if (opt == "LASTID" && idx + 1 < args.size()) {
+            if (!StreamID::parse(args[++idx], last_id))
+                return ExecResult(kInvalidStreamId, false, client_fd);
+            has_last = true;
+        } else {
+            return ExecResult("-ERR Unrecognized XCLAIM option '" + std::string(args[idx]) + "'\r\n",
+                              false, client_fd);
+        }
+    }
+
+    RedisObj* obj = store.getObject(key);
+    if (obj && obj->type != RedisType::STREAM)
+        return ExecResult(kWrongType, false, client_fd);
+    Stream* stream = obj ? &std::get<Stream>(obj->value) : nullptr;
+    StreamGroup* group = stream ? stream->findGroup(group_name) : nullptr;
+    if (!group)
+        return ExecResult(noGroupError(key, group_name), false, client_fd);
+
+    suppressPropagation = true;
 
-        // deadline == 0 → infinite block
-        if (it->deadline_ms != 0 && now >= it->deadline_ms) {
-            std::string resp = "*-1\r\n";  // RESP null array
-            ::write(it->fd, resp.c_str(), resp.size());
+    if (has_last && group->lastId < last_id) {
+        group->lastId = last_id;
+        alsoPropagate({"XGROUP", "SETID", key, group_name, last_id.toString()});
+    }
+
+    std::string body;
+    size_t n = 0;
+    StreamConsumer* consumer = nullptr;
 
-            it = blockedXReadClients.erase(it);
+    for (const StreamID& id : ids) {
+        StreamPendingEntry* entry = group->findPending(id);
+        bool exists = stream->hasEntry(id);
+
+        if (!entry) {
+            if (!force || !exists)
+                continue;
+            if (!consumer) {
+                bool created;
+                consumer = &group->consumer(consumer_name, created);
+            }
+            group->addPending(id, *consumer, delivery_time);
+            entry = group->findPending(id);
+            entry->deliveryCount = 0;
+        } else if (min_idle > 0 && now - std::min(entry->deliveryTime, now) <
+                                       static_cast<uint64_t>(min_idle)) {
             continue;
         }
 
-        ++it;
+        if (!exists) {
+            group->ack(id);
+            alsoPropagate({"XACK", key, group_name, id.toString()});
+            continue;
+        }
+
+        if (!consumer) {
+            bool created;
+            consumer = &group->consumer(consumer_name, created);
+        }
+        group->transfer(id, *entry, *consumer);
+        entry->deliveryTime = delivery_time;
+        if (retry_count >= 0)
+            entry->deliveryCount = static_cast<uint64_t>(retry_count);
+        else if (!justid)
+            entry->deliveryCount++;
+        consumer->seenTime = now;
+
+        if (justid) {
+            appendBulk(body, id.toString());
+        } else {
+            auto e = stream->getPairsInRange(id, id);
+            appendStreamEntry(body, id, &e[0].second);
+        }
+        ++n;
+        alsoPropagate(xclaimArgv(key, group_name, consumer_name, id, *entry, group->lastId));
+    }
+
+    return ExecResult("*" + std::to_string(n) + "\r\n" + body, false, client_fd);
+}
+
+/**
+ * RESP command: XAUTOCLAIM key group consumer min-idle-time start
+ *               [COUNT count] [JUSTID]
+ *
+ * Behavior:
+ *   Walks the group PEL from `start` and claims up to `count` (default
+ *   100) entries idle for at least min-idle-time, looking at no more
+ *   than 10 x count entries per call. Entries gone from the stream
+ *   are dropped from the PEL and reported separately.
+ *
+ * Return:
+ *   [next start (0-0 once the PEL is exhausted), claimed entries or
+ *    IDs, deleted IDs]
+ */
+ExecResult CommandHandler::handleXAUTOCLAIM(const std::vector<std::string_view>& args) {
+    if (args.size() < 6)
+        return ExecResult("-ERR wrong number of arguments for 'XAUTOCLAIM'\r\n",
+                          false, client_fd);
+
+    std::string key(args[1]);
+    std::string group_name(args[2]);
+    std::string consumer_name(args[3]);
+
+    long long min_idle;
+    if (!parseLongLong(args[4], min_idle))
+        return ExecResult("-ERR Invalid min-idle-time argument for XAUTOCLAIM\r\n",
+                          false, client_fd);
+
+    StreamID start;
+    if (!parseRangeBound(args[5], false, start))
+        return ExecResult(kInvalidStreamId, false, client_fd);
+
+    long long count = 100;
+    bool justid = false;
+    for (size_t idx = 6; idx < args.size(); ++idx) {
+        std::string opt = toUpper(args[idx]);
+        if (opt == "JUSTID") {
+            justid = true;
+        } else if (opt == "COUNT" && idx + 1 < args.size()) {
+            if (!parseLongLong(args[++idx], count) || count < 1 || count > (1LL << 40))
+                return ExecResult("-ERR COUNT must be > 0\r\n", false, client_fd);
+        } else {
+            return ExecResult(kSyntaxError, false, client_fd);
+        }
     }
-}
\ No newline at end of file
+
+    RedisObj* obj = store.getObject(key);
+    if (obj && obj->type != RedisType::STREAM)
+        return ExecResult(kWrongType, false, client_fd);
+    Stream* stream = obj ? &std::get<Stream>(obj->value) : nullptr;
+    StreamGroup* group = stream ? stream->findGroup(group_name) : nullptr;
+    if (!group)
+        return ExecResult(noGroupError(key, group_name), false, client_fd);
+
+    suppressPropagation = true;
+
+    uint64_t now = nowUnixMs();
+    long long attempts = count * 10;
+    StreamConsumer* consumer = nullptr;
+
+    std::string claimed, deleted;
+    size_t n_claimed = 0, n_deleted = 0;
+
+    const auto& pel = group->pel();
+    auto it = pel.lower_bound(start);
+    while (it != pel.end() && count > 0 && attempts-- > 0) {
+        StreamID id = it->first;
+        StreamPendingEntry& entry = *group->findPending(id);
+        ++it;   // the entry may be acked below
+
+        if (min_idle > 0 && now - std::min(entry.deliveryTime, now) <
+                                static_cast<uint64_t>(min_idle))
+            continue;
+
+        if (!stream->hasEntry(id)) {
+            group->ack(id);
+            alsoPropagate({"XACK", key, group_name, id.toString()});
+            appendBulk(deleted, id.toString());
+            ++n_deleted;
+            continue;
+        }
+
+        if (!consumer) {
+            bool created;
+            consumer = &group->consumer(consumer_name, created);
+        }
+        group->transfer(id, entry, *consumer);
+        entry.deliveryTime = now;
+        if (!justid)
+            entry.deliveryCount++;
+        consumer->seenTime = now;
+
+        if (justid) {
+            appendBulk(claimed, id.toString());
+        } else {
+            auto e = stream->getPairsInRange(id, id);
+            appendStreamEntry(claimed, id, &e[0].second);
+        }
+        ++n_claimed;
+        --count;
+        alsoPropagate(xclaimArgv(key, group_name, consumer_name, id, entry, group->lastId));
+    }
+
+    std::string out = "*3\r\n";
+    appendBulk(out, it == pel.end() ? "0-0" : it->first.toString());
+    out += "*" + std::to_string(n_claimed) + "\r\n" + claimed;
+    out += "*" + std::to_string(n_deleted) + "\r\n" + deleted;
+    return ExecResult(out, false, client_fd);
+}
@@ -1,5 +1,41 @@
 #include "CommandHandler.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+#include "../utils/StringUtils.hpp"
+
+namespace {
+
+// Largest value APPEND / SETRANGE may build (Redis' proto-max-bulk-len).
+constexpr size_t kMaxStringSize = 512ull * 1024 * 1024;
+
+const char* kTooLarge =
+    "-ERR string exceeds maximum allowed size (proto-max-bulk-len)\r\n";
+
+// Makes room for `needed` bytes the way sds does: twice that up to 1 MB,
+// then 1 MB more, so a value built by repeated APPENDs is reallocated
+// O(log n) times and each append is amortized O(1).
+void reserveForGrowth(std::string& s, size_t needed) {
+    constexpr size_t kMaxPrealloc = 1024 * 1024;
+    if (needed <= s.capacity())
+        return;
+    s.reserve(needed < kMaxPrealloc ? 2 * needed : needed + kMaxPrealloc);
+}
+
+// Text of a STRING object without copying it; an integer is formatted
+// into `buf`, which must outlive the view.
+std::string_view textOf(const RedisObj& obj, char (&buf)[24]) {
+    if (const int64_t* n = std::get_if<int64_t>(&obj.value)) {
+        auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), *n);
+        return std::string_view(buf, static_cast<size_t>(ptr - buf));
+    }
+    return std::get<std::string>(obj.value);
+}
+
+} // namespace
 
 
 /**
@@ -52,6 +88,7 @@ ExecResult CommandHandler::handleECHO(const std::vector<std::string_view>& args)
  * RESP command: 
  *    SET <key> <value>
  *    SET <key> <value> PX <ttl_ms>
+ *    SET <key> <value> PXAT <unix_time_ms>
  *
  * Behavior:
  *   Stores a string value in the KeyValueStore.
@@ -61,9 +98,9 @@ ExecResult CommandHandler::handleECHO(const std::vector<std::string_view>& args)
  *   SET key value PX 1000
  *   → Sets key with a 1000-millisecond expiration time.
  *
- * Supported Syntax:
- *   1) SET key value
- *   2) SET key value PX ttl
+ * Propagation:
+ *   Relative TTLs are logged as PXAT so that replaying the
+ *   AOF later does not extend the key's lifetime.
  *
  * Error Handling:
  *   - Anything else results in a syntax error, matching Redis behavior.
@@ -77,12 +114,28 @@ ExecResult CommandHandler::handleSET(const std::vector<std::string_view>& args)
         return ExecResult(simpleString("OK"), false, client_fd);
     }
 
-    if (args.size() == 5 && args[3] == "PX") {
+    if (args.size() == 5 &&
+        (equalsIgnoreCase(args[3], "PX") || equalsIgnoreCase(args[3], "PXAT"))) {
         std::string key = std::string(args[1]);
         std::string val = std::string(args[2]);
-        uint64_t ttl = std::stoull(std::string(args[4]));
 
-        store.setString(key, val, ttl);
+        uint64_t when;
+        try {
+            when = std::stoull(std::string(args[4]));
+        } catch (...) {
+            return ExecResult("-ERR value is not an integer or out of range\r\n",
+                              false, client_fd);
+        }
+
+        if (equalsIgnoreCase(args[3], "PX")) {
+            store.setString(key, val, when);
+        } else {
+            store.setString(key, val);
+            store.setExpireUnixMs(key, when);
+        }
+
+        rewriteArgv({"SET", key, val, "PXAT",
+                     std::to_string(store.getExpireUnixMs(key))});
         return ExecResult(simpleString("OK"), false, client_fd);
     }
 
@@ -118,15 +171,127 @@ ExecResult CommandHandler::handleGET(const std::vector<std::string_view>& args)
         return ExecResult("-ERR wrong number of arguments for 'GET'\r\n",
                           false, client_fd);
 
-    std::string value;
-    bool found = store.getString(std::string(args[1]), value);
+    RedisObj* obj = store.getObject(std::string(args[1]));
 
-    // Key not found → RESP null bulk
-    if (!found)
+    // Key not found (or not a string) → RESP null bulk
+    if (!obj || obj->type != RedisType::STRING)
         return ExecResult(nullBulk(), false, client_fd);
 
+    // Integer-encoded values are formatted (or taken pre-encoded) here
+    if (const int64_t* n = std::get_if<int64_t>(&obj->value))
+        return ExecResult(respBulkInteger(*n), false, client_fd);
+
     // Return value as a RESP bulk string
-    return ExecResult(valueReturnResp(value), false, client_fd);
+    return ExecResult(valueReturnResp(std::get<std::string>(obj->value)),
+                      false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleMGET
+ * ----------------------------------------------------
+ * RESP command: MGET <key> [key ...]
+ *
+ * Behavior:
+ *   Replies with an array holding, per key, its value or a
+ *   null bulk (missing key or not a string), like GET.
+ *
+ * Batching:
+ *   All keys are resolved in one pass (RedisStore::getObjects),
+ *   then the reply is sized and written in one go, with no
+ *   per-key temporaries.
+ *
+ * Cluster:
+ *   Every key is routed, so the keys must share a hash slot
+ *   (else CROSSSLOT); a client scatters a wider MGET per slot
+ *   and gathers the replies.
+ */
+ExecResult CommandHandler::handleMGET(const std::vector<std::string_view>& args) {
+    if (args.size() < 2)
+        return ExecResult("-ERR wrong number of arguments for 'MGET'\r\n",
+                          false, client_fd);
+
+    std::vector<std::string> keys(args.begin() + 1, args.end());
+    std::vector<RedisObj*> objs;
+    store.getObjects(keys, objs);
+
+    // $<len>\r\n<value>\r\n: 5 bytes of framing, up to 20 length digits
+    size_t bytes = 32;
+    for (RedisObj* obj : objs) {
+        if (obj && obj->type == RedisType::STRING) {
+            const std::string* s = std::get_if<std::string>(&obj->value);
+            bytes += 25 + (s ? s->size() : 20);
+        } else {
+            bytes += 5;
+        }
+    }
+
+    std::string out;
+    out.reserve(bytes);
+    out += '*';
+    out += std::to_string(objs.size());
+    out += "\r\n";
+
+    char buf[24];
+    for (RedisObj* obj : objs) {
+        if (!obj || obj->type != RedisType::STRING) {
+            out += "$-1\r\n";
+        } else if (const int64_t* n = std::get_if<int64_t>(&obj->value)) {
+            auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), *n);
+            appendBulk(out, std::string_view(buf, static_cast<size_t>(ptr - buf)));
+        } else {
+            appendBulk(out, std::get<std::string>(obj->value));
+        }
+    }
+    return ExecResult(std::move(out), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleMSET
+ * ----------------------------------------------------
+ * RESP commands:
+ *    MSET <key> <value> [key value ...]
+ *    MSETNX <key> <value> [key value ...]
+ *
+ * Behavior:
+ *   MSET stores every pair, as SET would, and replies +OK.
+ *   MSETNX stores them only if none of the keys exists, and
+ *   replies 1 if it did, 0 if it did nothing.
+ *
+ * Cluster:
+ *   As for MGET, all keys must share a hash slot.
+ */
+ExecResult CommandHandler::handleMSET(const std::vector<std::string_view>& args) {
+    bool nx = equalsIgnoreCase(args[0], "MSETNX");
+    if (args.size() < 3 || args.size() % 2 == 0)
+        return ExecResult(std::string("-ERR wrong number of arguments for '") +
+                          (nx ? "MSETNX" : "MSET") + "'\r\n",
+                          false, client_fd);
+
+    if (nx) {
+        std::vector<std::string> keys;
+        keys.reserve(args.size() / 2);
+        for (size_t i = 1; i < args.size(); i += 2)
+            keys.emplace_back(args[i]);
+
+        std::vector<RedisObj*> objs;
+        store.getObjects(keys, objs);
+        for (RedisObj* obj : objs) {
+            if (obj) {
+                suppressPropagation = true;
+                return ExecResult(respInteger(0), false, client_fd);
+            }
+        }
+    }
+
+    std::vector<std::pair<std::string, std::string_view>> pairs;
+    pairs.reserve(args.size() / 2);
+    for (size_t i = 1; i < args.size(); i += 2)
+        pairs.emplace_back(std::string(args[i]), args[i + 1]);
+    store.setStrings(pairs);
+
+    return ExecResult(nx ? respInteger(1) : simpleString("OK"), false, client_fd);
 }
 
 ExecResult CommandHandler::handleTYPE(const std::vector<std::string_view>& args) {
@@ -147,7 +312,389 @@ ExecResult CommandHandler::handleTYPE(const std::vector<std::string_view>& args)
             return ExecResult(simpleString("list"), false, client_fd);
         case RedisType::STREAM:
             return ExecResult(simpleString("stream"), false, client_fd);
+        case RedisType::HASH:
+            return ExecResult(simpleString("hash"), false, client_fd);
+        case RedisType::SET:
+            return ExecResult(simpleString("set"), false, client_fd);
+        case RedisType::ZSET:
+            return ExecResult(simpleString("zset"), false, client_fd);
     }
 
     return ExecResult(simpleString("none"), false, client_fd);
 }
+
+/**
+ * ----------------------------------------------------
+ * handleINCR
+ * ----------------------------------------------------
+ * RESP commands:
+ *    INCR <key>
+ *    DECR <key>
+ *    INCRBY <key> <increment>
+ *    DECRBY <key> <decrement>
+ *
+ * Behavior:
+ *   Adds to the integer stored at key (a missing key counts as 0)
+ *   and replies with the result. The key keeps its TTL.
+ *
+ * Encoding:
+ *   The result is stored as an int64_t, so a counter is parsed
+ *   at most once (when it was SET as text) and formatted only
+ *   when it is read back.
+ *
+ * Error Handling:
+ *   - A value or increment that is not a 64-bit integer, spelled
+ *     as Redis does (no '+', no leading zeros) → not an integer error.
+ *   - A result outside the 64-bit range → overflow error, and the
+ *     value is left alone.
+ */
+ExecResult CommandHandler::handleINCR(const std::vector<std::string_view>& args) {
+    bool by = equalsIgnoreCase(args[0], "INCRBY") || equalsIgnoreCase(args[0], "DECRBY");
+    bool decr = equalsIgnoreCase(args[0], "DECR") || equalsIgnoreCase(args[0], "DECRBY");
+    if (args.size() != (by ? 3u : 2u)) {
+        std::string name = by ? (decr ? "DECRBY" : "INCRBY") : (decr ? "DECR" : "INCR");
+        return ExecResult("-ERR wrong number of arguments for '" + name + "'\r\n",
+                          false, client_fd);
+    }
+
+    long long incr = 1;
+    if (by && !parseLongLong(args[2], incr))
+        return ExecResult(kNotInteger, false, client_fd);
+    if (decr) {
+        if (incr == std::numeric_limits<long long>::min())
+            return ExecResult("-ERR decrement would overflow\r\n", false, client_fd);
+        incr = -incr;
+    }
+
+    std::string key(args[1]);
+    RedisObj* obj = store.getObject(key);
+    if (obj && obj->type != RedisType::STRING)
+        return ExecResult(kWrongType, false, client_fd);
+
+    long long current = 0;
+    if (obj) {
+        if (const int64_t* n = std::get_if<int64_t>(&obj->value))
+            current = *n;
+        else if (!parseLongLong(std::get<std::string>(obj->value), current))
+            return ExecResult(kNotInteger, false, client_fd);
+    }
+
+    long long result;
+    if (__builtin_add_overflow(current, incr, &result))
+        return ExecResult("-ERR increment or decrement would overflow\r\n", false, client_fd);
+
+    store.getOrCreateString(key).value = static_cast<int64_t>(result);
+    return ExecResult(respInteger(result), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleINCRBYFLOAT
+ * ----------------------------------------------------
+ * RESP command: INCRBYFLOAT <key> <increment>
+ *
+ * Behavior:
+ *   Adds a float to the value at key (a missing key counts as 0),
+ *   stores the result as plain decimal text (no exponent, no
+ *   trailing zeros) and replies with it. The key keeps its TTL.
+ *
+ * Propagation:
+ *   Logged as SET with the result (and the key's PXAT, if any),
+ *   so replicas and the AOF never redo the float arithmetic.
+ */
+ExecResult CommandHandler::handleINCRBYFLOAT(const std::vector<std::string_view>& args) {
+    if (args.size() != 3)
+        return ExecResult("-ERR wrong number of arguments for 'INCRBYFLOAT'\r\n",
+                          false, client_fd);
+
+    long double incr;
+    if (!parseLongDouble(args[2], incr))
+        return ExecResult("-ERR value is not a valid float\r\n", false, client_fd);
+
+    std::string key(args[1]);
+    RedisObj* obj = store.getObject(key);
+    if (obj && obj->type != RedisType::STRING)
+        return ExecResult(kWrongType, false, client_fd);
+
+    long double current = 0;
+    if (obj) {
+        if (const int64_t* n = std::get_if<int64_t>(&obj->value))
+            current = static_cast<long double>(*n);
+        else if (!parseLongDouble(std::get<std::string>(obj->value), current))
+            return ExecResult("-ERR value is not a valid float\r\n", false, client_fd);
+    }
+
+    long double result = current + incr;
+    if (!std::isfinite(result))
+        return ExecResult("-ERR increment would produce NaN or Infinity\r\n", false, client_fd);
+
+    std::string text = formatLongDouble(result);
+    assignString(store.getOrCreateString(key), text);
+
+    uint64_t expire_at = store.getExpireUnixMs(key);
+    if (expire_at != 0)
+        rewriteArgv({"SET", key, text, "PXAT", std::to_string(expire_at)});
+    else
+        rewriteArgv({"SET", key, text});
+    return ExecResult(respBulk(text), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleAPPEND
+ * ----------------------------------------------------
+ * RESP command: APPEND <key> <value>
+ *
+ * Behavior:
+ *   Appends to the string at key (a missing key counts as
+ *   empty), keeping its TTL, and replies with the new length.
+ *
+ * Growth:
+ *   The value is extended in place with spare capacity (see
+ *   reserveForGrowth), so building a value piece by piece is
+ *   linear overall rather than quadratic.
+ */
+ExecResult CommandHandler::handleAPPEND(const std::vector<std::string_view>& args) {
+    if (args.size() != 3)
+        return ExecResult("-ERR wrong number of arguments for 'APPEND'\r\n",
+                          false, client_fd);
+
+    std::string key(args[1]);
+    RedisObj* obj = store.getObject(key);
+    if (obj && obj->type != RedisType::STRING)
+        return ExecResult(kWrongType, false, client_fd);
+
+    char buf[24];
+    size_t length = obj ? textOf(*obj, buf).size() : 0;
+    if (length + args[2].size() > kMaxStringSize)
+        return ExecResult(kTooLarge, false, client_fd);
+
+    std::string& value = mutableString(store.getOrCreateString(key));
+    reserveForGrowth(value, value.size() + args[2].size());
+    value.append(args[2]);
+    return ExecResult(respInteger(static_cast<long long>(value.size())), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleSETRANGE
+ * ----------------------------------------------------
+ * RESP command: SETRANGE <key> <offset> <value>
+ *
+ * Behavior:
+ *   Overwrites the string at key from `offset` on, padding with
+ *   zero bytes if it was shorter, and replies with the new
+ *   length. An empty value changes nothing (and creates no key).
+ */
+ExecResult CommandHandler::handleSETRANGE(const std::vector<std::string_view>& args) {
+    if (args.size() != 4)
+        return ExecResult("-ERR wrong number of arguments for 'SETRANGE'\r\n",
+                          false, client_fd);
+
+    long long offset;
+    if (!parseLongLong(args[2], offset))
+        return ExecResult(kNotInteger, false, client_fd);
+    if (offset < 0)
+        return ExecResult("-ERR offset is out of range\r\n", false, client_fd);
+
+    std::string key(args[1]);
+    RedisObj* obj = store.getObject(key);
+    if (obj && obj->type != RedisType::STRING)
+        return ExecResult(kWrongType, false, client_fd);
+
+    std::string_view patch = args[3];
+    if (patch.empty()) {
+        char buf[24];
+        suppressPropagation = true;
+        return ExecResult(respInteger(obj ? static_cast<long long>(textOf(*obj, buf).size()) : 0),
+                          false, client_fd);
+    }
+    if (static_cast<unsigned long long>(offset) + patch.size() > kMaxStringSize)
+        return ExecResult(kTooLarge, false, client_fd);
+
+    std::string& value = mutableString(store.getOrCreateString(key));
+    size_t pos = static_cast<size_t>(offset);
+    if (pos + patch.size() > value.size()) {
+        reserveForGrowth(value, pos + patch.size());
+        value.resize(pos + patch.size(), '\0');
+    }
+    value.replace(pos, patch.size(), patch);
+    return ExecResult(respInteger(static_cast<long long>(value.size())), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleGETRANGE
+ * ----------------------------------------------------
+ * RESP command: GETRANGE <key> <start> <end>
+ *
+ * Behavior:
+ *   Replies with the bytes from start to end, both inclusive;
+ *   negative offsets count from the end. Out of range offsets
+ *   are clamped, and an empty range is an empty string.
+ *
+ *   The range is written into the reply straight from the
+ *   stored value, with no intermediate substring.
+ */
+ExecResult CommandHandler::handleGETRANGE(const std::vector<std::string_view>& args) {
+    if (args.size() != 4)
+        return ExecResult("-ERR wrong number of arguments for 'GETRANGE'\r\n",
+                          false, client_fd);
+
+    long long start, end;
+    if (!parseLongLong(args[2], start) || !parseLongLong(args[3], end))
+        return ExecResult(kNotInteger, false, client_fd);
+
+    RedisObj* obj = store.getObject(std::string(args[1]));
+    if (obj && obj->type != RedisType::STRING)
+        return ExecResult(kWrongType, false, client_fd);
+    if (!obj)
+        return ExecResult("$0\r\n\r\n", false, client_fd);
+
+    char buf[24];
+    std::string_view value = textOf(*obj, buf);
+    long long length = static_cast<long long>(value.size());
+    if (start < 0)
+        start = std::max(start + length, 0LL);
+    if (end < 0)
+        end = std::max(end + length, 0LL);
+    end = std::min(end, length - 1);
+    if (start > end || length == 0)
+        return ExecResult("$0\r\n\r\n", false, client_fd);
+
+    std::string out;
+    out.reserve(static_cast<size_t>(end - start + 1) + 32);
+    appendBulk(out, value.substr(static_cast<size_t>(start), static_cast<size_t>(end - start + 1)));
+    return ExecResult(std::move(out), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleSTRLEN
+ * ----------------------------------------------------
+ * RESP command: STRLEN <key>
+ *
+ * Behavior:
+ *   Replies with the length of the string at key, 0 if missing.
+ */
+ExecResult CommandHandler::handleSTRLEN(const std::vector<std::string_view>& args) {
+    if (args.size() != 2)
+        return ExecResult("-ERR wrong number of arguments for 'STRLEN'\r\n",
+                          false, client_fd);
+
+    RedisObj* obj = store.getObject(std::string(args[1]));
+    if (obj && obj->type != RedisType::STRING)
+        return ExecResult(kWrongType, false, client_fd);
+
+    char buf[24];
+    return ExecResult(respInteger(obj ? static_cast<long long>(textOf(*obj, buf).size()) : 0),
+                      false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleGETDEL
+ * ----------------------------------------------------
+ * RESP command: GETDEL <key>
+ *
+ * Behavior:
+ *   Replies with the string at key, like GET, and deletes it.
+ *
+ * Propagation:
+ *   Logged as DEL.
+ */
+ExecResult CommandHandler::handleGETDEL(const std::vector<std::string_view>& args) {
+    if (args.size() != 2)
+        return ExecResult("-ERR wrong number of arguments for 'GETDEL'\r\n",
+                          false, client_fd);
+
+    std::string key(args[1]);
+    RedisObj* obj = store.getObject(key);
+    if (obj && obj->type != RedisType::STRING)
+        return ExecResult(kWrongType, false, client_fd);
+    if (!obj) {
+        suppressPropagation = true;
+        return ExecResult(nullBulk(), false, client_fd);
+    }
+
+    char buf[24];
+    std::string out;
+    appendBulk(out, textOf(*obj, buf));
+    store.del(key);
+
+    rewriteArgv({"DEL", key});
+    return ExecResult(std::move(out), false, client_fd);
+}
+
+/**
+ * ----------------------------------------------------
+ * handleGETEX
+ * ----------------------------------------------------
+ * RESP command:
+ *    GETEX <key> [EX seconds | PX ms | EXAT unix_s | PXAT unix_ms | PERSIST]
+ *
+ * Behavior:
+ *   Replies with the string at key, like GET, and sets or
+ *   clears its TTL. A deadline already past deletes the key.
+ *
+ * Propagation:
+ *   There is no EXPIRE family to log, so a new TTL is logged as
+ *   SET with the value and its PXAT (or without one for PERSIST),
+ *   and a past deadline as DEL. Plain GETEX is not logged.
+ */
+ExecResult CommandHandler::handleGETEX(const std::vector<std::string_view>& args) {
+    if (args.size() < 2)
+        return ExecResult("-ERR wrong number of arguments for 'GETEX'\r\n",
+                          false, client_fd);
+
+    uint64_t now_unix = static_cast<uint64_t>(getUnixTimeMs());
+    bool persist = false;
+    uint64_t deadline = 0;
+    if (args.size() == 3 && equalsIgnoreCase(args[2], "PERSIST")) {
+        persist = true;
+    } else if (args.size() == 4) {
+        bool seconds = equalsIgnoreCase(args[2], "EX") || equalsIgnoreCase(args[2], "EXAT");
+        bool absolute = equalsIgnoreCase(args[2], "EXAT") || equalsIgnoreCase(args[2], "PXAT");
+        if (!seconds && !absolute && !equalsIgnoreCase(args[2], "PX"))
+            return ExecResult(kSyntaxError, false, client_fd);
+
+        long long when;
+        if (!parseLongLong(args[3], when))
+            return ExecResult(kNotInteger, false, client_fd);
+        uint64_t ms;
+        if (when <= 0 ||
+            __builtin_mul_overflow(static_cast<uint64_t>(when), seconds ? 1000u : 1u, &ms) ||
+            __builtin_add_overflow(ms, absolute ? 0 : now_unix, &deadline))
+            return ExecResult("-ERR invalid expire time in 'getex' command\r\n",
+                              false, client_fd);
+    } else if (args.size() != 2) {
+        return ExecResult(kSyntaxError, false, client_fd);
+    }
+
+    std::string key(args[1]);
+    RedisObj* obj = store.getObject(key);
+    if (obj && obj->type != RedisType::STRING)
+        return ExecResult(kWrongType, false, client_fd);
+    if (!obj) {
+        suppressPropagation = true;
+        return ExecResult(nullBulk(), false, client_fd);
+    }
+
+    char buf[24];
+    std::string_view value = textOf(*obj, buf);
+    std::string out;
+    appendBulk(out, value);
+
+    if (deadline != 0 && deadline <= now_unix) {
+        rewriteArgv({"DEL", key});
+        store.del(key);
+    } else if (deadline != 0) {
+        store.setExpireUnixMs(key, deadline);
+        rewriteArgv({"SET", key, std::string(value), "PXAT", std::to_string(deadline)});
+    } else if (persist && store.expires.erase(key) > 0) {
+        rewriteArgv({"SET", key, std::string(value)});
+    } else {
+        suppressPropagation = true;
+    }
+    return ExecResult(std::move(out), false, client_fd);
+}
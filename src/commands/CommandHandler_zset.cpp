@@ -0,0 +1,573 @@
+#include "./CommandHandler.hpp"
+
+#include <charconv>
+#include <cmath>
+
+#include "../utils/StringUtils.hpp"
+
+namespace {
+
+const char* kNotFloat = "-ERR value is not a valid float\r\n";
+
+// Scores: decimal or "inf" / "+inf" / "-inf", never NaN.
+bool parseScore(std::string_view s, double& out) {
+    if (!s.empty() && s[0] == '+')
+        s.remove_prefix(1);
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return !s.empty() && ec == std::errc() && ptr == s.data() + s.size() && !std::isnan(out);
+}
+
+// "1.5", "(1.5" (exclusive), "-inf", "+inf".
+struct ScoreBound {
+    double value;
+    bool exclusive = false;
+};
+
+bool parseScoreBound(std::string_view s, ScoreBound& out) {
+    out.exclusive = !s.empty() && s[0] == '(';
+    if (out.exclusive)
+        s.remove_prefix(1);
+    return parseScore(s, out.value);
+}
+
+// "[a" (inclusive), "(a" (exclusive), "-" and "+" (the ends).
+struct LexBound {
+    std::string_view value;
+    bool exclusive = false;
+    int end = 0;        // -1 for "-", +1 for "+"
+};
+
+bool parseLexBound(std::string_view s, LexBound& out) {
+    if (s == "-" || s == "+") {
+        out.end = s == "-" ? -1 : 1;
+        return true;
+    }
+    if (s.empty() || (s[0] != '[' && s[0] != '('))
+        return false;
+    out.exclusive = s[0] == '(';
+    out.value = s.substr(1);
+    return true;
+}
+
+// Members before a lower (upper) lex bound
+size_t lexRank(const ZSet& zset, const LexBound& b, bool upper) {
+    if (b.end)
+        return b.end < 0 ? 0 : zset.size();
+    return zset.countBelowLex(b.value, upper ? b.exclusive : !b.exclusive);
+}
+
+} // namespace
+
+/*
+===============================================================================
+  Lookup
+-------------------------------------------------------------------------------
+  Sorted sets are created by the first write that adds a member and, like
+  lists, deleted by the one that removes the last.
+===============================================================================
+*/
+ZSet* CommandHandler::lookupZSet(const std::string& key, bool& wrong_type) {
+    wrong_type = false;
+
+    RedisObj* obj = store.getObject(key);
+    if (!obj)
+        return nullptr;
+    if (obj->type != RedisType::ZSET) {
+        wrong_type = true;
+        return nullptr;
+    }
+    return &std::get<ZSet>(obj->value);
+}
+
+void CommandHandler::deleteIfEmpty(const std::string& key, const ZSet& zset) {
+    if (zset.empty())
+        store.del(key);
+}
+
+void CommandHandler::appendZRange(std::string& out, const ZSet& zset, size_t from, size_t to,
+                                  bool reverse, bool with_scores) {
+    size_t n = to > from ? to - from : 0;
+    out += "*" + std::to_string(with_scores ? 2 * n : n) + "\r\n";
+    zset.range(from, to, reverse, [&](std::string_view member, double score) {
+        appendBulk(out, member);
+        if (with_scores)
+            appendBulk(out, formatDouble(score));
+    });
+}
+
+/**
+ * RESP command: ZADD key [NX|XX] [GT|LT] [CH] [INCR] score member [score member ...]
+ *
+ * Replies with the number of new members (CH: new or changed), or with
+ * INCR the new score (nil when NX/XX/GT/LT held it back). Every score is
+ * validated before the first one is applied.
+ */
+ExecResult CommandHandler::handleZADD(const std::vector<std::string_view>& args) {
+    bool nx = false, xx = false, gt = false, lt = false, ch = false, incr = false;
+    size_t i = 2;
+    for (; i < args.size(); ++i) {
+        std::string opt = toUpper(args[i]);
+        if (opt == "NX") nx = true;
+        else if (opt == "XX") xx = true;
+        else if (opt == "GT") gt = true;
+        else if (opt == "LT") lt = true;
+        else if (opt == "CH") ch = true;
+        else if (opt == "INCR") incr = true;
+        else break;
+    }
+
+    if (args.size() < 4 || i == args.size() || (args.size() - i) % 2 != 0)
+        return ExecResult(kSyntaxError, false, client_fd);
+    if (nx && xx)
+        return ExecResult("-ERR XX and NX options at the same time are not compatible\r\n",
+                          false, client_fd);
+    if ((gt && lt) || (nx && (gt || lt)))
+        return ExecResult("-ERR GT, LT, and/or NX options at the same time are not compatible\r\n",
+                          false, client_fd);
+    if (incr && args.size() - i != 2)
+        return ExecResult("-ERR INCR option supports a single increment-element pair\r\n",
+                          false, client_fd);
+
+    std::vector<double> scores;
+    for (size_t j = i; j < args.size(); j += 2) {
+        double s;
+        if (!parseScore(args[j], s))
+            return ExecResult(kNotFloat, false, client_fd);
+        scores.push_back(s);
+    }
+
+    std::string key(args[1]);
+    bool wrong;
+    ZSet* zset = lookupZSet(key, wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    long long added = 0, changed = 0;
+    bool applied = false;
+    double result = 0;
+    for (size_t j = i, k = 0; j < args.size(); j += 2, ++k) {
+        std::string_view member = args[j + 1];
+        double current = 0;
+        bool exists = zset && zset->score(member, current);
+        if ((nx && exists) || (xx && !exists))
+            continue;
+
+        double score = incr ? current + scores[k] : scores[k];
+        if (std::isnan(score))
+            return ExecResult("-ERR resulting score is not a number (NaN)\r\n", false, client_fd);
+        if (exists && ((gt && !(score > current)) || (lt && !(score < current))))
+            continue;
+
+        applied = true;
+        result = score;
+        if (exists && score == current)
+            continue;
+
+        if (!zset)
+            zset = &store.getOrCreateZSet(key);
+        if (zset->insert(member, score))
+            ++added;
+        else
+            ++changed;
+    }
+
+    if (added == 0 && changed == 0)
+        suppressPropagation = true;
+    if (added > 0)
+        signalKeyAsReady(key);
+
+    if (incr)
+        return ExecResult(applied ? respBulk(formatDouble(result)) : nullBulk(), false, client_fd);
+    return ExecResult(respInteger(ch ? added + changed : added), false, client_fd);
+}
+
+/** RESP command: ZINCRBY key increment member — a missing member counts as 0. */
+ExecResult CommandHandler::handleZINCRBY(const std::vector<std::string_view>& args) {
+    if (args.size() != 4)
+        return ExecResult("-ERR wrong number of arguments for 'ZINCRBY'\r\n",
+                          false, client_fd);
+
+    double incr;
+    if (!parseScore(args[2], incr))
+        return ExecResult(kNotFloat, false, client_fd);
+
+    std::string key(args[1]);
+    bool wrong;
+    ZSet* zset = lookupZSet(key, wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    double current = 0;
+    bool exists = zset && zset->score(args[3], current);
+    double result = current + incr;
+    if (std::isnan(result))
+        return ExecResult("-ERR resulting score is not a number (NaN)\r\n", false, client_fd);
+
+    store.getOrCreateZSet(key).insert(args[3], result);
+    if (!exists)
+        signalKeyAsReady(key);
+    return ExecResult(respBulk(formatDouble(result)), false, client_fd);
+}
+
+/** RESP command: ZSCORE key member */
+ExecResult CommandHandler::handleZSCORE(const std::vector<std::string_view>& args) {
+    if (args.size() != 3)
+        return ExecResult("-ERR wrong number of arguments for 'ZSCORE'\r\n",
+                          false, client_fd);
+
+    bool wrong;
+    ZSet* zset = lookupZSet(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    double score;
+    if (!zset || !zset->score(args[2], score))
+        return ExecResult(nullBulk(), false, client_fd);
+    return ExecResult(respBulk(formatDouble(score)), false, client_fd);
+}
+
+/** RESP command: ZCARD key */
+ExecResult CommandHandler::handleZCARD(const std::vector<std::string_view>& args) {
+    if (args.size() != 2)
+        return ExecResult("-ERR wrong number of arguments for 'ZCARD'\r\n",
+                          false, client_fd);
+
+    bool wrong;
+    ZSet* zset = lookupZSet(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+    return ExecResult(respInteger(zset ? static_cast<long long>(zset->size()) : 0),
+                      false, client_fd);
+}
+
+/** RESP command: ZREM key member [member ...] */
+ExecResult CommandHandler::handleZREM(const std::vector<std::string_view>& args) {
+    if (args.size() < 3)
+        return ExecResult("-ERR wrong number of arguments for 'ZREM'\r\n",
+                          false, client_fd);
+
+    std::string key(args[1]);
+    bool wrong;
+    ZSet* zset = lookupZSet(key, wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    long long removed = 0;
+    for (size_t i = 2; zset && i < args.size(); ++i)
+        removed += zset->erase(args[i]);
+
+    if (removed == 0)
+        suppressPropagation = true;
+    else
+        deleteIfEmpty(key, *zset);
+    return ExecResult(respInteger(removed), false, client_fd);
+}
+
+/**
+ * RESP command: ZRANGE key start stop [BYSCORE | BYLEX] [REV]
+ *                      [LIMIT offset count] [WITHSCORES]
+ *
+ * Every form is reduced to a range of ranks: indexes directly, score
+ * and lex bounds by counting the members before them, O(log n) each on
+ * a skiplist. With REV, start and stop are the upper and lower bound,
+ * and LIMIT applies in descending order.
+ */
+ExecResult CommandHandler::handleZRANGE(const std::vector<std::string_view>& args) {
+    if (args.size() < 4)
+        return ExecResult("-ERR wrong number of arguments for 'ZRANGE'\r\n",
+                          false, client_fd);
+
+    bool by_score = false, by_lex = false, rev = false, with_scores = false, limit = false;
+    long long offset = 0, count = -1;
+    for (size_t i = 4; i < args.size(); ++i) {
+        std::string opt = toUpper(args[i]);
+        if (opt == "BYSCORE") {
+            by_score = true;
+        } else if (opt == "BYLEX") {
+            by_lex = true;
+        } else if (opt == "REV") {
+            rev = true;
+        } else if (opt == "WITHSCORES") {
+            with_scores = true;
+        } else if (opt == "LIMIT" && i + 2 < args.size()) {
+            if (!parseLongLong(args[i + 1], offset) || !parseLongLong(args[i + 2], count))
+                return ExecResult(kNotInteger, false, client_fd);
+            limit = true;
+            i += 2;
+        } else {
+            return ExecResult(kSyntaxError, false, client_fd);
+        }
+    }
+
+    if (by_score && by_lex)
+        return ExecResult(kSyntaxError, false, client_fd);
+    if (limit && !by_score && !by_lex)
+        return ExecResult("-ERR syntax error, LIMIT is only supported in combination with "
+                          "either BYSCORE or BYLEX\r\n", false, client_fd);
+    if (with_scores && by_lex)
+        return ExecResult("-ERR syntax error, WITHSCORES not supported in combination "
+                          "with BYLEX\r\n", false, client_fd);
+
+    // With REV the bounds come highest first
+    std::string_view lo_arg = rev && (by_score || by_lex) ? args[3] : args[2];
+    std::string_view hi_arg = rev && (by_score || by_lex) ? args[2] : args[3];
+
+    ScoreBound lo_score, hi_score;
+    LexBound lo_lex, hi_lex;
+    long long start = 0, stop = 0;
+    if (by_score) {
+        if (!parseScoreBound(lo_arg, lo_score) || !parseScoreBound(hi_arg, hi_score))
+            return ExecResult("-ERR min or max is not a float\r\n", false, client_fd);
+    } else if (by_lex) {
+        if (!parseLexBound(lo_arg, lo_lex) || !parseLexBound(hi_arg, hi_lex))
+            return ExecResult("-ERR min or max not valid string range item\r\n",
+                              false, client_fd);
+    } else if (!parseLongLong(args[2], start) || !parseLongLong(args[3], stop)) {
+        return ExecResult(kNotInteger, false, client_fd);
+    }
+
+    bool wrong;
+    ZSet* zset = lookupZSet(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+    if (!zset)
+        return ExecResult("*0\r\n", false, client_fd);
+
+    size_t n = zset->size();
+    size_t from = 0, to = 0;
+    if (by_score) {
+        from = zset->countBelow(lo_score.value, !lo_score.exclusive);
+        to = zset->countBelow(hi_score.value, hi_score.exclusive);
+    } else if (by_lex) {
+        from = lexRank(*zset, lo_lex, false);
+        to = lexRank(*zset, hi_lex, true);
+    } else {
+        long long len = static_cast<long long>(n);
+        if (start < 0) start += len;
+        if (stop < 0) stop += len;
+        start = std::max(start, 0LL);
+        stop = std::min(stop, len - 1);
+        if (start <= stop) {
+            // REV counts indexes from the highest score down
+            from = static_cast<size_t>(rev ? len - 1 - stop : start);
+            to = static_cast<size_t>(rev ? len - start : stop + 1);
+        }
+    }
+    to = std::max(to, from);
+
+    // LIMIT counts in the direction of the walk
+    if (limit) {
+        size_t skip = offset < 0 ? to - from : std::min(static_cast<size_t>(offset), to - from);
+        if (rev)
+            to -= skip;
+        else
+            from += skip;
+        if (count >= 0 && static_cast<size_t>(count) < to - from) {
+            if (rev)
+                from = to - static_cast<size_t>(count);
+            else
+                to = from + static_cast<size_t>(count);
+        }
+    }
+
+    std::string out;
+    appendZRange(out, *zset, from, to, rev, with_scores);
+    return ExecResult(out, false, client_fd);
+}
+
+/**
+ * RESP commands: ZRANK key member [WITHSCORE], ZREVRANK key member [WITHSCORE]
+ *
+ * O(log n) on a skiplist: the rank is the sum of the spans walked to
+ * the member.
+ */
+ExecResult CommandHandler::handleZRANK(const std::vector<std::string_view>& args) {
+    bool with_score = args.size() == 4 && toUpper(args[3]) == "WITHSCORE";
+    if (args.size() != 3 && !with_score)
+        return ExecResult(args.size() == 4 ? std::string(kSyntaxError)
+                              : "-ERR wrong number of arguments for '" + toUpper(args[0]) + "'\r\n",
+                          false, client_fd);
+
+    bool wrong;
+    ZSet* zset = lookupZSet(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    size_t rank;
+    double score = 0;
+    if (!zset || !zset->rank(args[2], rank))
+        return ExecResult(with_score ? "*-1\r\n" : nullBulk(), false, client_fd);
+    if (toUpper(args[0]) == "ZREVRANK")
+        rank = zset->size() - 1 - rank;
+    if (!with_score)
+        return ExecResult(respInteger(static_cast<long long>(rank)), false, client_fd);
+
+    zset->score(args[2], score);
+    std::string out = "*2\r\n" + respInteger(static_cast<long long>(rank));
+    appendBulk(out, formatDouble(score));
+    return ExecResult(out, false, client_fd);
+}
+
+/** RESP command: ZCOUNT key min max */
+ExecResult CommandHandler::handleZCOUNT(const std::vector<std::string_view>& args) {
+    if (args.size() != 4)
+        return ExecResult("-ERR wrong number of arguments for 'ZCOUNT'\r\n",
+                          false, client_fd);
+
+    ScoreBound lo, hi;
+    if (!parseScoreBound(args[2], lo) || !parseScoreBound(args[3], hi))
+        return ExecResult("-ERR min or max is not a float\r\n", false, client_fd);
+
+    bool wrong;
+    ZSet* zset = lookupZSet(std::string(args[1]), wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+    if (!zset)
+        return ExecResult(respInteger(0), false, client_fd);
+
+    size_t from = zset->countBelow(lo.value, !lo.exclusive);
+    size_t to = zset->countBelow(hi.value, hi.exclusive);
+    return ExecResult(respInteger(to > from ? static_cast<long long>(to - from) : 0),
+                      false, client_fd);
+}
+
+/**
+ * RESP commands: ZPOPMIN key [count], ZPOPMAX key [count]
+ *
+ * Reply: [member, score, ...], lowest (highest) first.
+ */
+ExecResult CommandHandler::handleZPOPMIN(const std::vector<std::string_view>& args) {
+    if (args.size() != 2 && args.size() != 3)
+        return ExecResult("-ERR wrong number of arguments for '" + toUpper(args[0]) + "'\r\n",
+                          false, client_fd);
+
+    long long count = 1;
+    if (args.size() == 3) {
+        if (!parseLongLong(args[2], count))
+            return ExecResult(kNotInteger, false, client_fd);
+        if (count < 0)
+            return ExecResult("-ERR value is out of range, must be positive\r\n",
+                              false, client_fd);
+    }
+
+    std::string key(args[1]);
+    bool wrong;
+    ZSet* zset = lookupZSet(key, wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+    if (!zset || count == 0) {
+        suppressPropagation = true;
+        return ExecResult("*0\r\n", false, client_fd);
+    }
+
+    bool max = toUpper(args[0]) == "ZPOPMAX";
+    size_t n = zset->size();
+    size_t k = std::min(static_cast<size_t>(count), n);
+    size_t from = max ? n - k : 0;
+
+    std::string out;
+    appendZRange(out, *zset, from, from + k, max, true);
+    zset->eraseRange(from, from + k);
+    deleteIfEmpty(key, *zset);
+    return ExecResult(out, false, client_fd);
+}
+
+/**
+ * RESP commands: BZPOPMIN key [key ...] timeout, BZPOPMAX key [key ...] timeout
+ *
+ * Like BLPOP: the first non-empty sorted set is popped right away,
+ * otherwise the client joins the same wait queues list waiters use and
+ * the ZADD that gives it a member serves it. Reply: [key, member,
+ * score], or a Null Array on timeout.
+ */
+ExecResult CommandHandler::handleBZPOPMIN(const std::vector<std::string_view>& args) {
+    if (args.size() < 3)
+        return ExecResult("-ERR wrong number of arguments for '" + toUpper(args[0]) + "'\r\n",
+                          false, client_fd);
+
+    bool min = toUpper(args[0]) == "BZPOPMIN";
+    uint64_t deadline = 0;
+    if (const char* err = parseTimeout(args.back(), deadline))
+        return ExecResult(err, false, client_fd);
+
+    for (size_t i = 1; i + 1 < args.size(); ++i) {
+        std::string key(args[i]);
+        bool wrong;
+        ZSet* zset = lookupZSet(key, wrong);
+        if (wrong)
+            return ExecResult(kWrongType, false, client_fd);
+        if (!zset || zset->empty())
+            continue;
+
+        std::string out = "*3\r\n";
+        appendBulk(out, key);
+        size_t rank = min ? 0 : zset->size() - 1;
+        zset->range(rank, rank + 1, false, [&](std::string_view member, double score) {
+            appendBulk(out, member);
+            appendBulk(out, formatDouble(score));
+        });
+        zset->eraseRange(rank, rank + 1);
+        deleteIfEmpty(key, *zset);
+        rewriteArgv({min ? "ZPOPMIN" : "ZPOPMAX", key});
+        return ExecResult(out, false, client_fd);
+    }
+
+    return blockClient(BlockedClient{ .fd = client_fd, .deadline_ms = deadline, .head = min,
+                                      .zset = true },
+                       args.begin() + 1, args.end() - 1);
+}
+
+/**
+ * Runs after the command that gave `key` members: its BZPOPMIN /
+ * BZPOPMAX waiters are served in FIFO order while members last, each
+ * pop logged as ZPOPMIN / ZPOPMAX after the causing command.
+ */
+void CommandHandler::serveClientsBlockedOnZSet(const std::string& key, ZSet& zset) {
+    while (!zset.empty()) {
+        int fd = nextWaiter(key, true);
+        if (fd < 0)
+            break;
+
+        bool min = blockedByFd.at(fd).head;
+        unblockClient(fd);
+
+        std::string out = "*3\r\n";
+        appendBulk(out, key);
+        size_t rank = min ? 0 : zset.size() - 1;
+        zset.range(rank, rank + 1, false, [&](std::string_view member, double score) {
+            appendBulk(out, member);
+            appendBulk(out, formatDouble(score));
+        });
+        zset.eraseRange(rank, rank + 1);
+        alsoPropagate({min ? "ZPOPMIN" : "ZPOPMAX", key});
+        sendToClient(fd, out);
+    }
+    deleteIfEmpty(key, zset);
+}
+
+/** RESP command: ZREMRANGEBYSCORE key min max */
+ExecResult CommandHandler::handleZREMRANGEBYSCORE(const std::vector<std::string_view>& args) {
+    if (args.size() != 4)
+        return ExecResult("-ERR wrong number of arguments for 'ZREMRANGEBYSCORE'\r\n",
+                          false, client_fd);
+
+    ScoreBound lo, hi;
+    if (!parseScoreBound(args[2], lo) || !parseScoreBound(args[3], hi))
+        return ExecResult("-ERR min or max is not a float\r\n", false, client_fd);
+
+    std::string key(args[1]);
+    bool wrong;
+    ZSet* zset = lookupZSet(key, wrong);
+    if (wrong)
+        return ExecResult(kWrongType, false, client_fd);
+
+    size_t removed = 0;
+    if (zset)
+        removed = zset->eraseRange(zset->countBelow(lo.value, !lo.exclusive),
+                                   zset->countBelow(hi.value, hi.exclusive));
+    if (removed == 0)
+        suppressPropagation = true;
+    else
+        deleteIfEmpty(key, *zset);
+    return ExecResult(respInteger(static_cast<long long>(removed)), false, client_fd);
+}
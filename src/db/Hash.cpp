@@ -0,0 +1,160 @@
+#include "Hash.hpp"
+
+/* =====================================================================
+   Lookup
+   ===================================================================== */
+
+size_t Hash::find(std::string_view field) const {
+    for (size_t pos = lp.begin(); pos != lp.end(); pos = lp.next(lp.next(pos))) {
+        if (lp.equals(pos, field))
+            return pos;
+    }
+    return lp.end();
+}
+
+bool Hash::get(std::string_view field, std::string &out) const {
+    if (!compact) {
+        auto it = table.find(field);
+        if (it == table.end())
+            return false;
+        out = it->second;
+        return true;
+    }
+
+    size_t pos = find(field);
+    if (pos == lp.end())
+        return false;
+    out = lp.get(lp.next(pos));
+    return true;
+}
+
+bool Hash::contains(std::string_view field) const {
+    return compact ? find(field) != lp.end() : table.find(field) != table.end();
+}
+
+/* =====================================================================
+   Updates
+   ===================================================================== */
+
+bool Hash::set(std::string_view field, std::string_view value) {
+    clearExpire(field);
+
+    if (compact) {
+        size_t pos = find(field);
+        if (pos != lp.end()) {
+            if (value.size() <= maxListpackValue) {
+                lp.replace(lp.next(pos), value);
+                return false;
+            }
+        } else if (size() < maxListpackEntries &&
+                   field.size() <= maxListpackValue && value.size() <= maxListpackValue) {
+            lp.pushBack(field);
+            lp.pushBack(value);
+            return true;
+        }
+        convertToTable();
+    }
+
+    auto [it, inserted] = table.try_emplace(std::string(field));
+    it->second.assign(value);
+    return inserted;
+}
+
+bool Hash::erase(std::string_view field) {
+    if (compact) {
+        size_t pos = find(field);
+        if (pos == lp.end())
+            return false;
+        lp.eraseRange(pos, lp.next(lp.next(pos)), 2);
+    } else {
+        auto it = table.find(field);
+        if (it == table.end())
+            return false;
+        table.erase(it);
+    }
+    clearExpire(field);
+    return true;
+}
+
+// Moves every pair into the table and frees the listpack
+void Hash::convertToTable() {
+    table.reserve(size() + 1);
+    forEach([&](std::string_view field, std::string_view value) {
+        table.emplace(field, value);
+    });
+    lp = Listpack{};
+    compact = false;
+}
+
+/* =====================================================================
+   Per-field expiry
+   ===================================================================== */
+
+void Hash::clearExpire(std::string_view field) {
+    if (ttls.empty())
+        return;
+    auto it = ttls.find(field);
+    if (it == ttls.end())
+        return;
+    deadlines.erase({it->second, it->first});
+    ttls.erase(it);
+}
+
+int Hash::expireField(std::string_view field, uint64_t unix_ms,
+                      ExpireCondition cond, uint64_t now) {
+    if (!contains(field))
+        return -2;
+
+    auto it = ttls.find(field);
+    bool has = it != ttls.end();
+
+    // No expiry time counts as an infinite one for GT / LT
+    switch (cond) {
+        case ExpireCondition::NX: if (has) return 0; break;
+        case ExpireCondition::XX: if (!has) return 0; break;
+        case ExpireCondition::GT: if (!has || unix_ms <= it->second) return 0; break;
+        case ExpireCondition::LT: if (has && unix_ms >= it->second) return 0; break;
+        case ExpireCondition::NONE: break;
+    }
+
+    if (unix_ms <= now) {
+        erase(field);
+        return 2;
+    }
+
+    if (has) {
+        deadlines.erase({it->second, it->first});
+        it->second = unix_ms;
+    } else {
+        it = ttls.emplace(std::string(field), unix_ms).first;
+    }
+    deadlines.emplace(unix_ms, it->first);
+    return 1;
+}
+
+int64_t Hash::fieldExpireTime(std::string_view field) const {
+    if (!contains(field))
+        return -2;
+    auto it = ttls.find(field);
+    return it == ttls.end() ? -1 : static_cast<int64_t>(it->second);
+}
+
+int Hash::persistField(std::string_view field) {
+    if (!contains(field))
+        return -2;
+    if (ttls.find(field) == ttls.end())
+        return -1;
+    clearExpire(field);
+    return 1;
+}
+
+size_t Hash::expireFields(uint64_t now) {
+    size_t removed = 0;
+    while (!deadlines.empty() && deadlines.begin()->first <= now) {
+        // erase() drops the deadline too
+        std::string field = deadlines.begin()->second;
+        erase(field);
+        ++removed;
+    }
+    return removed;
+}
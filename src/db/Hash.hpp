@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "Listpack.hpp"
+
+/*
+------------------------------------------------------------------------------
+  HASH (listpack / hash table)
+------------------------------------------------------------------------------
+
+Field -> value map with two encodings:
+
+  compact:  one Listpack of alternating items, scanned linearly
+
+                [field_1 value_1 field_2 value_2 ...]
+
+            used while the hash has at most hash-max-listpack-entries
+            fields, none of them (or their values) longer than
+            hash-max-listpack-value bytes. A session object of a dozen
+            small fields is a single allocation of a few hundred bytes,
+            and numeric values are stored as integers.
+
+  table:    std::unordered_map, once either limit is crossed. A hash
+            never converts back, as in Redis.
+
+Fields can carry their own expiry time (HEXPIRE), in Unix ms so it
+survives a restart. The deadlines live beside the fields:
+
+  ttls:       field -> deadline
+  deadlines:  (deadline, field), ordered, so expireFields() only looks
+              at the fields that are due
+
+Expired fields are removed lazily: the command layer calls
+expireFields() before it reads or writes the hash.
+------------------------------------------------------------------------------
+*/
+class Hash {
+public:
+    // hash-max-listpack-entries / -value, shared by every hash.
+    static void SetListpackLimits(size_t max_entries, size_t max_value) {
+        maxListpackEntries = max_entries;
+        maxListpackValue = max_value;
+    }
+
+    size_t size() const { return compact ? lp.count() / 2 : table.size(); }
+    bool empty() const { return size() == 0; }
+    bool isCompact() const { return compact; }
+
+    bool get(std::string_view field, std::string &out) const;
+    bool contains(std::string_view field) const;
+
+    // Sets the field, dropping its expiry time. True if it is new.
+    bool set(std::string_view field, std::string_view value);
+
+    // False if there is no such field.
+    bool erase(std::string_view field);
+
+    // Calls fn(field, value) for every field, in storage order.
+    template <typename Fn>
+    void forEach(Fn &&fn) const;
+
+    // HSCAN: visits a batch of about `count` fields from `cursor` on and
+    // returns the cursor to continue from, 0 when done. Compact hashes
+    // are returned whole. A table is walked bucket by bucket, so fields
+    // present for the whole scan are returned at least once unless the
+    // table is resized in between.
+    template <typename Fn>
+    uint64_t scan(uint64_t cursor, size_t count, Fn &&fn) const;
+
+    // --- Per-field expiry (HEXPIRE family) ---
+
+    enum class ExpireCondition { NONE, NX, XX, GT, LT };
+
+    // Reply codes of HEXPIRE: -2 no such field, 0 condition not met,
+    // 1 deadline set, 2 field deleted (deadline not after `now`).
+    int expireField(std::string_view field, uint64_t unix_ms,
+                    ExpireCondition cond, uint64_t now);
+
+    // -2 no such field, -1 no expiry time, otherwise the deadline.
+    int64_t fieldExpireTime(std::string_view field) const;
+
+    // -2 no such field, -1 no expiry time, 1 expiry time removed.
+    int persistField(std::string_view field);
+
+    // Deletes the fields whose deadline is <= now; returns how many.
+    size_t expireFields(uint64_t now);
+
+    const std::set<std::pair<uint64_t, std::string>> &fieldDeadlines() const {
+        return deadlines;
+    }
+
+private:
+    static inline size_t maxListpackEntries = 128;
+    static inline size_t maxListpackValue = 64;
+
+    // Lets the table be searched with string_views
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+    using Table = std::unordered_map<std::string, std::string, StringHash, std::equal_to<>>;
+
+    bool compact = true;
+    Listpack lp;
+    Table table;
+
+    std::unordered_map<std::string, uint64_t, StringHash, std::equal_to<>> ttls;
+    std::set<std::pair<uint64_t, std::string>> deadlines;
+
+    // Position of the field item, or lp.end().
+    size_t find(std::string_view field) const;
+
+    void convertToTable();
+    void clearExpire(std::string_view field);
+};
+
+template <typename Fn>
+void Hash::forEach(Fn &&fn) const {
+    if (!compact) {
+        for (const auto &[field, value] : table)
+            fn(std::string_view(field), std::string_view(value));
+        return;
+    }
+
+    char ftmp[Listpack::kIntBufSize], vtmp[Listpack::kIntBufSize];
+    for (size_t pos = lp.begin(); pos != lp.end();) {
+        size_t vpos = lp.next(pos);
+        fn(lp.view(pos, ftmp), lp.view(vpos, vtmp));
+        pos = lp.next(vpos);
+    }
+}
+
+template <typename Fn>
+uint64_t Hash::scan(uint64_t cursor, size_t count, Fn &&fn) const {
+    if (compact) {
+        forEach(fn);
+        return 0;
+    }
+
+    size_t buckets = table.bucket_count();
+    size_t seen = 0;
+    while (cursor < buckets && seen < count) {
+        for (auto it = table.begin(cursor); it != table.end(cursor); ++it, ++seen)
+            fn(std::string_view(it->first), std::string_view(it->second));
+        ++cursor;
+    }
+    return cursor < buckets ? cursor : 0;
+}
@@ -0,0 +1,67 @@
+#include "IntSet.hpp"
+
+#include <limits>
+
+namespace {
+
+template <typename T>
+bool fits(int64_t value) {
+    return value >= std::numeric_limits<T>::min() && value <= std::numeric_limits<T>::max();
+}
+
+} // namespace
+
+bool IntSet::contains(int64_t value) const {
+    return std::visit([value](const auto &v) {
+        using T = typename std::decay_t<decltype(v)>::value_type;
+        return fits<T>(value) &&
+               std::binary_search(v.begin(), v.end(), static_cast<T>(value));
+    }, values);
+}
+
+bool IntSet::add(int64_t value) {
+    upgradeFor(value);
+    return std::visit([value](auto &v) {
+        using T = typename std::decay_t<decltype(v)>::value_type;
+        T x = static_cast<T>(value);
+
+        // Ascending inserts (IDs) append without a search
+        if (v.empty() || v.back() < x) {
+            v.push_back(x);
+            return true;
+        }
+        auto it = std::lower_bound(v.begin(), v.end(), x);
+        if (*it == x)
+            return false;
+        v.insert(it, x);
+        return true;
+    }, values);
+}
+
+bool IntSet::remove(int64_t value) {
+    return std::visit([value](auto &v) {
+        using T = typename std::decay_t<decltype(v)>::value_type;
+        if (!fits<T>(value))
+            return false;
+        auto it = std::lower_bound(v.begin(), v.end(), static_cast<T>(value));
+        if (it == v.end() || *it != static_cast<T>(value))
+            return false;
+        v.erase(it);
+        return true;
+    }, values);
+}
+
+void IntSet::upgradeFor(int64_t value) {
+    size_t needed = fits<int16_t>(value) ? 2 : fits<int32_t>(value) ? 4 : 8;
+    if (needed <= width())
+        return;
+
+    auto widen = [this](auto wider) {
+        std::visit([&](const auto &v) { wider.assign(v.begin(), v.end()); }, values);
+        values = std::move(wider);
+    };
+    if (needed == 4)
+        widen(std::vector<int32_t>{});
+    else
+        widen(std::vector<int64_t>{});
+}
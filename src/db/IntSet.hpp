@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <variant>
+#include <vector>
+
+/*
+------------------------------------------------------------------------------
+  INTSET (sorted packed integers)
+------------------------------------------------------------------------------
+
+A set of int64 values kept as one sorted array, in the narrowest of
+int16 / int32 / int64 that holds every member:
+
+    [ -7 | 3 | 12 | 900 ]        (int16: 2 bytes a member)
+
+Adding a value that does not fit upgrades the whole array to the wider
+type; it never goes back. Lookups are binary searches, inserts and
+removals move the tail of the array, which is cheap at the sizes Set
+keeps intsets to (set-max-intset-entries).
+
+Sorted arrays also make intersections cheap: intersectSorted() below
+walks two of them together instead of probing a hash table per member.
+------------------------------------------------------------------------------
+*/
+class IntSet {
+public:
+    size_t size() const {
+        return std::visit([](const auto &v) { return v.size(); }, values);
+    }
+    bool empty() const { return size() == 0; }
+
+    // Bytes per member (2, 4 or 8).
+    size_t width() const {
+        return std::visit([](const auto &v) { return sizeof(v[0]); }, values);
+    }
+
+    bool contains(int64_t value) const;
+    int64_t at(size_t i) const {
+        return std::visit([i](const auto &v) { return static_cast<int64_t>(v[i]); }, values);
+    }
+
+    // True if the value was not there yet.
+    bool add(int64_t value);
+    bool remove(int64_t value);
+
+    // Calls fn(const T *data, size_t n) with the members in ascending
+    // order, T being the current element type.
+    template <typename Fn>
+    decltype(auto) visit(Fn &&fn) const {
+        return std::visit([&](const auto &v) -> decltype(auto) { return fn(v.data(), v.size()); },
+                          values);
+    }
+
+private:
+    std::variant<std::vector<int16_t>, std::vector<int32_t>, std::vector<int64_t>> values;
+
+    // Widens the array so that `value` fits.
+    void upgradeFor(int64_t value);
+};
+
+/*
+------------------------------------------------------------------------------
+  intersectSorted()
+------------------------------------------------------------------------------
+
+Writes the values present in both ascending arrays to `out` (room for
+min(na, nb) values) and returns how many there are.
+
+  similar sizes:  merge; each step compares the two heads and advances
+                  either side or both without a branch on the outcome,
+                  so unpredictable data costs no mispredictions
+  skewed sizes:   gallop; for every value of the small array, probe the
+                  large one at 1, 2, 4, ... positions ahead and binary
+                  search the last gap: O(small * log(large / small))
+------------------------------------------------------------------------------
+*/
+template <typename A, typename B>
+size_t intersectSorted(const A *a, size_t na, const B *b, size_t nb, int64_t *out)
+{
+    // Galloping pays off once one side is this many times longer
+    constexpr size_t kGallopRatio = 16;
+
+    if (na == 0 || nb == 0)
+        return 0;
+
+    if (nb / na >= kGallopRatio || na / nb >= kGallopRatio) {
+        if (na > nb)
+            return intersectSorted(b, nb, a, na, out);
+
+        size_t k = 0, lo = 0;
+        for (size_t i = 0; i < na && lo < nb; ++i) {
+            int64_t x = a[i];
+            size_t step = 1, hi = lo;
+            while (hi < nb && static_cast<int64_t>(b[hi]) < x) {
+                lo = hi + 1;
+                hi += step;
+                step <<= 1;
+            }
+            hi = std::min(hi + 1, nb);
+            lo = static_cast<size_t>(
+                std::lower_bound(b + lo, b + hi, x,
+                                 [](B y, int64_t v) { return static_cast<int64_t>(y) < v; }) - b);
+            if (lo < nb && static_cast<int64_t>(b[lo]) == x)
+                out[k++] = x;
+        }
+        return k;
+    }
+
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        int64_t x = a[i], y = b[j];
+        out[k] = x;
+        k += x == y;
+        i += x <= y;
+        j += y <= x;
+    }
+    return k;
+}
@@ -1,62 +1,450 @@
 #include "List.hpp"
 
-bool List::Empty() {
-    return list.empty();
+#include <cstdint>
+#include <iterator>
+
+bool List::Empty() const {
+    return length == 0;
+}
+
+int List::Len() const {
+    return static_cast<int>(length);
 }
 
-int List::Len() {
-    return list.size();
+// A node always takes at least one element, so values bigger than a
+// node get a node of their own.
+bool List::HasRoom(const Listpack &node, std::string_view element) {
+    return node.empty() ||
+           node.bytes() + Listpack::entrySize(element) <= kNodeMaxBytes;
+}
+
+size_t List::CompressedNodeCount() const {
+    size_t n = 0;
+    for (const Listpack &node : nodes)
+        n += node.compressed();
+    return n;
+}
+
+size_t List::AllocatedBytes() const {
+    size_t n = 0;
+    for (const Listpack &node : nodes)
+        n += node.allocatedBytes();
+    return n;
+}
+
+void List::CompressEnd(bool head) {
+    if (compressDepth == 0)
+        return;
+
+    size_t depth = static_cast<size_t>(compressDepth);
+    auto walk = [&](auto it, auto end) {
+        for (size_t i = 0; i < depth && it != end; ++i, ++it)
+            it->decompress();
+        if (nodes.size() > 2 * depth && it != end)
+            it->compress();
+    };
+
+    if (head)
+        walk(nodes.begin(), nodes.end());
+    else
+        walk(nodes.rbegin(), nodes.rend());
 }
 
-int List::PushFront(std::string element) {
-    list.push_front(element);
-    return list.size();
+int List::PushFront(std::string_view element) {
+    if (nodes.empty() || !HasRoom(nodes.front(), element)) {
+        if (!nodes.empty())
+            nodes.front().shrinkToFit();
+        nodes.emplace_front();
+    }
+
+    nodes.front().decompress();
+    nodes.front().pushFront(element);
+    CompressEnd(true);
+    return static_cast<int>(++length);
 }
 
-int List::PushBack(std::string element) {
-    list.push_back(element);
-    return list.size();
+int List::PushBack(std::string_view element) {
+    if (nodes.empty() || !HasRoom(nodes.back(), element)) {
+        if (!nodes.empty())
+            nodes.back().shrinkToFit();
+        nodes.emplace_back();
+    }
+
+    nodes.back().decompress();
+    nodes.back().pushBack(element);
+    CompressEnd(false);
+    return static_cast<int>(++length);
 }
 
 std::string List::POPFront() {
-    if (list.empty())
-        return "";             
-    std::string value = list.front();
-    list.pop_front();
+    if (nodes.empty())
+        return "";
+
+    Listpack &node = nodes.front();
+    node.decompress();
+    std::string value = node.get(node.begin());
+    node.erase(node.begin());
+    --length;
+
+    if (node.empty()) {
+        nodes.pop_front();
+        CompressEnd(true);
+    }
     return value;
 }
 
 std::string List::POPBack() {
-    if (list.empty())
+    if (nodes.empty())
         return "";
 
-    std::string value = list.back();
-    list.pop_back();
+    Listpack &node = nodes.back();
+    node.decompress();
+    size_t pos = node.last();
+    std::string value = node.get(pos);
+    node.erase(pos);
+    --length;
+
+    if (node.empty()) {
+        nodes.pop_back();
+        CompressEnd(false);
+    }
     return value;
 }
 
-std::vector<std::string> List::GetElementsInRange(int start, int end) {
-    int len = list.size();
-    if (len == 0) return {};
+namespace {
+
+// Node holding the index-th element, walking from the nearer end.
+// Works for both the const and the mutable node list.
+template <typename Nodes>
+auto locateNode(Nodes &nodes, size_t length, size_t index, size_t &offset) {
+    if (index < length / 2) {
+        auto it = nodes.begin();
+        while (index >= it->count()) {
+            index -= it->count();
+            ++it;
+        }
+        offset = index;
+        return it;
+    }
+
+    size_t from_back = length - 1 - index;
+    auto it = std::prev(nodes.end());
+    while (from_back >= it->count()) {
+        from_back -= it->count();
+        --it;
+    }
+    offset = it->count() - 1 - from_back;
+    return it;
+}
+
+} // namespace
+
+bool List::NormalizeRange(int &start, int &end) const {
+    int len = static_cast<int>(length);
+    if (len == 0) return false;
 
     if (start < 0) start = len + start;
     if (end < 0) end = len + end;
-    
     if (start < 0) start = 0;
-    if (end < 0) end = 0;
-
-    if (start >= len) return {};
 
+    if (start >= len || start > end) return false;
     if (end >= len) end = len - 1;
+    return true;
+}
 
-    if (start > end) return {};
+List::NodeIt List::Locate(size_t index, size_t &offset) {
+    return locateNode(nodes, length, index, offset);
+}
 
-    std::vector<std::string> result;
-    result.reserve(end - start + 1);
+void List::Settle(NodeIt node, bool was_compressed) {
+    if (node->empty()) {
+        nodes.erase(node);
+    } else if (node->bytes() > kNodeMaxBytes && node->count() > 1) {
+        Listpack tail = node->splitAt(node->seek(static_cast<long long>(node->count() / 2)));
+        auto next = nodes.insert(std::next(node), std::move(tail));
+        if (was_compressed) {
+            node->compress();
+            next->compress();
+        }
+    } else if (was_compressed) {
+        node->compress();
+    }
 
-    for (int i = start; i <= end; i++) {
-        result.push_back(list[i]);
+    CompressEnd(true);
+    CompressEnd(false);
+}
+
+void List::RangeIterator::Open() {
+    usingScratch = node->compressed();
+    if (usingScratch)
+        scratch = node->decompressedCopy();
+    pos = reverse ? Current().last() : Current().begin();
+}
+
+bool List::RangeIterator::Next(std::string_view &out) {
+    if (remaining == 0)
+        return false;
+
+    // end() marks a node that has been read completely, in either direction
+    if (pos == Current().end()) {
+        if (reverse)
+            --node;
+        else
+            ++node;
+        Open();
     }
 
+    const Listpack &lp = Current();
+    out = lp.view(pos, intBuf);
+    if (reverse)
+        pos = pos == lp.begin() ? lp.end() : lp.prev(pos);
+    else
+        pos = lp.next(pos);
+    --remaining;
+    return true;
+}
+
+List::RangeIterator List::Range(int start, int end) const {
+    RangeIterator it;
+    if (!NormalizeRange(start, end))
+        return it;
+
+    size_t offset = 0;
+    it.node = locateNode(nodes, length, static_cast<size_t>(start), offset);
+    it.Open();
+    it.pos = it.Current().seek(static_cast<long long>(offset));
+    it.remaining = static_cast<size_t>(end - start + 1);
+    return it;
+}
+
+List::RangeIterator List::ReverseRange(int start, int end) const {
+    RangeIterator it;
+    it.reverse = true;
+    if (!NormalizeRange(start, end))
+        return it;
+
+    size_t offset = 0;
+    it.node = locateNode(nodes, length, static_cast<size_t>(end), offset);
+    it.Open();
+    it.pos = it.Current().seek(static_cast<long long>(offset));
+    it.remaining = static_cast<size_t>(end - start + 1);
+    return it;
+}
+
+std::vector<std::string> List::GetElementsInRange(int start, int end) const {
+    RangeIterator it = Range(start, end);
+
+    std::vector<std::string> result;
+    result.reserve(it.Remaining());
+
+    std::string_view value;
+    while (it.Next(value))
+        result.emplace_back(value);
+
     return result;
 }
+
+size_t List::TrimFront(size_t n) {
+    size_t removed = 0;
+    while (removed < n && !nodes.empty()) {
+        Listpack &node = nodes.front();
+        size_t k = n - removed;
+
+        // Whole node: no byte is moved
+        if (k >= node.count()) {
+            removed += node.count();
+            nodes.pop_front();
+            continue;
+        }
+
+        node.decompress();
+        size_t to = node.begin();
+        for (size_t i = 0; i < k; ++i)
+            to = node.next(to);
+        node.eraseRange(node.begin(), to, k);
+        removed += k;
+    }
+
+    length -= removed;
+    CompressEnd(true);
+    return removed;
+}
+
+size_t List::TrimBack(size_t n) {
+    size_t removed = 0;
+    while (removed < n && !nodes.empty()) {
+        Listpack &node = nodes.back();
+        size_t k = n - removed;
+
+        if (k >= node.count()) {
+            removed += node.count();
+            nodes.pop_back();
+            continue;
+        }
+
+        node.decompress();
+        size_t from = node.last();
+        for (size_t i = 1; i < k; ++i)
+            from = node.prev(from);
+        node.eraseRange(from, node.end(), k);
+        removed += k;
+    }
+
+    length -= removed;
+    CompressEnd(false);
+    return removed;
+}
+
+void List::Trim(int start, int end) {
+    if (!NormalizeRange(start, end)) {
+        nodes.clear();
+        length = 0;
+        return;
+    }
+
+    TrimBack(length - 1 - static_cast<size_t>(end));
+    TrimFront(static_cast<size_t>(start));
+}
+
+bool List::Index(long long index, std::string &out) const {
+    long long len = static_cast<long long>(length);
+    if (index < 0)
+        index += len;
+    if (index < 0 || index >= len)
+        return false;
+
+    size_t offset = 0;
+    auto node = locateNode(nodes, length, static_cast<size_t>(index), offset);
+    if (node->compressed()) {
+        Listpack raw = node->decompressedCopy();
+        out = raw.get(raw.seek(static_cast<long long>(offset)));
+    } else {
+        out = node->get(node->seek(static_cast<long long>(offset)));
+    }
+    return true;
+}
+
+bool List::Set(long long index, std::string_view element) {
+    long long len = static_cast<long long>(length);
+    if (index < 0)
+        index += len;
+    if (index < 0 || index >= len)
+        return false;
+
+    size_t offset = 0;
+    NodeIt node = Locate(static_cast<size_t>(index), offset);
+    bool was_compressed = node->compressed();
+    node->decompress();
+    node->replace(node->seek(static_cast<long long>(offset)), element);
+    Settle(node, was_compressed);
+    return true;
+}
+
+bool List::Insert(std::string_view pivot, std::string_view element, bool after) {
+    for (NodeIt node = nodes.begin(); node != nodes.end(); ++node) {
+        // Look for the pivot without decompressing the node in place
+        Listpack copy;
+        const Listpack *lp = &*node;
+        if (node->compressed()) {
+            copy = node->decompressedCopy();
+            lp = &copy;
+        }
+
+        for (size_t pos = lp->begin(); pos != lp->end(); pos = lp->next(pos)) {
+            if (!lp->equals(pos, pivot))
+                continue;
+
+            bool was_compressed = node->compressed();
+            node->decompress();
+            node->insert(after ? node->next(pos) : pos, element);
+            ++length;
+            Settle(node, was_compressed);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t List::Remove(long long count, std::string_view element) {
+    size_t limit = count == 0 ? SIZE_MAX
+                              : static_cast<size_t>(count < 0 ? -count : count);
+    bool from_tail = count < 0;
+    size_t removed = 0;
+
+    auto hasMatch = [&](const Listpack &node) {
+        Listpack copy;
+        const Listpack *lp = &node;
+        if (node.compressed()) {
+            copy = node.decompressedCopy();
+            lp = &copy;
+        }
+        for (size_t pos = lp->begin(); pos != lp->end(); pos = lp->next(pos)) {
+            if (lp->equals(pos, element))
+                return true;
+        }
+        return false;
+    };
+
+    // Removes matches inside one node, unlinking it if it ends up empty
+    auto sweep = [&](NodeIt node) {
+        bool was_compressed = node->compressed();
+        node->decompress();
+
+        if (!from_tail) {
+            size_t pos = node->begin();
+            while (pos != node->end() && removed < limit) {
+                if (node->equals(pos, element)) {
+                    node->erase(pos);
+                    ++removed;
+                } else {
+                    pos = node->next(pos);
+                }
+            }
+        } else if (!node->empty()) {
+            size_t pos = node->last();
+            while (removed < limit) {
+                bool first = pos == node->begin();
+                size_t before = first ? 0 : node->prev(pos);
+                if (node->equals(pos, element)) {
+                    node->erase(pos);
+                    ++removed;
+                }
+                if (first)
+                    break;
+                pos = before;
+            }
+        }
+
+        if (node->empty())
+            nodes.erase(node);
+        else if (was_compressed)
+            node->compress();
+    };
+
+    if (!from_tail) {
+        for (NodeIt node = nodes.begin(); node != nodes.end() && removed < limit;) {
+            NodeIt next = std::next(node);
+            if (hasMatch(*node))
+                sweep(node);
+            node = next;
+        }
+    } else {
+        for (NodeIt node = nodes.end(); node != nodes.begin() && removed < limit;) {
+            --node;
+            if (!hasMatch(*node))
+                continue;
+
+            bool first = node == nodes.begin();
+            NodeIt before = first ? nodes.end() : std::prev(node);
+            sweep(node);
+            if (first)
+                break;
+            node = std::next(before);
+        }
+    }
+
+    length -= removed;
+    CompressEnd(true);
+    CompressEnd(false);
+    return removed;
+}
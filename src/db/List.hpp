@@ -1,18 +1,136 @@
 #pragma once
 
-#include <deque>
+#include <list>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "Listpack.hpp"
+
+/*
+------------------------------------------------------------------------------
+  LIST (quicklist)
+------------------------------------------------------------------------------
+
+A doubly linked list of Listpack nodes, each holding up to kNodeMaxBytes
+of packed entries:
+
+    [lp: a b c ... ] <-> [lp: ... ] <-> ... <-> [lp: ... x y z]
+
+Pushes go into the head or tail node while it has room, otherwise into
+a fresh node; pops remove from the head or tail node and unlink it once
+empty. Both stay O(1): the work per operation is bounded by the node
+size, not by the list length.
+
+With list-compress-depth N > 0, only the N nodes at each end stay raw;
+interior nodes hold the LZF-compressed form of their listpack and are
+decompressed on demand by range reads. Push/pop never touch them.
+
+Compared to one std::string per element this removes the 32-byte string
+header, the separate heap block for anything past SSO and the allocator
+overhead that comes with it; numeric elements are stored as integers.
+------------------------------------------------------------------------------
+*/
 class List {
-private:
-    std::deque<std::string> list;
 public:
-    bool Empty();
-    int PushBack(std::string element);
-    int PushFront(std::string element);
+    // Same default as Redis' list-max-listpack-size -2 (8 KB)
+    static constexpr size_t kNodeMaxBytes = 8192;
+
+    bool Empty() const;
+    int PushBack(std::string_view element);
+    int PushFront(std::string_view element);
     std::string POPBack();
     std::string POPFront();
-    std::vector<std::string> GetElementsInRange(int start, int end);
-    int Len();
+    std::vector<std::string> GetElementsInRange(int start, int end) const;
+    int Len() const;
+
+    // Removes up to n elements from one end, dropping whole nodes where
+    // possible. Returns how many were removed.
+    size_t TrimFront(size_t n);
+    size_t TrimBack(size_t n);
+
+    // LTRIM: keeps only [start, end] (LRANGE-style indices).
+    void Trim(int start, int end);
+
+    // LINDEX / LSET. Negative indices count from the tail.
+    bool Index(long long index, std::string &out) const;
+    bool Set(long long index, std::string_view element);
+
+    // LINSERT: inserts next to the first element equal to `pivot`.
+    // Returns false if there is no such element.
+    bool Insert(std::string_view pivot, std::string_view element, bool after);
+
+    // LREM: removes up to |count| elements equal to `element`, from the
+    // head (count > 0), from the tail (count < 0) or all (count == 0).
+    size_t Remove(long long count, std::string_view element);
+
+    /*
+     * Forward cursor over an LRANGE-style index range. Elements come out
+     * as views that stay valid until the next call, so callers can encode
+     * straight into their output. A compressed node is decompressed into
+     * the cursor while it is being read; the list itself is untouched.
+     * The list must not be modified while a cursor is in use.
+     */
+    class RangeIterator {
+    public:
+        bool Next(std::string_view &out);
+        size_t Remaining() const { return remaining; }
+
+    private:
+        friend class List;
+
+        std::list<Listpack>::const_iterator node;
+        Listpack scratch;
+        bool usingScratch = false;
+        size_t pos = 0;
+        size_t remaining = 0;
+        bool reverse = false;
+        char intBuf[Listpack::kIntBufSize];
+
+        const Listpack &Current() const { return usingScratch ? scratch : *node; }
+        void Open();   // prepares `node` for reading, from its first entry
+                       // (last entry when reverse)
+    };
+
+    // Empty when the range selects nothing. Indices as in LRANGE.
+    RangeIterator Range(int start, int end) const;
+
+    // Same range, walked from `end` down to `start`.
+    RangeIterator ReverseRange(int start, int end) const;
+
+    size_t NodeCount() const { return nodes.size(); }
+    size_t CompressedNodeCount() const;
+
+    // Heap bytes held by the nodes' buffers.
+    size_t AllocatedBytes() const;
+
+    // list-compress-depth, shared by every list (0 = no compression).
+    static void SetCompressDepth(int depth) { compressDepth = depth < 0 ? 0 : depth; }
+    static int CompressDepth() { return compressDepth; }
+
+private:
+    std::list<Listpack> nodes;
+    size_t length = 0;
+
+    static inline int compressDepth = 0;
+
+    using NodeIt = std::list<Listpack>::iterator;
+
+    static bool HasRoom(const Listpack &node, std::string_view element);
+
+    // Clamps LRANGE-style indices; false if the range is empty.
+    bool NormalizeRange(int &start, int &end) const;
+
+    // Node holding the index-th element (walking from the nearer end)
+    // and the element's index inside it.
+    NodeIt Locate(size_t index, size_t &offset);
+
+    // After an in-place change: splits a node that outgrew kNodeMaxBytes,
+    // drops it if it became empty and restores its compression.
+    void Settle(NodeIt node, bool was_compressed);
+
+    // Keeps the `compressDepth` nodes at one end raw and compresses the
+    // first node past them, which is the only one that can have become
+    // interior after a push or pop at that end.
+    void CompressEnd(bool head);
 };
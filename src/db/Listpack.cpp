@@ -0,0 +1,437 @@
+#include "Listpack.hpp"
+
+#include "Lzf.hpp"
+
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+constexpr unsigned char ENC_INT16 = 0xF1;
+constexpr unsigned char ENC_INT24 = 0xF2;
+constexpr unsigned char ENC_INT32 = 0xF3;
+constexpr unsigned char ENC_INT64 = 0xF4;
+constexpr unsigned char ENC_STR32 = 0xF0;
+
+// Same thresholds as Redis: tiny nodes are not worth compressing, and
+// the result has to save at least a few bytes.
+constexpr size_t MIN_COMPRESS_BYTES = 48;
+constexpr size_t MIN_COMPRESS_IMPROVE = 8;
+
+void writeLE(unsigned char *out, uint64_t v, int n) {
+    for (int i = 0; i < n; ++i)
+        out[i] = static_cast<unsigned char>(v >> (8 * i));
+}
+
+int64_t readLE(const unsigned char *in, int n) {
+    uint64_t v = 0;
+    for (int i = 0; i < n; ++i)
+        v |= static_cast<uint64_t>(in[i]) << (8 * i);
+
+    // Sign-extend from n bytes
+    if (n < 8 && (v >> (8 * n - 1)) & 1)
+        v |= ~0ULL << (8 * n);
+    return static_cast<int64_t>(v);
+}
+
+} // namespace
+
+/* =====================================================================
+   Encoding
+   ===================================================================== */
+
+// Only the canonical decimal form round-trips, so "007", "+1", "-0" and
+// anything longer than an int64 stay strings.
+bool Listpack::toInt64(std::string_view s, int64_t &out) {
+    if (s.empty() || s.size() > 20)
+        return false;
+
+    size_t digits = s[0] == '-' ? 1 : 0;
+    if (digits == s.size() || s[digits] < '0' || s[digits] > '9')
+        return false;
+    if (s[digits] == '0' && (s.size() > digits + 1 || digits == 1))
+        return false;
+
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && ptr == s.data() + s.size();
+}
+
+size_t Listpack::backlenSize(size_t len) {
+    size_t n = 1;
+    while (len >>= 7)
+        ++n;
+    return n;
+}
+
+/**
+ * Writes <encoding><data><backlen> for `value` into `out` (if not null)
+ * and returns its size.
+ */
+size_t Listpack::encode(std::string_view value, unsigned char *out) {
+    int64_t v;
+    if (toInt64(value, v))
+        return encodeInt(v, out);
+
+    unsigned char head[5];
+    size_t head_len;
+    size_t payload_len = value.size();
+    if (payload_len < 64) {
+        head[0] = static_cast<unsigned char>(0x80 | payload_len);
+        head_len = 1;
+    } else if (payload_len < 4096) {
+        head[0] = static_cast<unsigned char>(0xE0 | (payload_len >> 8));
+        head[1] = static_cast<unsigned char>(payload_len & 0xFF);
+        head_len = 2;
+    } else {
+        head[0] = ENC_STR32;
+        writeLE(head + 1, payload_len, 4);
+        head_len = 5;
+    }
+    return writeEntry(head, head_len, value.data(), payload_len, out);
+}
+
+size_t Listpack::encodeInt(int64_t v, unsigned char *out) {
+    unsigned char head[9];
+    size_t head_len;
+
+    if (v >= 0 && v <= 127) {
+        head[0] = static_cast<unsigned char>(v);
+        head_len = 1;
+    } else if (v >= -4096 && v <= 4095) {
+        uint64_t u = static_cast<uint64_t>(v) & 0x1FFF;
+        head[0] = static_cast<unsigned char>(0xC0 | (u >> 8));
+        head[1] = static_cast<unsigned char>(u & 0xFF);
+        head_len = 2;
+    } else if (v >= INT16_MIN && v <= INT16_MAX) {
+        head[0] = ENC_INT16;
+        writeLE(head + 1, static_cast<uint64_t>(v), 2);
+        head_len = 3;
+    } else if (v >= -(1 << 23) && v < (1 << 23)) {
+        head[0] = ENC_INT24;
+        writeLE(head + 1, static_cast<uint64_t>(v), 3);
+        head_len = 4;
+    } else if (v >= INT32_MIN && v <= INT32_MAX) {
+        head[0] = ENC_INT32;
+        writeLE(head + 1, static_cast<uint64_t>(v), 4);
+        head_len = 5;
+    } else {
+        head[0] = ENC_INT64;
+        writeLE(head + 1, static_cast<uint64_t>(v), 8);
+        head_len = 9;
+    }
+    return writeEntry(head, head_len, nullptr, 0, out);
+}
+
+size_t Listpack::writeEntry(const unsigned char *head, size_t head_len,
+                            const char *payload, size_t payload_len,
+                            unsigned char *out) {
+    size_t len = head_len + payload_len;
+    size_t back = backlenSize(len);
+    if (!out)
+        return len + back;
+
+    std::memcpy(out, head, head_len);
+    if (payload_len)
+        std::memcpy(out + head_len, payload, payload_len);
+
+    // Least significant group rightmost; high bit = more bytes to the left
+    unsigned char *b = out + len;
+    for (size_t i = 0; i < back; ++i) {
+        unsigned char group = static_cast<unsigned char>((len >> (7 * i)) & 127);
+        b[back - 1 - i] = group | (i + 1 < back ? 128 : 0);
+    }
+    return len + back;
+}
+
+size_t Listpack::entrySize(std::string_view value) {
+    return encode(value, nullptr);
+}
+
+/* =====================================================================
+   Decoding and traversal
+   ===================================================================== */
+
+size_t Listpack::encodedSize(size_t pos) const {
+    const unsigned char *p = data() + pos;
+    unsigned char b = p[0];
+
+    if (b < 0x80)              return 1;
+    if ((b & 0xC0) == 0x80)    return 1 + (b & 0x3F);
+    if ((b & 0xE0) == 0xC0)    return 2;
+    if ((b & 0xF0) == 0xE0)    return 2 + (((b & 0x0F) << 8) | p[1]);
+
+    switch (b) {
+    case ENC_INT16: return 3;
+    case ENC_INT24: return 4;
+    case ENC_INT32: return 5;
+    case ENC_INT64: return 9;
+    default:        return 5 + static_cast<size_t>(readLE(p + 1, 4) & 0xFFFFFFFF);
+    }
+}
+
+void Listpack::decode(size_t pos, bool &is_int, int64_t &ival,
+                      std::string_view &str) const {
+    const unsigned char *p = data() + pos;
+    unsigned char b = p[0];
+    is_int = true;
+
+    if (b < 0x80) {
+        ival = b;
+    } else if ((b & 0xC0) == 0x80) {
+        is_int = false;
+        str = std::string_view(reinterpret_cast<const char *>(p + 1), b & 0x3F);
+    } else if ((b & 0xE0) == 0xC0) {
+        int64_t u = ((b & 0x1F) << 8) | p[1];
+        ival = (u & 0x1000) ? u - 0x2000 : u;
+    } else if ((b & 0xF0) == 0xE0) {
+        is_int = false;
+        size_t len = ((b & 0x0F) << 8) | p[1];
+        str = std::string_view(reinterpret_cast<const char *>(p + 2), len);
+    } else if (b == ENC_INT16) {
+        ival = readLE(p + 1, 2);
+    } else if (b == ENC_INT24) {
+        ival = readLE(p + 1, 3);
+    } else if (b == ENC_INT32) {
+        ival = readLE(p + 1, 4);
+    } else if (b == ENC_INT64) {
+        ival = readLE(p + 1, 8);
+    } else {
+        is_int = false;
+        size_t len = static_cast<size_t>(readLE(p + 1, 4) & 0xFFFFFFFF);
+        str = std::string_view(reinterpret_cast<const char *>(p + 5), len);
+    }
+}
+
+size_t Listpack::next(size_t pos) const {
+    size_t len = encodedSize(pos);
+    return pos + len + backlenSize(len);
+}
+
+size_t Listpack::prev(size_t pos) const {
+    const unsigned char *b = data();
+    size_t p = pos - 1;
+    size_t len = 0;
+    int shift = 0;
+    while (true) {
+        len |= static_cast<size_t>(b[p] & 127) << shift;
+        if (!(b[p] & 128))
+            break;
+        shift += 7;
+        --p;
+    }
+    return p - len;
+}
+
+size_t Listpack::last() const {
+    return size() == 0 ? end() : prev(end());
+}
+
+size_t Listpack::seek(long long index) const {
+    long long n = static_cast<long long>(entries);
+    if (index < 0)
+        index += n;
+    if (index < 0 || index >= n)
+        return end();
+
+    // Walk from whichever end is closer
+    if (index < n / 2) {
+        size_t pos = begin();
+        while (index-- > 0)
+            pos = next(pos);
+        return pos;
+    }
+
+    size_t pos = last();
+    for (long long i = n - 1; i > index; --i)
+        pos = prev(pos);
+    return pos;
+}
+
+std::string_view Listpack::view(size_t pos, char (&tmp)[kIntBufSize]) const {
+    bool is_int;
+    int64_t ival = 0;
+    std::string_view str;
+    decode(pos, is_int, ival, str);
+
+    if (!is_int)
+        return str;
+
+    auto [ptr, ec] = std::to_chars(tmp, tmp + kIntBufSize, ival);
+    return std::string_view(tmp, static_cast<size_t>(ptr - tmp));
+}
+
+int64_t Listpack::getInt(size_t pos) const {
+    bool is_int;
+    int64_t ival = 0;
+    std::string_view str;
+    decode(pos, is_int, ival, str);
+
+    if (!is_int)
+        toInt64(str, ival);
+    return ival;
+}
+
+void Listpack::appendTo(size_t pos, std::string &out) const {
+    char tmp[kIntBufSize];
+    out.append(view(pos, tmp));
+}
+
+std::string Listpack::get(size_t pos) const {
+    std::string out;
+    appendTo(pos, out);
+    return out;
+}
+
+/* =====================================================================
+   Mutation
+   ===================================================================== */
+
+void Listpack::insert(size_t pos, std::string_view value) {
+    own();
+    size_t size = entrySize(value);
+    buf.insert(buf.begin() + static_cast<std::ptrdiff_t>(pos), size, 0);
+    encode(value, buf.data() + pos);
+    ++entries;
+}
+
+void Listpack::insertInt(size_t pos, int64_t value) {
+    own();
+    size_t size = encodeInt(value, nullptr);
+    buf.insert(buf.begin() + static_cast<std::ptrdiff_t>(pos), size, 0);
+    encodeInt(value, buf.data() + pos);
+    ++entries;
+}
+
+void Listpack::erase(size_t pos) {
+    own();
+    size_t to = next(pos);
+    buf.erase(buf.begin() + static_cast<std::ptrdiff_t>(pos),
+              buf.begin() + static_cast<std::ptrdiff_t>(to));
+    --entries;
+
+    // Popping a node down should give its memory back eventually
+    if (buf.capacity() > 2 * buf.size() + 64)
+        buf.shrink_to_fit();
+}
+
+void Listpack::eraseRange(size_t from, size_t to, size_t n) {
+    own();
+    buf.erase(buf.begin() + static_cast<std::ptrdiff_t>(from),
+              buf.begin() + static_cast<std::ptrdiff_t>(to));
+    entries -= n;
+
+    if (buf.capacity() > 2 * buf.size() + 64)
+        buf.shrink_to_fit();
+}
+
+void Listpack::replace(size_t pos, std::string_view value) {
+    own();
+    resizeEntry(pos, entrySize(value));
+    encode(value, buf.data() + pos);
+}
+
+void Listpack::replaceInt(size_t pos, int64_t value) {
+    own();
+    resizeEntry(pos, encodeInt(value, nullptr));
+    encodeInt(value, buf.data() + pos);
+}
+
+// Makes the entry at `pos` take `new_size` bytes (contents undefined).
+void Listpack::resizeEntry(size_t pos, size_t new_size) {
+    size_t old_size = next(pos) - pos;
+
+    if (new_size > old_size)
+        buf.insert(buf.begin() + static_cast<std::ptrdiff_t>(pos), new_size - old_size, 0);
+    else if (new_size < old_size)
+        buf.erase(buf.begin() + static_cast<std::ptrdiff_t>(pos),
+                  buf.begin() + static_cast<std::ptrdiff_t>(pos + old_size - new_size));
+}
+
+Listpack Listpack::splitAt(size_t pos) {
+    own();
+    Listpack tail;
+    for (size_t p = pos; p < end(); p = next(p))
+        ++tail.entries;
+
+    tail.buf.assign(buf.begin() + static_cast<std::ptrdiff_t>(pos), buf.end());
+    buf.resize(pos);
+    buf.shrink_to_fit();
+    entries -= tail.entries;
+    return tail;
+}
+
+bool Listpack::equals(size_t pos, std::string_view value) const {
+    char tmp[kIntBufSize];
+    return view(pos, tmp) == value;
+}
+
+/* =====================================================================
+   Compression
+   ===================================================================== */
+
+bool Listpack::compress() {
+    if (compressed())
+        return true;
+    if (isExternal())
+        return false;
+    if (buf.size() < MIN_COMPRESS_BYTES)
+        return false;
+
+    std::string packed;
+    if (!lzf::compress(buf.data(), buf.size(), packed, buf.size() - MIN_COMPRESS_IMPROVE))
+        return false;
+
+    packed.shrink_to_fit();
+    lzfData = std::move(packed);
+    rawBytes = buf.size();
+    std::vector<unsigned char>().swap(buf);
+    return true;
+}
+
+void Listpack::decompress() {
+    if (!compressed())
+        return;
+
+    buf.resize(rawBytes);
+    lzf::decompress(reinterpret_cast<const unsigned char *>(lzfData.data()),
+                    lzfData.size(), buf.data(), rawBytes);
+    std::string().swap(lzfData);
+    rawBytes = 0;
+}
+
+Listpack Listpack::decompressedCopy() const {
+    Listpack copy;
+    copy.entries = entries;
+    if (!compressed()) {
+        copy.buf.assign(data(), data() + size());
+        return copy;
+    }
+
+    copy.buf.resize(rawBytes);
+    lzf::decompress(reinterpret_cast<const unsigned char *>(lzfData.data()),
+                    lzfData.size(), copy.buf.data(), rawBytes);
+    return copy;
+}
+
+/* =====================================================================
+   External bytes
+   ===================================================================== */
+
+Listpack Listpack::external(const unsigned char *data, size_t size, size_t entries,
+                            std::shared_ptr<const void> owner) {
+    Listpack lp;
+    lp.ext = data;
+    lp.extSize = size;
+    lp.entries = entries;
+    lp.extOwner = std::move(owner);
+    return lp;
+}
+
+void Listpack::own() {
+    if (!ext)
+        return;
+    buf.assign(ext, ext + extSize);
+    ext = nullptr;
+    extSize = 0;
+    extOwner.reset();
+}
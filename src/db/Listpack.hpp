@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+------------------------------------------------------------------------------
+  LISTPACK (one packed quicklist node)
+------------------------------------------------------------------------------
+
+A contiguous byte buffer of entries, walkable in both directions:
+
+    <entry> <entry> ... <entry>
+
+    entry := <encoding> <data> <backlen>
+
+Encodings (first byte):
+
+    0xxxxxxx                 7-bit unsigned int          (1 byte total)
+    10xxxxxx <bytes>         string, len < 64
+    110xxxxx yyyyyyyy        13-bit signed int
+    1110xxxx yyyyyyyy <bytes> string, len < 4096
+    0xF1 <2 bytes>           int16
+    0xF2 <3 bytes>           int24
+    0xF3 <4 bytes>           int32
+    0xF4 <8 bytes>           int64
+    0xF0 <4 bytes> <bytes>   string, 32-bit length
+
+Strings that are the canonical decimal form of an int64 ("42", "-7",
+but not "007" or "+1") are stored as integers and turned back into the
+same text on read, so a 20-digit job id costs 9 bytes instead of 21.
+
+<backlen> is the size of <encoding><data>, written in 7-bit groups from
+right to left (the high bit marks "one more byte to the left"). It lets
+prev() step backwards without an index.
+
+Positions are byte offsets into the buffer; end() is one past the last
+entry. Inserting or erasing moves the bytes after the position, which
+is cheap because nodes are size-bounded by List.
+
+An external listpack reads bytes it does not own, such as a stream
+node in a memory-mapped segment file; only the pages a read touches
+are loaded. The first mutation copies the bytes into its own buffer.
+------------------------------------------------------------------------------
+*/
+class Listpack {
+public:
+    size_t count() const { return entries; }
+    size_t bytes() const { return compressed() ? rawBytes : size(); }
+    bool empty() const { return entries == 0; }
+
+    size_t begin() const { return 0; }
+    size_t end() const { return size(); }
+
+    // Offset of the last entry, or end() when empty.
+    size_t last() const;
+
+    size_t next(size_t pos) const;
+    size_t prev(size_t pos) const;   // pos must not be begin()
+
+    // Offset of the index-th entry (negative counts from the back),
+    // or end() when out of range.
+    size_t seek(long long index) const;
+
+    std::string get(size_t pos) const;
+    void appendTo(size_t pos, std::string &out) const;
+
+    // Integer value of the entry (0 for non-numeric strings).
+    int64_t getInt(size_t pos) const;
+
+    // The entry as text without allocating: string entries point into
+    // the buffer, integers are formatted into `tmp`.
+    static constexpr size_t kIntBufSize = 24;
+    std::string_view view(size_t pos, char (&tmp)[kIntBufSize]) const;
+
+    // Inserts before the entry at `pos` (end() appends).
+    void insert(size_t pos, std::string_view value);
+    void insertInt(size_t pos, int64_t value);
+    void erase(size_t pos);
+
+    // Erases the `n` entries in [from, to) with a single move.
+    void eraseRange(size_t from, size_t to, size_t n);
+
+    void replace(size_t pos, std::string_view value);
+    void replaceInt(size_t pos, int64_t value);
+
+    // Moves the entries from `pos` on into a new listpack.
+    Listpack splitAt(size_t pos);
+
+    bool equals(size_t pos, std::string_view value) const;
+
+    void pushBack(std::string_view value) { insert(end(), value); }
+    void pushFront(std::string_view value) { insert(begin(), value); }
+    void pushBackInt(int64_t value) { insertInt(end(), value); }
+
+    // Drops spare capacity once a node stops growing.
+    void shrinkToFit() { buf.shrink_to_fit(); }
+
+    // Interior quicklist nodes (list-compress-depth) keep only the LZF
+    // form of their buffer. Every accessor above needs a raw node:
+    // mutate after decompress(), read through decompressedCopy().
+    bool compressed() const { return rawBytes != 0; }
+    bool compress();    // false (node stays raw) if it does not pay off
+    void decompress();
+    Listpack decompressedCopy() const;
+
+    // Heap bytes held right now, compressed or not (0 while external).
+    size_t allocatedBytes() const { return buf.capacity() + lzfData.capacity(); }
+
+    // Read-only view of `size` encoded bytes holding `entries` entries;
+    // `owner` keeps them alive as long as the view needs them.
+    static Listpack external(const unsigned char *data, size_t size, size_t entries,
+                             std::shared_ptr<const void> owner);
+    bool isExternal() const { return ext != nullptr; }
+
+    // Copies external bytes into the listpack's own buffer.
+    void own();
+
+    // The encoded entries, wherever they live.
+    const unsigned char *data() const { return ext ? ext : buf.data(); }
+
+    // Bytes an entry holding `value` takes.
+    static size_t entrySize(std::string_view value);
+
+private:
+    std::vector<unsigned char> buf;
+    size_t entries = 0;
+
+    std::string lzfData;    // set while compressed, `buf` is empty then
+    size_t rawBytes = 0;
+
+    // Set while external, `buf` is empty then
+    const unsigned char *ext = nullptr;
+    size_t extSize = 0;
+    std::shared_ptr<const void> extOwner;
+
+    size_t size() const { return ext ? extSize : buf.size(); }
+
+    // Decodes the entry at `pos`. Integers land in `ival` with
+    // `str` empty and `is_int` set.
+    void decode(size_t pos, bool &is_int, int64_t &ival, std::string_view &str) const;
+    size_t encodedSize(size_t pos) const;   // encoding + data, without backlen
+
+    void resizeEntry(size_t pos, size_t new_size);
+
+    static bool toInt64(std::string_view s, int64_t &out);
+    static size_t encode(std::string_view value, unsigned char *out);
+    static size_t encodeInt(int64_t value, unsigned char *out);
+    static size_t writeEntry(const unsigned char *head, size_t head_len,
+                             const char *payload, size_t payload_len,
+                             unsigned char *out);
+    static size_t backlenSize(size_t len);
+};
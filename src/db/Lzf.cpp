@@ -0,0 +1,127 @@
+#include "Lzf.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr size_t HASH_LOG = 13;
+constexpr size_t MAX_LITERAL = 32;
+constexpr size_t MAX_OFFSET = 1 << 13;
+constexpr size_t MAX_MATCH = 7 + 255 + 2;
+
+inline uint32_t hash3(const unsigned char *p) {
+    uint32_t v = (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | p[2];
+    return (v * 2654435761u) >> (32 - HASH_LOG);
+}
+
+} // namespace
+
+namespace lzf {
+
+bool compress(const unsigned char *in, size_t len, std::string &out, size_t max_out) {
+    out.clear();
+    out.reserve(max_out);
+
+    // Position + 1 of the last occurrence of each 3-byte hash (0 = none)
+    std::vector<uint32_t> table(size_t(1) << HASH_LOG, 0);
+
+    size_t lit_start = 0;
+    auto flushLiterals = [&](size_t upto) {
+        while (lit_start < upto) {
+            size_t n = std::min(MAX_LITERAL, upto - lit_start);
+            out.push_back(static_cast<char>(n - 1));
+            out.append(reinterpret_cast<const char *>(in + lit_start), n);
+            lit_start += n;
+        }
+    };
+
+    size_t i = 0;
+    while (i + 2 < len) {
+        if (out.size() >= max_out)
+            return false;
+
+        uint32_t h = hash3(in + i);
+        size_t cand = table[h];
+        table[h] = static_cast<uint32_t>(i + 1);
+
+        if (cand == 0 || i - (cand - 1) > MAX_OFFSET ||
+            std::memcmp(in + cand - 1, in + i, 3) != 0) {
+            ++i;
+            continue;
+        }
+
+        size_t ref = cand - 1;
+        size_t max = std::min(MAX_MATCH, len - i);
+        size_t match = 3;
+        while (match < max && in[ref + match] == in[i + match])
+            ++match;
+
+        flushLiterals(i);
+
+        size_t off = i - ref - 1;
+        size_t l = match - 2;
+        if (l < 7) {
+            out.push_back(static_cast<char>((l << 5) | (off >> 8)));
+        } else {
+            out.push_back(static_cast<char>((7 << 5) | (off >> 8)));
+            out.push_back(static_cast<char>(l - 7));
+        }
+        out.push_back(static_cast<char>(off & 0xFF));
+
+        // Index the positions covered by the match for later references
+        size_t stop = std::min(i + match, len - 2);
+        for (size_t p = i + 1; p < stop; ++p)
+            table[hash3(in + p)] = static_cast<uint32_t>(p + 1);
+
+        i += match;
+        lit_start = i;
+    }
+
+    flushLiterals(len);
+    return out.size() < max_out;
+}
+
+bool decompress(const unsigned char *in, size_t len, unsigned char *out, size_t raw_len) {
+    const unsigned char *ip = in;
+    const unsigned char *end = in + len;
+    size_t op = 0;
+
+    while (ip < end) {
+        unsigned ctrl = *ip++;
+
+        if (ctrl < MAX_LITERAL) {
+            size_t n = ctrl + 1;
+            if (static_cast<size_t>(end - ip) < n || op + n > raw_len)
+                return false;
+            std::memcpy(out + op, ip, n);
+            ip += n;
+            op += n;
+            continue;
+        }
+
+        size_t l = ctrl >> 5;
+        if (l == 7) {
+            if (ip >= end)
+                return false;
+            l += *ip++;
+        }
+        if (ip >= end)
+            return false;
+
+        size_t off = ((ctrl & 0x1F) << 8) + *ip++ + 1;
+        size_t n = l + 2;
+        if (off > op || op + n > raw_len)
+            return false;
+
+        // Byte by byte: the source may overlap what is being written
+        for (size_t k = 0; k < n; ++k, ++op)
+            out[op] = out[op - off];
+    }
+
+    return op == raw_len;
+}
+
+} // namespace lzf
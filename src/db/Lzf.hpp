@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/*
+------------------------------------------------------------------------------
+  LZF
+------------------------------------------------------------------------------
+
+Byte-oriented LZ77 codec in the LZF format (the one Redis uses for list
+nodes and snapshots). The stream is a sequence of
+
+    000LLLLL <L+1 literal bytes>             literal run (1..32 bytes)
+    LLLooooo oooooooo                        back reference, L in 1..6
+    111ooooo LLLLLLLL oooooooo               back reference, L = 7 + byte
+
+A back reference copies L+2 bytes starting (offset + 1) bytes behind the
+current output position, so matches are 3..264 bytes within an 8 KB
+window. Matches are found through a hash of the next three bytes; there
+is no entropy coding, which keeps both directions at memcpy-like speed.
+------------------------------------------------------------------------------
+*/
+namespace lzf {
+
+/**
+ * Compresses `len` bytes into `out` (replacing its contents).
+ * @return false if the result would not be smaller than `max_out` bytes.
+ */
+bool compress(const unsigned char *in, size_t len, std::string &out, size_t max_out);
+
+/**
+ * Decompresses into exactly `raw_len` bytes at `out`.
+ * @return false on a corrupt stream or a size mismatch.
+ */
+bool decompress(const unsigned char *in, size_t len, unsigned char *out, size_t raw_len);
+
+} // namespace lzf
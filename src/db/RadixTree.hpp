@@ -0,0 +1,335 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+/*
+------------------------------------------------------------------------------
+  RADIX TREE (fixed-length keys)
+------------------------------------------------------------------------------
+
+An ordered map from KeyLen-byte keys to values, stored as a compressed
+trie: every edge carries a run of key bytes, and a node only branches
+where two keys differ. Shared prefixes are stored once, so stream node
+IDs (big-endian ms + seq, mostly equal high bytes) cost a few bytes of
+edge label each.
+
+Because all keys have the same length, no key is a prefix of another:
+values live only in leaves, at depth KeyLen. Internal nodes other than
+the root always have at least two children; erase() merges a node left
+with one child into it.
+
+Children are kept sorted by their first edge byte, so an in-order walk
+yields keys in ascending byte order (numeric order for big-endian
+integers). seekGE / seekLE are the lower / upper-bound primitives the
+stream code uses to find the node holding an ID and to step between
+nodes.
+
+Values are heap-allocated once and never move: pointers returned by
+insert / find / seek stay valid until their key is erased.
+------------------------------------------------------------------------------
+*/
+template <typename V, size_t KeyLen = 16>
+class RadixTree
+{
+public:
+    using Key = std::array<unsigned char, KeyLen>;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Inserts `value` under `key`, replacing any previous value.
+    V &insert(const Key &key, V value);
+
+    V *find(const Key &key) const;
+    bool erase(const Key &key);
+    void clear();
+
+    // Smallest key >= `key` / largest key <= `key`, nullptr when there is
+    // none. The key found is written to `found` if given.
+    V *seekGE(const Key &key, Key *found = nullptr) const;
+    V *seekLE(const Key &key, Key *found = nullptr) const;
+
+    V *first(Key *found = nullptr) const;
+    V *last(Key *found = nullptr) const;
+
+private:
+    struct Node
+    {
+        std::vector<unsigned char> edge;               // label of the edge into this node
+        std::vector<std::unique_ptr<Node>> children;   // sorted by edge[0]
+        std::unique_ptr<V> value;                      // leaves only
+    };
+
+    Node root;
+    size_t count = 0;
+
+    // Index of the child whose edge starts with `b`, or of the first
+    // child starting above it.
+    static size_t childIndex(const Node &n, unsigned char b);
+
+    static Node *minLeaf(Node *n, size_t depth, Key &out);
+    static Node *maxLeaf(Node *n, size_t depth, Key &out);
+    static Node *ge(Node *n, size_t depth, const Key &key, Key &out);
+    static Node *le(Node *n, size_t depth, const Key &key, Key &out);
+};
+
+/* =====================================================================
+   Implementation
+   ===================================================================== */
+
+template <typename V, size_t KeyLen>
+size_t RadixTree<V, KeyLen>::childIndex(const Node &n, unsigned char b)
+{
+    auto it = std::lower_bound(n.children.begin(), n.children.end(), b,
+                               [](const std::unique_ptr<Node> &c, unsigned char v) {
+                                   return c->edge[0] < v;
+                               });
+    return static_cast<size_t>(it - n.children.begin());
+}
+
+template <typename V, size_t KeyLen>
+V &RadixTree<V, KeyLen>::insert(const Key &key, V value)
+{
+    Node *n = &root;
+    size_t depth = 0;
+
+    while (depth < KeyLen) {
+        size_t i = childIndex(*n, key[depth]);
+
+        // No edge starts with this byte: the rest of the key is one new leaf
+        if (i == n->children.size() || n->children[i]->edge[0] != key[depth]) {
+            auto leaf = std::make_unique<Node>();
+            leaf->edge.assign(key.begin() + depth, key.end());
+            leaf->value = std::make_unique<V>(std::move(value));
+            V &ref = *leaf->value;
+            n->children.insert(n->children.begin() + static_cast<std::ptrdiff_t>(i),
+                               std::move(leaf));
+            ++count;
+            return ref;
+        }
+
+        Node *c = n->children[i].get();
+        size_t common = 0;
+        while (common < c->edge.size() && c->edge[common] == key[depth + common])
+            ++common;
+
+        if (common == c->edge.size()) {
+            n = c;
+            depth += common;
+            continue;
+        }
+
+        // Split the edge where the key diverges
+        auto mid = std::make_unique<Node>();
+        mid->edge.assign(c->edge.begin(), c->edge.begin() + static_cast<std::ptrdiff_t>(common));
+        c->edge.erase(c->edge.begin(), c->edge.begin() + static_cast<std::ptrdiff_t>(common));
+
+        auto leaf = std::make_unique<Node>();
+        leaf->edge.assign(key.begin() + depth + common, key.end());
+        leaf->value = std::make_unique<V>(std::move(value));
+        V &ref = *leaf->value;
+
+        bool leaf_first = leaf->edge[0] < c->edge[0];
+        mid->children.push_back(std::move(n->children[i]));
+        mid->children.insert(leaf_first ? mid->children.begin() : mid->children.end(),
+                             std::move(leaf));
+        n->children[i] = std::move(mid);
+        ++count;
+        return ref;
+    }
+
+    // Existing key
+    *n->value = std::move(value);
+    return *n->value;
+}
+
+template <typename V, size_t KeyLen>
+V *RadixTree<V, KeyLen>::find(const Key &key) const
+{
+    const Node *n = &root;
+    size_t depth = 0;
+
+    while (depth < KeyLen) {
+        size_t i = childIndex(*n, key[depth]);
+        if (i == n->children.size())
+            return nullptr;
+
+        const Node *c = n->children[i].get();
+        if (std::memcmp(c->edge.data(), key.data() + depth, c->edge.size()) != 0)
+            return nullptr;
+        n = c;
+        depth += c->edge.size();
+    }
+    return n->value.get();
+}
+
+template <typename V, size_t KeyLen>
+bool RadixTree<V, KeyLen>::erase(const Key &key)
+{
+    Node *parent = nullptr;
+    Node *n = &root;
+    size_t depth = 0;
+    size_t index = 0;
+
+    while (depth < KeyLen) {
+        size_t i = childIndex(*n, key[depth]);
+        if (i == n->children.size())
+            return false;
+
+        Node *c = n->children[i].get();
+        if (std::memcmp(c->edge.data(), key.data() + depth, c->edge.size()) != 0)
+            return false;
+
+        parent = n;
+        index = i;
+        n = c;
+        depth += c->edge.size();
+    }
+
+    parent->children.erase(parent->children.begin() + static_cast<std::ptrdiff_t>(index));
+    --count;
+
+    // A non-root node left with a single child absorbs it
+    if (parent != &root && parent->children.size() == 1) {
+        std::unique_ptr<Node> only = std::move(parent->children[0]);
+        parent->edge.insert(parent->edge.end(), only->edge.begin(), only->edge.end());
+        parent->children = std::move(only->children);
+        parent->value = std::move(only->value);
+    }
+    return true;
+}
+
+template <typename V, size_t KeyLen>
+void RadixTree<V, KeyLen>::clear()
+{
+    root.children.clear();
+    count = 0;
+}
+
+template <typename V, size_t KeyLen>
+typename RadixTree<V, KeyLen>::Node *
+RadixTree<V, KeyLen>::minLeaf(Node *n, size_t depth, Key &out)
+{
+    while (depth < KeyLen) {
+        n = n->children.front().get();
+        std::memcpy(out.data() + depth, n->edge.data(), n->edge.size());
+        depth += n->edge.size();
+    }
+    return n;
+}
+
+template <typename V, size_t KeyLen>
+typename RadixTree<V, KeyLen>::Node *
+RadixTree<V, KeyLen>::maxLeaf(Node *n, size_t depth, Key &out)
+{
+    while (depth < KeyLen) {
+        n = n->children.back().get();
+        std::memcpy(out.data() + depth, n->edge.data(), n->edge.size());
+        depth += n->edge.size();
+    }
+    return n;
+}
+
+// `n` sits at `depth` and its path equals key[0, depth).
+template <typename V, size_t KeyLen>
+typename RadixTree<V, KeyLen>::Node *
+RadixTree<V, KeyLen>::ge(Node *n, size_t depth, const Key &key, Key &out)
+{
+    if (depth == KeyLen)
+        return n;
+
+    for (size_t i = childIndex(*n, key[depth]); i < n->children.size(); ++i) {
+        Node *c = n->children[i].get();
+        size_t len = c->edge.size();
+        std::memcpy(out.data() + depth, c->edge.data(), len);
+
+        int cmp = std::memcmp(c->edge.data(), key.data() + depth, len);
+        if (cmp > 0)
+            return minLeaf(c, depth + len, out);
+        if (cmp == 0) {
+            if (Node *r = ge(c, depth + len, key, out))
+                return r;
+        }
+    }
+    return nullptr;
+}
+
+template <typename V, size_t KeyLen>
+typename RadixTree<V, KeyLen>::Node *
+RadixTree<V, KeyLen>::le(Node *n, size_t depth, const Key &key, Key &out)
+{
+    if (depth == KeyLen)
+        return n;
+
+    size_t i = childIndex(*n, key[depth]);
+    if (i < n->children.size() && n->children[i]->edge[0] == key[depth])
+        ++i;
+
+    while (i-- > 0) {
+        Node *c = n->children[i].get();
+        size_t len = c->edge.size();
+        std::memcpy(out.data() + depth, c->edge.data(), len);
+
+        int cmp = std::memcmp(c->edge.data(), key.data() + depth, len);
+        if (cmp < 0)
+            return maxLeaf(c, depth + len, out);
+        if (cmp == 0) {
+            if (Node *r = le(c, depth + len, key, out))
+                return r;
+        }
+    }
+    return nullptr;
+}
+
+template <typename V, size_t KeyLen>
+V *RadixTree<V, KeyLen>::seekGE(const Key &key, Key *found) const
+{
+    Key out{};
+    Node *n = ge(const_cast<Node *>(&root), 0, key, out);
+    if (!n)
+        return nullptr;
+    if (found)
+        *found = out;
+    return n->value.get();
+}
+
+template <typename V, size_t KeyLen>
+V *RadixTree<V, KeyLen>::seekLE(const Key &key, Key *found) const
+{
+    Key out{};
+    Node *n = le(const_cast<Node *>(&root), 0, key, out);
+    if (!n)
+        return nullptr;
+    if (found)
+        *found = out;
+    return n->value.get();
+}
+
+template <typename V, size_t KeyLen>
+V *RadixTree<V, KeyLen>::first(Key *found) const
+{
+    if (count == 0)
+        return nullptr;
+    Key out{};
+    Node *n = minLeaf(const_cast<Node *>(&root), 0, out);
+    if (found)
+        *found = out;
+    return n->value.get();
+}
+
+template <typename V, size_t KeyLen>
+V *RadixTree<V, KeyLen>::last(Key *found) const
+{
+    if (count == 0)
+        return nullptr;
+    Key out{};
+    Node *n = maxLeaf(const_cast<Node *>(&root), 0, out);
+    if (found)
+        *found = out;
+    return n->value.get();
+}
@@ -1,5 +1,6 @@
 #include "RedisStore.hpp"
 #include "../utils/time.cpp"  // assumes current_time_ms() is defined here
+#include "../cluster/HashSlot.hpp"
 
 // Internal: check TTL and delete key if expired.
 bool RedisStore::ensureNotExpired(const std::string& key) {
@@ -12,6 +13,7 @@ bool RedisStore::ensureNotExpired(const std::string& key) {
     uint64_t now = current_time_ms();
     if (now >= ttl_it->second) {
         // key expired → remove both object and ttl entry
+        unindexKey(key);
         data.erase(key);
         expires.erase(ttl_it);
         return false;
@@ -25,9 +27,9 @@ bool RedisStore::ensureNotExpired(const std::string& key) {
 void RedisStore::setString(const std::string& key, const std::string& value) {
     RedisObj obj;
     obj.type = RedisType::STRING;
-    obj.value = value;
+    assignString(obj, value);
 
-    data[key] = std::move(obj);
+    entryFor(key) = std::move(obj);
 
     // Clear any existing TTL for this key
     expires.erase(key);
@@ -41,9 +43,9 @@ void RedisStore::setString(const std::string& key,
                            uint64_t ttl_ms) {
     RedisObj obj;
     obj.type = RedisType::STRING;
-    obj.value = value;
+    assignString(obj, value);
 
-    data[key] = std::move(obj);
+    entryFor(key) = std::move(obj);
 
     uint64_t now = current_time_ms();
     expires[key] = now + ttl_ms;
@@ -65,11 +67,48 @@ bool RedisStore::getString(const std::string& key, std::string& out) {
     if (it->second.type != RedisType::STRING)
         return false;  // or you could raise a WRONGTYPE error elsewhere
 
-    // Extract the string from the variant
-    out = std::get<std::string>(it->second.value);
+    out = stringValue(it->second);
     return true;
 }
 
+// ----------------------------------------------------
+// STRING helper: create or reuse a string at key (INCR)
+// ----------------------------------------------------
+RedisObj& RedisStore::getOrCreateString(const std::string& key) {
+    auto it = data.find(key);
+    if (it != data.end() && it->second.type == RedisType::STRING)
+        return it->second;
+
+    RedisObj& obj = entryFor(key);
+    obj.type = RedisType::STRING;
+    obj.value = std::string();
+    expires.erase(key);
+    return obj;
+}
+
+// ----------------------------------------------------
+// STRING: MGET / MSET batches
+// ----------------------------------------------------
+void RedisStore::getObjects(const std::vector<std::string>& keys,
+                            std::vector<RedisObj*>& out) {
+    out.clear();
+    out.reserve(keys.size());
+
+    for (const std::string& key : keys)
+        out.push_back(getObject(key));
+}
+
+void RedisStore::setStrings(
+    const std::vector<std::pair<std::string, std::string_view>>& pairs) {
+    for (const auto& [key, value] : pairs) {
+        RedisObj& obj = entryFor(key);
+        obj.type = RedisType::STRING;
+        assignString(obj, value);
+        if (!expires.empty())
+            expires.erase(key);
+    }
+}
+
 // ----------------------------------------------------
 // DEL key
 // ----------------------------------------------------
@@ -78,6 +117,7 @@ bool RedisStore::del(const std::string& key) {
     expires.erase(key);
 
     // Then remove the actual object
+    unindexKey(key);
     auto erased = data.erase(key);
     return erased > 0;
 }
@@ -86,7 +126,7 @@ bool RedisStore::del(const std::string& key) {
 // LIST helper: create or reuse a List at key
 // ----------------------------------------------------
 List& RedisStore::getOrCreateList(const std::string& key) {
-    RedisObj& obj = data[key];
+    RedisObj& obj = entryFor(key);
 
     if (obj.type != RedisType::LIST) {
         // Overwrite any previous content/type
@@ -104,7 +144,7 @@ List& RedisStore::getOrCreateList(const std::string& key) {
 // STREAM helper: create or reuse a Stream at key
 // ----------------------------------------------------
 Stream& RedisStore::getOrCreateStream(const std::string& key) {
-    RedisObj& obj = data[key];
+    RedisObj& obj = entryFor(key);
 
     if (obj.type != RedisType::STREAM) {
         obj.type = RedisType::STREAM;
@@ -117,6 +157,51 @@ Stream& RedisStore::getOrCreateStream(const std::string& key) {
     return std::get<Stream>(obj.value);
 }
 
+// ----------------------------------------------------
+// HASH helper: create or reuse a Hash at key
+// ----------------------------------------------------
+Hash& RedisStore::getOrCreateHash(const std::string& key) {
+    RedisObj& obj = entryFor(key);
+
+    if (obj.type != RedisType::HASH) {
+        obj.type = RedisType::HASH;
+        obj.value = Hash{};
+        expires.erase(key);
+    }
+
+    return std::get<Hash>(obj.value);
+}
+
+// ----------------------------------------------------
+// SET helper: create or reuse a Set at key
+// ----------------------------------------------------
+Set& RedisStore::getOrCreateSet(const std::string& key) {
+    RedisObj& obj = entryFor(key);
+
+    if (obj.type != RedisType::SET) {
+        obj.type = RedisType::SET;
+        obj.value = Set{};
+        expires.erase(key);
+    }
+
+    return std::get<Set>(obj.value);
+}
+
+// ----------------------------------------------------
+// ZSET helper: create or reuse a ZSet at key
+// ----------------------------------------------------
+ZSet& RedisStore::getOrCreateZSet(const std::string& key) {
+    RedisObj& obj = entryFor(key);
+
+    if (obj.type != RedisType::ZSET) {
+        obj.type = RedisType::ZSET;
+        obj.value = ZSet{};
+        expires.erase(key);
+    }
+
+    return std::get<ZSet>(obj.value);
+}
+
 // ----------------------------------------------------
 // Raw access to object
 // ----------------------------------------------------
@@ -131,3 +216,88 @@ RedisObj* RedisStore::getObject(const std::string& key) {
 
     return &it->second;
 }
+
+void RedisStore::setObject(const std::string& key, RedisObj obj) {
+    entryFor(key) = std::move(obj);
+    expires.erase(key);
+}
+
+// ----------------------------------------------------
+// TTL <-> Unix time conversion (snapshot / AOF)
+// ----------------------------------------------------
+uint64_t RedisStore::getExpireUnixMs(const std::string& key) const {
+    auto it = expires.find(key);
+    if (it == expires.end())
+        return 0;
+
+    uint64_t now = current_time_ms();
+    uint64_t remaining = it->second > now ? it->second - now : 0;
+    return static_cast<uint64_t>(getUnixTimeMs()) + remaining;
+}
+
+void RedisStore::setExpireUnixMs(const std::string& key, uint64_t unix_ms) {
+    uint64_t now_unix = static_cast<uint64_t>(getUnixTimeMs());
+    uint64_t remaining = unix_ms > now_unix ? unix_ms - now_unix : 0;
+    expires[key] = current_time_ms() + remaining;
+}
+
+// ----------------------------------------------------
+// Whole keyspace
+// ----------------------------------------------------
+void RedisStore::clear() {
+    for (auto& keys : slotKeys)
+        keys.clear();
+    data.clear();
+    expires.clear();
+}
+
+// ----------------------------------------------------
+// Slot index (cluster mode)
+// ----------------------------------------------------
+RedisObj& RedisStore::entryFor(const std::string& key) {
+    auto [it, inserted] = data.try_emplace(key);
+    if (inserted && !slotKeys.empty())
+        slotKeys[keyHashSlot(it->first)].insert(it->first);
+    return it->second;
+}
+
+void RedisStore::unindexKey(const std::string& key) {
+    if (!slotKeys.empty())
+        slotKeys[keyHashSlot(key)].erase(key);
+}
+
+void RedisStore::enableSlotIndex() {
+    if (slotKeys.empty())
+        rebuildSlotIndex();
+}
+
+void RedisStore::rebuildSlotIndex() {
+    if (slotKeys.empty())
+        slotKeys.resize(CLUSTER_SLOTS);
+
+    for (auto& keys : slotKeys)
+        keys.clear();
+
+    // Views stay valid: unordered_map never moves its nodes
+    for (const auto& [key, obj] : data)
+        slotKeys[keyHashSlot(key)].insert(key);
+}
+
+size_t RedisStore::countKeysInSlot(uint16_t slot) const {
+    if (slotKeys.empty() || slot >= CLUSTER_SLOTS)
+        return 0;
+    return slotKeys[slot].size();
+}
+
+std::vector<std::string> RedisStore::getKeysInSlot(uint16_t slot, size_t count) const {
+    std::vector<std::string> keys;
+    if (slotKeys.empty() || slot >= CLUSTER_SLOTS)
+        return keys;
+
+    for (std::string_view key : slotKeys[slot]) {
+        if (keys.size() >= count)
+            break;
+        keys.emplace_back(key);
+    }
+    return keys;
+}
@@ -1,12 +1,17 @@
 #pragma once
 
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <cstdint>
+#include <utility>
 
 #include "../types/RedisType.hpp"
 
-// Central in-memory storage for all Redis objects (strings, lists, streams)
+// Central in-memory storage for all Redis objects (strings, lists, streams,
+// hashes)
 // plus TTL (PX) metadata.
 class RedisStore {
 public:
@@ -31,6 +36,19 @@ public:
     // Returns true if a non-expired STRING key exists, false otherwise.
     bool getString(const std::string& key, std::string& out);
 
+    // Returns the STRING object at "key", creating an empty one (and
+    // replacing any other type) if necessary. An existing string keeps
+    // its TTL; its value may be either encoding (see RedisObj).
+    RedisObj& getOrCreateString(const std::string& key);
+
+    // MGET: resolves every key in one pass into `out`, nullptr for a
+    // missing or expired key.
+    void getObjects(const std::vector<std::string>& keys,
+                    std::vector<RedisObj*>& out);
+
+    // MSET: stores each (key, value) as setString(key, value) would.
+    void setStrings(const std::vector<std::pair<std::string, std::string_view>>& pairs);
+
     // DEL key
     // Deletes any type of key (string/list/stream...). Returns true if existed.
     bool del(const std::string& key);
@@ -45,10 +63,58 @@ public:
     // creating it and setting type=STREAM if necessary.
     Stream& getOrCreateStream(const std::string& key);
 
+    // Returns a reference to a Hash object at "key", creating it and
+    // setting type=HASH if necessary. An existing hash keeps its TTL.
+    Hash& getOrCreateHash(const std::string& key);
+
+    // Returns a reference to a Set object at "key", creating it and
+    // setting type=SET if necessary. An existing set keeps its TTL.
+    Set& getOrCreateSet(const std::string& key);
+
+    // Returns a reference to a ZSet object at "key", creating it and
+    // setting type=ZSET if necessary. An existing sorted set keeps its TTL.
+    ZSet& getOrCreateZSet(const std::string& key);
+
     // Raw access to the underlying object, or nullptr if key does not exist.
     RedisObj* getObject(const std::string& key);
 
+    // Stores a ready-made object (RESTORE), replacing any previous value
+    // and TTL.
+    void setObject(const std::string& key, RedisObj obj);
+
+    // --- Persistence helpers ---
+
+    // `expires` holds monotonic deadlines, which mean nothing after a
+    // restart. These convert to/from absolute Unix time in ms.
+    // getExpireUnixMs returns 0 when the key has no TTL.
+    uint64_t getExpireUnixMs(const std::string& key) const;
+    void setExpireUnixMs(const std::string& key, uint64_t unix_ms);
+
+    // Drops every key (full resync).
+    void clear();
+
+    // --- Cluster: keys per hash slot ---
+
+    // Off by default. In cluster mode every key is also indexed under its
+    // hash slot, so slot migration never scans the whole keyspace. The
+    // index holds views of the keys owned by `data`, no copies.
+    void enableSlotIndex();
+    bool slotIndexEnabled() const { return !slotKeys.empty(); }
+
+    size_t countKeysInSlot(uint16_t slot) const;
+    std::vector<std::string> getKeysInSlot(uint16_t slot, size_t count) const;
+
+    // Must follow bulk changes made directly on `data` (snapshot load).
+    void rebuildSlotIndex();
+
 private:
+    std::vector<std::unordered_set<std::string_view>> slotKeys;
+
+    // Inserts an empty object for a new key (indexing it), or returns the
+    // existing one.
+    RedisObj& entryFor(const std::string& key);
+    void unindexKey(const std::string& key);
+
     // Internal helper: checks TTL and deletes key if expired.
     // Returns true if key is still valid (not expired or no TTL),
     // false if it expired (and was removed).
@@ -0,0 +1,142 @@
+#include "Set.hpp"
+
+#include <algorithm>
+
+#include "../utils/StringUtils.hpp"
+
+/* =====================================================================
+   Members
+   ===================================================================== */
+
+bool Set::add(std::string_view member) {
+    if (intset) {
+        // Only canonical integer text goes in the intset ("007" does not)
+        long long value;
+        if (parseLongLong(member, value)) {
+            if (ints.contains(value))
+                return false;
+            if (ints.size() < maxIntsetEntries)
+                return ints.add(value);
+        }
+        convertToTable();
+    }
+    return table.emplace(member).second;
+}
+
+bool Set::remove(std::string_view member) {
+    if (intset) {
+        long long value;
+        return parseLongLong(member, value) && ints.remove(value);
+    }
+    auto it = table.find(member);
+    if (it == table.end())
+        return false;
+    table.erase(it);
+    return true;
+}
+
+bool Set::contains(std::string_view member) const {
+    if (intset) {
+        long long value;
+        return parseLongLong(member, value) && ints.contains(value);
+    }
+    return table.find(member) != table.end();
+}
+
+// Moves every member into the table and frees the intset
+void Set::convertToTable() {
+    table.reserve(size() + 1);
+    forEach([&](std::string_view m) { table.emplace(m); });
+    ints = IntSet{};
+    intset = false;
+}
+
+/* =====================================================================
+   Multi-set operations
+   ===================================================================== */
+
+template <typename Emit>
+void Set::intersectInto(std::vector<const Set *> sets, Emit &&emit) {
+    for (const Set *s : sets) {
+        if (!s || s->empty())
+            return;
+    }
+    std::sort(sets.begin(), sets.end(),
+              [](const Set *a, const Set *b) { return a->size() < b->size(); });
+
+    bool allInts = std::all_of(sets.begin(), sets.end(),
+                               [](const Set *s) { return s->intset; });
+
+    if (!allInts) {
+        // The smallest set bounds the work; probe the rest per member
+        sets.front()->forEach([&, done = false](std::string_view m) mutable {
+            if (done)
+                return;
+            for (size_t i = 1; i < sets.size(); ++i) {
+                if (!sets[i]->contains(m))
+                    return;
+            }
+            done = !emit(m);
+        });
+        return;
+    }
+
+    // Narrow the candidates set by set, smallest first; each pass only
+    // ever shrinks `cur`, so it can be written in place
+    std::vector<int64_t> cur;
+    sets[0]->ints.visit([&](const auto *data, size_t n) { cur.assign(data, data + n); });
+    for (size_t i = 1; i < sets.size() && !cur.empty(); ++i) {
+        size_t n = sets[i]->ints.visit([&](const auto *data, size_t m) {
+            return intersectSorted(cur.data(), cur.size(), data, m, cur.data());
+        });
+        cur.resize(n);
+    }
+
+    char buf[24];
+    for (int64_t v : cur) {
+        auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+        if (!emit(std::string_view(buf, static_cast<size_t>(end - buf))))
+            return;
+    }
+}
+
+std::vector<std::string> Set::intersect(std::vector<const Set *> sets, size_t limit) {
+    std::vector<std::string> out;
+    intersectInto(std::move(sets), [&](std::string_view m) {
+        out.emplace_back(m);
+        return limit == 0 || out.size() < limit;
+    });
+    return out;
+}
+
+size_t Set::intersectCount(std::vector<const Set *> sets, size_t limit) {
+    size_t count = 0;
+    intersectInto(std::move(sets), [&](std::string_view) {
+        ++count;
+        return limit == 0 || count < limit;
+    });
+    return count;
+}
+
+Set Set::unite(const std::vector<const Set *> &sets) {
+    Set out;
+    for (const Set *s : sets) {
+        if (s)
+            s->forEach([&](std::string_view m) { out.add(m); });
+    }
+    return out;
+}
+
+Set Set::difference(const std::vector<const Set *> &sets) {
+    Set out;
+    if (sets.empty() || !sets[0])
+        return out;
+    sets[0]->forEach([&](std::string_view m) {
+        for (size_t i = 1; i < sets.size(); ++i) {
+            if (sets[i] && sets[i]->contains(m))
+                return;
+        }
+        out.add(m);
+    });
+    return out;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "IntSet.hpp"
+
+/*
+------------------------------------------------------------------------------
+  SET (intset / hash set)
+------------------------------------------------------------------------------
+
+Unordered collection of unique strings with two encodings:
+
+  intset:  every member is the canonical decimal form of an int64
+           ("42", "-7", not "007") and there are at most
+           set-max-intset-entries of them; stored as an IntSet, 2 to 8
+           bytes a member, in ascending order
+  table:   std::unordered_set of the strings otherwise; a set never
+           converts back, as in Redis
+
+Multi-key operations (SINTER & co.) live here as well, so they can
+pick the cheapest path for the encodings involved:
+
+  • all intsets: sorted-array intersection kernels (intersectSorted)
+    from the smallest set up, each pass narrowing the candidates
+  • otherwise: iterate the smallest set and probe the others, so the
+    work is bounded by the smallest input
+------------------------------------------------------------------------------
+*/
+class Set {
+public:
+    // set-max-intset-entries, shared by every set.
+    static void SetMaxIntsetEntries(size_t n) { maxIntsetEntries = n; }
+
+    size_t size() const { return intset ? ints.size() : table.size(); }
+    bool empty() const { return size() == 0; }
+    bool isIntset() const { return intset; }
+
+    // True if the member was not there yet / was there.
+    bool add(std::string_view member);
+    bool remove(std::string_view member);
+    bool contains(std::string_view member) const;
+
+    // Calls fn(member) for every member; intsets in ascending order.
+    template <typename Fn>
+    void forEach(Fn &&fn) const;
+
+    // Members of every set (missing keys are nullptr, i.e. empty), at
+    // most `limit` of them (0 = all).
+    static std::vector<std::string> intersect(std::vector<const Set *> sets, size_t limit = 0);
+
+    // Only counts them (SINTERCARD).
+    static size_t intersectCount(std::vector<const Set *> sets, size_t limit = 0);
+
+    static Set unite(const std::vector<const Set *> &sets);
+
+    // Members of the first set found in none of the others.
+    static Set difference(const std::vector<const Set *> &sets);
+
+private:
+    static inline size_t maxIntsetEntries = 512;
+
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+
+    bool intset = true;
+    IntSet ints;
+    std::unordered_set<std::string, StringHash, std::equal_to<>> table;
+
+    void convertToTable();
+
+    // Shared by intersect() and intersectCount(): calls emit(member)
+    // until it returns false.
+    template <typename Emit>
+    static void intersectInto(std::vector<const Set *> sets, Emit &&emit);
+};
+
+template <typename Fn>
+void Set::forEach(Fn &&fn) const {
+    if (!intset) {
+        for (const std::string &m : table)
+            fn(std::string_view(m));
+        return;
+    }
+
+    char buf[24];
+    ints.visit([&](const auto *data, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), data[i]);
+            fn(std::string_view(buf, static_cast<size_t>(end - buf)));
+        }
+    });
+}
@@ -1,105 +1,182 @@
 #include "./Stream.hpp"
 #include <algorithm>
+#include <charconv>
+#include <cmath>
+#include "../utils/StringUtils.hpp"
 
-/*
-===============================================================================
-  returnStreamType()
--------------------------------------------------------------------------------
-  Determines which Redis Stream ID format the user provided.
+namespace {
 
-  Supported formats:
-    1) "*"                  → AUTO_GENERATED
-    2) "<ms>-<seq>"         → EXPLICIT
-    3) "<ms>-*"             → AUTO_SEQUENCE
-  Redis XADD semantics:
-    * EXPLICIT: full ID specified → must be strictly increasing
-    * AUTO_SEQUENCE: timestamp fixed, sequence auto-generated
-    * AUTO_GENERATED: timestamp & sequence generated automatically
+bool allDigits(std::string_view s)
+{
+    return !s.empty() && std::all_of(s.begin(), s.end(),
+                                     [](char c) { return c >= '0' && c <= '9'; });
+}
 
-  Return:
-    A StreamIdType enum representing the ID category.
-===============================================================================
-*/
-StreamIdType Stream::returnStreamType(const std::string &id)
+const char *kTopItemErr =
+    "-ERR The ID specified in XADD is equal or smaller than the target stream top item\r\n";
+
+// Per-entry flags
+constexpr int64_t FLAG_DELETED = 1;
+constexpr int64_t FLAG_SAMEFIELDS = 2;
+
+// Position of the first master field (after count, deleted, N).
+size_t masterFieldsStart(const Listpack &lp)
 {
+    return lp.next(lp.next(lp.next(lp.begin())));
+}
 
-    if (id == "*")
-        return StreamIdType::AUTO_GENERATED;
+size_t masterFieldCount(const Listpack &lp)
+{
+    return static_cast<size_t>(lp.getInt(lp.next(lp.next(lp.begin()))));
+}
 
-    size_t pos = id.find('-');
-    if (pos == std::string::npos)
-    {
-        return StreamIdType::INVALID;
-    }
+size_t skipItems(const Listpack &lp, size_t pos, size_t n)
+{
+    while (n-- > 0)
+        pos = lp.next(pos);
+    return pos;
+}
 
-    std::string left = id.substr(0, pos);
-    std::string right = id.substr(pos + 1);
+// Position of the first entry's flags (past the master entry).
+size_t firstEntryPos(const Listpack &lp)
+{
+    return skipItems(lp, masterFieldsStart(lp), masterFieldCount(lp) + 1);
+}
 
-    // "*-*" form
-    if (left == "*" && right == "*")
-        return StreamIdType::AUTO_GENERATED;
+// Position of the entry after the one whose flags are at `pos`.
+size_t nextEntryPos(const Listpack &lp, size_t pos, size_t master_fields)
+{
+    if (lp.getInt(pos) & FLAG_SAMEFIELDS)
+        return skipItems(lp, pos, master_fields + 4);
 
-    // "<ms>-*" form
-    if (left != "*" && right == "*")
-    {
+    size_t m = skipItems(lp, pos, 3);
+    return skipItems(lp, m, 2 * static_cast<size_t>(lp.getInt(m)) + 2);
+}
 
-        for (char c : left)
-        {
-            if (!isdigit(c))
-                return StreamIdType::INVALID;
-        }
+StreamID entryId(const Listpack &lp, size_t pos, const StreamID &master)
+{
+    size_t ms = lp.next(pos);
+    return {master.ms + static_cast<uint64_t>(lp.getInt(ms)),
+            master.seq + static_cast<uint64_t>(lp.getInt(lp.next(ms)))};
+}
 
-        return StreamIdType::AUTO_SEQUENCE;
+// ID of the node's newest entry, deleted or not, found through its
+// trailing lp-count.
+StreamID nodeLastId(const Listpack &lp, const StreamID &master)
+{
+    size_t pos = lp.last();
+    for (int64_t n = lp.getInt(pos); n > 0; --n)
+        pos = lp.prev(pos);
+    return entryId(lp, pos, master);
+}
+
+} // namespace
+
+/*
+===============================================================================
+  StreamID
+-------------------------------------------------------------------------------
+  increment() / decrement() step through the ID space in order:
+  seq first, carrying into ms. They are what makes XREAD's "after
+  this ID" and exclusive range bounds plain inclusive lookups.
+===============================================================================
+*/
+bool StreamID::increment()
+{
+    if (seq != UINT64_MAX) {
+        ++seq;
+        return true;
     }
+    if (ms == UINT64_MAX)
+        return false;
+    ++ms;
+    seq = 0;
+    return true;
+}
 
-    // Check numeric left and right → EXPLICIT
-    bool left_number = !left.empty() &&
-                       std::all_of(left.begin(), left.end(), ::isdigit);
+bool StreamID::decrement()
+{
+    if (seq != 0) {
+        --seq;
+        return true;
+    }
+    if (ms == 0)
+        return false;
+    --ms;
+    seq = UINT64_MAX;
+    return true;
+}
 
-    bool right_number = !right.empty() &&
-                        std::all_of(right.begin(), right.end(), ::isdigit);
+bool StreamID::parse(std::string_view s, StreamID &out, uint64_t missing_seq)
+{
+    size_t dash = s.find('-');
+    if (dash == std::string_view::npos) {
+        if (!parseU64(s, out.ms))
+            return false;
+        out.seq = missing_seq;
+        return true;
+    }
+    return parseU64(s.substr(0, dash), out.ms) && parseU64(s.substr(dash + 1), out.seq);
+}
 
-    if (left_number && right_number)
-        return StreamIdType::EXPLICIT;
+void StreamID::appendTo(std::string &out) const
+{
+    char buf[48];
+    auto [p1, ec1] = std::to_chars(buf, buf + sizeof(buf), ms);
+    *p1++ = '-';
+    auto [p2, ec2] = std::to_chars(p1, buf + sizeof(buf), seq);
+    out.append(buf, static_cast<size_t>(p2 - buf));
+}
 
-    return StreamIdType::INVALID;
+std::string StreamID::toString() const
+{
+    std::string out;
+    appendTo(out);
+    return out;
 }
 
 /*
 ===============================================================================
-  parseIdToTwoInteger()
+  returnStreamType()
 -------------------------------------------------------------------------------
-  Parses a Redis-style ID of format "ms-seq" into two integers:
+  Determines which Redis Stream ID format the user provided.
 
-      ms  → millisecond timestamp (long long)
-      seq → sequence number       (long long)
+  Supported formats:
+    1) "*"                  → AUTO_GENERATED
+    2) "<ms>-<seq>", "<ms>" → EXPLICIT
+    3) "<ms>-*"             → AUTO_SEQUENCE
+  Redis XADD semantics:
+    * EXPLICIT: full ID specified → must be strictly increasing
+    * AUTO_SEQUENCE: timestamp fixed, sequence auto-generated
+    * AUTO_GENERATED: timestamp & sequence generated automatically
 
-  Returns:
-      true   → parsing succeeded
-      false  → malformed input or conversion error
+  Only the shape is checked here; the numbers are parsed (and range
+  checked) by StreamID::parse().
 
-  Purpose:
-      A common helper for ValidateID, XADD logic, and sequence generation.
+  Return:
+    A StreamIdType enum representing the ID category.
 ===============================================================================
 */
-bool Stream::parseIdToTwoInteger(const std::string &id, long long &ms, long long &seq)
+StreamIdType Stream::returnStreamType(std::string_view id) const
 {
+    if (id == "*" || id == "*-*")
+        return StreamIdType::AUTO_GENERATED;
+
     size_t pos = id.find('-');
+    if (pos == std::string_view::npos)
+        return allDigits(id) ? StreamIdType::EXPLICIT : StreamIdType::INVALID;
 
-    if (pos == std::string::npos)
-        return false;
+    std::string_view left = id.substr(0, pos);
+    std::string_view right = id.substr(pos + 1);
 
-    try
-    {
-        ms = std::stoll(id.substr(0, pos));
-        seq = std::stoll(id.substr(pos + 1));
-    }
-    catch (...)
-    {
-        return false;
-    }
+    if (!allDigits(left))
+        return StreamIdType::INVALID;
 
-    return true;
+    // "<ms>-*" form
+    if (right == "*")
+        return StreamIdType::AUTO_SEQUENCE;
+
+    return allDigits(right) ? StreamIdType::EXPLICIT : StreamIdType::INVALID;
 }
 
 /*
@@ -109,8 +186,7 @@ bool Stream::parseIdToTwoInteger(const std::string &id, long long &ms, long long
   Ensures that a given EXPLICIT ID obeys Redis ordering rules.
 
   Rules:
-    • ID must be of form "ms-seq"
-    • ID must be > last_id in the stream
+    • ID must be > last_id of the stream (deleted entries included)
     • ID cannot be "0-0"
 
   Errors match Redis error messages for strict correctness.
@@ -120,76 +196,139 @@ bool Stream::parseIdToTwoInteger(const std::string &id, long long &ms, long long
     false  → assign error message and reject
 ===============================================================================
 */
-bool Stream::validateId(const std::string &id, std::string &err)
+bool Stream::validateId(const StreamID &id, std::string &err) const
 {
-    long long ms, seq;
-
-    if (!parseIdToTwoInteger(id, ms, seq))
+    if (id == StreamID::min())
     {
-        err = "-ERR The ID specified in XADD is equal or smaller than the target stream top item\r\n";
+        err = "-ERR The ID specified in XADD must be greater than 0-0\r\n";
         return false;
     }
 
-    if (ms == 0 && seq == 0)
+    if (id <= lastId)
     {
-        err = "-ERR The ID specified in XADD must be greater than 0-0\r\n";
+        err = kTopItemErr;
         return false;
     }
 
-    if (entries.empty())
-        return true;
-
-    // Get last entry
-    StreamEntry &lastStream = entries.back();
-
-    long long last_ms, last_seq;
-
-    parseIdToTwoInteger(lastStream.id, last_ms, last_seq);
+    return true;
+}
 
-    if (ms < last_ms)
-    {
-        err = "-ERR The ID specified in XADD is equal or smaller than the target stream top item\r\n";
-        return false;
+/*
+===============================================================================
+  Node keys
+-------------------------------------------------------------------------------
+  Master IDs are stored big-endian (ms, then seq), so the radix tree's
+  byte order is the ID order and consecutive nodes share their high
+  bytes.
+===============================================================================
+*/
+Stream::NodeKey Stream::nodeKey(const StreamID &id)
+{
+    NodeKey key;
+    for (int i = 0; i < 8; ++i) {
+        key[i] = static_cast<unsigned char>(id.ms >> (56 - 8 * i));
+        key[8 + i] = static_cast<unsigned char>(id.seq >> (56 - 8 * i));
     }
+    return key;
+}
 
-    if (ms == last_ms && seq <= last_seq)
-    {
-        err = "-ERR The ID specified in XADD is equal or smaller than the target stream top item\r\n";
-        return false;
+StreamID Stream::nodeId(const NodeKey &key)
+{
+    StreamID id;
+    for (int i = 0; i < 8; ++i) {
+        id.ms = (id.ms << 8) | key[i];
+        id.seq = (id.seq << 8) | key[8 + i];
     }
-
-    return true;
+    return id;
 }
 
 /*
 ===============================================================================
   addStream()
 -------------------------------------------------------------------------------
-  Appends a new entry to the stream.
+  Appends a new entry to the tail node, starting a new node when the
+  tail is full.
 
   NOTE:
       This function assumes the ID is already validated or generated.
-      It simply inserts the entry and updates the index map.
-
-  Behavior:
-      - Appends {id, fields} to entries vector
-      - Inserts id → index in O(1)
 
-  Return:
-      The final ID (Redis returns the ID as success response).
+  An entry whose field names match the node's master fields is written
+  as flags | ms-delta | seq-delta | values... | lp-count; anything else
+  spells its fields out. Deltas are taken modulo 2^64, so they always
+  round-trip through the int64 items.
 ===============================================================================
 */
-std::string Stream::addStream(const std::string &id, const std::vector<std::pair<std::string, std::string>> &fields)
+void Stream::addStream(const StreamID &id, const std::vector<std::string_view> &field_values)
 {
-    StreamEntry entry;
-    entry.id = id;
-    entry.fields = fields;
+    size_t num_fields = field_values.size() / 2;
+
+    size_t entry_bytes = 8;
+    for (std::string_view v : field_values)
+        entry_bytes += v.size() + 2;
+
+    bool full = tail && (tail->getInt(tail->begin()) >= static_cast<int64_t>(kNodeMaxEntries) ||
+                         tail->bytes() + entry_bytes > kNodeMaxBytes);
+
+    if (!tail || full) {
+        // The sealed node will not grow again
+        if (tail)
+            tail->shrinkToFit();
+
+        tail = &nodes.insert(nodeKey(id), Listpack{});
+        tailMaster = id;
+
+        tail->pushBackInt(0);   // count
+        tail->pushBackInt(0);   // deleted
+        tail->pushBackInt(static_cast<int64_t>(num_fields));
+        for (size_t i = 0; i < num_fields; ++i)
+            tail->pushBack(field_values[2 * i]);
+        tail->pushBackInt(0);   // master terminator
+    } else {
+        unaccount(*tail);
+    }
+
+    // Same field names, in the same order, as the master entry?
+    size_t master_pos = masterFieldsStart(*tail);
+    bool same = tail->getInt(tail->next(tail->next(tail->begin()))) ==
+                static_cast<int64_t>(num_fields);
+    for (size_t i = 0; same && i < num_fields; ++i) {
+        same = tail->equals(master_pos, field_values[2 * i]);
+        master_pos = tail->next(master_pos);
+    }
 
-    // Fill ms/seq
-    parseIdToTwoInteger(id, entry.ms, entry.seq);
+    tail->pushBackInt(same ? FLAG_SAMEFIELDS : 0);
+    tail->pushBackInt(static_cast<int64_t>(id.ms - tailMaster.ms));
+    tail->pushBackInt(static_cast<int64_t>(id.seq - tailMaster.seq));
+
+    if (same) {
+        for (size_t i = 0; i < num_fields; ++i)
+            tail->pushBack(field_values[2 * i + 1]);
+        tail->pushBackInt(static_cast<int64_t>(num_fields + 3));
+    } else {
+        tail->pushBackInt(static_cast<int64_t>(num_fields));
+        for (std::string_view v : field_values)
+            tail->pushBack(v);
+        tail->pushBackInt(static_cast<int64_t>(2 * num_fields + 4));
+    }
 
-    entries.push_back(entry);
-    return id;
+    tail->replaceInt(tail->begin(), tail->getInt(tail->begin()) + 1);
+    ++entryCount;
+    lastId = id;
+
+    account(*tail);
+    if (full)
+        maybeSpill();
+}
+
+void Stream::addStream(const StreamID &id, const StreamFields &fields)
+{
+    std::vector<std::string_view> field_values;
+    field_values.reserve(fields.size() * 2);
+    for (const auto &[field, value] : fields) {
+        field_values.push_back(field);
+        field_values.push_back(value);
+    }
+    addStream(id, field_values);
 }
 
 /*
@@ -199,76 +338,31 @@ std::string Stream::addStream(const std::string &id, const std::vector<std::pair
   Handles ID format: "<ms>-*"
 
   Redis semantics:
-     • If stream empty       → "<ms>-1"
-     • Else:
+     Compared against last_id, which is 0-0 for a new stream:
           if ms < last_ms   → ERR
           if ms > last_ms   → seq = 0
-          if ms == last_ms  → seq = last_seq + 1
-
-  Converts the wildcard sequence '*' into the correct integer and rewrites ID.
+          if ms == last_ms  → seq = last_seq + 1 (ERR if exhausted)
 
   Return:
-      true  → success
+      true  → success, `id` filled in
       false → assign error msg
 ===============================================================================
 */
-bool Stream::addSequenceToId(std::string &id, std::string &err)
+bool Stream::addSequenceToId(uint64_t ms, StreamID &id, std::string &err) const
 {
-    size_t pos = id.find('-');
-    if (pos == std::string::npos)
-    {
-        err = "-ERR The ID specified in XADD is equal or smaller than the target stream top item\r\n";
-        return false;
-    }
+    id = {ms, ms == 0 ? 1u : 0u};
 
-    std::string ms_str = id.substr(0, pos);
-    long long new_ms;
+    // A new stream's last ID is 0-0, so millisecond 0 continues at seq 1
+    const StreamID &last = lastId;
 
-    try
+    if (ms < last.ms || (ms == last.ms && last.seq == UINT64_MAX))
     {
-        new_ms = std::stoll(ms_str);
-    }
-    catch (...)
-    {
-        err = "-ERR The ID specified in XADD is equal or smaller than the target stream top item\r\n";
+        err = kTopItemErr;
         return false;
     }
 
-    // Stream empty → "<ms>-1"
-    if (entries.empty())
-    {
-        id = ms_str + "-1";
-        return true;
-    }
-
-    // Compare to last entry
-    StreamEntry &last = entries.back();
-
-    long long last_ms, last_seq;
-    if (!parseIdToTwoInteger(last.id, last_ms, last_seq))
-    {
-        err = "-ERR The ID specified in XADD is equal or smaller than the target stream top item\r\n";
-        return false;
-    }
-
-    if (new_ms < last_ms)
-    {
-        err = "-ERR The ID specified in XADD is equal or smaller than the target stream top item\r\n";
-        return false;
-    }
-
-    long long new_seq;
-
-    if (new_ms > last_ms)
-    {
-        new_seq = 0;
-    }
-    else
-    {
-        new_seq = last_seq + 1;
-    }
-
-    id = ms_str + "-" + std::to_string(new_seq);
+    if (ms == last.ms)
+        id.seq = last.seq + 1;
     return true;
 }
 
@@ -281,360 +375,744 @@ bool Stream::addSequenceToId(std::string &id, std::string &err)
   Redis logic:
       now_ms = current Unix timestamp
 
-      Case A: stream empty
-          id = "<now_ms>-0"
-
-      Case B: now_ms > last_ms
+      Case A: now_ms > last_ms
           id = "<now_ms>-0"
 
-      Case C: now_ms == last_ms
-          id = "<last_ms>-(last_seq + 1)"
-
-      Case D: now_ms < last_ms
-          (clock moved backwards)
-          id = "<last_ms>-(last_seq + 1)"
+      Case B: now_ms <= last_ms
+          (same millisecond, or the clock moved backwards)
+          id = last_id + 1
           This preserves monotonically increasing IDs.
 
   Result:
       Stream ID is always increasing even if system clock changes.
 ===============================================================================
 */
-bool Stream::createUniqueId(std::string &id, std::string &err)
+bool Stream::createUniqueId(StreamID &id, std::string &err) const
 {
-    long long now_ms = getUnixTimeMs();
+    uint64_t now_ms = static_cast<uint64_t>(getUnixTimeMs());
 
-    if (entries.empty())
+    if (now_ms > lastId.ms)
     {
-        id = std::to_string(now_ms) + "-0";
+        id = {now_ms, 0};
         return true;
     }
 
-    StreamEntry &last = entries.back();
-
-    long long last_ms, last_seq;
-
-    if (!parseIdToTwoInteger(last.id, last_ms, last_seq))
+    id = lastId;
+    if (!id.increment())
     {
-        err = "-ERR The ID specified in XADD is equal or smaller than the target stream top item\r\n";
+        err = "-ERR The stream has exhausted the last possible ID, unable to add more items\r\n";
         return false;
     }
-
-    long long new_ms, new_seq;
-
-    if (now_ms > last_ms)
-    {
-        new_ms = now_ms;
-        new_seq = 0;
-    }
-    else if (now_ms == last_ms)
-    {
-        new_ms = last_ms;
-        new_seq = last_seq + 1;
-    }
-    else
-    {
-        // monotonic guarantee (clock moved backwards)
-        new_ms = last_ms;
-        new_seq = last_seq + 1;
-    }
-
-    id = std::to_string(new_ms) + "-" + std::to_string(new_seq);
     return true;
 }
 
-std::vector<
-    std::pair<
-        std::string,
-        std::vector<std::pair<std::string,std::string>>
-    >
->
-Stream::getPairsInRange(std::string& err, const std::string& first, const std::string& second)
+/*
+===============================================================================
+  deleteEntry()
+-------------------------------------------------------------------------------
+  The only node that can hold `id` is the last one whose master ID is
+  <= id. The entry is flagged in place; entriesDeleted() takes care of
+  the node header.
+===============================================================================
+*/
+bool Stream::deleteEntry(const StreamID &id)
 {
-    err.clear();
+    NodeKey key;
+    Listpack *lp = nodes.seekLE(nodeKey(id), &key);
+    if (!lp)
+        return false;
 
-    using ReturnType = std::vector<
-        std::pair<
-            std::string,
-            std::vector<std::pair<std::string,std::string>>
-        >
-    >;
+    StreamID master = nodeId(key);
+    size_t nf = masterFieldCount(*lp);
 
-    ReturnType result;
+    for (size_t pos = firstEntryPos(*lp); pos != lp->end(); pos = nextEntryPos(*lp, pos, nf)) {
+        StreamID cur = entryId(*lp, pos, master);
+        if (cur < id)
+            continue;
 
-    if (entries.empty())
-        return result;
+        int64_t flags = lp->getInt(pos);
+        if (cur > id || (flags & FLAG_DELETED))
+            return false;
 
-    long long first_ms, first_seq;
-    long long second_ms, second_seq;
+        unaccount(*lp);
+        lp->replaceInt(pos, flags | FLAG_DELETED);
+        entriesDeleted(key, *lp, 1);
+        return true;
+    }
+    return false;
+}
+
+void Stream::entriesDeleted(const NodeKey &key, Listpack &lp, int64_t removed)
+{
+    entryCount -= static_cast<uint64_t>(removed);
+    dropSummaries(nodeId(key));
 
-    bool ok = parseIdToTwoInteger(first, first_ms, first_seq);
-    if (!ok) {
-        err = "-ERR invalid stream ID for XRANGE start\r\n";
-        return {};
+    int64_t count = lp.getInt(lp.begin());
+    int64_t deleted = lp.getInt(lp.next(lp.begin())) + removed;
+
+    if (deleted == count) {
+        if (&lp == tail)
+            tail = nullptr;
+        nodes.erase(key);
+        return;
     }
 
-    ok = parseIdToTwoInteger(second, second_ms, second_seq);
-    if (!ok) {
-        err = "-ERR invalid stream ID for XRANGE end\r\n";
-        return {};
+    if (deleted * 2 <= count) {
+        lp.replaceInt(lp.next(lp.begin()), deleted);
+        account(lp);
+        return;
     }
 
-    // Comparator for (ms, seq)
-    auto cmp_id = [](long long a_ms, long long a_seq,
-                     long long b_ms, long long b_seq) -> int {
-        if (a_ms < b_ms) return -1;
-        if (a_ms > b_ms) return 1;
-        if (a_seq < b_seq) return -1;
-        if (a_seq > b_seq) return 1;
-        return 0;
-    };
+    // Compact: drop the tombstones, keep the master entry (and with it
+    // the delta base) as it is
+    size_t nf = masterFieldCount(lp);
+    size_t pos = firstEntryPos(lp);
+    while (pos != lp.end()) {
+        size_t next = nextEntryPos(lp, pos, nf);
+        if (lp.getInt(pos) & FLAG_DELETED) {
+            size_t items = 0;
+            for (size_t p = pos; p != next; p = lp.next(p))
+                ++items;
+            lp.eraseRange(pos, next, items);
+            continue;
+        }
+        pos = next;
+    }
 
-    // Sanity check: first <= second ?
-    if (cmp_id(first_ms, first_seq, second_ms, second_seq) > 0)
-        return result;
+    lp.replaceInt(lp.next(lp.begin()), 0);
+    lp.replaceInt(lp.begin(), count - deleted);
+    account(lp);
+}
 
-    int n = entries.size();
+/*
+===============================================================================
+  trimByLength() / trimByMinId()
+-------------------------------------------------------------------------------
+  Work on the oldest node until the condition holds:
 
-    // ---------------------------------------------------------------
-    // 1) Find start_idx = first entry >= first_id   (lower_bound)
-    // ---------------------------------------------------------------
-    int lo = 0, hi = n - 1;
-    int start_idx = n; // default: not found
+    • the whole node can go (MAXLEN: the rest of the stream is still
+      >= maxlen; MINID: its newest ID is < minid) → drop it from the
+      tree, O(1) per node
+    • otherwise, exact mode flags its entries one by one from the front
+      and stops; approximate mode just stops
 
-    while (lo <= hi) {
-        int mid = lo + (hi - lo) / 2;
+  LIMIT only applies to approximate trimming (the command layer
+  rejects it otherwise), and a node that would overshoot it is kept.
+===============================================================================
+*/
+uint64_t Stream::trimByLength(uint64_t maxlen, bool approx, uint64_t limit)
+{
+    return trimFront(maxlen, nullptr, approx, limit);
+}
 
-        int comp = cmp_id(entries[mid].ms, entries[mid].seq,
-                          first_ms, first_seq);
+uint64_t Stream::trimByMinId(const StreamID &minid, bool approx, uint64_t limit)
+{
+    return trimFront(0, &minid, approx, limit);
+}
 
-        if (comp >= 0) {
-            start_idx = mid;
-            hi = mid - 1;
-        } else {
-            lo = mid + 1;
+uint64_t Stream::trimFront(uint64_t maxlen, const StreamID *minid, bool approx, uint64_t limit)
+{
+    uint64_t removed = 0;
+
+    while (minid || entryCount > maxlen) {
+        NodeKey key;
+        Listpack *lp = nodes.first(&key);
+        if (!lp)
+            break;
+
+        StreamID master = nodeId(key);
+        uint64_t live = static_cast<uint64_t>(lp->getInt(lp->begin()) -
+                                              lp->getInt(lp->next(lp->begin())));
+
+        bool whole = minid ? nodeLastId(*lp, master) < *minid
+                           : entryCount - live >= maxlen;
+        if (whole) {
+            if (limit && removed + live > limit)
+                break;
+            if (lp == tail)
+                tail = nullptr;
+            dropSummaries(master);
+            unaccount(*lp);
+            nodes.erase(key);
+            entryCount -= live;
+            removed += live;
+            continue;
+        }
+
+        if (approx)
+            break;
+
+        // Flags are rewritten in place at the same size, so positions
+        // hold until the header is updated below
+        size_t nf = masterFieldCount(*lp);
+        int64_t flagged = 0;
+        unaccount(*lp);
+        for (size_t pos = firstEntryPos(*lp); pos != lp->end(); pos = nextEntryPos(*lp, pos, nf)) {
+            int64_t flags = lp->getInt(pos);
+            if (flags & FLAG_DELETED)
+                continue;
+            if (minid ? !(entryId(*lp, pos, master) < *minid)
+                      : entryCount - static_cast<uint64_t>(flagged) <= maxlen)
+                break;
+            lp->replaceInt(pos, flags | FLAG_DELETED);
+            ++flagged;
         }
+
+        removed += static_cast<uint64_t>(flagged);
+        if (flagged)
+            entriesDeleted(key, *lp, flagged);
+        else
+            account(*lp);
+
+        // Only a MINID trim whose newest entries in the node were
+        // already deleted can empty the node here; go on with the next
+        if (!minid || nodes.find(key))
+            break;
     }
 
-    // ---------------------------------------------------------------
-    // 2) Find end_idx = last entry <= second_id   (upper_bound - 1)
-    // ---------------------------------------------------------------
-    lo = 0; hi = n - 1;
-    int end_idx = -1;
+    return removed;
+}
 
-    while (lo <= hi) {
-        int mid = lo + (hi - lo) / 2;
+/*
+===============================================================================
+  Tiered storage
+-------------------------------------------------------------------------------
+  maybeSpill() runs when the tail is sealed, so at most once per node.
+  Past the budget it:
+
+    1) walks back from the tail to the node where the newest
+       hot-entries live entries begin; that node and the newer ones
+       stay in memory
+    2) collects in-memory nodes from spillFrom on, oldest first, until
+       the rest fits in 3/4 of the budget
+    3) writes them to one segment file and swaps each tree value for
+       a listpack reading from the mapping, which frees the heap copy
+
+  Stopping at 3/4 means the next spill writes a batch of at least a
+  quarter of the budget instead of one node per seal. When the hot
+  window alone is over the budget, or the file cannot be written,
+  nothing is retried until hotBytes grows by another quarter.
+===============================================================================
+*/
+void Stream::unaccount(const Listpack &lp)
+{
+    (lp.isExternal() ? coldBytes : hotBytes) -= lp.bytes();
+}
 
-        int comp = cmp_id(entries[mid].ms, entries[mid].seq,
-                          second_ms, second_seq);
+void Stream::account(const Listpack &lp)
+{
+    (lp.isExternal() ? coldBytes : hotBytes) += lp.bytes();
+}
 
-        if (comp <= 0) {
-            end_idx = mid;
-            lo = mid + 1;
-        } else {
-            hi = mid - 1;
-        }
+void Stream::maybeSpill()
+{
+    if (tierDir.empty() || hotBytes <= memoryBudget || hotBytes < spillRetryAt)
+        return;
+
+    // 1) Start of the hot window
+    NodeKey key;
+    Listpack *lp = nodes.last(&key);
+    uint64_t live = 0;
+    StreamID hotStart;
+    while (lp) {
+        hotStart = nodeId(key);
+        live += static_cast<uint64_t>(lp->getInt(lp->begin()) -
+                                      lp->getInt(lp->next(lp->begin())));
+        if (live >= hotEntries)
+            break;
+        StreamID before = hotStart;
+        lp = before.decrement() ? nodes.seekLE(nodeKey(before), &key) : nullptr;
     }
 
-    if (start_idx == n || end_idx == -1 || start_idx > end_idx)
-        return result;
+    // 2) Candidates
+    std::vector<std::pair<StreamID, const Listpack *>> batch;
+    StreamID from = spillFrom;
+    uint64_t target = memoryBudget / 4 * 3;
+    uint64_t left = hotBytes;
+    for (lp = nodes.seekGE(nodeKey(spillFrom), &key); lp && left > target;
+         lp = nodes.seekGE(nodeKey(spillFrom), &key)) {
+        StreamID master = nodeId(key);
+        if (!(master < hotStart))
+            break;
+        if (!lp->isExternal()) {
+            batch.emplace_back(master, lp);
+            left -= lp->bytes();
+        }
+        spillFrom = master;
+        if (!spillFrom.increment())
+            break;
+    }
 
-    // ---------------------------------------------------------------
-    // 3) Copy entries into return vector
-    // ---------------------------------------------------------------
-    result.reserve(end_idx - start_idx + 1);
+    spillRetryAt = left > target ? hotBytes + memoryBudget / 4 : 0;
+    if (batch.empty())
+        return;
+
+    // 3) Write and swap
+    std::string err;
+    std::shared_ptr<StreamSegment> segment = StreamSegment::write(tierDir, batch, err);
+    if (!segment) {
+        std::cerr << "Stream spill failed: " << err << "\n";
+        spillFrom = from;
+        spillRetryAt = hotBytes + memoryBudget / 4;
+        return;
+    }
 
-    for (int i = start_idx; i <= end_idx; ++i) {
-        const StreamEntry &entry = entries[i];
+    for (size_t i = 0; i < batch.size(); ++i) {
+        Listpack *node = nodes.find(nodeKey(batch[i].first));
+        unaccount(*node);
+        *node = segment->node(i);
+        account(*node);
+    }
+}
 
-        result.emplace_back(
-            entry.id,
-            entry.fields   // vector<pair<string,string>>
-        );
+/*
+===============================================================================
+  setLastId() / firstId()
+===============================================================================
+*/
+bool Stream::setLastId(const StreamID &id, std::string &err)
+{
+    if (entryCount && id < lastId) {
+        // lastId may belong to a deleted entry; only live ones count
+        NodeKey key;
+        Listpack *lp = nodes.last(&key);
+        StreamID top = StreamID::min();
+        size_t nf = masterFieldCount(*lp);
+        StreamID master = nodeId(key);
+        for (size_t pos = firstEntryPos(*lp); pos != lp->end(); pos = nextEntryPos(*lp, pos, nf)) {
+            if (!(lp->getInt(pos) & FLAG_DELETED))
+                top = entryId(*lp, pos, master);
+        }
+        if (id < top) {
+            err = "-ERR The ID specified in XSETID is smaller than the target stream top item\r\n";
+            return false;
+        }
     }
 
-    return result;
+    lastId = id;
+    return true;
 }
 
-std::vector<
-    std::pair<
-        std::string,
-        std::vector<std::pair<std::string,std::string>>
-    >
->
-Stream::getPairsFromStartToId(std::string& err, const std::string& second)
+bool Stream::firstId(StreamID &id) const
 {
-    err.clear();
+    Iterator it(*this, StreamID::min(), StreamID::max());
+    return it.next(id);
+}
 
-    using ReturnType = std::vector<
-        std::pair<
-            std::string,
-            std::vector<std::pair<std::string,std::string>>
-        >
-    >;
+bool Stream::hasEntry(const StreamID &id) const
+{
+    Iterator it(*this, id, id);
+    StreamID found;
+    return it.next(found);
+}
 
-    ReturnType result;
+/*
+===============================================================================
+  Consumer groups
+-------------------------------------------------------------------------------
+  Groups only hold IDs; deleting or trimming entries leaves their
+  pending entries alone, as in Redis. Readers of the PEL check
+  hasEntry() and report or drop the ones that are gone.
+===============================================================================
+*/
+StreamGroup *Stream::findGroup(const std::string &name)
+{
+    auto it = cgroups.find(name);
+    return it == cgroups.end() ? nullptr : &it->second;
+}
 
-    if (entries.empty())
-        return result;
+StreamGroup *Stream::createGroup(const std::string &name, const StreamID &last_id)
+{
+    auto [it, inserted] = cgroups.try_emplace(name);
+    if (!inserted)
+        return nullptr;
+    it->second.lastId = last_id;
+    return &it->second;
+}
 
-    long long second_ms, second_seq;
+bool Stream::destroyGroup(const std::string &name)
+{
+    return cgroups.erase(name) == 1;
+}
 
-    bool ok = parseIdToTwoInteger(second, second_ms, second_seq);
-    if (!ok) {
-        err = "-ERR invalid stream ID for XRANGE end\r\n";
-        return {};
+/*
+===============================================================================
+  Iterator
+-------------------------------------------------------------------------------
+  Forward: starts at the last node whose master ID is <= start (the
+  only node that can hold `start` and smaller IDs), skips entries below
+  `start` and deleted ones, and stops at the first ID above `end`.
+  Moving to the next node is a seekGE on the radix tree just past the
+  current master ID.
+
+  Reverse: starts at the last node whose master ID is <= end and reads
+  each node back to front. Every entry ends with its lp-count, so the
+  start of the previous entry is that many items to the left; the
+  entry is then read forward like any other. The previous node is a
+  seekLE just below the current master ID.
+===============================================================================
+*/
+Stream::Iterator::Iterator(const Stream &s, const StreamID &start_id, const StreamID &end_id,
+                           bool reverse_order)
+    : stream(s), start(start_id), end(end_id), reverse(reverse_order)
+{
+    if (start > end) {
+        done = true;
+        return;
     }
 
-    // Comparator for (ms, seq)
-    auto cmp_id = [](long long a_ms, long long a_seq,
-                     long long b_ms, long long b_seq) -> int {
-        if (a_ms < b_ms) return -1;
-        if (a_ms > b_ms) return 1;
-        if (a_seq < b_seq) return -1;
-        if (a_seq > b_seq) return 1;
-        return 0;
-    };
-
-    int n = entries.size();
-
-    // ---------------------------------------------------------------
-    // 2) Find end_idx = last entry <= second_id   (upper_bound - 1)
-    // ---------------------------------------------------------------
-    int lo = 0; 
-    int hi = n - 1;
-    int end_idx = -1;
+    NodeKey found;
+    const Listpack *node = stream.nodes.seekLE(nodeKey(reverse ? end : start), &found);
+    if (!node && !reverse)
+        node = stream.nodes.first(&found);
 
-    while (lo <= hi) {
-        int mid = lo + (hi - lo) / 2;
+    if (node)
+        openNode(node, nodeId(found));
+    else
+        done = true;
+}
 
-        int comp = cmp_id(entries[mid].ms, entries[mid].seq,
-                          second_ms, second_seq);
+void Stream::Iterator::openNode(const Listpack *node, const StreamID &master_id)
+{
+    lp = node;
+    master = master_id;
+    masterFieldCount = static_cast<size_t>(lp->getInt(lp->next(lp->next(lp->begin()))));
+    masterFieldsPos = masterFieldsStart(*lp);
+
+    pos = masterFieldsPos;
+    for (size_t i = 0; i < masterFieldCount; ++i)
+        pos = lp->next(pos);
+    pos = lp->next(pos);    // master terminator
+    firstEntry = pos;
+    back = lp->end();
+    inEntry = false;
+    fieldsLeft = 0;
+}
 
-        if (comp <= 0) {
-            end_idx = mid;
-            lo = mid + 1;
-        } else {
-            hi = mid - 1;
-        }
+// Steps over whatever the caller did not read of the current entry.
+void Stream::Iterator::skipRest()
+{
+    for (; fieldsLeft > 0; --fieldsLeft) {
+        if (!sameFields)
+            pos = lp->next(pos);
+        pos = lp->next(pos);
+    }
+    if (inEntry) {
+        pos = lp->next(pos);    // lp-count
+        inEntry = false;
     }
+}
 
-    if (end_idx == -1)
-        return result;
+bool Stream::Iterator::stepForward()
+{
+    skipRest();
+
+    while (pos == lp->end()) {
+        StreamID after = master;
+        NodeKey found;
+        const Listpack *node = after.increment()
+            ? stream.nodes.seekGE(nodeKey(after), &found) : nullptr;
+        if (!node)
+            return false;
+        openNode(node, nodeId(found));
+    }
+    return true;
+}
 
-    // ---------------------------------------------------------------
-    // 3) Copy entries into return vector
-    // ---------------------------------------------------------------
-    result.reserve(end_idx + 1);
+bool Stream::Iterator::stepBack()
+{
+    while (back == firstEntry) {
+        StreamID before = master;
+        NodeKey found;
+        const Listpack *node = before.decrement()
+            ? stream.nodes.seekLE(nodeKey(before), &found) : nullptr;
+        if (!node)
+            return false;
+        openNode(node, nodeId(found));
+    }
 
-    for (int i = 0; i <= end_idx; ++i) {
-        const StreamEntry &entry = entries[i];
+    size_t p = lp->prev(back);    // lp-count of the entry
+    for (int64_t n = lp->getInt(p); n > 0; --n)
+        p = lp->prev(p);
+    back = pos = p;
+    return true;
+}
 
-        result.emplace_back(
-            entry.id,
-            entry.fields   // vector<pair<string,string>>
-        );
+int64_t Stream::Iterator::readHeader(StreamID &id)
+{
+    int64_t flags = lp->getInt(pos);
+    pos = lp->next(pos);
+    id.ms = master.ms + static_cast<uint64_t>(lp->getInt(pos));
+    pos = lp->next(pos);
+    id.seq = master.seq + static_cast<uint64_t>(lp->getInt(pos));
+    pos = lp->next(pos);
+
+    sameFields = flags & FLAG_SAMEFIELDS;
+    if (sameFields) {
+        numFields = masterFieldCount;
+    } else {
+        numFields = static_cast<size_t>(lp->getInt(pos));
+        pos = lp->next(pos);
     }
-
-    return result;
+    fieldsLeft = numFields;
+    masterCursor = masterFieldsPos;
+    inEntry = true;
+    return flags;
 }
 
-std::vector<
-    std::pair<
-        std::string,
-        std::vector<std::pair<std::string,std::string>>
-    >
->
-Stream::getPairsFromIdToEnd(std::string& err, const std::string& first)
+bool Stream::Iterator::next(StreamID &id)
 {
-    err.clear();
+    while (!done) {
+        if (!(reverse ? stepBack() : stepForward())) {
+            done = true;
+            break;
+        }
 
-    using ReturnType = std::vector<
-        std::pair<
-            std::string,
-            std::vector<std::pair<std::string,std::string>>
-        >
-    >;
+        int64_t flags = readHeader(id);
 
-    ReturnType result;
+        // Past the far bound: nothing further can match
+        if (reverse ? id < start : id > end) {
+            done = true;
+            break;
+        }
+        if ((reverse ? id > end : id < start) || (flags & FLAG_DELETED))
+            continue;
+        return true;
+    }
+    return false;
+}
 
-    if (entries.empty())
-        return result;
+bool Stream::Iterator::nextField(std::string_view &field, std::string_view &value)
+{
+    if (fieldsLeft == 0)
+        return false;
 
-    long long first_ms, first_seq;
+    if (sameFields) {
+        field = lp->view(masterCursor, fieldTmp);
+        masterCursor = lp->next(masterCursor);
+    } else {
+        field = lp->view(pos, fieldTmp);
+        pos = lp->next(pos);
+    }
+    value = lp->view(pos, valueTmp);
+    pos = lp->next(pos);
+    --fieldsLeft;
+    return true;
+}
 
-    bool ok = parseIdToTwoInteger(first, first_ms, first_seq);
-    if (!ok) {
-        err = "-ERR invalid stream ID for XRANGE start\r\n";
-        return {};
+/*
+===============================================================================
+  getPairsInRange()
+-------------------------------------------------------------------------------
+  Entries with first <= id <= last, oldest first, copied out of the
+  nodes; at most `count` of them unless it is 0. "-" and "+" arrive
+  here as StreamID::min() / max().
+===============================================================================
+*/
+std::vector<std::pair<StreamID, StreamFields>>
+Stream::getPairsInRange(const StreamID &first, const StreamID &last, size_t count) const
+{
+    std::vector<std::pair<StreamID, StreamFields>> result;
+
+    Iterator it(*this, first, last);
+    StreamID id;
+    std::string_view field, value;
+    while ((count == 0 || result.size() < count) && it.next(id)) {
+        StreamFields fields;
+        fields.reserve(it.fieldCount());
+        while (it.nextField(field, value))
+            fields.emplace_back(field, value);
+        result.emplace_back(id, std::move(fields));
     }
 
-    // Comparator for (ms, seq)
-    auto cmp_id = [](long long a_ms, long long a_seq,
-                     long long b_ms, long long b_seq) -> int {
-        if (a_ms < b_ms) return -1;
-        if (a_ms > b_ms) return 1;
-        if (a_seq < b_seq) return -1;
-        if (a_seq > b_seq) return 1;
-        return 0;
-    };
+    return result;
+}
 
-    int n = entries.size();
+/*
+===============================================================================
+  aggregate()
+-------------------------------------------------------------------------------
+  Walks the nodes that overlap [start, end]. The values of a node are
+  first gathered into a flat array, then each run that falls in one
+  bucket is reduced by foldValues(), whose loop keeps four independent
+  accumulators per statistic so the compiler can vectorize it.
+
+  A sealed node that lies entirely inside the range and inside one
+  bucket contributes its cached summary instead, so repeating a query
+  over old data reads no entries at all. The summary is built on first
+  use and dropped when the node changes (deleteEntry, trimming); only
+  the kSummaryFields most recently queried fields keep theirs. The
+  tail node still grows and is always read.
+===============================================================================
+*/
+void StreamBucket::merge(const StreamBucket &later)
+{
+    if (later.count == 0)
+        return;
+    if (count == 0) {
+        uint64_t at = start;
+        *this = later;
+        start = at;
+        return;
+    }
+    min = std::min(min, later.min);
+    max = std::max(max, later.max);
+    sum += later.sum;
+    count += later.count;
+    last = later.last;
+}
 
-    // ---------------------------------------------------------------
-    // 1) Find start_idx = first entry >= first_id   (lower_bound)
-    // ---------------------------------------------------------------
-    int lo = 0, hi = n - 1;
-    int start_idx = n; // default: not found
+namespace {
 
-    while (lo <= hi) {
-        int mid = lo + (hi - lo) / 2;
+// Reduces n >= 1 values into a partial bucket.
+StreamBucket foldValues(const double *v, size_t n)
+{
+    double lo[4] = {v[0], v[0], v[0], v[0]};
+    double hi[4] = {v[0], v[0], v[0], v[0]};
+    double sum[4] = {0, 0, 0, 0};
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (size_t l = 0; l < 4; ++l) {
+            double x = v[i + l];
+            lo[l] = x < lo[l] ? x : lo[l];
+            hi[l] = x > hi[l] ? x : hi[l];
+            sum[l] += x;
+        }
+    }
+    for (; i < n; ++i) {
+        lo[0] = v[i] < lo[0] ? v[i] : lo[0];
+        hi[0] = v[i] > hi[0] ? v[i] : hi[0];
+        sum[0] += v[i];
+    }
 
-        int comp = cmp_id(entries[mid].ms, entries[mid].seq,
-                          first_ms, first_seq);
+    StreamBucket b;
+    b.count = n;
+    b.min = std::min(std::min(lo[0], lo[1]), std::min(lo[2], lo[3]));
+    b.max = std::max(std::max(hi[0], hi[1]), std::max(hi[2], hi[3]));
+    b.sum = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+    b.first = v[0];
+    b.last = v[n - 1];
+    return b;
+}
 
-        if (comp >= 0) {
-            start_idx = mid;
-            hi = mid - 1;
-        } else {
-            lo = mid + 1;
+// Values of `field` for the live entries in [lo, hi], with their ms.
+void collectValues(const Stream &stream, const StreamID &lo, const StreamID &hi,
+                   std::string_view field, std::vector<double> &values,
+                   std::vector<uint64_t> &times)
+{
+    values.clear();
+    times.clear();
+
+    Stream::Iterator it(stream, lo, hi);
+    StreamID id;
+    std::string_view f, v;
+    while (it.next(id)) {
+        while (it.nextField(f, v)) {
+            if (f != field)
+                continue;
+            double x;
+            auto [end, ec] = std::from_chars(v.data(), v.data() + v.size(), x);
+            if (ec == std::errc() && end == v.data() + v.size() && std::isfinite(x)) {
+                values.push_back(x);
+                times.push_back(id.ms);
+            }
+            break;
         }
     }
+}
 
-    if (start_idx == n)
-        return result;
+} // namespace
 
-    // ---------------------------------------------------------------
-    // 3) Copy entries into return vector
-    // ---------------------------------------------------------------
-    result.reserve(n - start_idx);
+const StreamBucket &Stream::nodeSummary(const StreamID &master, const StreamID &last,
+                                        std::string_view field) const
+{
+    auto cached = std::find_if(summaries.begin(), summaries.end(),
+                               [field](const auto &entry) { return entry.first == field; });
+    if (cached == summaries.end()) {
+        if (summaries.size() == kSummaryFields)
+            summaries.pop_back();
+        summaries.emplace_back(std::string(field), std::map<StreamID, StreamBucket>());
+        cached = summaries.end() - 1;
+    }
+    std::rotate(summaries.begin(), cached, cached + 1);
 
-    for (int i = start_idx; i <= n - 1; ++i) {
-        const StreamEntry &entry = entries[i];
+    auto &byNode = summaries.front().second;
+    auto it = byNode.find(master);
+    if (it != byNode.end())
+        return it->second;
 
-        result.emplace_back(
-            entry.id,
-            entry.fields   // vector<pair<string,string>>
-        );
-    }
+    std::vector<double> values;
+    std::vector<uint64_t> times;
+    collectValues(*this, master, last, field, values, times);
 
-    return result;
+    StreamBucket summary;
+    if (!values.empty())
+        summary = foldValues(values.data(), values.size());
+    return byNode.emplace(master, summary).first->second;
 }
 
-std::string Stream::incrementId(const std::string& id) {
-    long long ms, seq;
+void Stream::dropSummaries(const StreamID &master)
+{
+    for (auto &[field, byNode] : summaries)
+        byNode.erase(master);
+}
 
-    if (!parseIdToTwoInteger(id, ms, seq)) {
-        return id;
-    }
+std::vector<StreamBucket> Stream::aggregate(const StreamID &start, const StreamID &end,
+                                            std::string_view field, uint64_t bucket_ms) const
+{
+    std::vector<StreamBucket> result;
+    if (start > end || bucket_ms == 0)
+        return result;
 
-    seq += 1;
-    return std::to_string(ms) + "-" + std::to_string(seq);
-}
+    auto bucketOf = [bucket_ms](uint64_t ms) { return ms - ms % bucket_ms; };
+    auto emit = [&](StreamBucket part, uint64_t bucket) {
+        if (result.empty() || result.back().start != bucket) {
+            part.start = bucket;
+            result.push_back(part);
+        } else {
+            result.back().merge(part);
+        }
+    };
 
-std::string Stream::getLastId() {
-    if (entries.empty()) {
-        // Redis behavior: if stream has no entries, $ corresponds to "0-0"
-        return "0-0";
+    std::vector<double> values;
+    std::vector<uint64_t> times;
+
+    NodeKey found;
+    const Listpack *lp = nodes.seekLE(nodeKey(start), &found);
+    if (!lp)
+        lp = nodes.first(&found);
+
+    while (lp) {
+        StreamID master = nodeId(found);
+        if (master > end)
+            break;
+
+        StreamID last = nodeLastId(*lp, master);
+        if (!(last < start)) {
+            bool inside = !(master < start) && !(last > end);
+            if (inside && lp != tail && bucketOf(master.ms) == bucketOf(last.ms)) {
+                const StreamBucket &summary = nodeSummary(master, last, field);
+                if (summary.count)
+                    emit(summary, bucketOf(master.ms));
+            } else {
+                collectValues(*this, std::max(start, master), std::min(end, last), field, values, times);
+                for (size_t i = 0; i < values.size(); ) {
+                    uint64_t bucket = bucketOf(times[i]);
+                    size_t j = i + 1;
+                    while (j < values.size() && bucketOf(times[j]) == bucket)
+                        ++j;
+                    emit(foldValues(values.data() + i, j - i), bucket);
+                    i = j;
+                }
+            }
+        }
+
+        StreamID after = master;
+        if (!after.increment())
+            break;
+        lp = nodes.seekGE(nodeKey(after), &found);
     }
-    return entries.back().id;
-}
\ No newline at end of file
+
+    return result;
+}
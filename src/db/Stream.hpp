@@ -1,10 +1,19 @@
 #pragma once
 
+#include <compare>
+#include <cstdint>
 #include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
 
 #include "../utils/time.cpp"
+#include "Listpack.hpp"
+#include "RadixTree.hpp"
+#include "StreamGroup.hpp"
+#include "StreamID.hpp"
+#include "StreamSegment.hpp"
 
 /*
 ------------------------------------------------------------------------------
@@ -49,108 +58,293 @@ enum class StreamIdType
 
 /*
 ------------------------------------------------------------------------------
-  STREAM ENTRY
+  STREAM BUCKET (XAGG)
 ------------------------------------------------------------------------------
 
-Each entry holds:
-    id     → unique Redis-style ID ("ms-seq")
-    fields → list of key-value pairs (similar to a small hash)
-
-A Redis Stream is conceptually:
-    Ordered append-only log of StreamEntry items.
-
-The fields vector keeps insertion order, matching Redis behavior.
+The numeric values of one field over the entries whose ID milliseconds
+fall in [start, start + bucket size). Buckets are aligned to multiples
+of the bucket size, so the same query always produces the same ones.
 ------------------------------------------------------------------------------
 */
-struct StreamEntry
+struct StreamBucket
 {
-  std::string id;
-  long long ms;
-  long long seq;
-  std::vector<std::pair<std::string, std::string>> fields;
+  uint64_t start = 0;            // ms
+  uint64_t count = 0;
+  double min = 0, max = 0, sum = 0;
+  double first = 0, last = 0;
+
+  // Folds in the values of entries that come after this bucket's.
+  void merge(const StreamBucket &later);
 };
 
 /*
 ------------------------------------------------------------------------------
-  STREAM CLASS (Minimal Redis Stream Implementation)
+  STREAM CLASS (Redis-style packed storage)
 ------------------------------------------------------------------------------
 
 CORE RESPONSIBILITIES:
 
-  • Validate and parse IDs (ms-seq format)
+  • Classify XADD IDs and check them against the last entry
   • Append entries while maintaining strict ordering
   • Generate IDs for AUTO mode
-  • Provide random access via ID → index lookup (idToIndex map)
-  • Provide a clean interface for XADD / XRANGE / XREVRANGE
+  • Iterate ID ranges for XRANGE / XREAD
 
 DATA STRUCTURES:
 
-  entries:      vector of StreamEntry (append-only)
-  idToIndex:    map from string ID → position in entries vector
-                Enables O(1) lookup for XRANGE and similar ops.
+  nodes:  radix tree keyed by the big-endian master ID of each node
+          (so byte order is ID order); the value is one listpack
+          holding up to kNodeMaxEntries entries / kNodeMaxBytes bytes.
+
+  Node layout (every item is one listpack element):
+
+      master entry:  count | deleted | N | field_1 ... field_N | 0
+      each entry:    flags | ms-delta | seq-delta | fields... | lp-count
+
+      fields...  SAMEFIELDS flag: value_1 ... value_N (names from master)
+                 otherwise:       M | field_1 | value_1 ... field_M | value_M
+
+  The master fields are those of the node's first entry. Entries with
+  the same field names (the usual case) store only their values, and
+  their ID as a delta from the master ID, which the listpack packs as
+  small integers. lp-count (elements before it in the entry) lets a
+  reader walk entries backwards. A new node is started once the tail
+  node is full, so appends only ever touch the tail.
+
+  Deleting an entry (XDEL, exact trimming) only sets its DELETED flag
+  and bumps the node's deleted count. A node is rewritten without its
+  tombstones once more than half of it is deleted, and dropped from the
+  tree once all of it is. Approximate trimming drops whole nodes only.
 
-PRIVATE FUNCTIONALITY:
-  parseIdToTwoInteger()
-      Converts a "ms-seq" string into two integers.
+  lastId is kept separately from the entries: deleting or trimming the
+  newest entry must not let XADD reuse its ID.
+
+TIERED STORAGE (--stream-tier-dir):
+
+  Once the nodes a stream holds in memory pass the memory budget, its
+  oldest sealed nodes are written to a segment file (StreamSegment.hpp)
+  and the tree is pointed at the mapped bytes instead, down to 3/4 of
+  the budget and never into the newest hot-entries entries. Readers do
+  not notice: an external listpack reads the same encoding. Deleting
+  or trimming inside a cold node copies it back into memory first
+  (Listpack::own()).
 
 PUBLIC API:
   • returnStreamType()   → Classifies given ID
   • validateId()         → Ensures ID ordering rules
   • addStream()          → Main XADD logic
-  • getById()            → Fetch entry by ID
   • addSequenceToId()    → Handles "ms-*"
   • createUniqueId()     → Handles "*"
+  • Iterator             → Entries with start <= id <= end, either way
+  • getPairsInRange()    → The same, copied out (small reads only)
+  • deleteEntry()        → XDEL
+  • trimByLength/MinId() → XTRIM, XADD MAXLEN / MINID
+  • aggregate()          → XAGG time buckets
+  • findGroup() ...      → consumer groups (see StreamGroup.hpp)
 
 ------------------------------------------------------------------------------
 */
 class Stream
 {
-private:
-  std::vector<StreamEntry> entries;
-
-  // Parses "ms-seq" into two long long integers.
-  // Returns true on success, false on malformed input.
-  bool parseIdToTwoInteger(const std::string &, long long &, long long &);
-
 public:
+  // Node size limits (stream-node-max-bytes / -entries in Redis).
+  static constexpr size_t kNodeMaxBytes = 4096;
+  static constexpr size_t kNodeMaxEntries = 100;
+
   // Determines the type of ID supplied by the user.
-  StreamIdType returnStreamType(const std::string &id);
+  StreamIdType returnStreamType(std::string_view id) const;
 
-  // Validates whether an ID is syntactically correct
-  // AND maintains strict monotonic ordering relative to last entry.
-  bool validateId(const std::string &id, std::string &err);
+  // Validates that an explicit ID is above 0-0 and above the last ID.
+  bool validateId(const StreamID &id, std::string &err) const;
 
-  // Appends a new entry to the stream.
-  // Handles EXPLICIT, AUTO_SEQUENCE, AUTO_GENERATED.
-  std::string addStream(const std::string &id, const std::vector<std::pair<std::string, std::string>> &fields);
+  // Appends a new entry. The ID must already be validated or generated.
+  // `field_values` alternates field, value (XADD's argument tail).
+  void addStream(const StreamID &id, const std::vector<std::string_view> &field_values);
+  void addStream(const StreamID &id, const StreamFields &fields);
 
   // Handles "ms-*". Generates the smallest valid next sequence number.
-  bool addSequenceToId(std::string &id, std::string &err);
+  bool addSequenceToId(uint64_t ms, StreamID &id, std::string &err) const;
 
   // Handles "*" (AUTO_GENERATED).
   // Generates a unique ID based on Unix time + sequence logic.
-  bool createUniqueId(std::string &id, std::string &err);
-
-  std::vector<
-      std::pair<
-          std::string,
-          std::vector<std::pair<std::string, std::string>>>>
-  getPairsInRange(std::string &err, const std::string &first, const std::string &second);
-
-  std::vector<
-      std::pair<
-          std::string,
-          std::vector<std::pair<std::string, std::string>>>>
-  getPairsFromStartToId(std::string &err, const std::string &second);
-
-  std::vector<
-      std::pair<
-          std::string,
-          std::vector<std::pair<std::string, std::string>>>>
-  getPairsFromIdToEnd(std::string &err, const std::string &first);
-
-  std::string incrementId(const std::string& id);
-
-  std::string getLastId();
-  
-};
\ No newline at end of file
+  bool createUniqueId(StreamID &id, std::string &err) const;
+
+  // At most `count` entries (0 = all).
+  std::vector<std::pair<StreamID, StreamFields>>
+  getPairsInRange(const StreamID &first, const StreamID &last, size_t count = 0) const;
+
+  // Marks the entry as deleted. False if there is no such live entry.
+  bool deleteEntry(const StreamID &id);
+
+  // Remove entries from the oldest end while the stream is longer than
+  // `maxlen` / older than `minid`, and return how many went. With
+  // `approx` only whole nodes are removed, stopping at the first node
+  // that would have to be split, and at most `limit` entries (0 = no
+  // limit) are removed.
+  uint64_t trimByLength(uint64_t maxlen, bool approx, uint64_t limit = 0);
+  uint64_t trimByMinId(const StreamID &minid, bool approx, uint64_t limit = 0);
+
+  // Highest ID ever added, 0-0 for a new stream ("$" in XREAD). It
+  // survives the deletion of that entry.
+  StreamID getLastId() const { return lastId; }
+
+  // XSETID: fails if `id` is below the newest live entry.
+  bool setLastId(const StreamID &id, std::string &err);
+
+  // ID of the oldest live entry; false when the stream is empty.
+  bool firstId(StreamID &id) const;
+
+  // True if `id` is a live (not deleted or trimmed) entry.
+  bool hasEntry(const StreamID &id) const;
+
+  // XAGG: the non-empty buckets of `bucket_ms` milliseconds, oldest
+  // first, over the numeric values of `field` for start <= id <= end.
+  // Entries without the field, or whose value is not a finite number,
+  // are left out.
+  std::vector<StreamBucket> aggregate(const StreamID &start, const StreamID &end,
+                                      std::string_view field, uint64_t bucket_ms) const;
+
+  // Consumer groups. createGroup() returns nullptr if the name is taken.
+  StreamGroup *findGroup(const std::string &name);
+  StreamGroup *createGroup(const std::string &name, const StreamID &last_id);
+  bool destroyGroup(const std::string &name);
+  const std::map<std::string, StreamGroup> &groups() const { return cgroups; }
+
+  uint64_t length() const { return entryCount; }
+  size_t nodeCount() const { return nodes.size(); }
+
+  // XAGG keeps node summaries for this many fields, least recently
+  // used dropped first.
+  static constexpr size_t kSummaryFields = 8;
+  size_t summarizedFields() const { return summaries.size(); }
+
+  // Tiered storage, shared by every stream: `dir` holds the segment
+  // files (empty = off), `hot_entries` newest entries always stay in
+  // memory, `memory_budget` bytes of nodes per stream trigger a spill.
+  static void SetTiering(const std::string &dir, uint64_t hot_entries, uint64_t memory_budget)
+  {
+    tierDir = dir;
+    hotEntries = hot_entries;
+    memoryBudget = memory_budget;
+  }
+
+  // Node bytes held in memory / read from segment files.
+  uint64_t residentBytes() const { return hotBytes; }
+  uint64_t spilledBytes() const { return coldBytes; }
+
+  /**
+   * Walks the entries with start <= id <= end, oldest first (newest
+   * first with `reverse`):
+   *
+   *     Stream::Iterator it(stream, start, end);
+   *     StreamID id;
+   *     while (it.next(id))
+   *         while (it.nextField(field, value)) ...
+   *
+   * Field and value views point into the node (or into the iterator
+   * for integer-encoded items) and stay valid until the next call.
+   * The stream must not be modified while iterating.
+   */
+  class Iterator
+  {
+  public:
+    Iterator(const Stream &stream, const StreamID &start, const StreamID &end,
+             bool reverse = false);
+
+    bool next(StreamID &id);
+
+    size_t fieldCount() const { return numFields; }
+    bool nextField(std::string_view &field, std::string_view &value);
+
+  private:
+    const Stream &stream;
+    StreamID start, end;
+    bool reverse;
+    bool done = false;
+
+    const Listpack *lp = nullptr;
+    StreamID master;
+    size_t masterFieldsPos = 0;
+    size_t masterFieldCount = 0;
+
+    size_t firstEntry = 0;         // flags of the node's first entry
+    size_t pos = 0;                // next unread item of the node
+    size_t back = 0;               // reverse: end of the entries not yet visited
+    bool inEntry = false;          // lp-count of the current entry still unread
+    bool sameFields = false;
+    size_t numFields = 0;
+    size_t fieldsLeft = 0;
+    size_t masterCursor = 0;
+
+    char fieldTmp[Listpack::kIntBufSize];
+    char valueTmp[Listpack::kIntBufSize];
+
+    void openNode(const Listpack *node, const StreamID &master_id);
+    void skipRest();
+
+    // Move `pos` to the flags of the next entry in iteration order,
+    // crossing into the neighbouring node when needed.
+    bool stepForward();
+    bool stepBack();
+
+    // Reads flags and ID; `pos` is left on the fields.
+    int64_t readHeader(StreamID &id);
+  };
+
+private:
+  using NodeKey = RadixTree<Listpack>::Key;
+
+  RadixTree<Listpack> nodes;
+
+  // Newest node; entries are appended to it in place
+  Listpack *tail = nullptr;
+  StreamID tailMaster;
+
+  uint64_t entryCount = 0;
+  StreamID lastId;
+
+  std::map<std::string, StreamGroup> cgroups;
+
+  static inline std::string tierDir;
+  static inline uint64_t hotEntries = 100000;
+  static inline uint64_t memoryBudget = 64ULL * 1024 * 1024;
+
+  uint64_t hotBytes = 0;
+  uint64_t coldBytes = 0;
+
+  // Nodes before this master ID were already offered to a segment
+  StreamID spillFrom;
+
+  // After a spill that could not get under the budget, the next one
+  // waits until hotBytes reaches this
+  uint64_t spillRetryAt = 0;
+
+  // Take a node out of / add it to hotBytes or coldBytes; done around
+  // every change to a node, which may move it to memory.
+  void unaccount(const Listpack &lp);
+  void account(const Listpack &lp);
+
+  // Called when the tail is sealed: moves old nodes to a segment file
+  // while over the memory budget.
+  void maybeSpill();
+
+  // (field, node master ID -> summary of the whole node) for XAGG,
+  // most recently used field first, at most kSummaryFields of them.
+  // Only sealed nodes are summarized; deleting or trimming entries of
+  // a node drops its summaries.
+  mutable std::vector<std::pair<std::string, std::map<StreamID, StreamBucket>>> summaries;
+
+  const StreamBucket &nodeSummary(const StreamID &master, const StreamID &last,
+                                  std::string_view field) const;
+  void dropSummaries(const StreamID &master);
+
+  static NodeKey nodeKey(const StreamID &id);
+  static StreamID nodeId(const NodeKey &key);
+
+  // Shared by trimByLength / trimByMinId: `minid` is null for MAXLEN.
+  uint64_t trimFront(uint64_t maxlen, const StreamID *minid, bool approx, uint64_t limit);
+
+  // Updates the node header after `removed` of its entries were flagged
+  // deleted, then compacts or drops the node. The caller unaccount()ed
+  // it before flagging.
+  void entriesDeleted(const NodeKey &key, Listpack &lp, int64_t removed);
+};
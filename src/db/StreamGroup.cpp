@@ -0,0 +1,81 @@
+#include "./StreamGroup.hpp"
+
+StreamConsumer *StreamGroup::findConsumer(const std::string &name)
+{
+    auto it = members.find(name);
+    return it == members.end() ? nullptr : &it->second;
+}
+
+StreamConsumer &StreamGroup::consumer(const std::string &name, bool &created)
+{
+    auto [it, inserted] = members.try_emplace(name);
+    if (inserted)
+        it->second.name = name;
+    created = inserted;
+    return it->second;
+}
+
+int64_t StreamGroup::deleteConsumer(const std::string &name)
+{
+    auto it = members.find(name);
+    if (it == members.end())
+        return -1;
+
+    int64_t count = static_cast<int64_t>(it->second.pending.size());
+    for (const auto &[id, entry] : it->second.pending)
+        pending.erase(id);
+    members.erase(it);
+    return count;
+}
+
+/*
+===============================================================================
+  addPending()
+-------------------------------------------------------------------------------
+  An entry can already be pending when it is delivered as new: the
+  group's last ID was moved back (XGROUP SETID). It then changes hands
+  and starts over, as in Redis.
+===============================================================================
+*/
+void StreamGroup::addPending(const StreamID &id, StreamConsumer &owner, uint64_t now)
+{
+    auto [it, inserted] = pending.try_emplace(id);
+    StreamPendingEntry &entry = it->second;
+
+    if (inserted) {
+        entry.consumer = &owner;
+        owner.pending.emplace(id, &entry);
+    } else {
+        transfer(id, entry, owner);
+    }
+
+    entry.deliveryTime = now;
+    entry.deliveryCount = 1;
+}
+
+StreamPendingEntry *StreamGroup::findPending(const StreamID &id)
+{
+    auto it = pending.find(id);
+    return it == pending.end() ? nullptr : &it->second;
+}
+
+void StreamGroup::transfer(const StreamID &id, StreamPendingEntry &entry, StreamConsumer &owner)
+{
+    if (entry.consumer == &owner)
+        return;
+
+    entry.consumer->pending.erase(id);
+    entry.consumer = &owner;
+    owner.pending.emplace(id, &entry);
+}
+
+bool StreamGroup::ack(const StreamID &id)
+{
+    auto it = pending.find(id);
+    if (it == pending.end())
+        return false;
+
+    it->second.consumer->pending.erase(id);
+    pending.erase(it);
+    return true;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "StreamID.hpp"
+
+/*
+------------------------------------------------------------------------------
+  CONSUMER GROUPS
+------------------------------------------------------------------------------
+
+A group hands every entry of its stream to one of its consumers and
+remembers it as pending until the consumer acknowledges it (XACK).
+
+  lastId:     the newest entry delivered to the group; XREADGROUP ">"
+              serves the entries after it
+  pel:        pending entries list, ID -> delivery time, delivery count,
+              owner; the group-wide view (XPENDING, XAUTOCLAIM)
+  consumers:  name -> consumer; each consumer keeps its own ordered
+              index of the pending entries it owns (XREADGROUP history,
+              XPENDING ... consumer)
+
+Both indexes are ordered maps, so acking, claiming and looking up one
+entry cost O(log n) however many millions of entries are pending, and
+ranges are walked from a lower bound without scanning what comes
+before. A pending entry lives in the group PEL; the consumer index
+points at it, and the entry points back at its owner, so moving it to
+another consumer (XCLAIM) is two map operations.
+
+Delivery times are Unix milliseconds: they are persisted, and idle
+times must survive a restart.
+------------------------------------------------------------------------------
+*/
+struct StreamConsumer;
+
+struct StreamPendingEntry
+{
+  uint64_t deliveryTime = 0;     // Unix ms of the last delivery
+  uint64_t deliveryCount = 0;
+  StreamConsumer *consumer = nullptr;
+};
+
+struct StreamConsumer
+{
+  std::string name;
+  uint64_t seenTime = 0;         // Unix ms of the last read or claim
+  std::map<StreamID, StreamPendingEntry *> pending;
+};
+
+class StreamGroup
+{
+public:
+  StreamID lastId;
+
+  StreamGroup() = default;
+  StreamGroup(StreamGroup &&) = default;
+  StreamGroup &operator=(StreamGroup &&) = default;
+
+  // Pending entries and consumers point at each other
+  StreamGroup(const StreamGroup &) = delete;
+  StreamGroup &operator=(const StreamGroup &) = delete;
+
+  StreamConsumer *findConsumer(const std::string &name);
+
+  // Creates the consumer if needed; `created` tells which happened.
+  StreamConsumer &consumer(const std::string &name, bool &created);
+
+  // Drops the consumer together with its pending entries; returns how
+  // many it had, or -1 if there is no such consumer.
+  int64_t deleteConsumer(const std::string &name);
+
+  // Records a delivery of `id` to `owner` (XREADGROUP ">"): a new
+  // pending entry, or an existing one handed over and restarted.
+  void addPending(const StreamID &id, StreamConsumer &owner, uint64_t now);
+
+  StreamPendingEntry *findPending(const StreamID &id);
+
+  // Gives the entry to `owner` (no-op if it already has it).
+  void transfer(const StreamID &id, StreamPendingEntry &entry, StreamConsumer &owner);
+
+  // Removes the entry from the PEL (XACK); false if it was not pending.
+  bool ack(const StreamID &id);
+
+  const std::map<StreamID, StreamPendingEntry> &pel() const { return pending; }
+  const std::map<std::string, StreamConsumer> &consumers() const { return members; }
+
+private:
+  std::map<StreamID, StreamPendingEntry> pending;
+  std::map<std::string, StreamConsumer> members;
+};
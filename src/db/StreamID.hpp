@@ -0,0 +1,47 @@
+#pragma once
+
+#include <compare>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+------------------------------------------------------------------------------
+  STREAM ID
+------------------------------------------------------------------------------
+
+An ID is two unsigned 64-bit integers, compared as (ms, seq). It is
+parsed once where it enters a command and formatted only when a reply
+(or the AOF) needs its text, so entries carry 16 bytes instead of a
+heap string, and ordering is two integer compares.
+
+Text forms (parse):
+    "<ms>-<seq>"   both parts strict decimal, 0 .. 2^64-1
+    "<ms>"         seq taken from `missing_seq` (0 for a range start,
+                   UINT64_MAX for a range end, as Redis does)
+------------------------------------------------------------------------------
+*/
+struct StreamID
+{
+  uint64_t ms = 0;
+  uint64_t seq = 0;
+
+  auto operator<=>(const StreamID &) const = default;
+
+  static constexpr StreamID min() { return {0, 0}; }
+  static constexpr StreamID max() { return {UINT64_MAX, UINT64_MAX}; }
+
+  // Smallest ID after / largest ID before this one.
+  // Return false (ID unchanged) at the ends of the ID space.
+  bool increment();
+  bool decrement();
+
+  static bool parse(std::string_view s, StreamID &out, uint64_t missing_seq = 0);
+
+  std::string toString() const;
+  void appendTo(std::string &out) const;
+};
+
+using StreamFields = std::vector<std::pair<std::string, std::string>>;
@@ -0,0 +1,183 @@
+#include "./StreamSegment.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kMagic[8] = {'R', 'C', 'S', 'S', 'E', 'G', '0', '1'};
+const char kTrailer[8] = {'R', 'C', 'S', 'S', 'E', 'G', 'N', 'D'};
+
+constexpr size_t kIndexEntrySize = 5 * 8;
+constexpr size_t kTrailerSize = 3 * 8;
+
+// Buffered writes are flushed once they reach this size.
+constexpr size_t kWriteChunk = 1 << 20;
+
+void putFixed64(std::string &out, uint64_t v)
+{
+    for (int i = 0; i < 8; ++i)
+        out += static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+uint64_t getFixed64(const unsigned char *p)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i)
+        v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    return v;
+}
+
+bool writeAll(int fd, const char *p, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+/*
+===============================================================================
+  write()
+-------------------------------------------------------------------------------
+  Nodes are copied out in the order given (oldest first), followed by
+  the index and the trailer. No fsync: a crash loses nothing, since
+  the file is never read again after a restart.
+===============================================================================
+*/
+std::shared_ptr<StreamSegment>
+StreamSegment::write(const std::string &dir,
+                     const std::vector<std::pair<StreamID, const Listpack *>> &nodes,
+                     std::string &err)
+{
+    std::string path = dir + "/stream-segment-XXXXXX";
+    int fd = ::mkstemp(path.data());
+    if (fd < 0) {
+        err = "cannot create " + path + ": " + std::strerror(errno);
+        return nullptr;
+    }
+
+    std::string buf(kMagic, sizeof(kMagic));
+    std::string index;
+    uint64_t offset = sizeof(kMagic);
+    bool ok = true;
+
+    for (const auto &[master, lp] : nodes) {
+        putFixed64(index, master.ms);
+        putFixed64(index, master.seq);
+        putFixed64(index, offset);
+        putFixed64(index, lp->bytes());
+        putFixed64(index, lp->count());
+
+        buf.append(reinterpret_cast<const char *>(lp->data()), lp->bytes());
+        offset += lp->bytes();
+
+        if (buf.size() >= kWriteChunk) {
+            ok = ok && writeAll(fd, buf.data(), buf.size());
+            buf.clear();
+        }
+    }
+
+    buf += index;
+    putFixed64(buf, nodes.size());
+    putFixed64(buf, offset);
+    buf.append(kTrailer, sizeof(kTrailer));
+    ok = ok && writeAll(fd, buf.data(), buf.size());
+
+    if (!ok)
+        err = "write to " + path + " failed: " + std::strerror(errno);
+    ::close(fd);
+
+    std::shared_ptr<StreamSegment> segment(new StreamSegment());
+    if (ok && !segment->open(path, err))
+        ok = false;
+
+    ::unlink(path.c_str());
+    return ok ? segment : nullptr;
+}
+
+bool StreamSegment::open(const std::string &path, std::string &err)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        err = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        err = "cannot stat " + path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    size_t len = static_cast<size_t>(st.st_size);
+    void *m = len ? ::mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+
+    if (m == MAP_FAILED) {
+        err = "mmap " + path + " failed: " + std::strerror(errno);
+        return false;
+    }
+    ::madvise(m, len, MADV_RANDOM);
+    map = static_cast<const unsigned char *>(m);
+    length = len;
+
+    if (len < sizeof(kMagic) + kTrailerSize ||
+        std::memcmp(map, kMagic, sizeof(kMagic)) != 0 ||
+        std::memcmp(map + len - sizeof(kTrailer), kTrailer, sizeof(kTrailer)) != 0) {
+        err = "bad segment file " + path;
+        return false;
+    }
+
+    const unsigned char *trailer = map + len - kTrailerSize;
+    uint64_t count = getFixed64(trailer);
+    uint64_t index_offset = getFixed64(trailer + 8);
+    if (index_offset + count * kIndexEntrySize != len - kTrailerSize) {
+        err = "bad segment index in " + path;
+        return false;
+    }
+
+    nodes.resize(count);
+    const unsigned char *p = map + index_offset;
+    for (Node &n : nodes) {
+        n.master = {getFixed64(p), getFixed64(p + 8)};
+        n.offset = getFixed64(p + 16);
+        n.bytes = getFixed64(p + 24);
+        n.entries = getFixed64(p + 32);
+        p += kIndexEntrySize;
+
+        if (n.offset < sizeof(kMagic) || n.offset + n.bytes > index_offset) {
+            err = "bad segment index in " + path;
+            return false;
+        }
+    }
+    return true;
+}
+
+StreamSegment::~StreamSegment()
+{
+    if (map)
+        ::munmap(const_cast<unsigned char *>(map), length);
+}
+
+Listpack StreamSegment::node(size_t i) const
+{
+    const Node &n = nodes[i];
+    return Listpack::external(map + n.offset, n.bytes, n.entries, shared_from_this());
+}
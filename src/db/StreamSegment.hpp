@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Listpack.hpp"
+#include "StreamID.hpp"
+
+/*
+------------------------------------------------------------------------------
+  STREAM SEGMENT (cold stream nodes on disk)
+------------------------------------------------------------------------------
+
+An immutable file holding sealed stream nodes, mapped read-only so the
+stream can keep pointing at them instead of at heap copies:
+
+    "RCSSEG01"
+    <node bytes> <node bytes> ...
+    index:    per node: master ms | master seq | offset | bytes | entries
+    trailer:  node count | index offset | "RCSSEGND"
+
+All numbers are fixed 64-bit little-endian. The index is the sparse
+ID index of the segment: one entry per node of up to 100 entries, read
+once when the file is mapped. Lookups go through the stream's radix
+tree, which keeps the master ID of every node whatever tier it is in,
+so a range read only faults in the pages of the nodes it walks
+(the mapping is MADV_RANDOM: no read-ahead into unrelated nodes).
+
+The file is unlinked as soon as it is mapped. It is a memory tier, not
+a copy of the data: snapshots and the AOF still read every entry
+through the stream, and the disk space is returned once the last node
+of the segment is deleted, trimmed or copied back into memory.
+------------------------------------------------------------------------------
+*/
+class StreamSegment : public std::enable_shared_from_this<StreamSegment>
+{
+public:
+  struct Node
+  {
+    StreamID master;
+    uint64_t offset = 0;
+    uint64_t bytes = 0;
+    uint64_t entries = 0;
+  };
+
+  // Writes `nodes` (master ID, node) to a new file in `dir` and maps
+  // it back. nullptr with `err` set on failure.
+  static std::shared_ptr<StreamSegment>
+  write(const std::string &dir, const std::vector<std::pair<StreamID, const Listpack *>> &nodes,
+        std::string &err);
+
+  ~StreamSegment();
+
+  StreamSegment(const StreamSegment &) = delete;
+  StreamSegment &operator=(const StreamSegment &) = delete;
+
+  const std::vector<Node> &index() const { return nodes; }
+
+  // The i-th node as a listpack reading straight from the mapping.
+  Listpack node(size_t i) const;
+
+  size_t mappedBytes() const { return length; }
+
+private:
+  StreamSegment() = default;
+
+  const unsigned char *map = nullptr;
+  size_t length = 0;
+  std::vector<Node> nodes;
+
+  bool open(const std::string &path, std::string &err);
+};
@@ -0,0 +1,414 @@
+#include "ZSet.hpp"
+
+#include <charconv>
+#include <new>
+#include <random>
+#include <utility>
+
+#include "../utils/StringUtils.hpp"
+
+/* =====================================================================
+   Lifetime
+   ===================================================================== */
+
+ZSet::ZSet() = default;
+
+ZSet::ZSet(const ZSet &other) : compact(other.compact), lp(other.lp) {
+    if (compact)
+        return;
+    initSkiplist();
+    dict.reserve(other.length);
+    other.range(0, other.length, false, [&](std::string_view member, double score) {
+        Node *x = slInsert(score, member);
+        dict.emplace(x->member, x);
+    });
+}
+
+ZSet::ZSet(ZSet &&other) noexcept
+    : compact(other.compact), lp(std::move(other.lp)), header(other.header),
+      tail(other.tail), length(other.length), level(other.level),
+      dict(std::move(other.dict)) {
+    other.compact = true;
+    other.header = other.tail = nullptr;
+    other.length = 0;
+    other.level = 1;
+}
+
+ZSet &ZSet::operator=(ZSet other) noexcept {
+    std::swap(compact, other.compact);
+    std::swap(lp, other.lp);
+    std::swap(header, other.header);
+    std::swap(tail, other.tail);
+    std::swap(length, other.length);
+    std::swap(level, other.level);
+    std::swap(dict, other.dict);
+    return *this;
+}
+
+ZSet::~ZSet() {
+    if (!header)
+        return;
+    Node *x = header->levels()[0].forward;
+    while (x) {
+        Node *next = x->levels()[0].forward;
+        freeNode(x);
+        x = next;
+    }
+    freeNode(header);
+}
+
+/* =====================================================================
+   Lookup
+   ===================================================================== */
+
+size_t ZSet::find(std::string_view member) const {
+    for (size_t pos = lp.begin(); pos != lp.end(); pos = lp.next(lp.next(pos))) {
+        if (lp.equals(pos, member))
+            return pos;
+    }
+    return lp.end();
+}
+
+double ZSet::scoreAt(const Listpack &lp, size_t pos) {
+    char tmp[Listpack::kIntBufSize];
+    std::string_view s = lp.view(pos, tmp);
+    double score = 0;
+    std::from_chars(s.data(), s.data() + s.size(), score);
+    return score;
+}
+
+bool ZSet::score(std::string_view member, double &out) const {
+    if (!compact) {
+        auto it = dict.find(member);
+        if (it == dict.end())
+            return false;
+        out = it->second->score;
+        return true;
+    }
+
+    size_t pos = find(member);
+    if (pos == lp.end())
+        return false;
+    out = scoreAt(lp, lp.next(pos));
+    return true;
+}
+
+bool ZSet::rank(std::string_view member, size_t &out) const {
+    if (!compact) {
+        auto it = dict.find(member);
+        if (it == dict.end())
+            return false;
+        const Node *target = it->second;
+        out = slCountWhile([&](const Node *x) {
+            return x->score < target->score ||
+                   (x->score == target->score && x->member < target->member);
+        });
+        return true;
+    }
+
+    size_t r = 0;
+    for (size_t pos = lp.begin(); pos != lp.end(); pos = lp.next(lp.next(pos)), ++r) {
+        if (lp.equals(pos, member)) {
+            out = r;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t ZSet::countBelow(double score, bool inclusive) const {
+    auto before = [&](double s) { return inclusive ? s < score : s <= score; };
+    if (!compact)
+        return slCountWhile([&](const Node *x) { return before(x->score); });
+
+    size_t n = 0;
+    for (size_t pos = lp.begin(); pos != lp.end(); pos = lp.next(lp.next(pos)), ++n) {
+        if (!before(scoreAt(lp, lp.next(pos))))
+            break;
+    }
+    return n;
+}
+
+size_t ZSet::countBelowLex(std::string_view member, bool inclusive) const {
+    auto before = [&](std::string_view m) { return inclusive ? m < member : m <= member; };
+    if (!compact)
+        return slCountWhile([&](const Node *x) { return before(x->member); });
+
+    char tmp[Listpack::kIntBufSize];
+    size_t n = 0;
+    for (size_t pos = lp.begin(); pos != lp.end(); pos = lp.next(lp.next(pos)), ++n) {
+        if (!before(lp.view(pos, tmp)))
+            break;
+    }
+    return n;
+}
+
+/* =====================================================================
+   Updates
+   ===================================================================== */
+
+bool ZSet::insert(std::string_view member, double score) {
+    if (compact) {
+        size_t pos = find(member);
+        if (pos != lp.end()) {
+            if (scoreAt(lp, lp.next(pos)) == score)
+                return false;
+            lp.eraseRange(pos, lp.next(lp.next(pos)), 2);
+            insertCompact(member, score);
+            return false;
+        }
+        if (size() < maxListpackEntries && member.size() <= maxListpackValue) {
+            insertCompact(member, score);
+            return true;
+        }
+        convertToSkiplist();
+    }
+
+    bool added = true;
+    if (auto it = dict.find(member); it != dict.end()) {
+        Node *x = it->second;
+        if (x->score == score)
+            return false;
+        // The key points into the node, so it goes first
+        double old = x->score;
+        dict.erase(it);
+        slErase(old, member);
+        added = false;
+    }
+    Node *x = slInsert(score, member);
+    dict.emplace(x->member, x);
+    return added;
+}
+
+bool ZSet::erase(std::string_view member) {
+    if (compact) {
+        size_t pos = find(member);
+        if (pos == lp.end())
+            return false;
+        lp.eraseRange(pos, lp.next(lp.next(pos)), 2);
+        return true;
+    }
+
+    auto it = dict.find(member);
+    if (it == dict.end())
+        return false;
+    double score = it->second->score;
+    dict.erase(it);
+    slErase(score, member);
+    return true;
+}
+
+size_t ZSet::eraseRange(size_t from, size_t to) {
+    to = std::min(to, size());
+    if (from >= to)
+        return 0;
+
+    if (compact) {
+        size_t first = lp.seek(static_cast<long long>(2 * from));
+        size_t last = to == size() ? lp.end() : lp.seek(static_cast<long long>(2 * to));
+        lp.eraseRange(first, last, 2 * (to - from));
+        return to - from;
+    }
+
+    // Path to the node just before `from`, then unlink forward from it
+    Node *update[kMaxLevel];
+    Node *x = header;
+    size_t traversed = 0;
+    for (int i = level - 1; i >= 0; --i) {
+        while (x->levels()[i].forward && traversed + x->levels()[i].span <= from) {
+            traversed += x->levels()[i].span;
+            x = x->levels()[i].forward;
+        }
+        update[i] = x;
+    }
+
+    x = x->levels()[0].forward;
+    size_t removed = 0;
+    while (x && from + removed < to) {
+        Node *next = x->levels()[0].forward;
+        slDelete(x, update);
+        dict.erase(x->member);
+        freeNode(x);
+        ++removed;
+        x = next;
+    }
+    return removed;
+}
+
+// Sorted by (score, member); the pair goes before the first larger one
+void ZSet::insertCompact(std::string_view member, double score) {
+    char tmp[Listpack::kIntBufSize];
+    size_t pos = lp.begin();
+    for (; pos != lp.end(); pos = lp.next(lp.next(pos))) {
+        double s = scoreAt(lp, lp.next(pos));
+        if (s > score || (s == score && lp.view(pos, tmp) > member))
+            break;
+    }
+
+    std::string text = formatDouble(score);
+    lp.insert(pos, member);
+    lp.insert(lp.next(pos), text);
+}
+
+// Moves every member into the skiplist and frees the listpack
+void ZSet::convertToSkiplist() {
+    initSkiplist();
+    dict.reserve(size() + 1);
+    range(0, size(), false, [&](std::string_view member, double score) {
+        Node *x = slInsert(score, member);
+        dict.emplace(x->member, x);
+    });
+    lp = Listpack{};
+    compact = false;
+}
+
+/* =====================================================================
+   Skiplist
+   ===================================================================== */
+
+ZSet::Node *ZSet::newNode(int height, double score, std::string_view member) {
+    void *mem = ::operator new(sizeof(Node) + static_cast<size_t>(height) * sizeof(Level));
+    Node *x = new (mem) Node{score, std::string(member), nullptr, height};
+    for (int i = 0; i < height; ++i)
+        new (&x->levels()[i]) Level{nullptr, 0};
+    return x;
+}
+
+void ZSet::freeNode(Node *node) {
+    node->~Node();
+    ::operator delete(node);
+}
+
+// Level i + 1 with probability 1/4 of level i, as in Redis
+int ZSet::randomLevel() {
+    static std::mt19937 rng(0x5eed);
+    int h = 1;
+    while (h < kMaxLevel && (rng() & 3) == 0)
+        ++h;
+    return h;
+}
+
+void ZSet::initSkiplist() {
+    header = newNode(kMaxLevel, 0, {});
+    tail = nullptr;
+    length = 0;
+    level = 1;
+}
+
+ZSet::Node *ZSet::slInsert(double score, std::string_view member) {
+    auto before = [&](const Node *x) {
+        return x->score < score || (x->score == score && x->member < member);
+    };
+
+    Node *update[kMaxLevel];
+    size_t rank[kMaxLevel];
+    Node *x = header;
+    for (int i = level - 1; i >= 0; --i) {
+        rank[i] = i == level - 1 ? 0 : rank[i + 1];
+        while (x->levels()[i].forward && before(x->levels()[i].forward)) {
+            rank[i] += x->levels()[i].span;
+            x = x->levels()[i].forward;
+        }
+        update[i] = x;
+    }
+
+    int h = randomLevel();
+    if (h > level) {
+        for (int i = level; i < h; ++i) {
+            rank[i] = 0;
+            update[i] = header;
+            header->levels()[i].span = length;
+        }
+        level = h;
+    }
+
+    x = newNode(h, score, member);
+    for (int i = 0; i < h; ++i) {
+        Level &prev = update[i]->levels()[i];
+        x->levels()[i].forward = prev.forward;
+        prev.forward = x;
+        x->levels()[i].span = prev.span - (rank[0] - rank[i]);
+        prev.span = rank[0] - rank[i] + 1;
+    }
+    for (int i = h; i < level; ++i)
+        update[i]->levels()[i].span++;
+
+    x->backward = update[0] == header ? nullptr : update[0];
+    if (x->levels()[0].forward)
+        x->levels()[0].forward->backward = x;
+    else
+        tail = x;
+    ++length;
+    return x;
+}
+
+// Unlinks x, given the last node before it on every level
+void ZSet::slDelete(Node *x, Node **update) {
+    for (int i = 0; i < level; ++i) {
+        Level &prev = update[i]->levels()[i];
+        if (prev.forward == x) {
+            prev.span += x->levels()[i].span - 1;
+            prev.forward = x->levels()[i].forward;
+        } else {
+            prev.span -= 1;
+        }
+    }
+
+    if (x->levels()[0].forward)
+        x->levels()[0].forward->backward = x->backward;
+    else
+        tail = x->backward;
+
+    while (level > 1 && !header->levels()[level - 1].forward)
+        --level;
+    --length;
+}
+
+bool ZSet::slErase(double score, std::string_view member) {
+    Node *update[kMaxLevel];
+    Node *x = header;
+    for (int i = level - 1; i >= 0; --i) {
+        while (x->levels()[i].forward) {
+            const Node *next = x->levels()[i].forward;
+            if (!(next->score < score || (next->score == score && next->member < member)))
+                break;
+            x = x->levels()[i].forward;
+        }
+        update[i] = x;
+    }
+
+    x = x->levels()[0].forward;
+    if (!x || x->score != score || x->member != member)
+        return false;
+    slDelete(x, update);
+    freeNode(x);
+    return true;
+}
+
+ZSet::Node *ZSet::slNodeAt(size_t rank) const {
+    size_t target = rank + 1;
+    size_t traversed = 0;
+    Node *x = header;
+    for (int i = level - 1; i >= 0; --i) {
+        while (x->levels()[i].forward && traversed + x->levels()[i].span <= target) {
+            traversed += x->levels()[i].span;
+            x = x->levels()[i].forward;
+        }
+        if (traversed == target)
+            return x;
+    }
+    return nullptr;
+}
+
+template <typename Before>
+size_t ZSet::slCountWhile(Before before) const {
+    size_t n = 0;
+    const Node *x = header;
+    for (int i = level - 1; i >= 0; --i) {
+        while (x->levels()[i].forward && before(x->levels()[i].forward)) {
+            n += x->levels()[i].span;
+            x = x->levels()[i].forward;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "Listpack.hpp"
+
+/*
+------------------------------------------------------------------------------
+  ZSET (listpack / skiplist + dict)
+------------------------------------------------------------------------------
+
+Members ordered by (score, member), with two encodings:
+
+  compact:  one Listpack of alternating items, kept sorted
+
+                [member_1 score_1 member_2 score_2 ...]
+
+            while there are at most zset-max-listpack-entries members,
+            none longer than zset-max-listpack-value bytes. Every
+            operation is a linear scan, over a few hundred bytes.
+
+  indexed:  a skiplist whose links carry spans (how many members they
+            step over), so a member's rank is the sum of the spans on
+            the path to it and the member at a rank is found the same
+            way, both O(log n); plus a member -> node map for O(1) score
+            lookups. A sorted set never converts back, as in Redis.
+
+Range commands work on ranks: a score or lex bound is first turned into
+the number of members before it (countBelow / countBelowLex), and the
+members between two ranks are then walked in either direction.
+------------------------------------------------------------------------------
+*/
+class ZSet {
+public:
+    // zset-max-listpack-entries / -value, shared by every sorted set.
+    static void SetListpackLimits(size_t max_entries, size_t max_value) {
+        maxListpackEntries = max_entries;
+        maxListpackValue = max_value;
+    }
+
+    ZSet();
+    ZSet(const ZSet &other);
+    ZSet(ZSet &&other) noexcept;
+    ZSet &operator=(ZSet other) noexcept;
+    ~ZSet();
+
+    size_t size() const { return compact ? lp.count() / 2 : length; }
+    bool empty() const { return size() == 0; }
+    bool isCompact() const { return compact; }
+
+    bool score(std::string_view member, double &out) const;
+
+    // 0-based position in ascending order.
+    bool rank(std::string_view member, size_t &out) const;
+
+    // Adds the member or moves it to `score`. True if it is new.
+    bool insert(std::string_view member, double score);
+    bool erase(std::string_view member);
+
+    // Members before a score bound: those with a score below `score`,
+    // or not above it when `inclusive` is false (i.e. the bound is
+    // exclusive and equal scores fall before it).
+    size_t countBelow(double score, bool inclusive) const;
+
+    // Same by member, for sets whose members all share one score.
+    size_t countBelowLex(std::string_view member, bool inclusive) const;
+
+    // Calls fn(member, score) for ranks [from, to), from the top when
+    // `reverse` (to - 1 down to from).
+    template <typename Fn>
+    void range(size_t from, size_t to, bool reverse, Fn &&fn) const;
+
+    // Removes ranks [from, to); returns how many.
+    size_t eraseRange(size_t from, size_t to);
+
+private:
+    static inline size_t maxListpackEntries = 128;
+    static inline size_t maxListpackValue = 64;
+
+    static constexpr int kMaxLevel = 32;
+
+    struct Node;
+    struct Level {
+        Node *forward;
+        size_t span;        // members stepped over by `forward`
+    };
+    struct Node {
+        double score;
+        std::string member;
+        Node *backward;
+        int height;
+
+        // The levels live right behind the node, in the same allocation
+        Level *levels() { return reinterpret_cast<Level *>(this + 1); }
+        const Level *levels() const { return reinterpret_cast<const Level *>(this + 1); }
+    };
+
+    bool compact = true;
+    Listpack lp;
+
+    Node *header = nullptr;
+    Node *tail = nullptr;
+    size_t length = 0;
+    int level = 1;
+    std::unordered_map<std::string_view, Node *> dict;
+
+    // --- compact ---
+    size_t find(std::string_view member) const;
+    static double scoreAt(const Listpack &lp, size_t pos);
+    void insertCompact(std::string_view member, double score);
+    void convertToSkiplist();
+
+    // --- skiplist ---
+    static Node *newNode(int height, double score, std::string_view member);
+    static void freeNode(Node *node);
+    static int randomLevel();
+    void initSkiplist();
+    Node *slInsert(double score, std::string_view member);
+    void slDelete(Node *x, Node **update);
+    bool slErase(double score, std::string_view member);
+    Node *slNodeAt(size_t rank) const;   // 0-based
+
+    // Members for which before(node) holds, which must be a prefix
+    template <typename Before>
+    size_t slCountWhile(Before before) const;
+};
+
+template <typename Fn>
+void ZSet::range(size_t from, size_t to, bool reverse, Fn &&fn) const {
+    to = std::min(to, size());
+    if (from >= to)
+        return;
+
+    if (!compact) {
+        const Node *x = slNodeAt(reverse ? to - 1 : from);
+        for (size_t n = to - from; n > 0 && x; --n) {
+            fn(std::string_view(x->member), x->score);
+            x = reverse ? x->backward : x->levels()[0].forward;
+        }
+        return;
+    }
+
+    char tmp[Listpack::kIntBufSize];
+    size_t pos = lp.seek(static_cast<long long>(2 * (reverse ? to - 1 : from)));
+    for (size_t n = to - from; n > 0; --n) {
+        fn(lp.view(pos, tmp), scoreAt(lp, lp.next(pos)));
+        if (n > 1)
+            pos = reverse ? lp.prev(lp.prev(pos)) : lp.next(lp.next(pos));
+    }
+}
@@ -1,7 +1,17 @@
 #include "server/RedisServer.hpp"
 
-int main() {
-    RedisServer server(6379);
+#include <iostream>
+
+int main(int argc, char** argv) {
+    ServerConfig config;
+    std::string err;
+
+    if (!config.parseArgs(std::vector<std::string>(argv + 1, argv + argc), err)) {
+        std::cerr << "Invalid arguments: " << err << "\n";
+        return 1;
+    }
+
+    RedisServer server(config);
     server.start();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,586 @@
+#include "AppendOnlyFile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../commands/CommandHandler.hpp"
+#include "../protocol/RESPParser.hpp"
+#include "Snapshot.hpp"
+#include "../utils/StringUtils.hpp"
+
+namespace {
+
+// Marks a snapshot preamble: "#SNAPSHOT <len>\r\n" followed by <len> bytes
+// of snapshot data, then regular RESP commands.
+constexpr std::string_view kPreambleTag = "#SNAPSHOT ";
+
+// Redis batches collection elements per rewritten command the same way.
+constexpr size_t kItemsPerCommand = 64;
+
+// Pending rewrite output is written out once it grows past this.
+constexpr size_t kRewriteFlushBytes = 1 << 20;
+
+bool writeAll(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+AppendOnlyFile::~AppendOnlyFile() {
+    close();
+}
+
+bool AppendOnlyFile::parsePolicy(const std::string &name, AppendFsync &out) {
+    if (name == "always")   { out = AppendFsync::ALWAYS;   return true; }
+    if (name == "everysec") { out = AppendFsync::EVERYSEC; return true; }
+    if (name == "no")       { out = AppendFsync::NO;       return true; }
+    return false;
+}
+
+bool AppendOnlyFile::open(const std::string &path, AppendFsync p, std::string &err) {
+    close();
+
+    fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) {
+        err = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    struct stat st{};
+    fileSize = ::fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+    rewriteBaseSize = fileSize;
+    policy = p;
+
+    if (policy == AppendFsync::EVERYSEC) {
+        stopping = false;
+        fsyncThread = std::thread(&AppendOnlyFile::fsyncLoop, this);
+    }
+    return true;
+}
+
+void AppendOnlyFile::close() {
+    if (fd == -1)
+        return;
+
+    flush();
+
+    if (fsyncThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            stopping = true;
+        }
+        cv.notify_one();
+        fsyncThread.join();
+    }
+
+    ::fdatasync(fd);
+    ::close(fd);
+    fd = -1;
+}
+
+void AppendOnlyFile::encodeCommand(std::string &out, const std::vector<std::string> &argv) {
+    out += '*';
+    out += std::to_string(argv.size());
+    out += "\r\n";
+
+    for (const auto &arg : argv) {
+        out += '$';
+        out += std::to_string(arg.size());
+        out += "\r\n";
+        out += arg;
+        out += "\r\n";
+    }
+}
+
+void AppendOnlyFile::feed(const std::vector<std::string> &argv) {
+    if (fd == -1)
+        return;
+
+    size_t before = buf.size();
+    encodeCommand(buf, argv);
+
+    if (rewriting)
+        rewriteBuf.append(buf, before, std::string::npos);
+}
+
+/*
+===============================================================================
+  flush()
+-------------------------------------------------------------------------------
+  One write() per event-loop iteration, no matter how many commands the
+  iteration executed. On a short write the remainder stays in `buf` and
+  is retried on the next iteration.
+===============================================================================
+*/
+bool AppendOnlyFile::flush() {
+    if (fd == -1 || buf.empty())
+        return true;
+
+    size_t written = 0;
+    while (written < buf.size()) {
+        ssize_t n = ::write(fd, buf.data() + written, buf.size() - written);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "AOF write error: " << std::strerror(errno) << "\n";
+            buf.erase(0, written);
+            fileSize += written;
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+
+    fileSize += written;
+    buf.clear();
+
+    switch (policy) {
+        case AppendFsync::ALWAYS:
+            ::fdatasync(fd);
+            break;
+        case AppendFsync::EVERYSEC:
+            fsyncPending = true;
+            break;
+        case AppendFsync::NO:
+            break;
+    }
+    return true;
+}
+
+void AppendOnlyFile::fsyncLoop() {
+    std::unique_lock<std::mutex> lock(mu);
+
+    while (!stopping) {
+        cv.wait_for(lock, std::chrono::seconds(1));
+        if (stopping)
+            break;
+
+        if (fsyncPending.exchange(false))
+            ::fdatasync(fd);
+    }
+}
+
+bool AppendOnlyFile::needsRewrite(unsigned percentage, uint64_t min_size) const {
+    if (fd == -1 || rewriting || percentage == 0 || fileSize < min_size)
+        return false;
+
+    uint64_t base = rewriteBaseSize ? rewriteBaseSize : 1;
+    uint64_t growth = (fileSize - std::min(fileSize, base)) * 100 / base;
+    return growth >= percentage;
+}
+
+void AppendOnlyFile::startRewrite() {
+    rewriting = true;
+    rewriteBuf.clear();
+}
+
+void AppendOnlyFile::abortRewrite() {
+    rewriting = false;
+    rewriteBuf.clear();
+    rewriteBuf.shrink_to_fit();
+}
+
+/*
+===============================================================================
+  finishRewrite()
+-------------------------------------------------------------------------------
+  Called in the parent once the child exited successfully.
+
+    1) Append every command logged since the fork to the child's file
+       and fsync it. The new file now matches the in-memory state.
+    2) rename() it over the live AOF: readers see either the complete
+       old file or the complete new one, never a mix.
+    3) Reopen for appending. Anything still in `buf` was fed after the
+       fork, so it is already part of the tail written in step 1.
+===============================================================================
+*/
+bool AppendOnlyFile::finishRewrite(const std::string &tmp_path,
+                                   const std::string &path,
+                                   std::string &err) {
+    int nfd = ::open(tmp_path.c_str(), O_WRONLY | O_APPEND);
+    if (nfd < 0) {
+        err = "cannot open " + tmp_path + ": " + std::strerror(errno);
+        abortRewrite();
+        return false;
+    }
+
+    if (!writeAll(nfd, rewriteBuf.data(), rewriteBuf.size()) || ::fsync(nfd) != 0) {
+        err = "cannot write rewrite tail: " + std::string(std::strerror(errno));
+        ::close(nfd);
+        abortRewrite();
+        return false;
+    }
+
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        err = "rename " + tmp_path + " failed: " + std::strerror(errno);
+        ::close(nfd);
+        abortRewrite();
+        return false;
+    }
+
+    struct stat st{};
+    ::fstat(nfd, &st);
+
+    {
+        // The everysec thread may be syncing the old descriptor
+        std::lock_guard<std::mutex> lock(mu);
+        if (fd != -1)
+            ::close(fd);
+        fd = nfd;
+    }
+
+    buf.clear();
+    fileSize = static_cast<uint64_t>(st.st_size);
+    rewriteBaseSize = fileSize;
+    abortRewrite();
+    return true;
+}
+
+/*
+===============================================================================
+  writeRewrite()
+-------------------------------------------------------------------------------
+  Emits, per key, the fewest commands that rebuild it:
+
+    STRING  SET key value [PXAT unix_ms]
+    LIST    RPUSH key e1 .. e64, repeated
+    STREAM  XADD key id field value ...   (one per entry)
+            XGROUP CREATE key group last-id MKSTREAM, then per consumer
+            XGROUP CREATECONSUMER and one XCLAIM ... FORCE JUSTID per
+            pending entry; pending IDs no longer in the stream get a
+            placeholder XADD and a final XDEL so the PEL keeps them
+
+  A list pushed and popped a billion times collapses to its current
+  contents. With `snapshot_preamble` the keyspace is written as a
+  snapshot instead, which replays with the parallel loader.
+===============================================================================
+*/
+bool AppendOnlyFile::writeRewrite(RedisStore &store, const std::string &path,
+                                  bool snapshot_preamble, std::string &err) {
+    int wfd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (wfd < 0) {
+        err = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    std::string out;
+    bool ok = true;
+
+    auto drain = [&](bool force) {
+        if (ok && (force || out.size() >= kRewriteFlushBytes)) {
+            ok = writeAll(wfd, out.data(), out.size());
+            out.clear();
+        }
+    };
+
+    if (snapshot_preamble) {
+        std::string snapshot = Snapshot::serialize(store);
+        out += kPreambleTag;
+        out += std::to_string(snapshot.size());
+        out += "\r\n";
+        drain(true);
+        ok = ok && writeAll(wfd, snapshot.data(), snapshot.size());
+    } else {
+        uint64_t now_unix = static_cast<uint64_t>(getUnixTimeMs());
+        std::vector<std::string> argv;
+
+        for (auto &[key, obj] : store.data) {
+            uint64_t expire_at = store.getExpireUnixMs(key);
+            if (expire_at != 0 && expire_at <= now_unix)
+                continue;
+
+            switch (obj.type) {
+                case RedisType::STRING: {
+                    argv = {"SET", key, stringValue(obj)};
+                    if (expire_at != 0) {
+                        argv.push_back("PXAT");
+                        argv.push_back(std::to_string(expire_at));
+                    }
+                    encodeCommand(out, argv);
+                    break;
+                }
+
+                case RedisType::LIST: {
+                    List::RangeIterator it = std::get<List>(obj.value).Range(0, -1);
+                    std::string_view element;
+
+                    while (it.Remaining() > 0) {
+                        argv = {"RPUSH", key};
+                        for (size_t j = 0; j < kItemsPerCommand && it.Next(element); ++j)
+                            argv.emplace_back(element);
+                        encodeCommand(out, argv);
+                    }
+                    break;
+                }
+
+                case RedisType::STREAM: {
+                    const Stream &stream = std::get<Stream>(obj.value);
+                    Stream::Iterator it(stream, StreamID::min(), StreamID::max());
+                    StreamID id;
+                    std::string_view field, value;
+
+                    // Pending entries whose ID was XDEL'd stay in the PEL,
+                    // but XCLAIM ... FORCE only claims IDs that exist. They
+                    // are written as placeholder entries in ID order, claimed
+                    // and then deleted again
+                    std::vector<StreamID> deleted;
+                    for (const auto &[name, group] : stream.groups()) {
+                        for (const auto &[cname, consumer] : group.consumers()) {
+                            for (const auto &[pid, entry] : consumer.pending) {
+                                if (!stream.hasEntry(pid))
+                                    deleted.push_back(pid);
+                            }
+                        }
+                    }
+                    std::sort(deleted.begin(), deleted.end());
+                    deleted.erase(std::unique(deleted.begin(), deleted.end()), deleted.end());
+                    auto placeholder = deleted.begin();
+
+                    StreamID written = StreamID::min();
+
+                    while (it.next(id)) {
+                        for (; placeholder != deleted.end() && *placeholder < id; ++placeholder) {
+                            encodeCommand(out, {"XADD", key, placeholder->toString(), "x", "y"});
+                            written = *placeholder;
+                        }
+                        argv = {"XADD", key, id.toString()};
+                        while (it.nextField(field, value)) {
+                            argv.emplace_back(field);
+                            argv.emplace_back(value);
+                        }
+                        encodeCommand(out, argv);
+                        written = id;
+                    }
+                    for (; placeholder != deleted.end(); ++placeholder) {
+                        encodeCommand(out, {"XADD", key, placeholder->toString(), "x", "y"});
+                        written = *placeholder;
+                    }
+
+                    // Everything deleted: recreate the key empty, the way
+                    // Redis does, then restore the last ID
+                    StreamID last = stream.getLastId();
+                    if (written == StreamID::min() && last != StreamID::min()) {
+                        encodeCommand(out, {"XADD", key, "MAXLEN", "0", last.toString(), "x", "y"});
+                        written = last;
+                    }
+                    if (last != written)
+                        encodeCommand(out, {"XSETID", key, last.toString()});
+
+                    for (const auto &[name, group] : stream.groups()) {
+                        encodeCommand(out, {"XGROUP", "CREATE", key, name,
+                                            group.lastId.toString(), "MKSTREAM"});
+                        for (const auto &[cname, consumer] : group.consumers()) {
+                            encodeCommand(out, {"XGROUP", "CREATECONSUMER", key, name, cname});
+                            for (const auto &[pid, entry] : consumer.pending) {
+                                encodeCommand(out, {"XCLAIM", key, name, cname, "0",
+                                                    pid.toString(),
+                                                    "TIME", std::to_string(entry->deliveryTime),
+                                                    "RETRYCOUNT", std::to_string(entry->deliveryCount),
+                                                    "FORCE", "JUSTID"});
+                            }
+                        }
+                    }
+
+                    if (!deleted.empty()) {
+                        argv = {"XDEL", key};
+                        for (const StreamID &pid : deleted)
+                            argv.push_back(pid.toString());
+                        encodeCommand(out, argv);
+                    }
+                    break;
+                }
+
+                case RedisType::HASH: {
+                    const Hash &hash = std::get<Hash>(obj.value);
+                    argv = {"HSET", key};
+                    hash.forEach([&](std::string_view field, std::string_view value) {
+                        argv.emplace_back(field);
+                        argv.emplace_back(value);
+                        if (argv.size() >= 2 + 2 * kItemsPerCommand) {
+                            encodeCommand(out, argv);
+                            argv.resize(2);
+                        }
+                    });
+                    if (argv.size() > 2)
+                        encodeCommand(out, argv);
+
+                    for (const auto &[when, field] : hash.fieldDeadlines())
+                        encodeCommand(out, {"HPEXPIREAT", key, std::to_string(when),
+                                            "FIELDS", "1", field});
+                    break;
+                }
+
+                case RedisType::SET: {
+                    const Set &set = std::get<Set>(obj.value);
+                    argv = {"SADD", key};
+                    set.forEach([&](std::string_view member) {
+                        argv.emplace_back(member);
+                        if (argv.size() >= 2 + kItemsPerCommand) {
+                            encodeCommand(out, argv);
+                            argv.resize(2);
+                        }
+                    });
+                    if (argv.size() > 2)
+                        encodeCommand(out, argv);
+                    break;
+                }
+
+                case RedisType::ZSET: {
+                    // Shortest round-trip text, so replay restores the exact score
+                    const ZSet &zset = std::get<ZSet>(obj.value);
+                    argv = {"ZADD", key};
+                    zset.range(0, zset.size(), false, [&](std::string_view member, double score) {
+                        argv.push_back(formatDouble(score));
+                        argv.emplace_back(member);
+                        if (argv.size() >= 2 + 2 * kItemsPerCommand) {
+                            encodeCommand(out, argv);
+                            argv.resize(2);
+                        }
+                    });
+                    if (argv.size() > 2)
+                        encodeCommand(out, argv);
+                    break;
+                }
+            }
+            drain(false);
+        }
+    }
+
+    drain(true);
+    ok = ok && ::fsync(wfd) == 0;
+    if (!ok)
+        err = "write to " + path + " failed: " + std::strerror(errno);
+
+    ::close(wfd);
+    return ok;
+}
+
+/*
+===============================================================================
+  replay()
+-------------------------------------------------------------------------------
+  mmaps the log and feeds each command to CommandHandler::execute() with
+  fd -1. The handler must not have this file attached yet, otherwise the
+  replay would log every command a second time.
+===============================================================================
+*/
+bool AppendOnlyFile::replay(const std::string &path, RedisStore &store,
+                            CommandHandler &handler, uint64_t &commands,
+                            std::string &err) {
+    commands = 0;
+
+    int rfd = ::open(path.c_str(), O_RDWR);
+    if (rfd < 0) {
+        err = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    struct stat st{};
+    if (::fstat(rfd, &st) != 0) {
+        err = "cannot stat " + path;
+        ::close(rfd);
+        return false;
+    }
+
+    size_t len = static_cast<size_t>(st.st_size);
+    if (len == 0) {
+        ::close(rfd);
+        return true;
+    }
+
+    void *map = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, rfd, 0);
+    if (map == MAP_FAILED) {
+        err = "mmap " + path + " failed: " + std::strerror(errno);
+        ::close(rfd);
+        return false;
+    }
+    ::madvise(map, len, MADV_SEQUENTIAL);
+
+    std::string_view data(static_cast<const char *>(map), len);
+    size_t pos = 0;
+    bool malformed = false;
+
+    if (data.substr(0, kPreambleTag.size()) == kPreambleTag) {
+        size_t eol = data.find("\r\n");
+        uint64_t snap_len = 0;
+        bool ok = eol != std::string_view::npos;
+
+        if (ok) {
+            try {
+                snap_len = std::stoull(std::string(
+                    data.substr(kPreambleTag.size(), eol - kPreambleTag.size())));
+            } catch (...) {
+                ok = false;
+            }
+        }
+
+        SnapshotLoadStats stats;
+        ok = ok && snap_len <= len - (eol + 2) &&
+             Snapshot::loadFromMemory(store, data.data() + eol + 2, snap_len,
+                                      0, stats, err);
+        if (!ok) {
+            if (err.empty())
+                err = "bad snapshot preamble in " + path;
+            ::munmap(map, len);
+            ::close(rfd);
+            return false;
+        }
+        pos = eol + 2 + snap_len;
+    }
+
+    while (pos < data.size()) {
+        size_t before = pos;
+        auto args = RESPParser::parseNext(data, pos, malformed);
+
+        if (pos == before)
+            break;   // partial or malformed tail
+        if (args.empty())
+            continue;
+
+        ExecResult result = handler.execute(args, -1);
+        if (!result.reply.empty() && result.reply[0] == '-') {
+            std::cerr << "AOF replay: command " << commands
+                      << " failed: " << result.reply;
+        }
+        ++commands;
+    }
+
+    ::munmap(map, len);
+
+    bool ok = true;
+    if (pos < len) {
+        if (malformed) {
+            err = "bad format in " + path + " at offset " + std::to_string(pos);
+            ok = false;
+        } else {
+            std::cerr << "AOF truncated at offset " << pos
+                      << ", dropping incomplete last command\n";
+            if (::ftruncate(rfd, static_cast<off_t>(pos)) != 0) {
+                err = "cannot truncate " + path;
+                ok = false;
+            }
+        }
+    }
+
+    ::close(rfd);
+    return ok;
+}
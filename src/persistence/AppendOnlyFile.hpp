@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+class CommandHandler;
+class RedisStore;
+
+/*
+------------------------------------------------------------------------------
+  APPEND-ONLY FILE
+------------------------------------------------------------------------------
+
+Every write command is logged in RESP form, already rewritten into a
+deterministic shape by CommandHandler (resolved XADD IDs, absolute SET
+expiries, BLPOP wake-ups as LPOP).
+
+Group commit:
+    feed()   appends to an in-memory buffer only.
+    flush()  is called once per event-loop iteration, before any reply
+             is written, and issues a single write() for everything the
+             iteration produced.
+
+fsync policies (appendfsync):
+    ALWAYS    fdatasync() inside flush(); replies leave only after the
+              data is durable.
+    EVERYSEC  a background thread fdatasync()s at most once per second.
+              The event loop never waits on the disk.
+    NO        leave it to the kernel.
+
+Rewrite (BGREWRITEAOF):
+    A forked child writes the smallest command stream that rebuilds the
+    current keyspace (optionally a snapshot preamble instead). Meanwhile
+    the parent keeps logging to the old file AND to a rewrite buffer.
+    When the child is done, the buffer is appended to its file, which
+    then atomically replaces the old one via rename().
+------------------------------------------------------------------------------
+*/
+enum class AppendFsync
+{
+    ALWAYS,
+    EVERYSEC,
+    NO
+};
+
+class AppendOnlyFile
+{
+public:
+    AppendOnlyFile() = default;
+    ~AppendOnlyFile();
+
+    AppendOnlyFile(const AppendOnlyFile &) = delete;
+    AppendOnlyFile &operator=(const AppendOnlyFile &) = delete;
+
+    // Opens (creating if needed) `path` for appending.
+    bool open(const std::string &path, AppendFsync policy, std::string &err);
+    void close();
+    bool isOpen() const { return fd != -1; }
+
+    // Queues one command. Nothing reaches the file before flush().
+    void feed(const std::vector<std::string> &argv);
+
+    // Writes the queued commands with one write() and applies the fsync
+    // policy. Returns false if the write failed (data stays buffered).
+    bool flush();
+
+    // Bytes currently in the file (not counting the unflushed buffer).
+    uint64_t size() const { return fileSize; }
+
+    // Size right after the last rewrite (or at open), the baseline for
+    // auto-aof-rewrite-percentage.
+    uint64_t baseSize() const { return rewriteBaseSize; }
+
+    // True once the file grew by `percentage` % over baseSize() and is
+    // at least `min_size` bytes.
+    bool needsRewrite(unsigned percentage, uint64_t min_size) const;
+
+    // --- rewrite ---
+
+    // From now on feed() also records commands for the new file.
+    void startRewrite();
+
+    // Appends the buffered tail to `tmp_path`, renames it over `path` and
+    // continues appending to the new file.
+    bool finishRewrite(const std::string &tmp_path, const std::string &path,
+                       std::string &err);
+
+    // Drops the rewrite buffer after a failed child.
+    void abortRewrite();
+
+    /**
+     * Writes a minimal command stream (or a snapshot preamble) rebuilding
+     * `store` into `path`. Runs inside the forked child.
+     */
+    static bool writeRewrite(RedisStore &store, const std::string &path,
+                             bool snapshot_preamble, std::string &err);
+
+    static bool parsePolicy(const std::string &name, AppendFsync &out);
+
+    /**
+     * Replays `path` through handler.execute(). A snapshot preamble, if
+     * present, is loaded straight into `store` first. A truncated last
+     * command (crash in the middle of a write) is cut off with a warning.
+     * @param commands Number of commands applied.
+     */
+    static bool replay(const std::string &path, RedisStore &store,
+                       CommandHandler &handler, uint64_t &commands,
+                       std::string &err);
+
+    // RESP encoding of one command, as it is written to the file.
+    static void encodeCommand(std::string &out, const std::vector<std::string> &argv);
+
+private:
+    int fd = -1;
+    AppendFsync policy = AppendFsync::EVERYSEC;
+    uint64_t fileSize = 0;
+    uint64_t rewriteBaseSize = 0;
+    std::string buf;
+
+    bool rewriting = false;
+    std::string rewriteBuf;
+
+    // everysec background fsync
+    std::thread fsyncThread;
+    std::mutex mu;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::atomic<bool> fsyncPending{false};
+
+    void fsyncLoop();
+};
@@ -0,0 +1,770 @@
+#include "Snapshot.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../utils/time.cpp"
+
+namespace {
+
+constexpr char kMagic[8]   = {'R', 'C', 'S', 'N', 'A', 'P', '0', '1'};
+constexpr char kTrailer[8] = {'R', 'C', 'S', 'N', 'A', 'P', 'F', 'T'};
+
+constexpr size_t kIndexEntrySize = 4 * 8;  // offset, length, keys, checksum
+constexpr size_t kTrailerSize    = 3 * 8 + sizeof(kTrailer);
+
+enum : uint8_t {
+    TYPE_STRING = 0,
+    TYPE_LIST   = 1,
+    TYPE_STREAM = 2,
+    TYPE_HASH   = 3,
+    TYPE_SET    = 4,
+    TYPE_ZSET   = 5,
+};
+
+// Version stamped into DUMP payloads; RESTORE refuses newer ones.
+constexpr uint16_t kDumpVersion = 6;
+
+uint8_t typeByte(RedisType type) {
+    switch (type) {
+        case RedisType::STRING: return TYPE_STRING;
+        case RedisType::LIST:   return TYPE_LIST;
+        case RedisType::STREAM: return TYPE_STREAM;
+        case RedisType::HASH:   return TYPE_HASH;
+        case RedisType::SET:    return TYPE_SET;
+        case RedisType::ZSET:   return TYPE_ZSET;
+    }
+    return TYPE_STRING;
+}
+
+bool typeFromByte(uint8_t byte, RedisType &out) {
+    switch (byte) {
+        case TYPE_STRING: out = RedisType::STRING; return true;
+        case TYPE_LIST:   out = RedisType::LIST;   return true;
+        case TYPE_STREAM: out = RedisType::STREAM; return true;
+        case TYPE_HASH:   out = RedisType::HASH;   return true;
+        case TYPE_SET:    out = RedisType::SET;    return true;
+        case TYPE_ZSET:   out = RedisType::ZSET;   return true;
+        default: return false;
+    }
+}
+
+// ---------------------------------------------------------------------
+// Primitive encoders
+// ---------------------------------------------------------------------
+void putVarint(std::string &out, uint64_t v) {
+    while (v >= 0x80) {
+        out += static_cast<char>((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    out += static_cast<char>(v);
+}
+
+void putFixed64(std::string &out, uint64_t v) {
+    for (int i = 0; i < 8; ++i)
+        out += static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+void putString(std::string &out, std::string_view s) {
+    putVarint(out, s.size());
+    out.append(s.data(), s.size());
+}
+
+bool getVarint(const char *&p, const char *end, uint64_t &v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*p++);
+        v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+uint64_t getFixed64(const char *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i)
+        v |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    return v;
+}
+
+bool getString(const char *&p, const char *end, std::string &out) {
+    uint64_t len;
+    if (!getVarint(p, end, len) || len > static_cast<uint64_t>(end - p))
+        return false;
+    out.assign(p, len);
+    p += len;
+    return true;
+}
+
+// Consumer groups of a stream payload (see encodeObject).
+bool decodeGroups(const char *&p, const char *end, Stream &stream) {
+    uint64_t ngroups;
+    if (!getVarint(p, end, ngroups))
+        return false;
+
+    for (uint64_t g = 0; g < ngroups; ++g) {
+        std::string name;
+        StreamID last;
+        uint64_t nconsumers;
+        if (!getString(p, end, name) || !getVarint(p, end, last.ms) ||
+            !getVarint(p, end, last.seq) || !getVarint(p, end, nconsumers))
+            return false;
+
+        StreamGroup *group = stream.createGroup(name, last);
+        if (!group)
+            return false;
+
+        for (uint64_t c = 0; c < nconsumers; ++c) {
+            std::string cname;
+            uint64_t seen, npending;
+            if (!getString(p, end, cname) || !getVarint(p, end, seen) ||
+                !getVarint(p, end, npending))
+                return false;
+
+            bool created;
+            StreamConsumer &consumer = group->consumer(cname, created);
+            consumer.seenTime = seen;
+            for (uint64_t i = 0; i < npending; ++i) {
+                StreamID id;
+                uint64_t delivery_time, delivery_count;
+                if (!getVarint(p, end, id.ms) || !getVarint(p, end, id.seq) ||
+                    !getVarint(p, end, delivery_time) || !getVarint(p, end, delivery_count))
+                    return false;
+                group->addPending(id, consumer, delivery_time);
+                group->findPending(id)->deliveryCount = delivery_count;
+            }
+        }
+    }
+    return true;
+}
+
+// FNV-1a: cheap enough to verify every chunk inside the decoder threads.
+uint64_t checksum(const char *p, size_t len) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<uint8_t>(p[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+struct ChunkInfo {
+    uint64_t offset;
+    uint64_t length;
+    uint64_t keys;
+    uint64_t sum;
+};
+
+/*
+ * Walks the keyspace and emits finished chunks through `sink`, returning
+ * the footer (index + trailer) that must follow them.
+ */
+template <typename Sink>
+std::string encodeKeyspace(RedisStore &store, size_t chunk_bytes, Sink &&sink) {
+    std::vector<ChunkInfo> index;
+    std::string chunk;
+    uint64_t chunk_keys = 0;
+    uint64_t total_keys = 0;
+    uint64_t offset = sizeof(kMagic);
+
+    chunk.reserve(chunk_bytes + 4096);
+
+    auto flush = [&]() {
+        if (chunk.empty())
+            return;
+        index.push_back({offset, chunk.size(), chunk_keys,
+                         checksum(chunk.data(), chunk.size())});
+        sink(chunk);
+        offset += chunk.size();
+        chunk.clear();
+        chunk_keys = 0;
+    };
+
+    uint64_t now_unix = static_cast<uint64_t>(getUnixTimeMs());
+
+    for (auto &[key, obj] : store.data) {
+        uint64_t expire_at = store.getExpireUnixMs(key);
+        if (expire_at != 0 && expire_at <= now_unix)
+            continue;   // already dead, do not resurrect it on load
+
+        chunk += static_cast<char>(typeByte(obj.type));
+        putString(chunk, key);
+        putVarint(chunk, expire_at);
+        Snapshot::encodeObject(obj, chunk);
+
+        ++chunk_keys;
+        ++total_keys;
+
+        if (chunk.size() >= chunk_bytes)
+            flush();
+    }
+    flush();
+
+    std::string footer;
+    footer.reserve(index.size() * kIndexEntrySize + kTrailerSize);
+    for (const auto &c : index) {
+        putFixed64(footer, c.offset);
+        putFixed64(footer, c.length);
+        putFixed64(footer, c.keys);
+        putFixed64(footer, c.sum);
+    }
+    putFixed64(footer, offset);          // index offset
+    putFixed64(footer, index.size());
+    putFixed64(footer, total_keys);
+    footer.append(kTrailer, sizeof(kTrailer));
+    return footer;
+}
+
+bool writeAll(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/*
+ * One decoder's output: a hash table segment pre-sized from the chunk's
+ * key count, plus the TTLs that go with it.
+ */
+struct Segment {
+    std::unordered_map<std::string, RedisObj> data;
+    std::vector<std::pair<std::string, uint64_t>> expires;
+};
+
+bool decodeChunk(const char *p, const char *end, uint64_t keys,
+                 uint64_t now_unix, Segment &seg) {
+    seg.data.reserve(keys);
+
+    while (p < end) {
+        uint8_t type = static_cast<uint8_t>(*p++);
+
+        std::string key;
+        uint64_t expire_at;
+        if (!getString(p, end, key) || !getVarint(p, end, expire_at))
+            return false;
+
+        RedisObj obj;
+        if (!Snapshot::decodeObject(type, p, end, obj))
+            return false;
+
+        if (expire_at != 0) {
+            if (expire_at <= now_unix)
+                continue;
+            seg.expires.emplace_back(key, expire_at);
+        }
+        seg.data.emplace(std::move(key), std::move(obj));
+    }
+    return true;
+}
+
+} // namespace
+
+/*
+===============================================================================
+  encodeObject() / decodeObject()
+-------------------------------------------------------------------------------
+  Payload encoding for a single value. The type byte lives in the
+  record header and is passed to the decoder, which sets `obj.type`.
+
+    STRING  varint len, bytes
+    LIST    varint count, count x (varint len, bytes)
+    STREAM  varint count, count x (varint ms, varint seq,
+                                   varint nfields, nfields x (field, value)),
+            varint last ms, varint last seq,
+            varint ngroups, ngroups x GROUP
+    HASH    varint count, count x (field, value),
+            varint nttl, nttl x (field, varint unix ms)
+    SET     varint count, count x member
+    ZSET    varint count, count x (member, fixed64 IEEE 754 score),
+            in ascending order
+
+    GROUP     name, varint last ms, varint last seq,
+              varint nconsumers, nconsumers x CONSUMER
+    CONSUMER  name, varint seen time, varint npending, npending x
+              (varint ms, varint seq, varint delivery time,
+               varint delivery count)
+
+  Only live entries are written; the last ID is what keeps XADD from
+  reusing the ID of a deleted or trimmed entry after a reload. Pending
+  entries are written under their owner, which rebuilds both PEL
+  indexes on load. Hash fields past their deadline are written like
+  the others and expire on first access after the load.
+===============================================================================
+*/
+void Snapshot::encodeObject(const RedisObj &obj, std::string &out) {
+    switch (obj.type) {
+        case RedisType::STRING:
+            putString(out, stringValue(obj));
+            break;
+
+        case RedisType::LIST: {
+            List::RangeIterator it = std::get<List>(obj.value).Range(0, -1);
+            putVarint(out, it.Remaining());
+            std::string_view e;
+            while (it.Next(e))
+                putString(out, e);
+            break;
+        }
+
+        case RedisType::STREAM: {
+            const Stream &stream = std::get<Stream>(obj.value);
+            putVarint(out, stream.length());
+
+            Stream::Iterator it(stream, StreamID::min(), StreamID::max());
+            StreamID id;
+            std::string_view field, value;
+            while (it.next(id)) {
+                putVarint(out, id.ms);
+                putVarint(out, id.seq);
+                putVarint(out, it.fieldCount());
+                while (it.nextField(field, value)) {
+                    putString(out, field);
+                    putString(out, value);
+                }
+            }
+            putVarint(out, stream.getLastId().ms);
+            putVarint(out, stream.getLastId().seq);
+
+            putVarint(out, stream.groups().size());
+            for (const auto &[name, group] : stream.groups()) {
+                putString(out, name);
+                putVarint(out, group.lastId.ms);
+                putVarint(out, group.lastId.seq);
+                putVarint(out, group.consumers().size());
+                for (const auto &[cname, consumer] : group.consumers()) {
+                    putString(out, cname);
+                    putVarint(out, consumer.seenTime);
+                    putVarint(out, consumer.pending.size());
+                    for (const auto &[pid, entry] : consumer.pending) {
+                        putVarint(out, pid.ms);
+                        putVarint(out, pid.seq);
+                        putVarint(out, entry->deliveryTime);
+                        putVarint(out, entry->deliveryCount);
+                    }
+                }
+            }
+            break;
+        }
+
+        case RedisType::HASH: {
+            const Hash &hash = std::get<Hash>(obj.value);
+            putVarint(out, hash.size());
+            hash.forEach([&](std::string_view field, std::string_view value) {
+                putString(out, field);
+                putString(out, value);
+            });
+
+            putVarint(out, hash.fieldDeadlines().size());
+            for (const auto &[when, field] : hash.fieldDeadlines()) {
+                putString(out, field);
+                putVarint(out, when);
+            }
+            break;
+        }
+
+        case RedisType::SET: {
+            const Set &set = std::get<Set>(obj.value);
+            putVarint(out, set.size());
+            set.forEach([&](std::string_view member) { putString(out, member); });
+            break;
+        }
+
+        case RedisType::ZSET: {
+            const ZSet &zset = std::get<ZSet>(obj.value);
+            putVarint(out, zset.size());
+            zset.range(0, zset.size(), false, [&](std::string_view member, double score) {
+                uint64_t bits;
+                std::memcpy(&bits, &score, sizeof(bits));
+                putString(out, member);
+                putFixed64(out, bits);
+            });
+            break;
+        }
+    }
+}
+
+bool Snapshot::decodeObject(uint8_t type, const char *&p, const char *end, RedisObj &out) {
+    if (!typeFromByte(type, out.type))
+        return false;
+
+    switch (out.type) {
+        case RedisType::STRING: {
+            std::string value;
+            if (!getString(p, end, value))
+                return false;
+            assignString(out, value);
+            return true;
+        }
+
+        case RedisType::LIST: {
+            uint64_t count;
+            if (!getVarint(p, end, count))
+                return false;
+
+            List list;
+            std::string element;
+            for (uint64_t i = 0; i < count; ++i) {
+                if (!getString(p, end, element))
+                    return false;
+                list.PushBack(std::move(element));
+            }
+            out.value = std::move(list);
+            return true;
+        }
+
+        case RedisType::STREAM: {
+            uint64_t count;
+            if (!getVarint(p, end, count))
+                return false;
+
+            Stream stream;
+            for (uint64_t i = 0; i < count; ++i) {
+                StreamID id;
+                uint64_t nfields;
+                if (!getVarint(p, end, id.ms) || !getVarint(p, end, id.seq) ||
+                    !getVarint(p, end, nfields))
+                    return false;
+
+                StreamFields fields(nfields);
+                for (auto &[field, value] : fields) {
+                    if (!getString(p, end, field) || !getString(p, end, value))
+                        return false;
+                }
+                stream.addStream(id, std::move(fields));
+            }
+
+            StreamID last;
+            std::string err;
+            if (!getVarint(p, end, last.ms) || !getVarint(p, end, last.seq) ||
+                !stream.setLastId(last, err) || !decodeGroups(p, end, stream))
+                return false;
+            out.value = std::move(stream);
+            return true;
+        }
+
+        case RedisType::HASH: {
+            uint64_t count;
+            if (!getVarint(p, end, count))
+                return false;
+
+            Hash hash;
+            std::string field, value;
+            for (uint64_t i = 0; i < count; ++i) {
+                if (!getString(p, end, field) || !getString(p, end, value))
+                    return false;
+                hash.set(field, value);
+            }
+
+            uint64_t nttl, when;
+            if (!getVarint(p, end, nttl))
+                return false;
+            for (uint64_t i = 0; i < nttl; ++i) {
+                if (!getString(p, end, field) || !getVarint(p, end, when) ||
+                    hash.expireField(field, when, Hash::ExpireCondition::NONE, 0) != 1)
+                    return false;
+            }
+            out.value = std::move(hash);
+            return true;
+        }
+
+        case RedisType::SET: {
+            uint64_t count;
+            if (!getVarint(p, end, count))
+                return false;
+
+            Set set;
+            std::string member;
+            for (uint64_t i = 0; i < count; ++i) {
+                if (!getString(p, end, member))
+                    return false;
+                set.add(member);
+            }
+            out.value = std::move(set);
+            return true;
+        }
+
+        case RedisType::ZSET: {
+            uint64_t count;
+            if (!getVarint(p, end, count))
+                return false;
+
+            ZSet zset;
+            std::string member;
+            for (uint64_t i = 0; i < count; ++i) {
+                if (!getString(p, end, member) || end - p < 8)
+                    return false;
+                uint64_t bits = getFixed64(p);
+                p += 8;
+                double score;
+                std::memcpy(&score, &bits, sizeof(score));
+                if (std::isnan(score))
+                    return false;
+                zset.insert(member, score);
+            }
+            out.value = std::move(zset);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+===============================================================================
+  dump() / restore()
+-------------------------------------------------------------------------------
+  Self-contained payload for DUMP / RESTORE / MIGRATE:
+
+    u8      type
+    ...     encodeObject() payload
+    u16     format version (little-endian)
+    u64     FNV-1a checksum of everything before it
+
+  The checksum guards against payloads mangled in transit or typed by
+  hand; the version lets an older node refuse data it cannot decode.
+===============================================================================
+*/
+std::string Snapshot::dump(const RedisObj &obj) {
+    std::string out;
+    out += static_cast<char>(typeByte(obj.type));
+    encodeObject(obj, out);
+    out += static_cast<char>(kDumpVersion & 0xFF);
+    out += static_cast<char>(kDumpVersion >> 8);
+    putFixed64(out, checksum(out.data(), out.size()));
+    return out;
+}
+
+bool Snapshot::restore(std::string_view payload, RedisObj &out) {
+    if (payload.size() < 1 + 2 + 8)
+        return false;
+
+    size_t body = payload.size() - 8;
+    if (getFixed64(payload.data() + body) != checksum(payload.data(), body))
+        return false;
+
+    uint16_t version = static_cast<uint8_t>(payload[body - 2]) |
+                       (static_cast<uint16_t>(static_cast<uint8_t>(payload[body - 1])) << 8);
+    if (version > kDumpVersion)
+        return false;
+
+    const char *p = payload.data() + 1;
+    const char *end = payload.data() + body - 2;
+    return decodeObject(static_cast<uint8_t>(payload[0]), p, end, out) && p == end;
+}
+
+/*
+===============================================================================
+  save()
+-------------------------------------------------------------------------------
+  Streams chunks straight to "<path>.tmp", appends the footer, fsyncs and
+  renames over `path`. A crash mid-save leaves the previous snapshot
+  untouched.
+===============================================================================
+*/
+bool Snapshot::save(RedisStore &store, const std::string &path,
+                    std::string &err, size_t chunk_bytes) {
+    std::string tmp = path + ".tmp";
+
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        err = "cannot open " + tmp + ": " + std::strerror(errno);
+        return false;
+    }
+
+    bool ok = writeAll(fd, kMagic, sizeof(kMagic));
+
+    std::string footer = encodeKeyspace(store, chunk_bytes,
+        [&](const std::string &chunk) {
+            ok = ok && writeAll(fd, chunk.data(), chunk.size());
+        });
+
+    ok = ok && writeAll(fd, footer.data(), footer.size());
+    ok = ok && ::fsync(fd) == 0;
+
+    if (!ok)
+        err = "write to " + tmp + " failed: " + std::strerror(errno);
+
+    ::close(fd);
+
+    if (ok && std::rename(tmp.c_str(), path.c_str()) != 0) {
+        err = "rename " + tmp + " failed: " + std::strerror(errno);
+        ok = false;
+    }
+
+    if (!ok)
+        ::unlink(tmp.c_str());
+    return ok;
+}
+
+std::string Snapshot::serialize(RedisStore &store, size_t chunk_bytes) {
+    std::string out(kMagic, sizeof(kMagic));
+    std::string footer = encodeKeyspace(store, chunk_bytes,
+        [&](const std::string &chunk) { out += chunk; });
+    out += footer;
+    return out;
+}
+
+/*
+===============================================================================
+  load()
+-------------------------------------------------------------------------------
+  mmaps the file and hands it to loadFromMemory(). The mapping is
+  MAP_PRIVATE + MADV_WILLNEED so the kernel starts read-ahead for every
+  chunk while the decoder threads spin up.
+===============================================================================
+*/
+bool Snapshot::load(RedisStore &store, const std::string &path,
+                    unsigned threads, SnapshotLoadStats &stats,
+                    std::string &err) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        err = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        err = "cannot stat " + path + " or file is empty";
+        ::close(fd);
+        return false;
+    }
+
+    size_t len = static_cast<size_t>(st.st_size);
+    void *map = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (map == MAP_FAILED) {
+        err = "mmap " + path + " failed: " + std::strerror(errno);
+        return false;
+    }
+    ::madvise(map, len, MADV_WILLNEED);
+
+    bool ok = loadFromMemory(store, static_cast<const char *>(map), len,
+                             threads, stats, err);
+    ::munmap(map, len);
+    return ok;
+}
+
+/*
+===============================================================================
+  loadFromMemory()
+-------------------------------------------------------------------------------
+  1) Validate header + trailer and read the chunk index.
+  2) Worker threads pull chunk numbers from an atomic counter, verify the
+     checksum and decode into their own pre-sized Segment.
+  3) The caller's thread splices every segment into `store.data` with
+     unordered_map::merge (node relinking, no object copies).
+===============================================================================
+*/
+bool Snapshot::loadFromMemory(RedisStore &store, const char *data, size_t len,
+                              unsigned threads, SnapshotLoadStats &stats,
+                              std::string &err) {
+    auto started = std::chrono::steady_clock::now();
+
+    if (len < sizeof(kMagic) + kTrailerSize ||
+        std::memcmp(data, kMagic, sizeof(kMagic)) != 0 ||
+        std::memcmp(data + len - sizeof(kTrailer), kTrailer, sizeof(kTrailer)) != 0) {
+        err = "not a snapshot file (bad magic)";
+        return false;
+    }
+
+    const char *trailer = data + len - kTrailerSize;
+    uint64_t index_offset = getFixed64(trailer);
+    uint64_t chunk_count  = getFixed64(trailer + 8);
+    uint64_t total_keys   = getFixed64(trailer + 16);
+
+    if (index_offset > len - kTrailerSize ||
+        (len - kTrailerSize - index_offset) / kIndexEntrySize != chunk_count) {
+        err = "corrupt snapshot index";
+        return false;
+    }
+
+    std::vector<ChunkInfo> index(chunk_count);
+    for (uint64_t i = 0; i < chunk_count; ++i) {
+        const char *e = data + index_offset + i * kIndexEntrySize;
+        index[i] = {getFixed64(e), getFixed64(e + 8),
+                    getFixed64(e + 16), getFixed64(e + 24)};
+
+        if (index[i].offset < sizeof(kMagic) ||
+            index[i].offset > index_offset ||
+            index[i].length > index_offset - index[i].offset) {
+            err = "corrupt snapshot index";
+            return false;
+        }
+    }
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    if (threads > chunk_count)
+        threads = static_cast<unsigned>(std::max<uint64_t>(1, chunk_count));
+
+    std::vector<Segment> segments(chunk_count);
+    std::atomic<uint64_t> next{0};
+    std::atomic<bool> failed{false};
+    std::mutex err_mu;
+    uint64_t now_unix = static_cast<uint64_t>(getUnixTimeMs());
+
+    auto worker = [&]() {
+        for (uint64_t i = next++; i < chunk_count && !failed; i = next++) {
+            const ChunkInfo &c = index[i];
+            const char *p = data + c.offset;
+
+            bool ok = checksum(p, c.length) == c.sum &&
+                      decodeChunk(p, p + c.length, c.keys, now_unix, segments[i]);
+            if (!ok) {
+                std::lock_guard<std::mutex> lock(err_mu);
+                if (!failed.exchange(true))
+                    err = "corrupt snapshot chunk " + std::to_string(i);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t)
+        pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool)
+        t.join();
+
+    if (failed)
+        return false;
+
+    stats.keys = 0;
+    store.data.reserve(store.data.size() + total_keys);
+    for (auto &seg : segments) {
+        stats.keys += seg.data.size();
+        store.data.merge(seg.data);
+        for (auto &[key, expire_at] : seg.expires)
+            store.setExpireUnixMs(key, expire_at);
+    }
+    if (store.slotIndexEnabled())
+        store.rebuildSlotIndex();
+
+    stats.bytes = len;
+    stats.chunks = chunk_count;
+    stats.threads = threads;
+    stats.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - started).count();
+    return true;
+}
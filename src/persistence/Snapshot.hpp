@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "../db/RedisStore.hpp"
+
+/*
+------------------------------------------------------------------------------
+  SNAPSHOT FILE FORMAT
+------------------------------------------------------------------------------
+
+  +-----------------+
+  | "RCSNAP01"      |  8-byte magic + version
+  +-----------------+
+  | chunk 0         |  records, independently decodable
+  | chunk 1         |
+  | ...             |
+  +-----------------+
+  | index           |  per chunk: offset, length, key count, checksum
+  +-----------------+
+  | trailer         |  index offset, chunk count, total keys, "RCSNAPFT"
+  +-----------------+
+
+Record layout (varint = LEB128, little-endian groups of 7 bits):
+
+    u8      type        (0 = string, 1 = list, 2/3/4 = stream without last ID /
+                         with last ID / with groups, 5 = hash, 6 = set,
+                         7 = sorted set)
+    varint  key length, key bytes
+    varint  absolute expiry in Unix ms (0 = no TTL)
+    ...     type specific payload (see encodeObject)
+
+Because the index sits at the end of the file, the loader can mmap the
+file, read the trailer, and hand every chunk to a different thread
+without scanning anything first. Each chunk carries its own key count,
+so decoders can pre-size their hash table segment exactly.
+------------------------------------------------------------------------------
+*/
+
+struct SnapshotLoadStats
+{
+    uint64_t keys = 0;
+    uint64_t bytes = 0;
+    uint64_t chunks = 0;
+    unsigned threads = 0;
+    double seconds = 0.0;
+
+    double keysPerSec() const { return seconds > 0.0 ? keys / seconds : 0.0; }
+    double mbPerSec() const
+    {
+        return seconds > 0.0 ? (bytes / (1024.0 * 1024.0)) / seconds : 0.0;
+    }
+};
+
+class Snapshot
+{
+public:
+    // Target uncompressed size of one chunk. Big enough to amortize the
+    // index entry, small enough that 20 GB still splits into thousands of
+    // chunks for the decoder threads to share.
+    static constexpr size_t kDefaultChunkBytes = 4 * 1024 * 1024;
+
+    // Writes every live key to `path` atomically (temp file + rename).
+    static bool save(RedisStore &store, const std::string &path,
+                     std::string &err,
+                     size_t chunk_bytes = kDefaultChunkBytes);
+
+    // Same format, produced in memory (used for full resynchronization).
+    static std::string serialize(RedisStore &store,
+                                 size_t chunk_bytes = kDefaultChunkBytes);
+
+    // mmaps `path` and decodes its chunks on `threads` threads
+    // (0 = hardware concurrency). Keys are merged into `store`.
+    static bool load(RedisStore &store, const std::string &path,
+                     unsigned threads, SnapshotLoadStats &stats,
+                     std::string &err);
+
+    // Same as load() but for a snapshot already in memory.
+    static bool loadFromMemory(RedisStore &store, const char *data, size_t len,
+                               unsigned threads, SnapshotLoadStats &stats,
+                               std::string &err);
+
+    // Encodes/decodes one object payload (no key, no expiry).
+    static void encodeObject(const RedisObj &obj, std::string &out);
+    static bool decodeObject(uint8_t type, const char *&p, const char *end, RedisObj &out);
+
+    // Versioned, checksummed single-value payload (DUMP / RESTORE).
+    static std::string dump(const RedisObj &obj);
+    static bool restore(std::string_view payload, RedisObj &out);
+};
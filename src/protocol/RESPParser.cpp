@@ -56,3 +56,88 @@ std::vector<std::string_view> RESPParser::parse(const std::string& data) {
 
     return values;
 }
+
+namespace {
+
+// Reads "<digits>\r\n" at `pos`. Returns -1 if incomplete, -2 if malformed.
+long long readLength(std::string_view s, size_t& pos) {
+    long long num = 0;
+    size_t i = pos;
+
+    if (i >= s.size())
+        return -1;
+
+    while (i < s.size() && s[i] != '\r') {
+        if (s[i] < '0' || s[i] > '9' || num > (1LL << 40))
+            return -2;
+        num = num * 10 + (s[i] - '0');
+        ++i;
+    }
+
+    if (i + 1 >= s.size())
+        return -1;
+    if (i == pos || s[i + 1] != '\n')
+        return -2;
+
+    pos = i + 2;
+    return num;
+}
+
+} // namespace
+
+std::vector<std::string_view> RESPParser::parseNext(std::string_view data,
+                                                    size_t& pos,
+                                                    bool& malformed) {
+    malformed = false;
+
+    size_t p = pos;
+    if (p >= data.size())
+        return {};
+
+    if (data[p] != '*') {
+        malformed = true;
+        return {};
+    }
+    ++p;
+
+    long long count = readLength(data, p);
+    if (count < 0) {
+        malformed = count == -2;
+        return {};
+    }
+
+    std::vector<std::string_view> values;
+    values.reserve(count);
+
+    for (long long i = 0; i < count; ++i) {
+        if (p >= data.size())
+            return {};
+
+        if (data[p] != '$') {
+            malformed = true;
+            return {};
+        }
+        ++p;
+
+        long long len = readLength(data, p);
+        if (len < 0) {
+            malformed = len == -2;
+            return {};
+        }
+
+        if (p + len + 2 > data.size())
+            return {};
+
+        values.emplace_back(data.data() + p, len);
+        p += len;
+
+        if (data[p] != '\r' || data[p + 1] != '\n') {
+            malformed = true;
+            return {};
+        }
+        p += 2;
+    }
+
+    pos = p;
+    return values;
+}
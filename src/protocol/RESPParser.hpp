@@ -8,4 +8,14 @@ public:
     static int parseInteger(const std::string& s, int& pos);
     static void skipCRLF(const std::string& s, int& pos);
     static std::vector<std::string_view> parse(const std::string& data);
-};
\ No newline at end of file
+
+    /**
+     * Parses the command that starts at `pos` and advances `pos` past it.
+     * Returns an empty vector and leaves `pos` untouched when `data` only
+     * holds part of a command, so callers can keep the tail buffered.
+     * `malformed` is set when the bytes can never become a valid command.
+     */
+    static std::vector<std::string_view> parseNext(std::string_view data,
+                                                   size_t& pos,
+                                                   bool& malformed);
+};
@@ -0,0 +1,52 @@
+#include "ReplicationBacklog.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+ReplicationBacklog::ReplicationBacklog(size_t capacity)
+    : buf(std::max<size_t>(capacity, 16)) {}
+
+void ReplicationBacklog::reset(uint64_t master_offset) {
+    idx = 0;
+    histlen = 0;
+    offset = master_offset;
+    start = master_offset + 1;
+}
+
+void ReplicationBacklog::feed(std::string_view data) {
+    offset += data.size();
+
+    // Only the tail that fits can ever be served
+    if (data.size() > buf.size())
+        data.remove_prefix(data.size() - buf.size());
+
+    while (!data.empty()) {
+        size_t n = std::min(buf.size() - idx, data.size());
+        std::memcpy(buf.data() + idx, data.data(), n);
+
+        idx = (idx + n) % buf.size();
+        histlen = std::min(buf.size(), histlen + n);
+        data.remove_prefix(n);
+    }
+
+    start = offset - histlen + 1;
+}
+
+bool ReplicationBacklog::copyFrom(uint64_t psync_offset, std::string &out) const {
+    if (psync_offset < start || psync_offset > offset + 1)
+        return false;
+
+    size_t skip = static_cast<size_t>(psync_offset - start);
+    size_t len = histlen - skip;
+
+    // Oldest byte sits right after the write position once the ring wrapped
+    size_t first = (idx + buf.size() - histlen + skip) % buf.size();
+
+    out.clear();
+    out.reserve(len);
+
+    size_t n = std::min(len, buf.size() - first);
+    out.append(buf.data() + first, n);
+    out.append(buf.data(), len - n);
+    return true;
+}
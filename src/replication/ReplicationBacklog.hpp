@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+------------------------------------------------------------------------------
+  REPLICATION BACKLOG
+------------------------------------------------------------------------------
+
+Fixed-size circular buffer holding the most recent bytes of the
+replication stream. Offsets follow Redis conventions:
+
+    master offset   total number of bytes ever produced
+    start offset    offset of the oldest byte still held, 1-based
+                    (the very first byte of the stream has offset 1)
+
+A replica that lost its link sends "PSYNC <replid> <its offset + 1>".
+As long as that offset is still inside [start, start + histlen] the
+master answers +CONTINUE and streams the missing bytes from here,
+instead of shipping a full snapshot again.
+------------------------------------------------------------------------------
+*/
+class ReplicationBacklog
+{
+public:
+    explicit ReplicationBacklog(size_t capacity = 1024 * 1024);
+
+    // Drops the history and restarts at `master_offset`.
+    void reset(uint64_t master_offset);
+
+    // Appends stream bytes; the oldest ones fall off once full.
+    void feed(std::string_view data);
+
+    // Copies everything from `psync_offset` up to the newest byte.
+    // Returns false if that offset is no longer (or not yet) available.
+    bool copyFrom(uint64_t psync_offset, std::string &out) const;
+
+    uint64_t startOffset() const { return start; }
+    uint64_t masterOffset() const { return offset; }
+    size_t historyLength() const { return histlen; }
+    size_t capacity() const { return buf.size(); }
+
+private:
+    std::vector<char> buf;
+    size_t idx = 0;        // next write position
+    size_t histlen = 0;    // valid bytes in buf
+    uint64_t offset = 0;   // master offset after the newest byte
+    uint64_t start = 1;    // offset of the oldest byte held
+};
@@ -0,0 +1,667 @@
+#include "ReplicationManager.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <iostream>
+#include <netdb.h>
+#include <random>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../commands/CommandHandler.hpp"
+#include "../db/RedisStore.hpp"
+#include "../persistence/AppendOnlyFile.hpp"
+#include "../persistence/Snapshot.hpp"
+#include "../protocol/RESPParser.hpp"
+#include "../server/ServerConfig.hpp"
+#include "../utils/StringUtils.hpp"
+#include "../utils/time.cpp"
+
+namespace {
+
+// Handshake steps that never complete are retried from scratch.
+constexpr uint64_t kHandshakeTimeoutMs = 60000;
+constexpr uint64_t kReconnectDelayMs = 1000;
+constexpr uint64_t kAckPeriodMs = 1000;
+
+
+std::string peerIp(int fd) {
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    char buf[INET_ADDRSTRLEN] = "?";
+    if (::getpeername(fd, reinterpret_cast<sockaddr *>(&addr), &len) == 0 &&
+        addr.sin_family == AF_INET)
+        ::inet_ntop(AF_INET, &addr.sin_addr, buf, sizeof(buf));
+    return buf;
+}
+
+} // namespace
+
+ReplicationManager::ReplicationManager(RedisStore &str)
+    : store(str),
+      replid(newReplicationId()) {}
+
+ReplicationManager::~ReplicationManager() {
+    if (linkFd != -1)
+        ::close(linkFd);
+}
+
+void ReplicationManager::configure(const ServerConfig &cfg) {
+    backlog = ReplicationBacklog(cfg.replBacklogSize);
+    listeningPort = cfg.port;
+
+    if (!cfg.replicaofHost.empty())
+        replicaOf(cfg.replicaofHost, cfg.replicaofPort);
+}
+
+void ReplicationManager::setSender(Sender send_fn, Closer close_fn) {
+    send = std::move(send_fn);
+    closeClient = std::move(close_fn);
+}
+
+std::string ReplicationManager::newReplicationId() {
+    static const char hex[] = "0123456789abcdef";
+    std::random_device rd;
+    std::mt19937_64 gen((static_cast<uint64_t>(rd()) << 32) ^ rd());
+
+    std::string id(40, '0');
+    for (char &c : id)
+        c = hex[gen() & 15];
+    return id;
+}
+
+/* ========================================================================== */
+/*                                MASTER SIDE                                 */
+/* ========================================================================== */
+
+/* =====================================================================
+   feed()
+   ---------------------------------------------------------------------
+   A replica does not re-encode what it executes: the master stream is
+   proxied byte for byte in processMasterData(), so every node of a
+   chain agrees on offsets.
+   ===================================================================== */
+void ReplicationManager::feed(const std::vector<std::string> &argv) {
+    if (isReplica())
+        return;
+
+    std::string encoded;
+    AppendOnlyFile::encodeCommand(encoded, argv);
+    feedRaw(encoded);
+    writeOffset = offset();
+}
+
+void ReplicationManager::feedRaw(std::string_view data) {
+    backlog.feed(data);
+
+    if (!send)
+        return;
+    for (const auto &[fd, replica] : replicas) {
+        if (replica.online)
+            send(fd, data);
+    }
+}
+
+/* =====================================================================
+   psync()
+   ---------------------------------------------------------------------
+   Partial resync is accepted for our current history, or for the
+   previous one (replid2) up to the offset where it ended. Anything
+   else gets a full snapshot, serialized synchronously so it matches
+   the announced offset exactly.
+   ===================================================================== */
+std::string ReplicationManager::psync(int fd, std::string_view req_replid,
+                                      std::string_view req_offset) {
+    if (isReplica() && !masterLinkUp())
+        return "-NOMASTERLINK Can't SYNC while not connected with my master\r\n";
+
+    ReplicaInfo info;
+    info.online = true;
+    info.ip = peerIp(fd);
+    if (auto it = replicas.find(fd); it != replicas.end())
+        info.listeningPort = it->second.listeningPort;
+
+    uint64_t psync_offset = 0;
+    bool known_history =
+        req_replid == replid ||
+        (!replid2.empty() && req_replid == replid2);
+
+    if (known_history && parseU64(req_offset, psync_offset) &&
+        (req_replid == replid || psync_offset <= secondReplidOffset + 1)) {
+        std::string missing;
+        if (backlog.copyFrom(psync_offset, missing)) {
+            info.ackOffset = psync_offset - 1;
+            replicas[fd] = std::move(info);
+
+            std::cout << "Partial resynchronization accepted for replica "
+                      << replicas[fd].ip << ", sending " << missing.size()
+                      << " bytes" << std::endl;
+            return "+CONTINUE " + replid + "\r\n" + missing;
+        }
+    }
+
+    std::string blob = Snapshot::serialize(store);
+
+    std::string reply = "+FULLRESYNC " + replid + " " +
+                        std::to_string(offset()) + "\r\n";
+    reply += "$" + std::to_string(blob.size()) + "\r\n";
+    reply += blob;
+
+    info.ackOffset = offset();
+    replicas[fd] = std::move(info);
+
+    std::cout << "Full resynchronization for replica " << replicas[fd].ip
+              << ": " << blob.size() << " bytes snapshot" << std::endl;
+    return reply;
+}
+
+void ReplicationManager::replconfAck(int fd, uint64_t ack_offset) {
+    auto it = replicas.find(fd);
+    if (it == replicas.end() || !it->second.online)
+        return;
+
+    it->second.ackOffset = std::max(it->second.ackOffset, ack_offset);
+    checkWaiting();
+}
+
+void ReplicationManager::replconfListeningPort(int fd, int port) {
+    // Sent before PSYNC; kept so the entry made by psync() inherits it
+    replicas[fd].listeningPort = port;
+}
+
+size_t ReplicationManager::countAcked(uint64_t target) const {
+    size_t n = 0;
+    for (const auto &[fd, replica] : replicas) {
+        if (replica.online && replica.ackOffset >= target)
+            ++n;
+    }
+    return n;
+}
+
+/* =====================================================================
+   wait()
+   ---------------------------------------------------------------------
+   The target is the offset right after the last write. If not enough
+   replicas are there yet, REPLCONF GETACK asks all of them to report
+   right away instead of waiting for their next periodic ACK. GETACK
+   itself does not move the target, so a replica that answered it is
+   caught up for every later WAIT until the next write.
+   ===================================================================== */
+long long ReplicationManager::wait(int fd, long long numreplicas,
+                                   uint64_t timeout_ms) {
+    uint64_t target = writeOffset;
+    long long acked = static_cast<long long>(countAcked(target));
+
+    if (acked >= numreplicas)
+        return acked;
+
+    std::string getack;
+    AppendOnlyFile::encodeCommand(getack, {"REPLCONF", "GETACK", "*"});
+    feedRaw(getack);
+
+    uint64_t deadline = timeout_ms ? current_time_ms() + timeout_ms : 0;
+    waiting.push_back({fd, target, numreplicas, deadline});
+    waitingFds.insert(fd);
+    return -1;
+}
+
+void ReplicationManager::checkWaiting() {
+    if (waiting.empty())
+        return;
+
+    uint64_t now = current_time_ms();
+
+    for (auto it = waiting.begin(); it != waiting.end();) {
+        long long acked = static_cast<long long>(countAcked(it->targetOffset));
+        bool expired = it->deadline != 0 && now >= it->deadline;
+
+        if (acked >= it->numReplicas || expired) {
+            // Unblocked before the reply goes out, so the sender can
+            // resume the client's pipelined commands
+            waitingFds.erase(it->fd);
+            if (send)
+                send(it->fd, ":" + std::to_string(acked) + "\r\n");
+            it = waiting.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ReplicationManager::onClientDisconnected(int fd) {
+    auto it = replicas.find(fd);
+    if (it != replicas.end()) {
+        if (it->second.online)
+            std::cout << "Connection with replica " << it->second.ip
+                      << " lost" << std::endl;
+        replicas.erase(it);
+    }
+
+    std::erase_if(waiting, [fd](const WaitingClient &w) { return w.fd == fd; });
+    waitingFds.erase(fd);
+}
+
+std::string ReplicationManager::info() const {
+    std::string out = "# Replication\r\n";
+
+    if (isReplica()) {
+        out += "role:slave\r\n";
+        out += "master_host:" + masterHost + "\r\n";
+        out += "master_port:" + std::to_string(masterPort) + "\r\n";
+        out += std::string("master_link_status:") +
+               (masterLinkUp() ? "up" : "down") + "\r\n";
+        out += std::string("master_sync_in_progress:") +
+               (state == State::TRANSFER ? "1" : "0") + "\r\n";
+        out += "slave_repl_offset:" + std::to_string(offset()) + "\r\n";
+    } else {
+        out += "role:master\r\n";
+    }
+
+    size_t online = 0;
+    for (const auto &[fd, replica] : replicas)
+        online += replica.online;
+    out += "connected_slaves:" + std::to_string(online) + "\r\n";
+
+    size_t i = 0;
+    for (const auto &[fd, replica] : replicas) {
+        if (!replica.online)
+            continue;
+        out += "slave" + std::to_string(i++) + ":ip=" + replica.ip +
+               ",port=" + std::to_string(replica.listeningPort) +
+               ",state=online,offset=" + std::to_string(replica.ackOffset) +
+               "\r\n";
+    }
+
+    out += "master_replid:" + replid + "\r\n";
+    out += "master_replid2:" +
+           (replid2.empty() ? std::string(40, '0') : replid2) + "\r\n";
+    out += "master_repl_offset:" + std::to_string(offset()) + "\r\n";
+    out += "second_repl_offset:" +
+           (replid2.empty() ? std::string("-1")
+                            : std::to_string(secondReplidOffset + 1)) + "\r\n";
+    out += "repl_backlog_active:1\r\n";
+    out += "repl_backlog_size:" + std::to_string(backlog.capacity()) + "\r\n";
+    out += "repl_backlog_first_byte_offset:" +
+           std::to_string(backlog.startOffset()) + "\r\n";
+    out += "repl_backlog_histlen:" + std::to_string(backlog.historyLength()) + "\r\n";
+    return out;
+}
+
+/* ========================================================================== */
+/*                                REPLICA SIDE                                */
+/* ========================================================================== */
+
+void ReplicationManager::setState(State s) {
+    state = s;
+    stateSince = current_time_ms();
+}
+
+void ReplicationManager::replicaOf(const std::string &host, int port) {
+    if (host == masterHost && port == masterPort)
+        return;
+
+    dropMasterLink();
+    masterHost = host;
+    masterPort = port;
+    nextConnectAt = 0;
+    setState(State::CONNECT);
+
+    std::cout << "Connecting to MASTER " << host << ":" << port << std::endl;
+}
+
+void ReplicationManager::replicaOfNoOne() {
+    if (!isReplica())
+        return;
+
+    dropMasterLink();
+    masterHost.clear();
+    masterPort = 0;
+    setState(State::NONE);
+
+    // Replicas that followed the old master can still continue from us
+    replid2 = replid;
+    secondReplidOffset = offset();
+    replid = newReplicationId();
+    writeOffset = offset();
+
+    std::cout << "MASTER MODE enabled, new replication ID " << replid << std::endl;
+}
+
+void ReplicationManager::dropMasterLink() {
+    if (linkFd != -1)
+        ::close(linkFd);
+
+    linkFd = -1;
+    linkBuf.clear();
+    transferHeaderRead = false;
+    transferLeft = 0;
+    transferBuf.clear();
+
+    if (isReplica()) {
+        setState(State::CONNECT);
+        nextConnectAt = current_time_ms() + kReconnectDelayMs;
+    }
+}
+
+void ReplicationManager::connectToMaster() {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo *res = nullptr;
+    std::string port = std::to_string(masterPort);
+    if (::getaddrinfo(masterHost.c_str(), port.c_str(), &hints, &res) != 0 || !res) {
+        std::cerr << "Unable to resolve master " << masterHost << "\n";
+        nextConnectAt = current_time_ms() + kReconnectDelayMs;
+        return;
+    }
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        ::freeaddrinfo(res);
+        nextConnectAt = current_time_ms() + kReconnectDelayMs;
+        return;
+    }
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    int rc = ::connect(fd, res->ai_addr, res->ai_addrlen);
+    ::freeaddrinfo(res);
+
+    if (rc == 0) {
+        attachMasterLink(fd);
+    } else if (errno == EINPROGRESS) {
+        linkFd = fd;
+        setState(State::CONNECTING);
+    } else {
+        ::close(fd);
+        nextConnectAt = current_time_ms() + kReconnectDelayMs;
+    }
+}
+
+void ReplicationManager::onMasterWritable() {
+    if (state != State::CONNECTING)
+        return;
+
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (::getsockopt(linkFd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+        std::cerr << "Error connecting to MASTER " << masterHost << ":"
+                  << masterPort << "\n";
+        dropMasterLink();
+        return;
+    }
+
+    int fd = linkFd;
+    attachMasterLink(fd);
+}
+
+void ReplicationManager::attachMasterLink(int fd) {
+    linkFd = fd;
+    linkBuf.clear();
+    setState(State::RECEIVE_PONG);
+    sendToMaster({"PING"});
+}
+
+void ReplicationManager::sendToMaster(const std::vector<std::string> &argv) {
+    if (linkFd == -1)
+        return;
+
+    std::string out;
+    AppendOnlyFile::encodeCommand(out, argv);
+
+    // Handshake steps and ACKs are a few dozen bytes; a full socket buffer
+    // here means the link is dead anyway and the next read will notice.
+    size_t off = 0;
+    while (off < out.size()) {
+        ssize_t n = ::send(linkFd, out.data() + off, out.size() - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        off += static_cast<size_t>(n);
+    }
+}
+
+void ReplicationManager::sendAck() {
+    sendToMaster({"REPLCONF", "ACK", std::to_string(offset())});
+    lastAckAt = current_time_ms();
+}
+
+void ReplicationManager::onMasterReadable(CommandHandler &handler) {
+    char buf[16 * 1024];
+
+    ssize_t n = ::read(linkFd, buf, sizeof(buf));
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return;
+
+    if (n <= 0) {
+        std::cerr << "Connection with master lost\n";
+        dropMasterLink();
+        return;
+    }
+
+    processMasterData(std::string_view(buf, static_cast<size_t>(n)), handler);
+}
+
+/* =====================================================================
+   handleHandshakeLine()
+   ---------------------------------------------------------------------
+   One reply line per handshake step. Errors to REPLCONF are tolerated
+   (older masters do not know every option); an error to PING or PSYNC
+   aborts the attempt.
+   ===================================================================== */
+bool ReplicationManager::handleHandshakeLine(const std::string &line) {
+    switch (state) {
+    case State::RECEIVE_PONG:
+        if (line.empty() || line[0] == '-')
+            return false;
+        setState(State::RECEIVE_PORT);
+        sendToMaster({"REPLCONF", "listening-port", std::to_string(listeningPort)});
+        return true;
+
+    case State::RECEIVE_PORT:
+        setState(State::RECEIVE_CAPA);
+        sendToMaster({"REPLCONF", "capa", "psync2"});
+        return true;
+
+    case State::RECEIVE_CAPA:
+        setState(State::RECEIVE_PSYNC);
+        sendToMaster({"PSYNC", replid, std::to_string(offset() + 1)});
+        return true;
+
+    case State::RECEIVE_PSYNC: {
+        if (line.rfind("+FULLRESYNC ", 0) == 0) {
+            size_t sp = line.find(' ', 12);
+            if (sp == std::string::npos ||
+                !parseU64(std::string_view(line).substr(sp + 1), transferOffset))
+                return false;
+
+            transferReplid = line.substr(12, sp - 12);
+            transferHeaderRead = false;
+            transferBuf.clear();
+            setState(State::TRANSFER);
+            return true;
+        }
+
+        if (line.rfind("+CONTINUE", 0) == 0) {
+            // The master may have switched history (it was promoted)
+            if (line.size() > 10) {
+                std::string new_id = line.substr(10);
+                if (new_id != replid) {
+                    replid2 = replid;
+                    secondReplidOffset = offset();
+                    replid = new_id;
+                }
+            }
+            setState(State::CONNECTED);
+            sendAck();
+            std::cout << "MASTER <-> REPLICA sync: partial resynchronization "
+                         "accepted" << std::endl;
+            return true;
+        }
+        return false;
+    }
+
+    default:
+        return false;
+    }
+}
+
+/* =====================================================================
+   finishTransfer()
+   ---------------------------------------------------------------------
+   The received snapshot replaces the whole dataset. Our history is now
+   the master's, so sub-replicas (which followed the old one) are
+   dropped and will resync against the new data.
+   ===================================================================== */
+bool ReplicationManager::finishTransfer(CommandHandler &handler) {
+    store.clear();
+
+    SnapshotLoadStats stats;
+    std::string err;
+    if (!Snapshot::loadFromMemory(store, transferBuf.data(), transferBuf.size(),
+                                  0, stats, err)) {
+        std::cerr << "MASTER <-> REPLICA sync: failed loading snapshot: "
+                  << err << "\n";
+        return false;
+    }
+
+    replid = transferReplid;
+    replid2.clear();
+    backlog.reset(transferOffset);
+    writeOffset = transferOffset;
+    transferBuf.clear();
+    transferBuf.shrink_to_fit();
+
+    std::vector<int> subreplicas;
+    for (const auto &[fd, replica] : replicas)
+        subreplicas.push_back(fd);
+    for (int fd : subreplicas) {
+        replicas.erase(fd);
+        if (closeClient)
+            closeClient(fd);
+    }
+
+    // The AOF must describe the new dataset, not the old one
+    handler.scheduleAofRewrite();
+
+    setState(State::CONNECTED);
+    sendAck();
+
+    std::cout << "MASTER <-> REPLICA sync: loaded " << stats.keys
+              << " keys, offset " << transferOffset << std::endl;
+    return true;
+}
+
+void ReplicationManager::processMasterData(std::string_view data,
+                                           CommandHandler &handler) {
+    linkBuf.append(data);
+
+    while (true) {
+        if (state >= State::RECEIVE_PONG && state <= State::RECEIVE_PSYNC) {
+            size_t eol = linkBuf.find("\r\n");
+            if (eol == std::string::npos)
+                return;
+
+            std::string line = linkBuf.substr(0, eol);
+            linkBuf.erase(0, eol + 2);
+
+            if (!handleHandshakeLine(line)) {
+                std::cerr << "MASTER <-> REPLICA sync: unexpected reply '"
+                          << line << "'\n";
+                dropMasterLink();
+                return;
+            }
+            continue;
+        }
+
+        if (state == State::TRANSFER) {
+            if (!transferHeaderRead) {
+                size_t eol = linkBuf.find("\r\n");
+                if (eol == std::string::npos)
+                    return;
+
+                std::string_view header(linkBuf.data(), eol);
+                if (header.empty() || header[0] != '$' ||
+                    !parseU64(header.substr(1), transferLeft)) {
+                    dropMasterLink();
+                    return;
+                }
+
+                linkBuf.erase(0, eol + 2);
+                transferHeaderRead = true;
+                transferBuf.reserve(transferLeft);
+            }
+
+            size_t take = static_cast<size_t>(
+                std::min<uint64_t>(transferLeft, linkBuf.size()));
+            transferBuf.append(linkBuf, 0, take);
+            linkBuf.erase(0, take);
+            transferLeft -= take;
+
+            if (transferLeft > 0)
+                return;
+
+            if (!finishTransfer(handler)) {
+                dropMasterLink();
+                return;
+            }
+            continue;
+        }
+
+        if (state != State::CONNECTED)
+            return;
+
+        // Command stream: executed without replies, except GETACK
+        size_t pos = 0;
+        bool malformed = false;
+
+        while (pos < linkBuf.size()) {
+            size_t before = pos;
+            auto args = RESPParser::parseNext(linkBuf, pos, malformed);
+            if (pos == before)
+                break;
+
+            if (!args.empty()) {
+                if (args.size() >= 2 && equalsIgnoreCase(args[0], "REPLCONF") &&
+                    equalsIgnoreCase(args[1], "GETACK")) {
+                    // Reports the offset before this very command
+                    sendAck();
+                } else if (!equalsIgnoreCase(args[0], "PING")) {
+                    handler.execute(args, linkFd);
+                }
+            }
+
+            feedRaw(std::string_view(linkBuf).substr(before, pos - before));
+        }
+
+        linkBuf.erase(0, pos);
+
+        if (malformed) {
+            std::cerr << "Protocol error from MASTER, dropping link\n";
+            dropMasterLink();
+        }
+        return;
+    }
+}
+
+void ReplicationManager::cron() {
+    uint64_t now = current_time_ms();
+
+    if (isReplica()) {
+        if (state == State::CONNECT && now >= nextConnectAt) {
+            connectToMaster();
+        } else if (state >= State::CONNECTING && state <= State::TRANSFER &&
+                   now - stateSince > kHandshakeTimeoutMs) {
+            std::cerr << "Timeout connecting to the MASTER\n";
+            dropMasterLink();
+        } else if (state == State::CONNECTED && now - lastAckAt >= kAckPeriodMs) {
+            sendAck();
+        }
+    }
+
+    checkWaiting();
+}
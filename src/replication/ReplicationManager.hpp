@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ReplicationBacklog.hpp"
+
+class CommandHandler;
+class RedisStore;
+struct ServerConfig;
+
+/*
+------------------------------------------------------------------------------
+  LEADER-FOLLOWER REPLICATION
+------------------------------------------------------------------------------
+
+Master side
+    Every write, after it executed and was rewritten into its deterministic
+    form, is encoded once as RESP and fed to the backlog and to the output
+    buffer of every connected replica (see feed()).
+
+    PSYNC <replid> <offset>
+        +CONTINUE <replid>          the offset is still in the backlog, only
+                                    the missing bytes follow
+        +FULLRESYNC <replid> <off>  followed by "$<len>\r\n<snapshot>" and
+                                    then the live stream from <off>
+
+    REPLCONF ACK <offset> is sent by replicas once per second (and when
+    asked with REPLCONF GETACK). WAIT blocks a client until enough replicas
+    acknowledged the offset its writes reached, or until the timeout.
+
+Replica side
+    REPLICAOF host port starts a non-blocking handshake driven by the event
+    loop:
+
+        PING → REPLCONF listening-port → REPLCONF capa psync2 → PSYNC
+
+    Once in sync the master stream is executed command by command without
+    replies, counted into the replica's own offset, appended to its own
+    backlog and proxied verbatim to its sub-replicas. After a dropped link
+    the replica retries with "PSYNC <replid> <offset + 1>", so a short
+    outage only costs the bytes it missed.
+
+Nothing here touches client sockets directly: output for replicas and for
+clients blocked in WAIT goes through the Sender installed by the event
+loop, which appends to the client's reply buffer.
+------------------------------------------------------------------------------
+*/
+class ReplicationManager
+{
+public:
+    using Sender = std::function<void(int fd, std::string_view data)>;
+    using Closer = std::function<void(int fd)>;
+
+    explicit ReplicationManager(RedisStore &store);
+    ~ReplicationManager();
+
+    ReplicationManager(const ReplicationManager &) = delete;
+    ReplicationManager &operator=(const ReplicationManager &) = delete;
+
+    // Backlog size, announced listening port, --replicaof.
+    void configure(const ServerConfig &cfg);
+
+    // Output path to client reply buffers, and a way to drop a client
+    // (sub-replicas are disconnected when our own history is replaced).
+    void setSender(Sender send_fn, Closer close_fn);
+
+    bool isReplica() const { return !masterHost.empty(); }
+    const std::string &replicationId() const { return replid; }
+    uint64_t offset() const { return backlog.masterOffset(); }
+
+    // ------------------------------------------------------------------
+    // Master side
+    // ------------------------------------------------------------------
+
+    // Appends one executed write command to the replication stream.
+    void feed(const std::vector<std::string> &argv);
+
+    // Answers PSYNC from `fd` and registers it as a replica.
+    std::string psync(int fd, std::string_view req_replid,
+                      std::string_view req_offset);
+
+    void replconfAck(int fd, uint64_t ack_offset);
+    void replconfListeningPort(int fd, int port);
+
+    /**
+     * WAIT numreplicas timeout. Returns the number of replicas that
+     * acknowledged the current offset, or -1 if `fd` is now blocked; its
+     * reply is sent later through the Sender.
+     */
+    long long wait(int fd, long long numreplicas, uint64_t timeout_ms);
+
+    // True while `fd` is blocked in WAIT.
+    bool isWaiting(int fd) const { return waitingFds.count(fd) != 0; }
+
+    // Forgets replicas and WAIT waiters bound to a closed connection.
+    void onClientDisconnected(int fd);
+
+    // "# Replication" section of INFO.
+    std::string info() const;
+
+    // ------------------------------------------------------------------
+    // Replica side
+    // ------------------------------------------------------------------
+
+    // REPLICAOF host port. The link is established by cron().
+    void replicaOf(const std::string &host, int port);
+
+    // REPLICAOF NO ONE: keeps the dataset and the offset, starts a new
+    // history (the old replid stays valid for PSYNC up to that offset).
+    void replicaOfNoOne();
+
+    // Master link socket, or -1. The event loop polls it for reading once
+    // connected and for writing while the connect() is in flight.
+    int masterLinkFd() const { return linkFd; }
+    bool masterLinkConnecting() const { return state == State::CONNECTING; }
+    bool masterLinkUp() const { return state == State::CONNECTED; }
+
+    // Connect completion (socket became writable).
+    void onMasterWritable();
+
+    // Reads from the master link and processes it.
+    void onMasterReadable(CommandHandler &handler);
+
+    // Adopts an already connected socket and starts the handshake. Used by
+    // onMasterWritable(), and by tests over a socketpair.
+    void attachMasterLink(int fd);
+
+    // Parses whatever arrived from the master: handshake replies, the
+    // snapshot payload, then the command stream.
+    void processMasterData(std::string_view data, CommandHandler &handler);
+
+    // Once per event-loop iteration: reconnects, sends ACKs, expires WAITs.
+    void cron();
+
+private:
+    enum class State
+    {
+        NONE,           // master, or replica with no link wanted
+        CONNECT,        // must (re)connect
+        CONNECTING,     // non-blocking connect() in flight
+        RECEIVE_PONG,
+        RECEIVE_PORT,
+        RECEIVE_CAPA,
+        RECEIVE_PSYNC,
+        TRANSFER,       // reading the snapshot payload
+        CONNECTED
+    };
+
+    struct ReplicaInfo
+    {
+        bool online = false;    // false until PSYNC was answered
+        uint64_t ackOffset = 0;
+        int listeningPort = 0;
+        std::string ip;
+    };
+
+    struct WaitingClient
+    {
+        int fd;
+        uint64_t targetOffset;
+        long long numReplicas;
+        uint64_t deadline;      // steady ms, 0 = forever
+    };
+
+    RedisStore &store;
+    Sender send;
+    Closer closeClient;
+
+    std::string replid;
+    std::string replid2;             // previous history after a promotion
+    uint64_t secondReplidOffset = 0; // replid2 is valid up to here
+    ReplicationBacklog backlog;
+    uint64_t writeOffset = 0;        // offset after the last data write
+
+    std::unordered_map<int, ReplicaInfo> replicas;
+    std::vector<WaitingClient> waiting;
+    std::unordered_set<int> waitingFds;   // fds of `waiting`
+
+    // --- replica side ---
+    std::string masterHost;
+    int masterPort = 0;
+    int listeningPort = 0;
+    State state = State::NONE;
+    int linkFd = -1;
+    std::string linkBuf;
+    bool transferHeaderRead = false;
+    uint64_t transferLeft = 0;
+    std::string transferBuf;
+    std::string transferReplid;
+    uint64_t transferOffset = 0;
+    uint64_t nextConnectAt = 0;
+    uint64_t lastAckAt = 0;
+    uint64_t stateSince = 0;
+
+    void setState(State s);
+    void connectToMaster();
+    void dropMasterLink();
+    void sendToMaster(const std::vector<std::string> &argv);
+    bool handleHandshakeLine(const std::string &line);
+    bool finishTransfer(CommandHandler &handler);
+    void sendAck();
+    void feedRaw(std::string_view data);
+
+    size_t countAcked(uint64_t offset) const;
+    void checkWaiting();
+
+    static std::string newReplicationId();
+};
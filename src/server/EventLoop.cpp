@@ -1,33 +1,279 @@
 #include "EventLoop.hpp"
 #include "../protocol/RESPParser.hpp"
+#include "../persistence/Snapshot.hpp"
 
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
 #include <string>
 
-EventLoop::EventLoop(int serverFd)
+EventLoop::EventLoop(int serverFd, const ServerConfig& cfg)
     : server_fd(serverFd),
+      config(cfg),
       str(),
-      handler(str)
+      handler(str),
+      repl(str),
+      cluster(str)
 {
     FD_ZERO(&current_fds);
     FD_SET(server_fd, &current_fds);
+    handler.setConfig(config);
+    List::SetCompressDepth(static_cast<int>(config.listCompressDepth));
+    Hash::SetListpackLimits(config.hashMaxListpackEntries, config.hashMaxListpackValue);
+    Set::SetMaxIntsetEntries(config.setMaxIntsetEntries);
+    ZSet::SetListpackLimits(config.zsetMaxListpackEntries, config.zsetMaxListpackValue);
+    Stream::SetTiering(config.streamTierDir, config.streamHotEntries,
+                       config.streamMemoryBudget);
+
+    // Replies to woken or timed-out blocked clients; commands they
+    // pipelined behind the blocking one run once they are unblocked
+    handler.setSender([this](int fd, std::string_view data) {
+        auto it = clients.find(fd);
+        if (it == clients.end())
+            return;
+        it->second.reply.append(data);
+        if (!it->second.query.empty())
+            resumed.push_back(fd);
+    });
+
+    // Replication output is queued like any other reply; a client whose
+    // WAIT just got its answer runs what it pipelined behind it
+    repl.setSender(
+        [this](int fd, std::string_view data) {
+            auto it = clients.find(fd);
+            if (it == clients.end())
+                return;
+            it->second.reply.append(data);
+            if (!it->second.query.empty() && !repl.isWaiting(fd))
+                resumed.push_back(fd);
+        },
+        [this](int fd) {
+            if (clients.count(fd))
+                closeClient(fd);
+        });
+    repl.configure(config);
+    handler.setReplication(&repl);
+
+    std::string err;
+    if (!cluster.configure(config, err)) {
+        std::cerr << "Cluster config: " << err << "\n";
+        std::exit(1);
+    }
+    handler.setCluster(&cluster);
+}
+
+EventLoop::~EventLoop() {
+    if (loader.joinable())
+        loader.join();
+}
+
+static void logLoadStats(const SnapshotLoadStats& stats) {
+    std::cout << std::fixed << std::setprecision(2)
+              << "Snapshot loaded: " << stats.keys << " keys, "
+              << stats.bytes / (1024.0 * 1024.0) << " MB, "
+              << stats.chunks << " chunks on " << stats.threads << " threads in "
+              << std::setprecision(3) << stats.seconds << " s ("
+              << std::setprecision(0) << stats.keysPerSec() << " keys/s, "
+              << std::setprecision(2) << stats.mbPerSec() << " MB/s)"
+              << std::endl;
+}
+
+/**
+ * Restores the dataset at startup. With appendonly enabled and an AOF
+ * on disk the log is replayed, otherwise <dir>/<dbfilename> is loaded
+ * if it exists. In async mode this runs on a background thread while
+ * run() keeps accepting clients, which are answered with -LOADING until
+ * finishAsyncLoad() swaps the data in.
+ */
+void EventLoop::loadData() {
+    struct stat st{};
+    bool replayAof = config.appendonly && ::stat(config.aofPath().c_str(), &st) == 0;
+
+    if (!replayAof && ::stat(config.snapshotPath().c_str(), &st) != 0)
+        return;
+
+    auto load = [this, replayAof](RedisStore& target) {
+        std::string err;
+
+        if (replayAof) {
+            CommandHandler replayer(target);
+            uint64_t commands = 0;
+            if (AppendOnlyFile::replay(config.aofPath(), target, replayer, commands, err))
+                std::cout << "AOF replayed: " << commands << " commands" << std::endl;
+            else
+                std::cerr << "AOF replay failed: " << err << "\n";
+            return;
+        }
+
+        SnapshotLoadStats stats;
+        if (Snapshot::load(target, config.snapshotPath(), config.loadThreads, stats, err))
+            logLoadStats(stats);
+        else
+            std::cerr << "Snapshot load failed: " << err << "\n";
+    };
+
+    if (!config.asyncLoading) {
+        load(str);
+        return;
+    }
+
+    handler.setLoading(true);
+    loader = std::thread([this, load]() {
+        load(staging);
+        loadDone = true;
+    });
+}
+
+void EventLoop::finishAsyncLoad() {
+    if (!handler.isLoading() || !loadDone)
+        return;
+
+    loader.join();
+    str.data = std::move(staging.data);
+    str.expires = std::move(staging.expires);
+    if (str.slotIndexEnabled())
+        str.rebuildSlotIndex();
+    handler.setLoading(false);
+}
+
+void EventLoop::openAppendOnlyFile() {
+    if (!config.appendonly)
+        return;
+
+    AppendFsync policy;
+    AppendOnlyFile::parsePolicy(config.appendfsync, policy);
+
+    std::string err;
+    if (!aof.open(config.aofPath(), policy, err)) {
+        std::cerr << "AOF disabled: " << err << "\n";
+        return;
+    }
+    handler.setAppendOnlyFile(&aof);
+}
+
+void EventLoop::closeClient(int fd) {
+    handler.onClientDisconnected(fd);
+    repl.onClientDisconnected(fd);
+    cluster.onClientDisconnected(fd);
+    close(fd);
+    FD_CLR(fd, &current_fds);
+    clients.erase(fd);
+}
+
+/**
+ * Executes every complete command in the client's query buffer
+ * (pipelining) and queues the replies. Nothing is written here:
+ * replies leave only after the AOF flush at the end of the iteration.
+ * A client blocked by BLPOP/BRPOP keeps the rest of its pipeline
+ * until it is served.
+ */
+void EventLoop::processQuery(int fd, Client& client) {
+    size_t pos = 0;
+    bool malformed = false;
+
+    while (pos < client.query.size() && !handler.isBlocked(fd)) {
+        size_t before = pos;
+        auto args = RESPParser::parseNext(client.query, pos, malformed);
+
+        if (pos == before)
+            break;
+        if (args.empty())
+            continue;
+
+        ExecResult result = handler.execute(args, fd);
+
+        // BLPOP blokladığında reply boş olacak → hiçbir şey yazma
+        // (large replies are moved, not copied, into an empty buffer)
+        if (client.reply.empty())
+            client.reply = std::move(result.reply);
+        else
+            client.reply += result.reply;
+    }
+
+    client.query.erase(0, pos);
+
+    if (malformed) {
+        client.reply += "-ERR Protocol error\r\n";
+        client.query.clear();
+    }
+}
+
+/**
+ * Runs the pipelined input of clients that were just unblocked.
+ * Serving them may unblock others in turn, hence the loop.
+ */
+void EventLoop::resumeUnblocked() {
+    while (!resumed.empty()) {
+        std::vector<int> fds;
+        fds.swap(resumed);
+        for (int fd : fds) {
+            auto it = clients.find(fd);
+            if (it != clients.end() && !handler.isBlocked(fd))
+                processQuery(fd, it->second);
+        }
+    }
+}
+
+bool EventLoop::writeClient(int fd, Client& client) {
+    while (!client.reply.empty()) {
+        ssize_t n = ::write(fd, client.reply.data(), client.reply.size());
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        client.reply.erase(0, static_cast<size_t>(n));
+        if (!client.reply.empty())
+            return true;   // socket full, retry when writable
+    }
+    return true;
 }
 
 void EventLoop::run() {
+    loadData();
+    openAppendOnlyFile();
+
     int max_fd = server_fd;
     char buffer[4096];
 
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = 50000;
-
     while (true) {
         fd_set ready_fds = current_fds;
+        fd_set write_fds;
+        FD_ZERO(&write_fds);
+        for (auto& [fd, client] : clients) {
+            if (!client.reply.empty())
+                FD_SET(fd, &write_fds);
+        }
 
-        int activity = select(max_fd + 1, &ready_fds, nullptr, nullptr, &tv);
+        // Master link of a replica: writable once connect() completes,
+        // readable for the handshake and the replication stream.
+        int link_fd = repl.masterLinkFd();
+        if (link_fd != -1) {
+            if (repl.masterLinkConnecting())
+                FD_SET(link_fd, &write_fds);
+            else
+                FD_SET(link_fd, &ready_fds);
+        }
+
+        // Outgoing cluster bus links to the other nodes
+        int bus_max_fd = -1;
+        cluster.addFds(ready_fds, write_fds, bus_max_fd);
+
+        // select() overwrites the timeout, so it is rebuilt every round
+        struct timeval tv;
+        tv.tv_sec = 0;
+        tv.tv_usec = 50000;
+
+        int activity = select(std::max({max_fd, link_fd, bus_max_fd}) + 1, &ready_fds,
+                              &write_fds, nullptr, &tv);
         if (activity < 0) {
+            if (errno == EINTR)
+                continue;
             std::cerr << "select error\n";
             break;
         }
@@ -41,37 +287,62 @@ void EventLoop::run() {
                 std::cerr << "accept error\n";
             } else {
                 FD_SET(fd, &current_fds);
+                clients[fd];
                 if (fd > max_fd) max_fd = fd;
             }
         }
 
         // Var olan client'ları işle
-        for (int fd = 0; fd <= max_fd; ++fd) {
-            if (fd == server_fd) continue;
-            if (!FD_ISSET(fd, &ready_fds)) continue;
+        // (a snapshot: replies may close other clients, and the fd sets
+        // also hold the master link and the cluster bus links)
+        std::vector<int> readable;
+        for (auto& [fd, client] : clients) {
+            if (FD_ISSET(fd, &ready_fds))
+                readable.push_back(fd);
+        }
+
+        for (int fd : readable) {
+            if (!clients.count(fd)) continue;
 
             int bytes = read(fd, buffer, sizeof(buffer));
             if (bytes <= 0) {
-                close(fd);
-                FD_CLR(fd, &current_fds);
+                closeClient(fd);
                 continue;
             }
 
-            std::string request(buffer, bytes);
-
-            auto args = RESPParser::parse(request);
-            if (args.empty())
-                continue;
-
-            ExecResult result = handler.execute(args, fd);
+            Client& client = clients[fd];
+            client.query.append(buffer, bytes);
+            processQuery(fd, client);
+        }
+        resumeUnblocked();
 
-            // BLPOP blokladığında reply boş olacak → hiçbir şey yazma
-            if (!result.reply.empty()) {
-                ::write(fd, result.reply.c_str(), result.reply.size());
-            }
+        // The link may have been replaced while clients were served
+        if (link_fd != -1 && link_fd == repl.masterLinkFd()) {
+            if (FD_ISSET(link_fd, &write_fds))
+                repl.onMasterWritable();
+            else if (FD_ISSET(link_fd, &ready_fds))
+                repl.onMasterReadable(handler);
         }
+        repl.cron();
+
+        cluster.handleFds(ready_fds, write_fds);
+        cluster.cron();
 
         handler.checkTimeouts();
-        handler.checkXReadTimeouts();
+        resumeUnblocked();
+        handler.checkBackgroundJobs();
+        finishAsyncLoad();
+
+        // Group commit: everything this iteration logged goes out in one
+        // write() (and one fsync with appendfsync always) before replies.
+        aof.flush();
+
+        std::vector<int> broken;
+        for (auto& [fd, client] : clients) {
+            if (!writeClient(fd, client))
+                broken.push_back(fd);
+        }
+        for (int fd : broken)
+            closeClient(fd);
     }
 }
@@ -1,15 +1,55 @@
 #pragma once
 #include <sys/select.h>
+#include <atomic>
+#include <thread>
 #include "../db/RedisStore.hpp"
 #include "../commands/CommandHandler.hpp"
+#include "../persistence/AppendOnlyFile.hpp"
+#include "../replication/ReplicationManager.hpp"
+#include "../cluster/ClusterManager.hpp"
+#include "ServerConfig.hpp"
+
+/**
+ * Per-connection buffers. The query buffer keeps partial commands across
+ * reads; the reply buffer holds output until the end of the iteration.
+ */
+struct Client {
+    std::string query;
+    std::string reply;
+};
 
 class EventLoop {
     int server_fd;
     fd_set current_fds;
-    
+    ServerConfig config;
+
     RedisStore str;
-    CommandHandler handler; 
+    CommandHandler handler;
+    AppendOnlyFile aof;
+    ReplicationManager repl;
+    ClusterManager cluster;
+
+    std::unordered_map<int, Client> clients;
+
+    // Clients unblocked with commands still waiting in their query buffer
+    std::vector<int> resumed;
+
+    // Async snapshot loading (--async-loading yes): the loader thread fills
+    // `staging`, the loop swaps it into `str` once `loadDone` is set.
+    RedisStore staging;
+    std::thread loader;
+    std::atomic<bool> loadDone{false};
+
+    void loadData();
+    void finishAsyncLoad();
+    void openAppendOnlyFile();
+
+    void processQuery(int fd, Client& client);
+    void resumeUnblocked();
+    bool writeClient(int fd, Client& client);
+    void closeClient(int fd);
 public:
-    EventLoop(int serverFd);
+    EventLoop(int serverFd, const ServerConfig& cfg);
+    ~EventLoop();
     void run();
 };
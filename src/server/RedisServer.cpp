@@ -6,7 +6,7 @@
 #include <unistd.h>
 #include <iostream>
 
-RedisServer::RedisServer(int p) : port(p) {}
+RedisServer::RedisServer(const ServerConfig& cfg) : config(cfg) {}
 
 void RedisServer::start() {
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
@@ -17,11 +17,11 @@ void RedisServer::start() {
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(port);
+    addr.sin_port = htons(config.port);
 
     bind(server_fd, (sockaddr*)&addr, sizeof(addr));
     listen(server_fd, 5);
 
-    EventLoop loop(server_fd);
+    EventLoop loop(server_fd, config);
     loop.run();
 }
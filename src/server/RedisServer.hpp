@@ -1,8 +1,10 @@
 #pragma once
 
+#include "ServerConfig.hpp"
+
 class RedisServer {
-    int port;
+    ServerConfig config;
 public:
-    RedisServer(int port);
+    RedisServer(const ServerConfig& cfg);
     void start();
 };
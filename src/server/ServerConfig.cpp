@@ -0,0 +1,204 @@
+#include "ServerConfig.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+bool parseYesNo(const std::string &value, bool &out) {
+    std::string v = value;
+    std::transform(v.begin(), v.end(), v.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+
+    if (v == "yes") { out = true;  return true; }
+    if (v == "no")  { out = false; return true; }
+    return false;
+}
+
+// Accepts plain bytes or a kb/mb/gb suffix ("64mb").
+bool parseMemory(const std::string &value, unsigned long long &out);
+
+bool parseUnsigned(const std::string &value, unsigned long long &out) {
+    if (value.empty() ||
+        !std::all_of(value.begin(), value.end(), ::isdigit))
+        return false;
+
+    try {
+        out = std::stoull(value);
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
+bool parseMemory(const std::string &value, unsigned long long &out) {
+    std::string v = value;
+    std::transform(v.begin(), v.end(), v.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+
+    unsigned long long mul = 1;
+    if (v.size() > 2) {
+        std::string suffix = v.substr(v.size() - 2);
+        if (suffix == "kb") mul = 1024ULL;
+        else if (suffix == "mb") mul = 1024ULL * 1024;
+        else if (suffix == "gb") mul = 1024ULL * 1024 * 1024;
+        if (mul != 1)
+            v.resize(v.size() - 2);
+    }
+
+    if (!parseUnsigned(v, out))
+        return false;
+    out *= mul;
+    return true;
+}
+
+} // namespace
+
+bool ServerConfig::parseArgs(const std::vector<std::string> &args, std::string &err) {
+    for (size_t i = 0; i < args.size(); i += 2) {
+        const std::string &opt = args[i];
+
+        if (opt.rfind("--", 0) != 0) {
+            err = "unexpected argument '" + opt + "'";
+            return false;
+        }
+
+        if (i + 1 >= args.size()) {
+            err = "missing value for '" + opt + "'";
+            return false;
+        }
+
+        const std::string name = opt.substr(2);
+        const std::string &value = args[i + 1];
+        unsigned long long num = 0;
+
+        if (name == "port") {
+            if (!parseUnsigned(value, num) || num == 0 || num > 65535) {
+                err = "invalid port '" + value + "'";
+                return false;
+            }
+            port = static_cast<int>(num);
+        } else if (name == "dir") {
+            dir = value;
+        } else if (name == "dbfilename") {
+            dbfilename = value;
+        } else if (name == "async-loading") {
+            if (!parseYesNo(value, asyncLoading)) {
+                err = "async-loading must be yes or no";
+                return false;
+            }
+        } else if (name == "load-threads") {
+            if (!parseUnsigned(value, num) || num > 256) {
+                err = "invalid load-threads '" + value + "'";
+                return false;
+            }
+            loadThreads = static_cast<unsigned>(num);
+        } else if (name == "appendonly") {
+            if (!parseYesNo(value, appendonly)) {
+                err = "appendonly must be yes or no";
+                return false;
+            }
+        } else if (name == "appendfilename") {
+            appendfilename = value;
+        } else if (name == "appendfsync") {
+            if (value != "always" && value != "everysec" && value != "no") {
+                err = "appendfsync must be always, everysec or no";
+                return false;
+            }
+            appendfsync = value;
+        } else if (name == "auto-aof-rewrite-percentage") {
+            if (!parseUnsigned(value, num) || num > 100000) {
+                err = "invalid auto-aof-rewrite-percentage '" + value + "'";
+                return false;
+            }
+            autoAofRewritePercentage = static_cast<unsigned>(num);
+        } else if (name == "auto-aof-rewrite-min-size") {
+            if (!parseMemory(value, autoAofRewriteMinSize)) {
+                err = "invalid auto-aof-rewrite-min-size '" + value + "'";
+                return false;
+            }
+        } else if (name == "aof-use-snapshot-preamble") {
+            if (!parseYesNo(value, aofUseSnapshotPreamble)) {
+                err = "aof-use-snapshot-preamble must be yes or no";
+                return false;
+            }
+        } else if (name == "list-compress-depth") {
+            if (!parseUnsigned(value, num) || num > 65535) {
+                err = "invalid list-compress-depth '" + value + "'";
+                return false;
+            }
+            listCompressDepth = static_cast<unsigned>(num);
+        } else if (name == "hash-max-listpack-entries") {
+            if (!parseUnsigned(value, hashMaxListpackEntries)) {
+                err = "invalid hash-max-listpack-entries '" + value + "'";
+                return false;
+            }
+        } else if (name == "hash-max-listpack-value") {
+            if (!parseUnsigned(value, hashMaxListpackValue)) {
+                err = "invalid hash-max-listpack-value '" + value + "'";
+                return false;
+            }
+        } else if (name == "set-max-intset-entries") {
+            if (!parseUnsigned(value, setMaxIntsetEntries)) {
+                err = "invalid set-max-intset-entries '" + value + "'";
+                return false;
+            }
+        } else if (name == "zset-max-listpack-entries") {
+            if (!parseUnsigned(value, zsetMaxListpackEntries)) {
+                err = "invalid zset-max-listpack-entries '" + value + "'";
+                return false;
+            }
+        } else if (name == "zset-max-listpack-value") {
+            if (!parseUnsigned(value, zsetMaxListpackValue)) {
+                err = "invalid zset-max-listpack-value '" + value + "'";
+                return false;
+            }
+        } else if (name == "stream-tier-dir") {
+            streamTierDir = value;
+        } else if (name == "stream-hot-entries") {
+            if (!parseUnsigned(value, streamHotEntries)) {
+                err = "invalid stream-hot-entries '" + value + "'";
+                return false;
+            }
+        } else if (name == "stream-memory-budget") {
+            if (!parseMemory(value, streamMemoryBudget) || streamMemoryBudget == 0) {
+                err = "invalid stream-memory-budget '" + value + "'";
+                return false;
+            }
+        } else if (name == "replicaof") {
+            size_t sp = value.find(' ');
+            if (sp == std::string::npos ||
+                !parseUnsigned(value.substr(sp + 1), num) ||
+                num == 0 || num > 65535) {
+                err = "replicaof must be \"<host> <port>\"";
+                return false;
+            }
+            replicaofHost = value.substr(0, sp);
+            replicaofPort = static_cast<int>(num);
+        } else if (name == "repl-backlog-size") {
+            if (!parseMemory(value, replBacklogSize) || replBacklogSize == 0) {
+                err = "invalid repl-backlog-size '" + value + "'";
+                return false;
+            }
+        } else if (name == "cluster-enabled") {
+            if (!parseYesNo(value, clusterEnabled)) {
+                err = "cluster-enabled must be yes or no";
+                return false;
+            }
+        } else if (name == "cluster-config-file") {
+            clusterConfigFile = value;
+        } else if (name == "cluster-announce-ip") {
+            clusterAnnounceIp = value;
+        } else if (name == "cluster-node-timeout") {
+            if (!parseUnsigned(value, clusterNodeTimeout) || clusterNodeTimeout == 0) {
+                err = "invalid cluster-node-timeout '" + value + "'";
+                return false;
+            }
+        } else {
+            err = "unknown option '" + opt + "'";
+            return false;
+        }
+    }
+
+    return true;
+}
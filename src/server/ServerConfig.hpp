@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * ServerConfig
+ * ---------------
+ * Runtime options parsed from the command line, e.g.
+ *
+ *   ./redis --port 6380 --dir /var/lib/redis --dbfilename dump.rcs
+ *
+ * Every option maps to a "--name value" pair so the same names can be
+ * reused by CONFIG-style commands later on.
+ */
+struct ServerConfig {
+    int port = 6379;
+
+    // Snapshot location: <dir>/<dbfilename>
+    std::string dir = ".";
+    std::string dbfilename = "dump.rcs";
+
+    // When true, the server accepts connections while the snapshot is
+    // being loaded and answers every data command with -LOADING.
+    bool asyncLoading = false;
+
+    // Number of decoder threads used by the snapshot loader (0 = auto).
+    unsigned loadThreads = 0;
+
+    // Append-only file: <dir>/<appendfilename>, replayed at startup
+    // instead of the snapshot when enabled.
+    bool appendonly = false;
+    std::string appendfilename = "appendonly.aof";
+    std::string appendfsync = "everysec";   // always | everysec | no
+
+    // BGREWRITEAOF is triggered automatically once the AOF grew by this
+    // percentage since the last rewrite and is at least min-size bytes.
+    unsigned autoAofRewritePercentage = 100;
+    unsigned long long autoAofRewriteMinSize = 64ULL * 1024 * 1024;
+
+    // Rewritten AOFs start with a snapshot instead of commands.
+    bool aofUseSnapshotPreamble = false;
+
+    // Quicklist nodes kept uncompressed at each end of every list; the
+    // nodes in between are LZF-compressed (0 = never compress).
+    unsigned listCompressDepth = 0;
+
+    // Hashes stay a single packed listpack up to this many fields, each
+    // field and value at most this many bytes.
+    unsigned long long hashMaxListpackEntries = 128;
+    unsigned long long hashMaxListpackValue = 64;
+
+    // Sets of integers stay a sorted intset up to this many members.
+    unsigned long long setMaxIntsetEntries = 512;
+
+    // Sorted sets stay a single sorted listpack up to this many members,
+    // each at most this many bytes.
+    unsigned long long zsetMaxListpackEntries = 128;
+    unsigned long long zsetMaxListpackValue = 64;
+
+    // Tiered stream storage: once a stream holds more than the budget in
+    // memory, its oldest nodes are moved to segment files in this
+    // directory (empty = off), keeping the newest hot-entries in memory.
+    std::string streamTierDir;
+    unsigned long long streamHotEntries = 100000;
+    unsigned long long streamMemoryBudget = 64ULL * 1024 * 1024;
+
+    // Start as a replica of "<host> <port>" (--replicaof "127.0.0.1 6379").
+    std::string replicaofHost;
+    int replicaofPort = 0;
+
+    // Circular buffer of recent replication traffic that lets replicas
+    // resume after a short disconnect without a full resync.
+    unsigned long long replBacklogSize = 1024ULL * 1024;
+
+    // Cluster mode: slot ownership and known nodes are persisted in
+    // <dir>/<cluster-config-file>. The announce ip is what other nodes
+    // and MOVED/ASK redirections use to reach this one.
+    bool clusterEnabled = false;
+    std::string clusterConfigFile = "nodes.conf";
+    std::string clusterAnnounceIp = "127.0.0.1";
+    unsigned long long clusterNodeTimeout = 15000;   // ms
+
+    std::string snapshotPath() const {
+        return dir + "/" + dbfilename;
+    }
+
+    std::string aofPath() const {
+        return dir + "/" + appendfilename;
+    }
+
+    /**
+     * Parses "--name value" pairs. Unknown options are rejected so typos
+     * do not silently fall back to defaults.
+     * @return true on success, false with `err` filled otherwise.
+     */
+    bool parseArgs(const std::vector<std::string> &args, std::string &err);
+};
@@ -1,14 +1,47 @@
 #pragma once
 #include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
 
+#include "../db/Stream.hpp"
+
+/**
+ * A client blocked in BLPOP / BRPOP / BLMOVE / BZPOPMIN / BZPOPMAX. It waits on every key in
+ * `keys` at once; `positions` are its entries in the per-key wait
+ * queues, so it can leave all of them in O(1) once one key serves it.
+ */
 struct BlockedClient {
-    int fd;
-    uint64_t deadline_ms;
+    int fd = -1;
+    uint64_t deadline_ms = 0;                   // 0 → block forever
+    bool head = true;                           // pop the head (BLPOP, LEFT) or the tail
+    std::vector<std::string> keys = {};
+    std::vector<std::list<int>::iterator> positions = {};
+
+    // BLMOVE / BRPOPLPUSH: the popped element is pushed onto `target`
+    bool move = false;
+    std::string target = {};
+    bool targetHead = false;
+
+    // BZPOPMIN / BZPOPMAX: waits for a sorted set, `head` = lowest score
+    bool zset = false;
 };
 
+/**
+ * A client blocked in XREAD / XREADGROUP. Like BlockedClient it is
+ * queued once under every stream key it watches; `positions` are its
+ * entries in those queues.
+ */
 struct BlockedXReadClient {
-    int fd;
-    uint64_t deadline_ms;
-    std::string stream_name;
-    std::string last_id;
-};
\ No newline at end of file
+    int fd = -1;
+    uint64_t deadline_ms = 0;                   // 0 → block forever
+    std::vector<std::string> keys = {};
+    std::vector<StreamID> next_ids = {};        // per key: first ID it has not seen
+    std::vector<std::list<int>::iterator> positions = {};
+
+    // XREADGROUP ... ">": served from the group's last ID instead
+    std::string group = {};                     // empty → plain XREAD
+    std::string consumer = {};
+    size_t count = 0;                           // 0 → no COUNT
+    bool noack = false;
+};
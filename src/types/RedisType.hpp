@@ -1,14 +1,49 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <string>
+#include <string_view>
 #include <variant>
 
+#include "../db/Hash.hpp"
 #include "../db/List.hpp"
+#include "../db/Set.hpp"
 #include "../db/Stream.hpp"
+#include "../db/ZSet.hpp"
+#include "../utils/StringUtils.hpp"
 
-enum class RedisType {STRING, LIST, STREAM};
+enum class RedisType {STRING, LIST, STREAM, HASH, SET, ZSET};
 
+// A STRING is held as an int64_t when its text is the canonical spelling
+// of one ("42", "-7"; not "042" or "+7"), so counters take no heap memory
+// and INCR never parses. Anything else stays a std::string, as does any
+// value edited in place by APPEND or SETRANGE (see mutableString).
 struct RedisObj {
     RedisType type;
-    std::variant<std::string, List, Stream> value;
-};
\ No newline at end of file
+    std::variant<std::string, List, Stream, Hash, Set, ZSet, int64_t> value;
+};
+
+// Stores `text` as the value of a STRING object, in whichever encoding fits.
+inline void assignString(RedisObj &obj, std::string_view text) {
+    long long n;
+    if (parseLongLong(text, n))
+        obj.value = n;
+    else
+        obj.value = std::string(text);
+}
+
+// Text of a STRING object, whichever way it is stored.
+inline std::string stringValue(const RedisObj &obj) {
+    if (const int64_t *n = std::get_if<int64_t>(&obj.value))
+        return std::to_string(*n);
+    return std::get<std::string>(obj.value);
+}
+
+// The value of a STRING object as a std::string that can be edited in
+// place; an integer is turned into its text first.
+inline std::string &mutableString(RedisObj &obj) {
+    if (const int64_t *n = std::get_if<int64_t>(&obj.value))
+        obj.value = std::to_string(*n);
+    return std::get<std::string>(obj.value);
+}
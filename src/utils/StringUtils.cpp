@@ -0,0 +1,152 @@
+#include "StringUtils.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "time.cpp"
+
+bool parseLongLong(std::string_view s, long long &out) {
+    if (s.empty() || s.size() > 20)
+        return false;
+    // "007", "+7" and "-0" are not how Redis spells an integer
+    if (s[0] == '+' || (s.size() > 1 && s[0] == '0') ||
+        (s[0] == '-' && (s.size() == 1 || s[1] == '0')))
+        return false;
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && ptr == s.data() + s.size();
+}
+
+bool parseU64(std::string_view s, uint64_t &out) {
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && ptr == s.data() + s.size();
+}
+
+bool parseLongDouble(std::string_view s, long double &out) {
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && ptr == s.data() + s.size() && std::isfinite(out);
+}
+
+std::string formatLongDouble(long double v) {
+    // %Lf never switches to exponents, so the largest long double needs
+    // a few thousand digits
+    char buf[5 * 1024];
+    int len = std::snprintf(buf, sizeof(buf), "%.17Lf", v);
+    std::string text(buf, static_cast<size_t>(std::min<int>(len, sizeof(buf) - 1)));
+
+    if (text.find('.') != std::string::npos) {
+        text.erase(text.find_last_not_of('0') + 1);
+        if (text.back() == '.')
+            text.pop_back();
+    }
+    if (text == "-0")
+        text = "0";
+    return text;
+}
+
+std::string formatDouble(double d) {
+    char buf[32];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), d);
+    return std::string(buf, end);
+}
+
+const char *parseTimeout(std::string_view s, uint64_t &deadline_ms) {
+    std::string str(s);
+    char *end = nullptr;
+    double timeout_sec = std::strtod(str.c_str(), &end);
+    if (str.empty() || end != str.c_str() + str.size() || !std::isfinite(timeout_sec))
+        return "-ERR timeout is not a float or out of range\r\n";
+    if (timeout_sec < 0)
+        return "-ERR timeout is negative\r\n";
+
+    deadline_ms = 0;
+    if (timeout_sec > 0.0)
+        deadline_ms = current_time_ms() + static_cast<uint64_t>(timeout_sec * 1000.0);
+    return nullptr;
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size())
+        return false;
+
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::toupper(static_cast<unsigned char>(a[i])) !=
+            std::toupper(static_cast<unsigned char>(b[i])))
+            return false;
+    }
+    return true;
+}
+
+std::string toUpper(std::string_view s) {
+    std::string upper(s);
+    for (char &c : upper)
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    return upper;
+}
+
+bool globMatch(std::string_view pattern, std::string_view s) {
+    size_t p = 0, i = 0;
+    size_t star = std::string_view::npos, resume = 0;
+
+    while (i < s.size()) {
+        if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            resume = i;
+            continue;
+        }
+
+        bool matched = false;
+        size_t next = p + 1;
+        if (p < pattern.size()) {
+            char c = pattern[p];
+            if (c == '?') {
+                matched = true;
+            } else if (c == '[') {
+                size_t j = p + 1;
+                bool negate = j < pattern.size() && pattern[j] == '^';
+                if (negate)
+                    ++j;
+                bool hit = false;
+                while (j < pattern.size() && pattern[j] != ']') {
+                    if (pattern[j] == '\\' && j + 1 < pattern.size()) {
+                        hit |= pattern[j + 1] == s[i];
+                        j += 2;
+                    } else if (j + 2 < pattern.size() && pattern[j + 1] == '-' &&
+                               pattern[j + 2] != ']') {
+                        char lo = std::min(pattern[j], pattern[j + 2]);
+                        char hi = std::max(pattern[j], pattern[j + 2]);
+                        hit |= s[i] >= lo && s[i] <= hi;
+                        j += 3;
+                    } else {
+                        hit |= pattern[j] == s[i];
+                        ++j;
+                    }
+                }
+                matched = hit != negate;
+                next = j < pattern.size() ? j + 1 : j;
+            } else if (c == '\\' && p + 1 < pattern.size()) {
+                matched = pattern[p + 1] == s[i];
+                next = p + 2;
+            } else {
+                matched = c == s[i];
+            }
+        }
+
+        if (matched) {
+            p = next;
+            ++i;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            i = ++resume;
+        } else {
+            return false;
+        }
+    }
+
+    while (p < pattern.size() && pattern[p] == '*')
+        ++p;
+    return p == pattern.size();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/*
+------------------------------------------------------------------------------
+  STRING UTILITIES
+------------------------------------------------------------------------------
+
+Parsing and formatting helpers shared by the command handlers, so every
+command reads its arguments by the same rules.
+------------------------------------------------------------------------------
+*/
+
+// Parses a whole argument as a 64-bit integer, with Redis' string2ll
+// rules: no sign other than a leading '-', no leading zeros, no "-0".
+bool parseLongLong(std::string_view s, long long &out);
+
+// Strict unsigned decimal: no sign, no spaces, no overflow.
+bool parseU64(std::string_view s, uint64_t &out);
+
+// Parses a whole argument as a finite long double (HINCRBYFLOAT,
+// INCRBYFLOAT), which carries a few more digits than a double.
+bool parseLongDouble(std::string_view s, long double &out);
+
+// Plain decimal text of `v` with up to 17 decimals and no trailing zeros
+// ("100000000000000000000", "10.6", "3"), as Redis prints float increments.
+std::string formatLongDouble(long double v);
+
+// Shortest text that reads back as the same double ("3", "0.5", "inf").
+std::string formatDouble(double d);
+
+// Blocking timeouts are seconds (fractions allowed), 0 = forever.
+// Returns the error reply, or nullptr with `deadline_ms` set.
+const char *parseTimeout(std::string_view s, uint64_t &deadline_ms);
+
+// ASCII case-insensitive comparison for option keywords (PX, COUNT...).
+bool equalsIgnoreCase(std::string_view a, std::string_view b);
+
+// ASCII upper-case copy, for matching option keywords.
+std::string toUpper(std::string_view s);
+
+// Glob-style matching (HSCAN MATCH): *, ?, [abc], [^a-z], \x.
+bool globMatch(std::string_view pattern, std::string_view s);
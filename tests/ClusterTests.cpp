@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../src/cluster/ClusterManager.hpp"
+#include "../src/cluster/HashSlot.hpp"
+#include "../src/commands/CommandHandler.hpp"
+#include "../src/db/RedisStore.hpp"
+#include "../src/server/ServerConfig.hpp"
+#include "TestHelpers.hpp"
+
+namespace {
+
+// One cluster node without sockets; bus messages are handed over directly.
+struct Node {
+    std::string dir;
+    RedisStore store;
+    CommandHandler handler{store};
+    ClusterManager cluster{store};
+
+    explicit Node(int port) {
+        char tmpl[] = "/tmp/cluster_test_XXXXXX";
+        dir = ::mkdtemp(tmpl);
+
+        ServerConfig cfg;
+        cfg.port = port;
+        cfg.dir = dir;
+        cfg.clusterEnabled = true;
+
+        std::string err;
+        EXPECT_TRUE(cluster.configure(cfg, err)) << err;
+        handler.setCluster(&cluster);
+    }
+    ~Node() { std::filesystem::remove_all(dir); }
+
+    std::string run(std::vector<std::string> args, int fd = 1) {
+        return handler.execute(RespArgs(std::move(args)).views, fd).reply;
+    }
+
+    std::string id() const { return cluster.myself().id; }
+};
+
+// `from` sends a PING to `to` (what the bus does once per second).
+void ping(Node& from, Node& to) {
+    to.run(from.cluster.busMessage("PING"));
+}
+
+} // namespace
+
+TEST(HashSlotTest, MatchesRedisKeySlots) {
+    EXPECT_EQ(0x31C3, crc16("123456789", 9));
+    EXPECT_EQ(12182, keyHashSlot("foo"));
+    EXPECT_EQ(keyHashSlot("user1000"), keyHashSlot("{user1000}.following"));
+    EXPECT_EQ(keyHashSlot("user1000"), keyHashSlot("x{user1000}y{other}"));
+
+    // An empty tag does not count: the whole key is hashed
+    EXPECT_EQ(static_cast<int>(crc16("foo{}{bar}", 10) % CLUSTER_SLOTS),
+              keyHashSlot("foo{}{bar}"));
+}
+
+TEST(ClusterTest, RedirectsKeysOwnedByOtherNodes) {
+    Node a(7001), b(7002);
+    ASSERT_EQ("+OK\r\n", a.run({"CLUSTER", "ADDSLOTSRANGE", "0", "8191"}));
+    ASSERT_EQ("+OK\r\n", b.run({"CLUSTER", "ADDSLOTSRANGE", "8192", "16383"}));
+    ping(a, b);
+    ping(b, a);
+
+    EXPECT_EQ("-MOVED 12182 127.0.0.1:7002\r\n", a.run({"SET", "foo", "bar"}));
+    EXPECT_EQ("+OK\r\n", b.run({"SET", "foo", "bar"}));
+    EXPECT_EQ("+OK\r\n", b.run({"SET", "{foo}2", "baz"}));
+    EXPECT_EQ(0u, b.run({"DEL", "foo", "bar"}).rfind("-CROSSSLOT", 0));
+    EXPECT_EQ(0u, b.run({"MSET", "foo", "1", "bar", "2"}).rfind("-CROSSSLOT", 0));
+    EXPECT_EQ("*2\r\n$3\r\nbar\r\n$3\r\nbaz\r\n", b.run({"MGET", "foo", "{foo}2"}));
+
+    EXPECT_EQ(":2\r\n", b.run({"CLUSTER", "COUNTKEYSINSLOT", "12182"}));
+    EXPECT_EQ("*1\r\n", b.run({"CLUSTER", "GETKEYSINSLOT", "12182", "1"}).substr(0, 4));
+
+    // Both nodes agree on the slot map
+    std::string slots = a.run({"CLUSTER", "SLOTS"});
+    EXPECT_EQ(slots, b.run({"CLUSTER", "SLOTS"}));
+    EXPECT_NE(std::string::npos, slots.find(":8192\r\n:16383\r\n*3\r\n$9\r\n127.0.0.1\r\n:7002"));
+}
+
+TEST(ClusterTest, MigratesSlotWithAskRedirection) {
+    Node a(7001), b(7002);
+    a.run({"CLUSTER", "ADDSLOTSRANGE", "0", "8191"});
+    b.run({"CLUSTER", "ADDSLOTSRANGE", "8192", "16383"});
+    ping(a, b);
+    ping(b, a);
+
+    b.run({"SET", "{foo}moved", "1"});
+    b.run({"RPUSH", "{foo}stays", "x"});
+
+    ASSERT_EQ("+OK\r\n", a.run({"CLUSTER", "SETSLOT", "12182", "IMPORTING", b.id()}));
+    ASSERT_EQ("+OK\r\n", b.run({"CLUSTER", "SETSLOT", "12182", "MIGRATING", a.id()}));
+
+    // What MIGRATE does for one key
+    std::string dump = b.run({"DUMP", "{foo}moved"});
+    std::string payload = dump.substr(dump.find("\r\n") + 2);
+    payload.resize(payload.size() - 2);
+    ASSERT_EQ("+OK\r\n", a.run({"RESTORE-ASKING", "{foo}moved", "0", payload}));
+    b.run({"DEL", "{foo}moved"});
+
+    // The source serves keys it still has and sends the rest to the target
+    EXPECT_EQ("*1\r\n$1\r\nx\r\n", b.run({"LRANGE", "{foo}stays", "0", "-1"}));
+    EXPECT_EQ("-ASK 12182 127.0.0.1:7001\r\n", b.run({"GET", "{foo}moved"}));
+
+    // The target only answers clients that sent ASKING, and only once
+    EXPECT_EQ("-MOVED 12182 127.0.0.1:7002\r\n", a.run({"GET", "{foo}moved"}));
+    EXPECT_EQ("+OK\r\n", a.run({"ASKING"}));
+    EXPECT_EQ("$1\r\n1\r\n", a.run({"GET", "{foo}moved"}));
+    EXPECT_EQ("-MOVED 12182 127.0.0.1:7002\r\n", a.run({"GET", "{foo}moved"}));
+
+    // Ownership flips on the target; its bumped epoch wins on the source
+    ASSERT_EQ("+OK\r\n", a.run({"CLUSTER", "SETSLOT", "12182", "NODE", a.id()}));
+    ping(a, b);
+
+    EXPECT_EQ("-MOVED 12182 127.0.0.1:7001\r\n", b.run({"GET", "{foo}moved"}));
+    EXPECT_EQ("$1\r\n1\r\n", a.run({"GET", "{foo}moved"}));
+    EXPECT_GT(a.cluster.myself().configEpoch, b.cluster.myself().configEpoch);
+}
+
+TEST(ClusterTest, RestoreRejectsCorruptPayloadsAndExistingKeys) {
+    RedisStore store;
+    CommandHandler handler(store);
+    auto run = [&](std::vector<std::string> args) {
+        return handler.execute(RespArgs(std::move(args)).views, 1).reply;
+    };
+
+    run({"RPUSH", "src", "a", "b", "c"});
+    std::string dump = run({"DUMP", "src"});
+    std::string payload = dump.substr(dump.find("\r\n") + 2);
+    payload.resize(payload.size() - 2);
+
+    EXPECT_EQ("$-1\r\n", run({"DUMP", "missing"}));
+    EXPECT_EQ("+OK\r\n", run({"RESTORE", "dst", "0", payload}));
+    EXPECT_EQ("*3\r\n$1\r\na\r\n$1\r\nb\r\n$1\r\nc\r\n", run({"LRANGE", "dst", "0", "-1"}));
+
+    EXPECT_EQ(0u, run({"RESTORE", "dst", "0", payload}).rfind("-BUSYKEY", 0));
+    EXPECT_EQ("+OK\r\n", run({"RESTORE", "dst", "0", payload, "REPLACE"}));
+
+    std::string corrupt = payload;
+    corrupt[1] ^= 0x01;
+    EXPECT_EQ("-ERR DUMP payload version or checksum are wrong\r\n",
+              run({"RESTORE", "other", "0", corrupt}));
+}
+
+TEST(ClusterTest, RestoreWakesBlockedClients) {
+    RedisStore store;
+    CommandHandler handler(store);
+    std::map<int, std::string> sent;
+    handler.setSender([&](int fd, std::string_view data) { sent[fd].append(data); });
+    auto run = [&](std::vector<std::string> args, int fd = 1) {
+        return handler.execute(RespArgs(std::move(args)).views, fd).reply;
+    };
+    auto payloadOf = [&](const std::string &key) {
+        std::string dump = run({"DUMP", key});
+        std::string payload = dump.substr(dump.find("\r\n") + 2);
+        payload.resize(payload.size() - 2);
+        return payload;
+    };
+
+    run({"ZADD", "zsrc", "1", "a"});
+    run({"XADD", "ssrc", "1-0", "f", "v"});
+    std::string zset = payloadOf("zsrc");
+    std::string stream = payloadOf("ssrc");
+
+    run({"BZPOPMIN", "zdst", "0"}, 10);
+    run({"XREAD", "BLOCK", "0", "STREAMS", "sdst", "0-0"}, 11);
+    ASSERT_TRUE(handler.isBlocked(10));
+    ASSERT_TRUE(handler.isBlocked(11));
+
+    EXPECT_EQ("+OK\r\n", run({"RESTORE", "zdst", "0", zset}));
+    EXPECT_EQ("*3\r\n$4\r\nzdst\r\n$1\r\na\r\n$1\r\n1\r\n", sent[10]);
+    EXPECT_FALSE(handler.isBlocked(10));
+
+    EXPECT_EQ("+OK\r\n", run({"RESTORE", "sdst", "0", stream}));
+    EXPECT_NE(std::string::npos, sent[11].find("$3\r\n1-0\r\n"));
+    EXPECT_FALSE(handler.isBlocked(11));
+}
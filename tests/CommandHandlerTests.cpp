@@ -1,8 +1,11 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <map>
+#include <set>
 #include <string>
 #include <thread>
+#include <variant>
 #include <vector>
 
 #include "../src/commands/CommandHandler.hpp"
@@ -46,6 +49,162 @@ TEST(CommandHandlerTest, SetPxExpiresKey) {
     EXPECT_EQ("$-1\r\n", getReply.reply);
 }
 
+TEST(CommandHandlerTest, CountersAreIntegerEncodedAndKeepTheirTtl) {
+    RedisStore store;
+    CommandHandler handler(store);
+    auto run = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+    auto isInt = [&](const std::string& key) {
+        return std::holds_alternative<int64_t>(store.getObject(key)->value);
+    };
+
+    EXPECT_EQ(":1\r\n", run({"INCR", "n"}));
+    EXPECT_EQ(":11\r\n", run({"INCRBY", "n", "10"}));
+    EXPECT_EQ(":-89\r\n", run({"DECRBY", "n", "100"}));
+    EXPECT_EQ(":-90\r\n", run({"DECR", "n"}));
+    EXPECT_TRUE(isInt("n"));
+    EXPECT_EQ("$3\r\n-90\r\n", run({"GET", "n"}));
+    EXPECT_EQ("+string\r\n", run({"TYPE", "n"}));
+
+    // Only the canonical spelling of an integer is stored as one
+    run({"SET", "a", "12345"});
+    run({"SET", "b", "007"});
+    EXPECT_TRUE(isInt("a"));
+    EXPECT_FALSE(isInt("b"));
+    EXPECT_EQ("$3\r\n007\r\n", run({"GET", "b"}));
+
+    // ...and only that spelling counts as one, as with Redis' string2ll
+    EXPECT_EQ("-ERR value is not an integer or out of range\r\n", run({"INCR", "b"}));
+    EXPECT_EQ("-ERR value is not an integer or out of range\r\n", run({"INCRBY", "a", "+5"}));
+    EXPECT_EQ("-ERR value is not an integer or out of range\r\n", run({"INCRBY", "a", "042"}));
+    EXPECT_EQ("$3\r\n007\r\n", run({"GET", "b"}));
+
+    run({"SET", "t", "5", "PX", "100000"});
+    run({"INCR", "t"});
+    EXPECT_NE(0u, store.getExpireUnixMs("t"));
+
+    run({"SET", "max", "9223372036854775807"});
+    EXPECT_EQ("-ERR increment or decrement would overflow\r\n", run({"INCR", "max"}));
+    EXPECT_EQ("-ERR decrement would overflow\r\n",
+              run({"DECRBY", "max", "-9223372036854775808"}));
+    EXPECT_EQ("$19\r\n9223372036854775807\r\n", run({"GET", "max"}));
+    run({"SET", "s", "abc"});
+    EXPECT_EQ("-ERR value is not an integer or out of range\r\n", run({"INCR", "s"}));
+    EXPECT_EQ("-ERR value is not an integer or out of range\r\n",
+              run({"INCRBY", "n", "1.5"}));
+    run({"RPUSH", "list", "x"});
+    EXPECT_EQ(0u, run({"INCR", "list"}).find("-WRONGTYPE"));
+
+    EXPECT_EQ("$4\r\n10.5\r\n", run({"INCRBYFLOAT", "f", "10.5"}));
+    EXPECT_EQ("$2\r\n11\r\n", run({"INCRBYFLOAT", "f", "0.5"}));
+    EXPECT_TRUE(isInt("f"));
+    EXPECT_EQ("$4\r\n11.1\r\n", run({"INCRBYFLOAT", "f", "0.1"}));
+    EXPECT_EQ("$4\r\n11.5\r\n", run({"INCRBYFLOAT", "a", "-12333.5"}));
+    EXPECT_EQ("-ERR value is not a valid float\r\n", run({"INCRBYFLOAT", "s", "1"}));
+    EXPECT_EQ("$21\r\n100000000000000000000\r\n", run({"INCRBYFLOAT", "big", "1e20"}));
+}
+
+TEST(CommandHandlerTest, MgetAndMsetWorkOnManyKeysAtOnce) {
+    RedisStore store;
+    CommandHandler handler(store);
+    auto run = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+
+    run({"SET", "old", "x", "PX", "100000"});
+    EXPECT_EQ("+OK\r\n", run({"MSET", "a", "1", "b", "two", "old", "3"}));
+    EXPECT_EQ(0u, store.getExpireUnixMs("old"));
+    run({"RPUSH", "list", "x"});
+
+    EXPECT_EQ("*5\r\n$1\r\n1\r\n$3\r\ntwo\r\n$-1\r\n$-1\r\n$1\r\n3\r\n",
+              run({"MGET", "a", "b", "missing", "list", "old"}));
+
+    // Enough keys to run the lookahead past the end of the batch
+    std::vector<std::string> mset{"MSET"}, mget{"MGET"};
+    for (int i = 0; i < 40; ++i) {
+        mset.push_back("k" + std::to_string(i));
+        mset.push_back(std::string(static_cast<size_t>(i), 'v'));
+        mget.push_back("k" + std::to_string(i));
+    }
+    run(mset);
+    auto values = parseBulkArray(run(mget));
+    ASSERT_EQ(40u, values.size());
+    EXPECT_EQ(std::string(39, 'v'), values[39]);
+
+    EXPECT_EQ(":0\r\n", run({"MSETNX", "new", "1", "a", "9"}));
+    EXPECT_EQ("$-1\r\n", run({"GET", "new"}));
+    EXPECT_EQ(":1\r\n", run({"MSETNX", "new", "1", "other", "2"}));
+    EXPECT_EQ("$1\r\n2\r\n", run({"GET", "other"}));
+
+    EXPECT_EQ("-ERR wrong number of arguments for 'MSET'\r\n", run({"MSET", "a", "1", "b"}));
+    EXPECT_EQ((std::vector<std::string_view>{"a", "b"}),
+              handler.commandKeys(makeArgs({"MSET", "a", "1", "b", "2"}).views));
+}
+
+TEST(CommandHandlerTest, StringsAreEditedInPlace) {
+    RedisStore store;
+    CommandHandler handler(store);
+    auto run = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+
+    EXPECT_EQ(":5\r\n", run({"APPEND", "log", "line1"}));
+    EXPECT_EQ(":10\r\n", run({"APPEND", "log", "line2"}));
+    EXPECT_EQ("$10\r\nline1line2\r\n", run({"GET", "log"}));
+
+    // Capacity grows ahead of the value, so few appends reallocate
+    const std::string& raw = std::get<std::string>(store.getObject("log")->value);
+    int reallocations = 0;
+    for (int i = 0; i < 1000; ++i) {
+        const char* before = raw.data();
+        run({"APPEND", "log", "0123456789"});
+        reallocations += raw.data() != before;
+    }
+    EXPECT_LT(reallocations, 15);
+    EXPECT_EQ(":10010\r\n", run({"STRLEN", "log"}));
+
+    EXPECT_EQ("$5\r\nline2\r\n", run({"GETRANGE", "log", "5", "9"}));
+    EXPECT_EQ("$3\r\n789\r\n", run({"GETRANGE", "log", "-3", "-1"}));
+    EXPECT_EQ("$0\r\n\r\n", run({"GETRANGE", "log", "9", "5"}));
+    EXPECT_EQ("$0\r\n\r\n", run({"GETRANGE", "missing", "0", "-1"}));
+
+    // Integer-encoded values read and edit like their text
+    run({"SET", "n", "12345"});
+    EXPECT_EQ(":5\r\n", run({"STRLEN", "n"}));
+    EXPECT_EQ("$3\r\n234\r\n", run({"GETRANGE", "n", "1", "3"}));
+    EXPECT_EQ(":7\r\n", run({"APPEND", "n", "67"}));
+    EXPECT_EQ(":1234568\r\n", run({"INCR", "n"}));
+
+    EXPECT_EQ(":8\r\n", run({"SETRANGE", "blob", "5", "abc"}));
+    EXPECT_EQ(std::string("$8\r\n\0\0\0\0\0abc\r\n", 14), run({"GET", "blob"}));
+    EXPECT_EQ(":8\r\n", run({"SETRANGE", "blob", "0", "hello"}));
+    EXPECT_EQ("$8\r\nhelloabc\r\n", run({"GET", "blob"}));
+    EXPECT_EQ(":0\r\n", run({"SETRANGE", "none", "3", ""}));
+    EXPECT_EQ("+none\r\n", run({"TYPE", "none"}));
+    EXPECT_EQ("-ERR offset is out of range\r\n", run({"SETRANGE", "blob", "-1", "x"}));
+    EXPECT_EQ("-ERR string exceeds maximum allowed size (proto-max-bulk-len)\r\n",
+              run({"SETRANGE", "blob", "536870912", "x"}));
+
+    EXPECT_EQ("$8\r\nhelloabc\r\n", run({"GETDEL", "blob"}));
+    EXPECT_EQ("$-1\r\n", run({"GETDEL", "blob"}));
+
+    run({"SET", "s", "v"});
+    EXPECT_EQ("$1\r\nv\r\n", run({"GETEX", "s", "PX", "100000"}));
+    EXPECT_NE(0u, store.getExpireUnixMs("s"));
+    EXPECT_EQ("$1\r\nv\r\n", run({"GETEX", "s", "PERSIST"}));
+    EXPECT_EQ(0u, store.getExpireUnixMs("s"));
+    EXPECT_EQ("$1\r\nv\r\n", run({"GETEX", "s", "EXAT", "1"}));
+    EXPECT_EQ("$-1\r\n", run({"GET", "s"}));
+    EXPECT_EQ("-ERR invalid expire time in 'getex' command\r\n",
+              run({"GETEX", "log", "EX", "0"}));
+    EXPECT_EQ("-ERR syntax error\r\n", run({"GETEX", "log", "KEEPTTL"}));
+
+    run({"RPUSH", "list", "x"});
+    EXPECT_EQ(0u, run({"APPEND", "list", "x"}).find("-WRONGTYPE"));
+    EXPECT_EQ(0u, run({"GETDEL", "list"}).find("-WRONGTYPE"));
+}
+
 TEST(CommandHandlerTest, ListRangeReturnsInOrder) {
     RedisStore store;
     CommandHandler handler(store);
@@ -61,6 +220,90 @@ TEST(CommandHandlerTest, ListRangeReturnsInOrder) {
     EXPECT_EQ("three", items[2]);
 }
 
+TEST(CommandHandlerTest, ListRangeStreamsAcrossPackedAndCompressedNodes) {
+    RedisStore store;
+    CommandHandler handler(store);
+
+    List::SetCompressDepth(1);
+    std::vector<std::string> pushed;
+    for (int i = 0; i < 3000; ++i) {
+        pushed.push_back(i % 3 ? "entry-" + std::to_string(i) : std::to_string(i * 1000));
+        handler.execute(makeArgs({"RPUSH", "log", pushed.back()}).views, 1);
+    }
+    List::SetCompressDepth(0);
+
+    auto items = parseBulkArray(
+        handler.execute(makeArgs({"LRANGE", "log", "0", "-1"}).views, 1).reply);
+    EXPECT_EQ(pushed, items);
+
+    items = parseBulkArray(
+        handler.execute(makeArgs({"LRANGE", "log", "-2", "100000"}).views, 1).reply);
+    ASSERT_EQ(2u, items.size());
+    EXPECT_EQ(pushed[2998], items[0]);
+
+    EXPECT_EQ("*0\r\n", handler.execute(makeArgs({"LRANGE", "log", "5", "2"}).views, 1).reply);
+    EXPECT_EQ("-ERR value is not an integer or out of range\r\n",
+              handler.execute(makeArgs({"LRANGE", "log", "a", "2"}).views, 1).reply);
+}
+
+TEST(CommandHandlerTest, PopWithCountRepliesOnceAndDeletesEmptyList) {
+    RedisStore store;
+    CommandHandler handler(store);
+    auto run = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+
+    run({"RPUSH", "q", "a", "b", "c", "d", "e"});
+
+    EXPECT_EQ("*2\r\n$1\r\na\r\n$1\r\nb\r\n", run({"LPOP", "q", "2"}));
+    EXPECT_EQ("*2\r\n$1\r\ne\r\n$1\r\nd\r\n", run({"RPOP", "q", "2"}));
+
+    // A count of 0 pops nothing
+    EXPECT_EQ("*0\r\n", run({"LPOP", "q", "0"}));
+    EXPECT_EQ("*0\r\n", run({"RPOP", "q", "0"}));
+    EXPECT_EQ("$1\r\nc\r\n", run({"RPOP", "q"}));
+
+    EXPECT_EQ("+none\r\n", run({"TYPE", "q"}));
+    EXPECT_EQ("*-1\r\n", run({"LPOP", "q", "3"}));
+    EXPECT_EQ("$-1\r\n", run({"RPOP", "q"}));
+    EXPECT_EQ("-ERR value is out of range, must be positive\r\n", run({"LPOP", "q", "-1"}));
+}
+
+TEST(CommandHandlerTest, ListEditingCommands) {
+    RedisStore store;
+    CommandHandler handler(store);
+    auto run = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+
+    run({"RPUSH", "l", "x", "a", "x", "b", "x", "c"});
+
+    EXPECT_EQ(":2\r\n", run({"LREM", "l", "2", "x"}));
+    EXPECT_EQ("$1\r\nb\r\n", run({"LINDEX", "l", "1"}));
+    EXPECT_EQ("$1\r\nc\r\n", run({"LINDEX", "l", "-1"}));
+    EXPECT_EQ("$-1\r\n", run({"LINDEX", "l", "10"}));
+
+    EXPECT_EQ(":5\r\n", run({"LINSERT", "l", "BEFORE", "b", "y"}));
+    EXPECT_EQ(":-1\r\n", run({"LINSERT", "l", "AFTER", "nope", "y"}));
+    EXPECT_EQ(":0\r\n", run({"LINSERT", "missing", "AFTER", "b", "y"}));
+
+    EXPECT_EQ("+OK\r\n", run({"LSET", "l", "0", "A"}));
+    EXPECT_EQ("-ERR index out of range\r\n", run({"LSET", "l", "9", "A"}));
+    EXPECT_EQ("-ERR no such key\r\n", run({"LSET", "missing", "0", "A"}));
+
+    // A x b -> trimmed to the middle three
+    EXPECT_EQ("+OK\r\n", run({"LTRIM", "l", "1", "-2"}));
+    auto items = parseBulkArray(run({"LRANGE", "l", "0", "-1"}));
+    EXPECT_EQ((std::vector<std::string>{"y", "b", "x"}), items);
+
+    EXPECT_EQ("+OK\r\n", run({"LTRIM", "l", "5", "10"}));
+    EXPECT_EQ("+none\r\n", run({"TYPE", "l"}));
+
+    run({"SET", "s", "v"});
+    EXPECT_EQ(0u, run({"LINDEX", "s", "0"}).rfind("-WRONGTYPE", 0));
+    EXPECT_EQ(0u, run({"RPOP", "s"}).rfind("-WRONGTYPE", 0));
+}
+
 TEST(CommandHandlerTest, BlpopReturnsImmediateResult) {
     RedisStore store;
     CommandHandler handler(store);
@@ -75,6 +318,122 @@ TEST(CommandHandlerTest, BlpopReturnsImmediateResult) {
     EXPECT_EQ("job1", items[1]);
 }
 
+TEST(CommandHandlerTest, BlockedClientsAreServedFifoAcrossKeys) {
+    RedisStore store;
+    CommandHandler handler(store);
+    std::map<int, std::string> sent;
+    handler.setSender([&](int fd, std::string_view data) { sent[fd].append(data); });
+
+    auto run = [&](std::vector<std::string> args, int fd) {
+        return handler.execute(makeArgs(args).views, fd);
+    };
+
+    // fd 10 waits on both queues, fd 11 only on "low", fd 12 tails "low"
+    EXPECT_TRUE(run({"BLPOP", "high", "low", "0"}, 10).should_write);
+    EXPECT_TRUE(run({"BLPOP", "low", "0"}, 11).should_write);
+    EXPECT_TRUE(run({"BRPOP", "low", "0"}, 12).should_write);
+    EXPECT_TRUE(handler.isBlocked(10));
+
+    // One push, three waiters: each gets exactly one element, in order
+    EXPECT_EQ(":3\r\n", run({"RPUSH", "low", "a", "b", "c"}, 1).reply);
+    EXPECT_EQ("*2\r\n$3\r\nlow\r\n$1\r\na\r\n", sent[10]);
+    EXPECT_EQ("*2\r\n$3\r\nlow\r\n$1\r\nb\r\n", sent[11]);
+    EXPECT_EQ("*2\r\n$3\r\nlow\r\n$1\r\nc\r\n", sent[12]);
+    EXPECT_EQ("+none\r\n", run({"TYPE", "low"}, 1).reply);
+
+    // fd 10 left "high" as well, so this element stays in the list
+    EXPECT_FALSE(handler.isBlocked(10));
+    run({"RPUSH", "high", "x"}, 1);
+    EXPECT_EQ(":1\r\n", run({"LLEN", "high"}, 1).reply);
+
+    // Immediate pops take the first non-empty key
+    auto items = parseBulkArray(run({"BRPOP", "empty", "high", "1"}, 13).reply);
+    EXPECT_EQ((std::vector<std::string>{"high", "x"}), items);
+}
+
+TEST(CommandHandlerTest, DisconnectedAndTimedOutWaitersAreDropped) {
+    RedisStore store;
+    CommandHandler handler(store);
+    std::map<int, std::string> sent;
+    handler.setSender([&](int fd, std::string_view data) { sent[fd].append(data); });
+
+    auto run = [&](std::vector<std::string> args, int fd) {
+        return handler.execute(makeArgs(args).views, fd);
+    };
+
+    run({"BLPOP", "jobs", "0"}, 10);
+    run({"BLPOP", "jobs", "0.01"}, 11);
+    run({"BLPOP", "jobs", "0"}, 12);
+
+    // The first waiter went away: its job must go to the next live one
+    handler.onClientDisconnected(10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    handler.checkTimeouts();
+    EXPECT_EQ("*-1\r\n", sent[11]);
+
+    run({"RPUSH", "jobs", "job1"}, 1);
+    EXPECT_EQ(0u, sent.count(10));
+    EXPECT_EQ("*2\r\n$4\r\njobs\r\n$4\r\njob1\r\n", sent[12]);
+
+    EXPECT_EQ("-ERR timeout is negative\r\n", run({"BLPOP", "jobs", "-1"}, 1).reply);
+    EXPECT_EQ("-ERR timeout is not a float or out of range\r\n",
+              run({"BLPOP", "jobs", "soon"}, 1).reply);
+}
+
+TEST(CommandHandlerTest, LmoveRotatesAndMovesBetweenLists) {
+    RedisStore store;
+    CommandHandler handler(store);
+    auto run = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+
+    run({"RPUSH", "pending", "a", "b", "c"});
+
+    EXPECT_EQ("$1\r\na\r\n", run({"LMOVE", "pending", "pending", "LEFT", "RIGHT"}));
+    EXPECT_EQ("$1\r\na\r\n", run({"RPOPLPUSH", "pending", "processing"}));
+    EXPECT_EQ("$1\r\nb\r\n", run({"LMOVE", "pending", "processing", "left", "right"}));
+    EXPECT_EQ((std::vector<std::string>{"a", "b"}),
+              parseBulkArray(run({"LRANGE", "processing", "0", "-1"})));
+
+    EXPECT_EQ("$1\r\nc\r\n", run({"LMOVE", "pending", "processing", "LEFT", "LEFT"}));
+    EXPECT_EQ("+none\r\n", run({"TYPE", "pending"}));
+    EXPECT_EQ("$-1\r\n", run({"LMOVE", "pending", "processing", "LEFT", "LEFT"}));
+
+    run({"SET", "str", "v"});
+    EXPECT_EQ(0u, run({"LMOVE", "processing", "str", "LEFT", "LEFT"}).rfind("-WRONGTYPE", 0));
+    EXPECT_EQ("-ERR syntax error\r\n", run({"LMOVE", "processing", "x", "UP", "LEFT"}));
+}
+
+TEST(CommandHandlerTest, BlmoveWakeupMovesBeforeReplying) {
+    RedisStore store;
+    CommandHandler handler(store);
+    std::map<int, std::string> sent;
+    handler.setSender([&](int fd, std::string_view data) { sent[fd].append(data); });
+
+    auto run = [&](std::vector<std::string> args, int fd) {
+        return handler.execute(makeArgs(args).views, fd);
+    };
+
+    // Worker 10 moves pending → processing; worker 11 waits on processing
+    EXPECT_TRUE(run({"BRPOPLPUSH", "pending", "processing", "0"}, 10).should_write);
+    EXPECT_TRUE(run({"BLMOVE", "processing", "done", "LEFT", "RIGHT", "0"}, 11).should_write);
+
+    run({"LPUSH", "pending", "job1"}, 1);
+
+    // Both handoffs ran within the LPUSH: the job went all the way through
+    EXPECT_EQ("$4\r\njob1\r\n", sent[10]);
+    EXPECT_EQ("$4\r\njob1\r\n", sent[11]);
+    EXPECT_EQ("+none\r\n", run({"TYPE", "pending"}, 1).reply);
+    EXPECT_EQ("+none\r\n", run({"TYPE", "processing"}, 1).reply);
+    EXPECT_EQ((std::vector<std::string>{"job1"}),
+              parseBulkArray(run({"LRANGE", "done", "0", "-1"}, 1).reply));
+
+    // Immediate path when the source already has elements
+    run({"RPUSH", "pending", "job2"}, 1);
+    EXPECT_EQ("$4\r\njob2\r\n",
+              run({"BLMOVE", "pending", "done", "RIGHT", "LEFT", "0"}, 12).reply);
+}
+
 TEST(CommandHandlerTest, TypeReflectsStoredObjects) {
     RedisStore store;
     CommandHandler handler(store);
@@ -114,10 +473,420 @@ TEST(CommandHandlerTest, XaddAndXrangeProduceStructuredOutput) {
     EXPECT_EQ(expected, rangeReply.reply);
 }
 
-TEST(CommandHandlerTest, XreadWithoutEntriesReturnsNullBulk) {
+TEST(CommandHandlerTest, StreamIdsAreParsedAsUnsigned64BitPairs) {
+    RedisStore store;
+    CommandHandler handler(store);
+    auto run = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+
+    EXPECT_EQ("$3\r\n5-0\r\n", run({"XADD", "s", "5", "f", "v"}));
+    EXPECT_EQ("$21\r\n9223372036854775808-0\r\n",
+              run({"XADD", "s", "9223372036854775808-0", "f", "v"}));
+    EXPECT_EQ("-ERR Invalid stream ID specified as stream command argument\r\n",
+              run({"XADD", "s", "18446744073709551616-0", "f", "v"}));
+    EXPECT_EQ(0u, run({"XADD", "s", "6-0", "f", "v"}).find("-ERR The ID specified in XADD is equal"));
+
+    // "-" / "+" and millisecond-only bounds
+    EXPECT_EQ(0u, run({"XRANGE", "s", "-", "+"}).rfind("*2\r\n", 0));
+    EXPECT_EQ(0u, run({"XRANGE", "s", "5", "5"}).rfind("*1\r\n", 0));
+    EXPECT_EQ("-ERR Invalid stream ID specified as stream command argument\r\n",
+              run({"XRANGE", "s", "x", "+"}));
+}
+
+TEST(CommandHandlerTest, XrangeAndXrevrangeHonourCountAndExclusiveBounds) {
+    RedisStore store;
+    CommandHandler handler(store);
+    auto run = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+    auto ids = [&](std::vector<std::string> args) {
+        std::vector<std::string> out;
+        std::string reply = run(args);
+        for (size_t pos = 0; (pos = reply.find("*2\r\n$", pos)) != std::string::npos; ) {
+            pos = reply.find("\r\n", pos + 4) + 2;
+            out.push_back(reply.substr(pos, reply.find("\r\n", pos) - pos));
+        }
+        return out;
+    };
+
+    // Two fields, so only entries start with "*2"
+    for (int i = 1; i <= 5; ++i)
+        run({"XADD", "s", std::to_string(i) + "-1", "f", "v", "g", "w"});
+
+    using V = std::vector<std::string>;
+    EXPECT_EQ((V{"1-1", "2-1"}), ids({"XRANGE", "s", "-", "+", "COUNT", "2"}));
+    EXPECT_EQ((V{"5-1", "4-1", "3-1"}), ids({"XREVRANGE", "s", "+", "(2-1"}));
+    EXPECT_EQ((V{"3-1", "4-1"}), ids({"XRANGE", "s", "(2-1", "(5-1"}));
+    EXPECT_EQ((V{"4-1"}), ids({"XREVRANGE", "s", "4", "(3-1", "COUNT", "9"}));
+    EXPECT_EQ("*0\r\n", run({"XRANGE", "s", "-", "+", "COUNT", "0"}));
+    EXPECT_EQ("*0\r\n", run({"XREVRANGE", "s", "-", "+"}));   // end before start
+
+    EXPECT_EQ("-ERR invalid start ID for the interval\r\n",
+              run({"XRANGE", "s", "(18446744073709551615-18446744073709551615", "+"}));
+    EXPECT_EQ("-ERR invalid end ID for the interval\r\n", run({"XRANGE", "s", "-", "(0-0"}));
+    EXPECT_EQ(0u, run({"XRANGE", "s", "(-", "+"}).find("-ERR Invalid stream ID"));
+    EXPECT_EQ("-ERR syntax error\r\n", run({"XRANGE", "s", "-", "+", "LIMIT", "1"}));
+}
+
+TEST(CommandHandlerTest, XaggReturnsOneRowPerBucket) {
+    RedisStore store;
+    CommandHandler handler(store);
+    auto run = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+
+    run({"XADD", "t", "60000-0", "temp", "20"});
+    run({"XADD", "t", "60500-0", "temp", "21.5"});
+    run({"XADD", "t", "61000-0", "hum", "40"});
+    run({"XADD", "t", "125000-0", "temp", "-3"});
+
+    EXPECT_EQ("*2\r\n"
+              "*4\r\n:60000\r\n$2\r\n20\r\n$4\r\n21.5\r\n:2\r\n"
+              "*4\r\n:120000\r\n$2\r\n-3\r\n$2\r\n-3\r\n:1\r\n",
+              run({"XAGG", "t", "-", "+", "temp", "60000", "min", "max", "count"}));
+    EXPECT_EQ("*1\r\n*3\r\n:60000\r\n$5\r\n20.75\r\n$4\r\n41.5\r\n",
+              run({"XAGG", "t", "-", "(125000-0", "temp", "60000", "AVG", "SUM"}));
+    EXPECT_EQ(0u, run({"XAGG", "t", "-", "+", "temp", "1000"}).find("*2\r\n*8\r\n:60000\r\n"));
+
+    EXPECT_EQ("-ERR bucket size must be a positive integer\r\n",
+              run({"XAGG", "t", "-", "+", "temp", "0"}));
+    EXPECT_EQ("-ERR unknown aggregator 'median'\r\n",
+              run({"XAGG", "t", "-", "+", "temp", "10", "median"}));
+    EXPECT_EQ("*0\r\n", run({"XAGG", "missing", "-", "+", "temp", "10"}));
+}
+
+TEST(CommandHandlerTest, XtrimXdelAndXaddTrimming) {
+    RedisStore store;
+    CommandHandler handler(store);
+    auto run = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+
+    for (int i = 1; i <= 10; ++i)
+        run({"XADD", "s", std::to_string(i) + "-0", "f", "v"});
+
+    EXPECT_EQ(":2\r\n", run({"XDEL", "s", "3-0", "4-0", "99-0"}));
+    EXPECT_EQ(":8\r\n", run({"XLEN", "s"}));
+    EXPECT_EQ(":2\r\n", run({"XTRIM", "s", "MAXLEN", "=", "6"}));
+    EXPECT_EQ(":1\r\n", run({"XTRIM", "s", "MINID", "6"}));
+    EXPECT_EQ(0u, run({"XRANGE", "s", "-", "+"}).rfind("*5\r\n*2\r\n$3\r\n6-0", 0));
+
+    // XADD trims after adding; the newest entry's ID stays reserved
+    EXPECT_EQ("$4\r\n11-0\r\n", run({"XADD", "s", "MAXLEN", "2", "11-0", "f", "v"}));
+    EXPECT_EQ(":2\r\n", run({"XLEN", "s"}));
+    EXPECT_EQ(":0\r\n", run({"XTRIM", "s", "MAXLEN", "~", "1"}));    // would split the node
+    EXPECT_EQ(":1\r\n", run({"XDEL", "s", "11-0"}));
+    EXPECT_EQ(0u, run({"XADD", "s", "11-0", "f", "v"}).find("-ERR The ID specified in XADD is equal"));
+
+    EXPECT_EQ("-ERR syntax error, LIMIT cannot be used without the special ~ option\r\n",
+              run({"XTRIM", "s", "MAXLEN", "5", "LIMIT", "10"}));
+    EXPECT_EQ("-ERR The MAXLEN argument must be >= 0.\r\n", run({"XTRIM", "s", "MAXLEN", "-1"}));
+    EXPECT_EQ("-ERR syntax error\r\n", run({"XTRIM", "s", "COUNT", "1"}));
+    EXPECT_EQ(":0\r\n", run({"XTRIM", "missing", "MAXLEN", "0"}));
+
+    // Failed XADDs neither create nor clobber keys
+    run({"RPUSH", "list", "a"});
+    EXPECT_EQ("-WRONGTYPE Operation against a key holding the wrong kind of value\r\n",
+              run({"XADD", "list", "*", "f", "v"}));
+    EXPECT_EQ("+list\r\n", run({"TYPE", "list"}));
+    run({"XADD", "fresh", "0-0", "f", "v"});
+    EXPECT_EQ("+none\r\n", run({"TYPE", "fresh"}));
+}
+
+TEST(CommandHandlerTest, ConsumerGroupsTrackPendingEntries) {
     RedisStore store;
     CommandHandler handler(store);
+    std::map<int, std::string> sent;
+    handler.setSender([&](int fd, std::string_view data) { sent[fd].append(data); });
+
+    auto run = [&](std::vector<std::string> args, int fd = 1) {
+        return handler.execute(makeArgs(args).views, fd).reply;
+    };
+
+    EXPECT_EQ(0u, run({"XGROUP", "CREATE", "s", "g", "$"}).find("-ERR The XGROUP subcommand requires"));
+    EXPECT_EQ("+OK\r\n", run({"XGROUP", "CREATE", "s", "g", "$", "MKSTREAM"}));
+    EXPECT_EQ("-BUSYGROUP Consumer Group name already exists\r\n",
+              run({"XGROUP", "CREATE", "s", "g", "0"}));
+
+    for (int i = 1; i <= 4; ++i)
+        run({"XADD", "s", std::to_string(i) + "-0", "f", std::to_string(i)});
+
+    // ">" hands out what the group has not seen yet
+    EXPECT_EQ("*1\r\n*2\r\n$1\r\ns\r\n*2\r\n"
+              "*2\r\n$3\r\n1-0\r\n*2\r\n$1\r\nf\r\n$1\r\n1\r\n"
+              "*2\r\n$3\r\n2-0\r\n*2\r\n$1\r\nf\r\n$1\r\n2\r\n",
+              run({"XREADGROUP", "GROUP", "g", "alice", "COUNT", "2", "STREAMS", "s", ">"}));
+    run({"XREADGROUP", "GROUP", "g", "bob", "STREAMS", "s", ">"});
+    EXPECT_EQ("*-1\r\n", run({"XREADGROUP", "GROUP", "g", "bob", "STREAMS", "s", ">"}));
+
+    EXPECT_EQ("*4\r\n:4\r\n$3\r\n1-0\r\n$3\r\n4-0\r\n"
+              "*2\r\n*2\r\n$5\r\nalice\r\n$1\r\n2\r\n*2\r\n$3\r\nbob\r\n$1\r\n2\r\n",
+              run({"XPENDING", "s", "g"}));
+
+    EXPECT_EQ(":1\r\n", run({"XACK", "s", "g", "1-0", "99-0"}));
+    auto pending = run({"XPENDING", "s", "g", "-", "+", "10", "bob"});
+    EXPECT_EQ(0u, pending.find("*2\r\n*4\r\n$3\r\n3-0\r\n$3\r\nbob\r\n"));
+
+    // Claims move ownership; an entry gone from the stream leaves the PEL
+    EXPECT_EQ("*1\r\n$3\r\n3-0\r\n",
+              run({"XCLAIM", "s", "g", "alice", "0", "3-0", "JUSTID"}));
+    run({"XDEL", "s", "2-0"});
+    EXPECT_EQ("*3\r\n$3\r\n0-0\r\n*2\r\n$3\r\n3-0\r\n$3\r\n4-0\r\n*1\r\n$3\r\n2-0\r\n",
+              run({"XAUTOCLAIM", "s", "g", "carol", "0", "-", "JUSTID"}));
+    EXPECT_EQ("-ERR COUNT must be > 0\r\n",
+              run({"XAUTOCLAIM", "s", "g", "carol", "0", "-", "COUNT", "0"}));
+
+    // History reads return the consumer's own pending entries
+    run({"XREADGROUP", "GROUP", "g", "dave", "STREAMS", "s", "0"});
+    run({"XCLAIM", "s", "g", "dave", "0", "3-0", "JUSTID"});
+    run({"XDEL", "s", "3-0"});
+    EXPECT_EQ("*1\r\n*2\r\n$1\r\ns\r\n*1\r\n*2\r\n$3\r\n3-0\r\n*-1\r\n",
+              run({"XREADGROUP", "GROUP", "g", "dave", "STREAMS", "s", "0"}));
+
+    EXPECT_EQ(0u, run({"XREADGROUP", "GROUP", "nope", "c", "STREAMS", "s", ">"}).find("-NOGROUP"));
+    EXPECT_EQ(":1\r\n", run({"XGROUP", "DELCONSUMER", "s", "g", "dave"}));
+
+    // Blocked group readers compete for the next entry
+    EXPECT_EQ("", run({"XREADGROUP", "GROUP", "g", "w1", "BLOCK", "0", "STREAMS", "s", ">"}, 10));
+    EXPECT_EQ("", run({"XREADGROUP", "GROUP", "g", "w2", "BLOCK", "0", "STREAMS", "s", ">"}, 11));
+    run({"XADD", "s", "5-0", "f", "5"});
+    EXPECT_EQ("*1\r\n*2\r\n$1\r\ns\r\n*1\r\n*2\r\n$3\r\n5-0\r\n*2\r\n$1\r\nf\r\n$1\r\n5\r\n",
+              sent[10]);
+    EXPECT_EQ(0u, sent.count(11));
+
+    EXPECT_EQ(":1\r\n", run({"XGROUP", "DESTROY", "s", "g"}));
+    EXPECT_EQ("-NOGROUP No such key 's' or consumer group 'g'\r\n", sent[11]);
+}
+
+TEST(CommandHandlerTest, XreadWithoutEntriesReturnsNullArray) {
+    RedisStore store;
+    CommandHandler handler(store);
+
+    auto reply = handler.execute(makeArgs({"XREAD", "STREAMS", "mystream", "0-0"}).views, 1);
+    EXPECT_EQ("*-1\r\n", reply.reply);
+}
 
-    auto reply = handler.execute(makeArgs({"XREAD", "streams", "mystream", "0-0"}).views, 1);
-    EXPECT_EQ("$-1\r\n", reply.reply);
+TEST(CommandHandlerTest, BlockedXreadIsServedOncePerClient) {
+    RedisStore store;
+    CommandHandler handler(store);
+    std::map<int, std::string> sent;
+    handler.setSender([&](int fd, std::string_view data) { sent[fd].append(data); });
+
+    auto run = [&](std::vector<std::string> args, int fd) {
+        return handler.execute(makeArgs(args).views, fd);
+    };
+
+    run({"XADD", "a", "1-0", "f", "v"}, 1);
+
+    // Waiters from the same ID share one reply; keys may not exist yet
+    run({"XREAD", "BLOCK", "0", "STREAMS", "a", "b", "$", "$"}, 10);
+    run({"XREAD", "BLOCK", "0", "STREAMS", "b", "a", "$", "$"}, 11);
+    EXPECT_EQ(0u, run({"XREAD", "BLOCK", "0", "STREAMS", "a", "0"}, 12).reply.find("*1\r\n"));
+    run({"XREAD", "BLOCK", "0", "STREAMS", "b", "$"}, 13);
+    EXPECT_TRUE(handler.isBlocked(10));
+    EXPECT_FALSE(handler.isBlocked(12));
+
+    run({"XADD", "a", "2-0", "f", "v"}, 1);
+    std::string expected = "*1\r\n*2\r\n$1\r\na\r\n*1\r\n*2\r\n$3\r\n2-0\r\n"
+                           "*2\r\n$1\r\nf\r\n$1\r\nv\r\n";
+    EXPECT_EQ(expected, sent[10]);
+    EXPECT_EQ(expected, sent[11]);
+    EXPECT_FALSE(handler.isBlocked(10));
+
+    // Served on "a", they no longer wait on "b"
+    run({"XADD", "b", "1-0", "f", "v"}, 1);
+    EXPECT_EQ(expected, sent[10]);
+    EXPECT_EQ(expected, sent[11]);
+    EXPECT_EQ(0u, sent[13].find("*1\r\n*2\r\n$1\r\nb\r\n"));
+
+    // Timeouts go through the same index as the list waiters
+    run({"XREAD", "BLOCK", "10", "STREAMS", "c", "$"}, 14);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    handler.checkTimeouts();
+    EXPECT_EQ("*-1\r\n", sent[14]);
+    EXPECT_FALSE(handler.isBlocked(14));
+}
+
+TEST(CommandHandlerTest, HashCommandsKeepFieldsAndTheirExpiry) {
+    RedisStore store;
+    CommandHandler handler(store);
+    auto run = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+
+    EXPECT_EQ(":2\r\n", run({"HSET", "session", "user", "42", "theme", "dark"}));
+    EXPECT_EQ(":0\r\n", run({"HSET", "session", "theme", "light"}));
+    EXPECT_EQ("+hash\r\n", run({"TYPE", "session"}));
+    EXPECT_EQ("$5\r\nlight\r\n", run({"HGET", "session", "theme"}));
+    EXPECT_EQ("*3\r\n$2\r\n42\r\n$-1\r\n$5\r\nlight\r\n",
+              run({"HMGET", "session", "user", "nope", "theme"}));
+    EXPECT_EQ(":52\r\n", run({"HINCRBY", "session", "user", "10"}));
+    EXPECT_EQ("-ERR hash value is not an integer\r\n", run({"HINCRBY", "session", "theme", "1"}));
+    EXPECT_EQ("$4\r\n52.5\r\n", run({"HINCRBYFLOAT", "session", "user", "0.5"}));
+    EXPECT_EQ("$21\r\n100000000000000000000\r\n",
+              run({"HINCRBYFLOAT", "floats", "big", "1e20"}));
+    run({"HINCRBYFLOAT", "floats", "sum", "0.1"});
+    EXPECT_EQ("$3\r\n0.3\r\n", run({"HINCRBYFLOAT", "floats", "sum", "0.2"}));
+    EXPECT_EQ("*4\r\n$4\r\nuser\r\n$4\r\n52.5\r\n$5\r\ntheme\r\n$5\r\nlight\r\n",
+              run({"HGETALL", "session"}));
+
+    run({"RPUSH", "list", "a"});
+    EXPECT_EQ(0u, run({"HGET", "list", "a"}).find("-WRONGTYPE"));
+
+    // HSCAN over a table, filtered and without values
+    for (int i = 0; i < 300; ++i)
+        run({"HSET", "big", "k" + std::to_string(i), "v"});
+    std::set<std::string> seen;
+    std::string cursor = "0";
+    do {
+        std::string reply = run({"HSCAN", "big", cursor, "MATCH", "k1?", "NOVALUES"});
+        size_t items = reply.find("\r\n*", 4);
+        ASSERT_NE(std::string::npos, items);
+        cursor = parseBulkArray("*1\r\n" + reply.substr(4, items - 2))[0];
+        auto fields = parseBulkArray(reply.substr(items + 2));
+        seen.insert(fields.begin(), fields.end());
+    } while (cursor != "0");
+    EXPECT_EQ(10u, seen.size());
+    EXPECT_TRUE(seen.count("k15"));
+
+    // Field expiry
+    EXPECT_EQ("*3\r\n:1\r\n:-2\r\n:1\r\n",
+              run({"HPEXPIRE", "session", "20", "FIELDS", "3", "user", "nope", "theme"}));
+    EXPECT_EQ("*1\r\n:0\r\n", run({"HEXPIRE", "session", "100", "NX", "FIELDS", "1", "user"}));
+    EXPECT_EQ("*1\r\n:1\r\n", run({"HPERSIST", "session", "FIELDS", "1", "theme"}));
+    EXPECT_EQ("*2\r\n:-1\r\n:-2\r\n", run({"HTTL", "session", "FIELDS", "2", "theme", "nope"}));
+    EXPECT_EQ("-ERR The `numfields` parameter must match the number of arguments\r\n",
+              run({"HTTL", "session", "FIELDS", "2", "theme"}));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_EQ(":1\r\n", run({"HLEN", "session"}));
+    EXPECT_EQ(":1\r\n", run({"HDEL", "session", "theme", "user"}));
+    EXPECT_EQ("+none\r\n", run({"TYPE", "session"}));
+}
+
+TEST(CommandHandlerTest, SetCommandsStoreAndCombineMembers) {
+    RedisStore store;
+    CommandHandler handler(store);
+    auto run = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+    auto members = [&](std::vector<std::string> args) {
+        auto items = parseBulkArray(run(args));
+        return std::set<std::string>(items.begin(), items.end());
+    };
+
+    EXPECT_EQ(":3\r\n", run({"SADD", "a", "3", "1", "2", "1"}));
+    EXPECT_EQ("+set\r\n", run({"TYPE", "a"}));
+    EXPECT_EQ("*3\r\n$1\r\n1\r\n$1\r\n2\r\n$1\r\n3\r\n", run({"SMEMBERS", "a"}));
+    EXPECT_EQ(":3\r\n", run({"SADD", "b", "2", "3", "four"}));
+    run({"SADD", "b", "5"});
+
+    EXPECT_EQ(":1\r\n", run({"SISMEMBER", "b", "four"}));
+    EXPECT_EQ("*3\r\n:1\r\n:0\r\n:0\r\n", run({"SMISMEMBER", "a", "1", "4", "01"}));
+    EXPECT_EQ(":4\r\n", run({"SCARD", "b"}));
+
+    EXPECT_EQ((std::set<std::string>{"2", "3"}), members({"SINTER", "a", "b"}));
+    EXPECT_EQ((std::set<std::string>{"1", "2", "3", "5", "four"}), members({"SUNION", "a", "b"}));
+    EXPECT_EQ((std::set<std::string>{"1"}), members({"SDIFF", "a", "b"}));
+    EXPECT_EQ("*0\r\n", run({"SINTER", "a", "missing"}));
+    EXPECT_EQ(":2\r\n", run({"SINTERCARD", "2", "a", "b"}));
+    EXPECT_EQ(":1\r\n", run({"SINTERCARD", "2", "a", "b", "LIMIT", "1"}));
+    EXPECT_EQ("-ERR syntax error\r\n", run({"SINTERCARD", "1", "a", "b"}));
+    EXPECT_EQ((std::vector<std::string_view>{"a", "b"}),
+              handler.commandKeys(makeArgs({"SINTERCARD", "2", "a", "b", "LIMIT", "1"}).views));
+
+    // STORE variants replace the destination, or delete it when empty
+    run({"SET", "dest", "string"});
+    EXPECT_EQ(":5\r\n", run({"SUNIONSTORE", "dest", "a", "b"}));
+    EXPECT_EQ("+set\r\n", run({"TYPE", "dest"}));
+    EXPECT_EQ(":2\r\n", run({"SINTERSTORE", "dest", "a", "b"}));
+    EXPECT_EQ(":0\r\n", run({"SDIFFSTORE", "dest", "a", "a"}));
+    EXPECT_EQ("+none\r\n", run({"TYPE", "dest"}));
+
+    run({"RPUSH", "list", "x"});
+    EXPECT_EQ(0u, run({"SINTER", "a", "list"}).find("-WRONGTYPE"));
+    EXPECT_EQ(0u, run({"SADD", "list", "x"}).find("-WRONGTYPE"));
+
+    EXPECT_EQ(":3\r\n", run({"SREM", "a", "1", "2", "3", "9"}));
+    EXPECT_EQ("+none\r\n", run({"TYPE", "a"}));
+}
+
+TEST(CommandHandlerTest, SortedSetCommandsRankAndRange) {
+    RedisStore store;
+    CommandHandler handler(store);
+    auto run = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+
+    EXPECT_EQ(":4\r\n", run({"ZADD", "board", "10", "ann", "20", "bob", "15", "cat", "-inf", "dan"}));
+    EXPECT_EQ("+zset\r\n", run({"TYPE", "board"}));
+    EXPECT_EQ(":0\r\n", run({"ZADD", "board", "NX", "99", "ann"}));
+    EXPECT_EQ(":1\r\n", run({"ZADD", "board", "GT", "CH", "5", "ann", "25", "bob"}));
+    EXPECT_EQ("$-1\r\n", run({"ZADD", "board", "XX", "INCR", "1", "eve"}));
+    EXPECT_EQ("$4\r\n17.5\r\n", run({"ZINCRBY", "board", "2.5", "cat"}));
+    EXPECT_EQ("-ERR value is not a valid float\r\n", run({"ZADD", "board", "x", "ann"}));
+    EXPECT_EQ("$4\r\n-inf\r\n", run({"ZSCORE", "board", "dan"}));
+
+    // dan -inf, ann 10, cat 17.5, bob 25
+    EXPECT_EQ(":2\r\n", run({"ZRANK", "board", "cat"}));
+    EXPECT_EQ(":0\r\n", run({"ZREVRANK", "board", "bob"}));
+    EXPECT_EQ("*2\r\n:1\r\n$2\r\n10\r\n", run({"ZRANK", "board", "ann", "WITHSCORE"}));
+    EXPECT_EQ((std::vector<std::string>{"ann", "cat"}), parseBulkArray(run({"ZRANGE", "board", "1", "2"})));
+    EXPECT_EQ((std::vector<std::string>{"bob", "cat"}),
+              parseBulkArray(run({"ZRANGE", "board", "0", "1", "REV"})));
+    EXPECT_EQ((std::vector<std::string>{"ann", "10", "cat", "17.5"}),
+              parseBulkArray(run({"ZRANGE", "board", "(-inf", "(25", "BYSCORE", "WITHSCORES"})));
+    EXPECT_EQ((std::vector<std::string>{"cat", "ann"}),
+              parseBulkArray(run({"ZRANGE", "board", "+inf", "0", "BYSCORE", "REV", "LIMIT", "1", "5"})));
+    EXPECT_EQ(":2\r\n", run({"ZCOUNT", "board", "10", "(25"}));
+    EXPECT_EQ(0u, run({"ZRANGE", "board", "0", "1", "LIMIT", "0", "1"}).find("-ERR syntax error"));
+
+    run({"ZADD", "names", "0", "a", "0", "b", "0", "c", "0", "d"});
+    EXPECT_EQ((std::vector<std::string>{"b", "c"}),
+              parseBulkArray(run({"ZRANGE", "names", "(a", "[c", "BYLEX"})));
+    EXPECT_EQ((std::vector<std::string>{"d", "c"}),
+              parseBulkArray(run({"ZRANGE", "names", "+", "[b", "BYLEX", "REV", "LIMIT", "0", "2"})));
+
+    EXPECT_EQ("*4\r\n$3\r\ndan\r\n$4\r\n-inf\r\n$3\r\nann\r\n$2\r\n10\r\n",
+              run({"ZPOPMIN", "board", "2"}));
+    EXPECT_EQ("*2\r\n$3\r\nbob\r\n$2\r\n25\r\n", run({"ZPOPMAX", "board"}));
+    EXPECT_EQ(":1\r\n", run({"ZREMRANGEBYSCORE", "board", "-inf", "+inf"}));
+    EXPECT_EQ("+none\r\n", run({"TYPE", "board"}));
+
+    run({"RPUSH", "list", "x"});
+    EXPECT_EQ(0u, run({"ZADD", "list", "1", "x"}).find("-WRONGTYPE"));
+}
+
+TEST(CommandHandlerTest, BzpopminWaitsBesideListWaiters) {
+    RedisStore store;
+    CommandHandler handler(store);
+    std::map<int, std::string> sent;
+    handler.setSender([&](int fd, std::string_view data) { sent[fd].append(data); });
+
+    auto run = [&](std::vector<std::string> args, int fd) {
+        return handler.execute(makeArgs(args).views, fd);
+    };
+
+    // A list waiter queued first on the same key must not take the member
+    run({"BLPOP", "q", "0"}, 10);
+    run({"BZPOPMIN", "q", "0"}, 11);
+    run({"BZPOPMAX", "other", "q", "0"}, 12);
+
+    EXPECT_EQ(":3\r\n", run({"ZADD", "q", "3", "c", "1", "a", "2", "b"}, 1).reply);
+    EXPECT_EQ("*3\r\n$1\r\nq\r\n$1\r\na\r\n$1\r\n1\r\n", sent[11]);
+    EXPECT_EQ("*3\r\n$1\r\nq\r\n$1\r\nc\r\n$1\r\n3\r\n", sent[12]);
+    EXPECT_TRUE(handler.isBlocked(10));
+    EXPECT_EQ(0u, sent.count(10));
+    EXPECT_EQ(":1\r\n", run({"ZCARD", "q"}, 1).reply);
+
+    // Served immediately when a member is there
+    EXPECT_EQ("*3\r\n$1\r\nq\r\n$1\r\nb\r\n$1\r\n2\r\n",
+              run({"BZPOPMIN", "q", "1"}, 13).reply);
+    EXPECT_EQ("+none\r\n", run({"TYPE", "q"}, 1).reply);
+
+    run({"BZPOPMIN", "later", "0.01"}, 14);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    handler.checkTimeouts();
+    EXPECT_EQ("*-1\r\n", sent[14]);
 }
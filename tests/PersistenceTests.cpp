@@ -0,0 +1,460 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/commands/CommandHandler.hpp"
+#include "../src/db/RedisStore.hpp"
+#include "../src/persistence/AppendOnlyFile.hpp"
+#include "../src/persistence/Snapshot.hpp"
+#include "TestHelpers.hpp"
+
+namespace {
+
+std::string tempPath(const std::string& name) {
+    return "/tmp/redis_clone_test_" + std::to_string(::getpid()) + "_" + name;
+}
+
+} // namespace
+
+TEST(SnapshotTest, RoundTripsAllTypesAcrossChunks) {
+    RedisStore store;
+    CommandHandler handler(store);
+
+    for (int i = 0; i < 200; ++i) {
+        std::string n = std::to_string(i);
+        handler.execute(makeArgs(std::vector<std::string>{"SET", "key:" + n, "value:" + n}).views, 1);
+    }
+    handler.execute(makeArgs({"RPUSH", "jobs", "a", "b", "c"}).views, 1);
+    handler.execute(makeArgs({"XADD", "events", "1-1", "temp", "20", "unit", "c"}).views, 1);
+    handler.execute(makeArgs({"XADD", "events", "2-0", "temp", "21"}).views, 1);
+    handler.execute(makeArgs({"SADD", "ids", "7", "-1", "300000"}).views, 1);
+    handler.execute(makeArgs({"SADD", "tags", "red", "42"}).views, 1);
+    handler.execute(makeArgs({"ZADD", "board", "0.1", "ann", "-inf", "bob"}).views, 1);
+    handler.execute(makeArgs({"INCRBY", "hits", "-4096"}).views, 1);
+
+    // Tiny chunks force many independently decoded chunks
+    std::string blob = Snapshot::serialize(store, /*chunk_bytes=*/256);
+
+    RedisStore restored;
+    SnapshotLoadStats stats;
+    std::string err;
+    ASSERT_TRUE(Snapshot::loadFromMemory(restored, blob.data(), blob.size(), 4, stats, err)) << err;
+
+    EXPECT_EQ(206u, stats.keys);
+    EXPECT_GT(stats.chunks, 1u);
+
+    CommandHandler reader(restored);
+    EXPECT_EQ("$9\r\nvalue:123\r\n", reader.execute(makeArgs({"GET", "key:123"}).views, 1).reply);
+    EXPECT_EQ(":-4095\r\n", reader.execute(makeArgs({"INCR", "hits"}).views, 1).reply);
+
+    auto items = parseBulkArray(reader.execute(makeArgs({"LRANGE", "jobs", "0", "-1"}).views, 1).reply);
+    ASSERT_EQ(3u, items.size());
+    EXPECT_EQ("c", items[2]);
+
+    std::string expected =
+        "*1\r\n"
+        "*2\r\n"
+        "$3\r\n2-0\r\n"
+        "*2\r\n"
+        "$4\r\ntemp\r\n"
+        "$2\r\n21\r\n";
+    EXPECT_EQ(expected, reader.execute(makeArgs({"XRANGE", "events", "2-0", "+"}).views, 1).reply);
+
+    EXPECT_EQ("*3\r\n$2\r\n-1\r\n$1\r\n7\r\n$6\r\n300000\r\n",
+              reader.execute(makeArgs({"SMEMBERS", "ids"}).views, 1).reply);
+    EXPECT_EQ(":1\r\n", reader.execute(makeArgs({"SISMEMBER", "tags", "red"}).views, 1).reply);
+    EXPECT_EQ("*4\r\n$3\r\nbob\r\n$4\r\n-inf\r\n$3\r\nann\r\n$3\r\n0.1\r\n",
+              reader.execute(makeArgs({"ZRANGE", "board", "0", "-1", "WITHSCORES"}).views, 1).reply);
+}
+
+TEST(SnapshotTest, SaveAndLoadFileKeepsTtl) {
+    RedisStore store;
+    store.setString("session", "abc", 60000);
+    store.setString("stale", "x", 1);
+    usleep(5000);
+
+    std::string path = tempPath("ttl.rcs");
+    std::string err;
+    ASSERT_TRUE(Snapshot::save(store, path, err)) << err;
+
+    RedisStore restored;
+    SnapshotLoadStats stats;
+    ASSERT_TRUE(Snapshot::load(restored, path, 2, stats, err)) << err;
+    std::remove(path.c_str());
+
+    std::string out;
+    EXPECT_TRUE(restored.getString("session", out));
+    EXPECT_EQ("abc", out);
+    EXPECT_FALSE(restored.getString("stale", out));
+
+    uint64_t expire_at = restored.getExpireUnixMs("session");
+    EXPECT_GT(expire_at, static_cast<uint64_t>(getUnixTimeMs()) + 50000);
+}
+
+TEST(SnapshotTest, RejectsCorruptedChunk) {
+    RedisStore store;
+    store.setString("a", "1");
+
+    std::string blob = Snapshot::serialize(store);
+    blob[10] ^= 0x5A;   // inside the first chunk
+
+    RedisStore restored;
+    SnapshotLoadStats stats;
+    std::string err;
+    EXPECT_FALSE(Snapshot::loadFromMemory(restored, blob.data(), blob.size(), 1, stats, err));
+    EXPECT_FALSE(err.empty());
+}
+
+TEST(SnapshotTest, LoadingModeAnswersWithLoadingError) {
+    RedisStore store;
+    CommandHandler handler(store);
+    handler.setLoading(true);
+
+    EXPECT_EQ("+PONG\r\n", handler.execute(makeArgs({"PING"}).views, 1).reply);
+    EXPECT_EQ(0u, handler.execute(makeArgs({"GET", "k"}).views, 1).reply.rfind("-LOADING", 0));
+
+    handler.setLoading(false);
+    EXPECT_EQ("$-1\r\n", handler.execute(makeArgs({"GET", "k"}).views, 1).reply);
+}
+
+TEST(AppendOnlyFileTest, ReplayRebuildsStateWithResolvedIds) {
+    std::string path = tempPath("replay.aof");
+    std::remove(path.c_str());
+
+    std::string stream_reply;
+    {
+        RedisStore store;
+        CommandHandler handler(store);
+        AppendOnlyFile aof;
+        std::string err;
+        ASSERT_TRUE(aof.open(path, AppendFsync::ALWAYS, err)) << err;
+        handler.setAppendOnlyFile(&aof);
+
+        handler.execute(makeArgs({"RPUSH", "jobs", "a", "b", "c"}).views, 1);
+        handler.execute(makeArgs({"LPOP", "jobs"}).views, 1);
+        handler.execute(makeArgs({"LPOP", "missing"}).views, 1);
+        handler.execute(makeArgs({"SET", "session", "v", "PX", "60000"}).views, 1);
+        handler.execute(makeArgs({"XADD", "events", "*", "k", "v"}).views, 1);
+        handler.execute(makeArgs({"GET", "session"}).views, 1);
+        stream_reply = handler.execute(makeArgs({"XRANGE", "events", "0-0", "+"}).views, 1).reply;
+        ASSERT_NE("*0\r\n", stream_reply);
+
+        // One write for the whole batch
+        EXPECT_EQ(0u, aof.size());
+        ASSERT_TRUE(aof.flush());
+        EXPECT_GT(aof.size(), 0u);
+    }
+
+    RedisStore restored;
+    CommandHandler replayer(restored);
+    uint64_t commands = 0;
+    std::string err;
+    ASSERT_TRUE(AppendOnlyFile::replay(path, restored, replayer, commands, err)) << err;
+    std::remove(path.c_str());
+
+    // LPOP on a missing key and the read-only commands are not logged
+    EXPECT_EQ(4u, commands);
+
+    auto items = parseBulkArray(replayer.execute(makeArgs({"LRANGE", "jobs", "0", "-1"}).views, 1).reply);
+    ASSERT_EQ(2u, items.size());
+    EXPECT_EQ("b", items[0]);
+
+    EXPECT_GT(restored.getExpireUnixMs("session"), static_cast<uint64_t>(getUnixTimeMs()) + 50000);
+    EXPECT_EQ(stream_reply, replayer.execute(makeArgs({"XRANGE", "events", "0-0", "+"}).views, 1).reply);
+}
+
+TEST(AppendOnlyFileTest, ReplayDropsTruncatedTail) {
+    std::string path = tempPath("truncated.aof");
+
+    std::string log;
+    AppendOnlyFile::encodeCommand(log, {"SET", "a", "1"});
+    size_t complete = log.size();
+    AppendOnlyFile::encodeCommand(log, {"SET", "b", "2"});
+    log.resize(log.size() - 4);
+
+    FILE* f = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(nullptr, f);
+    std::fwrite(log.data(), 1, log.size(), f);
+    std::fclose(f);
+
+    RedisStore restored;
+    CommandHandler replayer(restored);
+    uint64_t commands = 0;
+    std::string err;
+    ASSERT_TRUE(AppendOnlyFile::replay(path, restored, replayer, commands, err)) << err;
+    EXPECT_EQ(1u, commands);
+
+    struct stat st{};
+    ASSERT_EQ(0, ::stat(path.c_str(), &st));
+    EXPECT_EQ(complete, static_cast<size_t>(st.st_size));
+    std::remove(path.c_str());
+
+    std::string out;
+    EXPECT_TRUE(restored.getString("a", out));
+    EXPECT_FALSE(restored.getString("b", out));
+}
+
+TEST(AppendOnlyFileTest, RewriteCompactsAndKeepsWritesDuringRewrite) {
+    std::string path = tempPath("rewrite.aof");
+    std::string tmp = path + ".tmp";
+    std::remove(path.c_str());
+
+    RedisStore store;
+    CommandHandler handler(store);
+    AppendOnlyFile aof;
+    std::string err;
+    ASSERT_TRUE(aof.open(path, AppendFsync::NO, err)) << err;
+    handler.setAppendOnlyFile(&aof);
+
+    for (int i = 0; i < 500; ++i) {
+        handler.execute(makeArgs({"RPUSH", "jobs", "payload"}).views, 1);
+        handler.execute(makeArgs({"LPOP", "jobs"}).views, 1);
+    }
+    handler.execute(makeArgs({"RPUSH", "jobs", "kept"}).views, 1);
+    handler.execute(makeArgs({"XADD", "events", "5-1", "k", "v"}).views, 1);
+    ASSERT_TRUE(aof.flush());
+    uint64_t before = aof.size();
+
+    // What the forked child does, run inline
+    aof.startRewrite();
+    ASSERT_TRUE(AppendOnlyFile::writeRewrite(store, tmp, false, err)) << err;
+
+    // Arrives while the "child" is running
+    handler.execute(makeArgs({"RPUSH", "jobs", "late"}).views, 1);
+    ASSERT_TRUE(aof.finishRewrite(tmp, path, err)) << err;
+    ASSERT_TRUE(aof.flush());
+
+    EXPECT_LT(aof.size(), before / 20);
+    aof.close();
+
+    RedisStore restored;
+    CommandHandler replayer(restored);
+    uint64_t commands = 0;
+    ASSERT_TRUE(AppendOnlyFile::replay(path, restored, replayer, commands, err)) << err;
+    std::remove(path.c_str());
+
+    EXPECT_EQ(3u, commands);
+    auto items = parseBulkArray(replayer.execute(makeArgs({"LRANGE", "jobs", "0", "-1"}).views, 1).reply);
+    ASSERT_EQ(2u, items.size());
+    EXPECT_EQ("kept", items[0]);
+    EXPECT_EQ("late", items[1]);
+    std::string range = replayer.execute(makeArgs({"XRANGE", "events", "0-0", "+"}).views, 1).reply;
+    EXPECT_NE(std::string::npos, range.find("$3\r\n5-1\r\n"));
+}
+
+TEST(AppendOnlyFileTest, RewriteKeepsLastIdOfTrimmedStreams) {
+    std::string path = tempPath("stream_rewrite.aof");
+
+    RedisStore store;
+    CommandHandler handler(store);
+    for (int i = 1; i <= 5; ++i)
+        handler.execute(makeArgs({"XADD", "kept", std::to_string(i) + "-0", "k", "v"}).views, 1);
+    handler.execute(makeArgs({"XDEL", "kept", "5-0"}).views, 1);
+    handler.execute(makeArgs({"XADD", "emptied", "7-0", "k", "v"}).views, 1);
+    handler.execute(makeArgs({"XTRIM", "emptied", "MAXLEN", "0"}).views, 1);
+
+    std::string err;
+    ASSERT_TRUE(AppendOnlyFile::writeRewrite(store, path, false, err)) << err;
+
+    RedisStore restored;
+    CommandHandler replayer(restored);
+    uint64_t commands = 0;
+    ASSERT_TRUE(AppendOnlyFile::replay(path, restored, replayer, commands, err)) << err;
+    std::remove(path.c_str());
+
+    // The snapshot encoding carries the last ID as well
+    std::string blob = Snapshot::serialize(restored);
+    RedisStore reloaded;
+    SnapshotLoadStats stats;
+    ASSERT_TRUE(Snapshot::loadFromMemory(reloaded, blob.data(), blob.size(), 1, stats, err)) << err;
+
+    CommandHandler reader(reloaded);
+    auto run = [&](std::vector<std::string> args) {
+        return reader.execute(makeArgs(args).views, 1).reply;
+    };
+    EXPECT_EQ(":4\r\n", run({"XLEN", "kept"}));
+    EXPECT_EQ(":0\r\n", run({"XLEN", "emptied"}));
+    EXPECT_EQ("+stream\r\n", run({"TYPE", "emptied"}));
+    EXPECT_EQ(0u, run({"XADD", "kept", "5-0", "k", "v"}).find("-ERR The ID specified in XADD is equal"));
+    EXPECT_EQ("$3\r\n7-1\r\n", run({"XADD", "emptied", "7-*", "k", "v"}));
+}
+
+TEST(AppendOnlyFileTest, RewriteAndSnapshotKeepConsumerGroups) {
+    std::string path = tempPath("groups_rewrite.aof");
+
+    RedisStore store;
+    CommandHandler handler(store);
+    auto exec = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+    for (int i = 1; i <= 3; ++i)
+        exec({"XADD", "s", std::to_string(i) + "-0", "k", "v"});
+    exec({"XGROUP", "CREATE", "s", "g", "0"});
+    exec({"XREADGROUP", "GROUP", "g", "alice", "COUNT", "2", "STREAMS", "s", ">"});
+    exec({"XCLAIM", "s", "g", "bob", "0", "2-0", "RETRYCOUNT", "5", "JUSTID"});
+    exec({"XDEL", "s", "1-0"});
+    exec({"XGROUP", "CREATECONSUMER", "s", "g", "idle"});
+    exec({"XGROUP", "CREATE", "empty", "h", "$", "MKSTREAM"});
+
+    std::string err;
+    ASSERT_TRUE(AppendOnlyFile::writeRewrite(store, path, false, err)) << err;
+
+    RedisStore restored;
+    CommandHandler replayer(restored);
+    uint64_t commands = 0;
+    ASSERT_TRUE(AppendOnlyFile::replay(path, restored, replayer, commands, err)) << err;
+    std::remove(path.c_str());
+
+    std::string blob = Snapshot::serialize(restored);
+    RedisStore reloaded;
+    SnapshotLoadStats stats;
+    ASSERT_TRUE(Snapshot::loadFromMemory(reloaded, blob.data(), blob.size(), 1, stats, err)) << err;
+
+    CommandHandler reader(reloaded);
+    auto run = [&](std::vector<std::string> args) {
+        return reader.execute(makeArgs(args).views, 1).reply;
+    };
+    // 1-0 was deleted but is still pending for alice
+    EXPECT_EQ(":2\r\n", run({"XLEN", "s"}));
+    EXPECT_EQ("*4\r\n:2\r\n$3\r\n1-0\r\n$3\r\n2-0\r\n"
+              "*2\r\n*2\r\n$5\r\nalice\r\n$1\r\n1\r\n*2\r\n$3\r\nbob\r\n$1\r\n1\r\n",
+              run({"XPENDING", "s", "g"}));
+    auto bob = run({"XPENDING", "s", "g", "-", "+", "10", "bob"});
+    EXPECT_EQ(bob.size() - 4, bob.rfind(":5\r\n"));
+    EXPECT_EQ(":0\r\n", run({"XGROUP", "CREATECONSUMER", "s", "g", "idle"}));
+    EXPECT_EQ("-BUSYGROUP Consumer Group name already exists\r\n",
+              run({"XGROUP", "CREATE", "empty", "h", "0"}));
+
+    // The group's last ID survived: only the unread entry is new
+    EXPECT_EQ(0u, run({"XREADGROUP", "GROUP", "g", "c", "STREAMS", "s", ">"})
+                      .find("*1\r\n*2\r\n$1\r\ns\r\n*1\r\n*2\r\n$3\r\n3-0"));
+}
+
+TEST(AppendOnlyFileTest, RewriteAndSnapshotKeepHashesAndFieldExpiry) {
+    std::string path = tempPath("hash_rewrite.aof");
+
+    RedisStore store;
+    CommandHandler handler(store);
+    auto exec = [&](std::vector<std::string> args) {
+        return handler.execute(makeArgs(args).views, 1).reply;
+    };
+    exec({"HSET", "small", "a", "1", "b", "two"});
+    exec({"HEXPIRE", "small", "1000", "FIELDS", "1", "b"});
+    for (int i = 0; i < 1000; ++i)
+        exec({"HSET", "big", "f" + std::to_string(i), std::to_string(i)});
+
+    std::string err;
+    ASSERT_TRUE(AppendOnlyFile::writeRewrite(store, path, false, err)) << err;
+
+    RedisStore restored;
+    CommandHandler replayer(restored);
+    uint64_t commands = 0;
+    ASSERT_TRUE(AppendOnlyFile::replay(path, restored, replayer, commands, err)) << err;
+    std::remove(path.c_str());
+
+    std::string blob = Snapshot::serialize(restored);
+    RedisStore reloaded;
+    SnapshotLoadStats stats;
+    ASSERT_TRUE(Snapshot::loadFromMemory(reloaded, blob.data(), blob.size(), 1, stats, err)) << err;
+
+    CommandHandler reader(reloaded);
+    auto run = [&](std::vector<std::string> args) {
+        return reader.execute(makeArgs(args).views, 1).reply;
+    };
+    EXPECT_EQ("*2\r\n$1\r\n1\r\n$3\r\ntwo\r\n", run({"HMGET", "small", "a", "b"}));
+    EXPECT_EQ("*2\r\n:-1\r\n:1000\r\n", run({"HTTL", "small", "FIELDS", "2", "a", "b"}));
+    EXPECT_EQ(":1000\r\n", run({"HLEN", "big"}));
+    EXPECT_EQ("$3\r\n999\r\n", run({"HGET", "big", "f999"}));
+
+    // DUMP / RESTORE carry the same encoding
+    RedisObj* obj = reloaded.getObject("small");
+    ASSERT_NE(nullptr, obj);
+    RedisObj copy;
+    ASSERT_TRUE(Snapshot::restore(Snapshot::dump(*obj), copy));
+    EXPECT_EQ(RedisType::HASH, copy.type);
+    EXPECT_EQ(2u, std::get<Hash>(copy.value).size());
+}
+
+TEST(AppendOnlyFileTest, RewriteKeepsSetsOfBothEncodings) {
+    std::string path = tempPath("set_rewrite.aof");
+
+    RedisStore store;
+    CommandHandler handler(store);
+    for (int i = 0; i < 1500; ++i)
+        handler.execute(makeArgs({"SADD", "ids", std::to_string(i * 3)}).views, 1);
+    handler.execute(makeArgs({"SADD", "tags", "red", "green"}).views, 1);
+
+    std::string err;
+    ASSERT_TRUE(AppendOnlyFile::writeRewrite(store, path, false, err)) << err;
+
+    RedisStore restored;
+    CommandHandler replayer(restored);
+    uint64_t commands = 0;
+    ASSERT_TRUE(AppendOnlyFile::replay(path, restored, replayer, commands, err)) << err;
+    std::remove(path.c_str());
+
+    EXPECT_GT(commands, 2u);
+    EXPECT_EQ(":1500\r\n", replayer.execute(makeArgs({"SCARD", "ids"}).views, 1).reply);
+    EXPECT_EQ(":1\r\n", replayer.execute(makeArgs({"SISMEMBER", "ids", "4497"}).views, 1).reply);
+    EXPECT_EQ(":2\r\n", replayer.execute(makeArgs({"SCARD", "tags"}).views, 1).reply);
+}
+
+TEST(AppendOnlyFileTest, RewriteKeepsSortedSetScoresExact) {
+    std::string path = tempPath("zset_rewrite.aof");
+
+    RedisStore store;
+    CommandHandler handler(store);
+    for (int i = 0; i < 1000; ++i)
+        handler.execute(makeArgs({"ZADD", "board", std::to_string(i / 3.0), "p" + std::to_string(i)}).views, 1);
+
+    std::string err;
+    ASSERT_TRUE(AppendOnlyFile::writeRewrite(store, path, false, err)) << err;
+
+    RedisStore restored;
+    CommandHandler replayer(restored);
+    uint64_t commands = 0;
+    ASSERT_TRUE(AppendOnlyFile::replay(path, restored, replayer, commands, err)) << err;
+    std::remove(path.c_str());
+
+    const ZSet* before = &std::get<ZSet>(store.getObject("board")->value);
+    const ZSet* after = &std::get<ZSet>(restored.getObject("board")->value);
+    ASSERT_EQ(before->size(), after->size());
+    for (int i = 0; i < 1000; i += 37) {
+        double a = 0, b = 0;
+        std::string member = "p" + std::to_string(i);
+        ASSERT_TRUE(before->score(member, a));
+        ASSERT_TRUE(after->score(member, b));
+        EXPECT_EQ(a, b) << member;
+    }
+}
+
+TEST(AppendOnlyFileTest, SnapshotPreambleReplaysWithTail) {
+    std::string path = tempPath("preamble.aof");
+
+    RedisStore store;
+    store.setString("a", "1");
+    std::string err;
+    ASSERT_TRUE(AppendOnlyFile::writeRewrite(store, path, true, err)) << err;
+
+    std::string tail;
+    AppendOnlyFile::encodeCommand(tail, {"SET", "b", "2"});
+    FILE* f = std::fopen(path.c_str(), "ab");
+    ASSERT_NE(nullptr, f);
+    std::fwrite(tail.data(), 1, tail.size(), f);
+    std::fclose(f);
+
+    RedisStore restored;
+    CommandHandler replayer(restored);
+    uint64_t commands = 0;
+    ASSERT_TRUE(AppendOnlyFile::replay(path, restored, replayer, commands, err)) << err;
+    std::remove(path.c_str());
+
+    EXPECT_EQ(1u, commands);
+    std::string out;
+    EXPECT_TRUE(restored.getString("a", out));
+    EXPECT_TRUE(restored.getString("b", out));
+}
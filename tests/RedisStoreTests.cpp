@@ -1,12 +1,22 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <random>
+#include <set>
 #include <string>
 #include <thread>
 #include <vector>
 
 #include "../src/db/RedisStore.hpp"
+#include "../src/db/Hash.hpp"
 #include "../src/db/List.hpp"
+#include "../src/db/Lzf.hpp"
+#include "../src/db/Set.hpp"
+#include "../src/db/ZSet.hpp"
 
 TEST(RedisStoreTest, SetAndGetStringValue) {
     RedisStore store;
@@ -75,3 +85,481 @@ TEST(ListTest, PopOperationsHandleEmptyList) {
     EXPECT_EQ("back", list.POPBack());
     EXPECT_TRUE(list.Empty());
 }
+
+TEST(ListTest, PackedEntriesRoundTripAcrossEncodings) {
+    List list;
+    std::vector<std::string> values = {
+        "0", "127", "128", "-1", "-4096", "4095", "4096", "-32768", "65536",
+        "-8388608", "2147483647", "-9223372036854775808", "9223372036854775807",
+        "9223372036854775808", "007", "+1", "-0", "", "x", std::string(63, 'a'),
+        std::string(64, 'b'), std::string(4095, 'c'), std::string(5000, 'd')};
+
+    for (const auto& v : values)
+        list.PushBack(v);
+
+    EXPECT_EQ(values, list.GetElementsInRange(0, -1));
+    for (auto it = values.rbegin(); it != values.rend(); ++it)
+        EXPECT_EQ(*it, list.POPBack());
+    EXPECT_TRUE(list.Empty());
+}
+
+TEST(ListTest, SpansNodesAndReleasesThemWhenDrained) {
+    List list;
+    for (int i = 0; i < 5000; ++i) {
+        list.PushBack("job:" + std::to_string(i));
+        list.PushFront("pre:" + std::to_string(i));
+    }
+
+    ASSERT_EQ(10000, list.Len());
+    EXPECT_GT(list.NodeCount(), 2u);
+
+    auto middle = list.GetElementsInRange(4998, 5001);
+    ASSERT_EQ(4u, middle.size());
+    EXPECT_EQ("pre:1", middle[0]);
+    EXPECT_EQ("pre:0", middle[1]);
+    EXPECT_EQ("job:0", middle[2]);
+    EXPECT_EQ("job:1", middle[3]);
+
+    for (int i = 4999; i >= 0; --i) {
+        ASSERT_EQ("pre:" + std::to_string(i), list.POPFront());
+        ASSERT_EQ("job:" + std::to_string(i), list.POPBack());
+    }
+    EXPECT_TRUE(list.Empty());
+    EXPECT_EQ(0u, list.NodeCount());
+}
+
+TEST(ListTest, LzfRoundTripsRepetitiveAndRandomData) {
+    std::string repetitive;
+    for (int i = 0; i < 500; ++i)
+        repetitive += "level=info msg=\"request done\" id=" + std::to_string(i) + "\n";
+    repetitive += std::string(1000, 'z');   // long overlapping match
+
+    std::string random(4000, '\0');
+    uint32_t x = 12345;
+    for (char& c : random) {
+        x = x * 1103515245 + 12345;
+        c = static_cast<char>(x >> 16);
+    }
+
+    for (const std::string& input : {repetitive, random}) {
+        std::string packed;
+        bool ok = lzf::compress(reinterpret_cast<const unsigned char*>(input.data()),
+                                input.size(), packed, input.size() + input.size() / 16 + 64);
+        ASSERT_TRUE(ok);
+
+        std::string back(input.size(), '\0');
+        ASSERT_TRUE(lzf::decompress(reinterpret_cast<const unsigned char*>(packed.data()),
+                                    packed.size(),
+                                    reinterpret_cast<unsigned char*>(back.data()),
+                                    back.size()));
+        EXPECT_EQ(input, back);
+    }
+
+    std::string packed;
+    ASSERT_TRUE(lzf::compress(reinterpret_cast<const unsigned char*>(repetitive.data()),
+                              repetitive.size(), packed, repetitive.size()));
+    EXPECT_LT(packed.size() * 3, repetitive.size());
+
+    // Truncated input is rejected instead of read past its end
+    std::string out(repetitive.size(), '\0');
+    EXPECT_FALSE(lzf::decompress(reinterpret_cast<const unsigned char*>(packed.data()),
+                                 packed.size() - 1,
+                                 reinterpret_cast<unsigned char*>(out.data()), out.size()));
+}
+
+TEST(ListTest, CompressesInteriorNodesBeyondDepth) {
+    List::SetCompressDepth(1);
+    List list;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 4000; ++i) {
+        std::string v = "audit action=login user=alice seq=" + std::to_string(i);
+        list.PushBack(v);
+        expected.push_back(v);
+    }
+    List::SetCompressDepth(2);
+    list.PushFront("first");
+    expected.insert(expected.begin(), "first");
+
+    ASSERT_GT(list.NodeCount(), 4u);
+    EXPECT_GT(list.CompressedNodeCount(), 0u);
+    EXPECT_EQ(expected, list.GetElementsInRange(0, -1));
+    EXPECT_EQ(expected[2000], list.GetElementsInRange(2000, 2000)[0]);
+
+    // Draining brings every node back through the raw ends
+    EXPECT_EQ("first", list.POPFront());
+    for (int i = 3999; i >= 2000; --i)
+        ASSERT_EQ(expected[i + 1], list.POPBack());
+    for (int i = 0; i < 2000; ++i)
+        ASSERT_EQ(expected[i + 1], list.POPFront());
+
+    EXPECT_TRUE(list.Empty());
+    List::SetCompressDepth(0);
+}
+
+TEST(ListTest, NodeLevelOperationsMatchDequeModel) {
+    List::SetCompressDepth(1);
+    List list;
+    std::deque<std::string> model;
+
+    uint32_t x = 7;
+    auto rnd = [&](uint32_t n) {
+        x = x * 1103515245 + 12345;
+        return (x >> 8) % n;
+    };
+    // ~1 KB values keep nodes small, so every operation crosses nodes
+    auto value = [&]() {
+        uint32_t k = rnd(50);
+        return k < 10 ? std::to_string(k)
+                      : std::string(400 + 20 * k, 'a' + static_cast<char>(k % 26));
+    };
+
+    for (int step = 0; step < 4000; ++step) {
+        int len = static_cast<int>(model.size());
+        switch (rnd(9)) {
+        case 0: case 1: {
+            std::string v = value();
+            list.PushBack(v);
+            model.push_back(v);
+            break;
+        }
+        case 2: {
+            std::string v = value();
+            list.PushFront(v);
+            model.push_front(v);
+            break;
+        }
+        case 3: {
+            size_t n = rnd(3);
+            bool front = rnd(2);
+            size_t removed = front ? list.TrimFront(n) : list.TrimBack(n);
+            ASSERT_EQ(std::min(n, model.size()), removed);
+            for (size_t i = 0; i < removed; ++i) {
+                if (front)
+                    model.pop_front();
+                else
+                    model.pop_back();
+            }
+            break;
+        }
+        case 4: {
+            if (len == 0) break;
+            long long idx = static_cast<long long>(rnd(len)) - (rnd(2) ? len : 0);
+            std::string v = value();
+            ASSERT_TRUE(list.Set(idx, v));
+            model[idx < 0 ? idx + len : idx] = v;
+            break;
+        }
+        case 5: {
+            std::string pivot = std::to_string(rnd(10));
+            std::string v = value();
+            bool after = rnd(2);
+            auto it = std::find(model.begin(), model.end(), pivot);
+            ASSERT_EQ(it != model.end(), list.Insert(pivot, v, after));
+            if (it != model.end())
+                model.insert(after ? it + 1 : it, v);
+            break;
+        }
+        case 6: {
+            std::string v = std::to_string(rnd(10));
+            long long count = static_cast<long long>(rnd(5)) - 2;
+            size_t expected = 0;
+            if (count >= 0) {
+                for (auto it = model.begin(); it != model.end();) {
+                    if (*it == v && (count == 0 || expected < static_cast<size_t>(count))) {
+                        it = model.erase(it);
+                        ++expected;
+                    } else {
+                        ++it;
+                    }
+                }
+            } else {
+                for (size_t i = model.size(); i-- > 0 && expected < static_cast<size_t>(-count);) {
+                    if (model[i] == v) {
+                        model.erase(model.begin() + static_cast<long>(i));
+                        ++expected;
+                    }
+                }
+            }
+            ASSERT_EQ(expected, list.Remove(count, v));
+            break;
+        }
+        case 7: {
+            if (rnd(20) != 0) break;   // occasional, or the list never grows
+            int start = static_cast<int>(rnd(len + 2)) - 1;
+            int end = static_cast<int>(rnd(len + 2)) - 1;
+            list.Trim(start, end);
+            std::vector<std::string> kept = list.GetElementsInRange(0, -1);
+            int s = start < 0 ? std::max(0, len + start) : start;
+            int e = end < 0 ? len + end : std::min(end, len - 1);
+            std::deque<std::string> next;
+            for (int i = s; i <= e && i < len; ++i)
+                next.push_back(model[i]);
+            model = next;
+            break;
+        }
+        default: {
+            if (len == 0) break;
+            long long idx = rnd(len);
+            std::string out;
+            ASSERT_TRUE(list.Index(idx, out));
+            ASSERT_EQ(model[idx], out);
+            ASSERT_FALSE(list.Index(len, out));
+        }
+        }
+
+        ASSERT_EQ(static_cast<int>(model.size()), list.Len()) << "step " << step;
+    }
+
+    std::vector<std::string> all(model.begin(), model.end());
+    EXPECT_EQ(all, list.GetElementsInRange(0, -1));
+
+    std::vector<std::string> reversed;
+    auto it = list.ReverseRange(0, -1);
+    std::string_view v;
+    while (it.Next(v))
+        reversed.emplace_back(v);
+    EXPECT_EQ(std::vector<std::string>(all.rbegin(), all.rend()), reversed);
+
+    List::SetCompressDepth(0);
+}
+
+TEST(HashTest, MatchesMapModelAcrossEncodings) {
+    Hash hash;
+    std::map<std::string, std::string> model;
+    std::mt19937 rng(5);
+
+    auto same = [&] {
+        ASSERT_EQ(model.size(), hash.size());
+        std::map<std::string, std::string> seen;
+        hash.forEach([&](std::string_view f, std::string_view v) { seen.emplace(f, v); });
+        EXPECT_EQ(model, seen);
+    };
+
+    // Small and numeric: stays one listpack
+    for (int step = 0; step < 2000; ++step) {
+        std::string field = "f" + std::to_string(rng() % 100);
+        if (rng() % 3 == 0) {
+            EXPECT_EQ(model.erase(field) == 1, hash.erase(field));
+        } else {
+            std::string value = std::to_string(static_cast<int>(rng() % 20000) - 10000);
+            EXPECT_EQ(model.count(field) == 0, hash.set(field, value));
+            model[field] = value;
+        }
+    }
+    same();
+    EXPECT_TRUE(hash.isCompact());
+
+    // One long value turns it into a table, for good
+    hash.set("blob", std::string(100, 'x'));
+    model["blob"] = std::string(100, 'x');
+    EXPECT_FALSE(hash.isCompact());
+    hash.erase("blob");
+    model.erase("blob");
+    same();
+    EXPECT_FALSE(hash.isCompact());
+
+    for (int i = 0; i < 500; ++i) {
+        std::string field = "g" + std::to_string(i);
+        hash.set(field, field);
+        model[field] = field;
+    }
+    same();
+
+    // A full scan visits every field once when nothing changes
+    std::map<std::string, int> visits;
+    uint64_t cursor = 0;
+    do {
+        cursor = hash.scan(cursor, 7, [&](std::string_view f, std::string_view) {
+            ++visits[std::string(f)];
+        });
+    } while (cursor != 0);
+    EXPECT_EQ(model.size(), visits.size());
+    for (const auto& [field, n] : visits)
+        EXPECT_EQ(1, n) << field;
+}
+
+TEST(HashTest, FieldsExpireInDeadlineOrder) {
+    Hash hash;
+    for (int i = 0; i < 5; ++i)
+        hash.set("f" + std::to_string(i), "v");
+
+    EXPECT_EQ(1, hash.expireField("f0", 100, Hash::ExpireCondition::NONE, 10));
+    EXPECT_EQ(1, hash.expireField("f1", 300, Hash::ExpireCondition::NX, 10));
+    EXPECT_EQ(0, hash.expireField("f1", 200, Hash::ExpireCondition::NX, 10));
+    EXPECT_EQ(0, hash.expireField("f1", 200, Hash::ExpireCondition::GT, 10));
+    EXPECT_EQ(1, hash.expireField("f1", 200, Hash::ExpireCondition::LT, 10));
+    EXPECT_EQ(0, hash.expireField("f2", 200, Hash::ExpireCondition::XX, 10));
+    EXPECT_EQ(1, hash.expireField("f2", 250, Hash::ExpireCondition::LT, 10));
+    EXPECT_EQ(-2, hash.expireField("nope", 200, Hash::ExpireCondition::NONE, 10));
+    EXPECT_EQ(2, hash.expireField("f3", 5, Hash::ExpireCondition::NONE, 10));
+    EXPECT_FALSE(hash.contains("f3"));
+
+    EXPECT_EQ(200, hash.fieldExpireTime("f1"));
+    EXPECT_EQ(-1, hash.fieldExpireTime("f4"));
+    EXPECT_EQ(-2, hash.fieldExpireTime("f3"));
+
+    // Overwriting a field clears its expiry, as does HPERSIST
+    hash.set("f2", "new");
+    EXPECT_EQ(-1, hash.fieldExpireTime("f2"));
+    EXPECT_EQ(1, hash.persistField("f0"));
+    EXPECT_EQ(-1, hash.persistField("f0"));
+
+    EXPECT_EQ(0u, hash.expireFields(199));
+    EXPECT_EQ(1u, hash.expireFields(200));
+    EXPECT_FALSE(hash.contains("f1"));
+    EXPECT_EQ(3u, hash.size());
+    EXPECT_TRUE(hash.fieldDeadlines().empty());
+}
+
+TEST(SetTest, IntersectionKernelsMatchSortedModel) {
+    std::mt19937 rng(11);
+
+    // Mixed widths and size ratios on both sides of the gallop cut-off
+    for (size_t na : {1u, 10u, 100u, 3000u}) {
+        for (size_t nb : {1u, 50u, 2000u, 40000u}) {
+            std::set<int16_t> a;
+            std::set<int64_t> b;
+            while (a.size() < na)
+                a.insert(static_cast<int16_t>(rng() % 8000));
+            while (b.size() < nb)
+                b.insert(static_cast<int64_t>(rng() % 80000) - 1000);
+
+            std::vector<int16_t> va(a.begin(), a.end());
+            std::vector<int64_t> vb(b.begin(), b.end());
+            std::vector<int64_t> expected;
+            std::set_intersection(va.begin(), va.end(), vb.begin(), vb.end(),
+                                  std::back_inserter(expected));
+
+            std::vector<int64_t> out(std::min(na, nb));
+            out.resize(intersectSorted(va.data(), va.size(), vb.data(), vb.size(), out.data()));
+            EXPECT_EQ(expected, out) << na << " x " << nb;
+            out.assign(std::min(na, nb), 0);
+            out.resize(intersectSorted(vb.data(), vb.size(), va.data(), va.size(), out.data()));
+            EXPECT_EQ(expected, out) << nb << " x " << na;
+        }
+    }
+}
+
+TEST(SetTest, IntsetsWidenAndConvertLikeAModel) {
+    Set set;
+    std::set<std::string> model;
+    auto members = [](const Set& s) {
+        std::set<std::string> seen;
+        s.forEach([&](std::string_view m) { seen.emplace(m); });
+        return seen;
+    };
+
+    for (std::string m : {"5", "-3", "70000", "5", "9000000000"})
+        EXPECT_EQ(model.insert(m).second, set.add(m)) << m;
+    EXPECT_TRUE(set.isIntset());
+    EXPECT_EQ(model, members(set));
+    EXPECT_TRUE(set.contains("70000"));
+    EXPECT_FALSE(set.contains("070000"));
+    EXPECT_TRUE(set.remove("-3"));
+    model.erase("-3");
+
+    // Not canonical integers: stored as strings
+    set.add("007");
+    model.insert("007");
+    EXPECT_FALSE(set.isIntset());
+    EXPECT_TRUE(set.contains("5"));
+    EXPECT_EQ(model, members(set));
+
+    // Intsets and tables intersect, unite and subtract alike
+    Set evens, odds, all;
+    for (int i = 0; i < 1000; ++i) {
+        (i % 2 ? odds : evens).add(std::to_string(i));
+        all.add(std::to_string(i));
+    }
+    all.add("x");
+    EXPECT_TRUE(evens.isIntset());
+    EXPECT_FALSE(all.isIntset());
+
+    EXPECT_EQ(500u, Set::intersect({&evens, &all}).size());
+    EXPECT_EQ(0u, Set::intersect({&evens, &odds, &all}).size());
+    EXPECT_EQ(0u, Set::intersect({&evens, nullptr}).size());
+    EXPECT_EQ(10u, Set::intersectCount({&all, &odds}, 10));
+    EXPECT_EQ(1000u, Set::unite({&evens, &odds}).size());
+    Set rest = Set::difference({&all, &evens, &odds});
+    EXPECT_EQ(std::set<std::string>{"x"}, members(rest));
+}
+
+TEST(ZSetTest, MatchesOrderedModelAcrossEncodings) {
+    ZSet zset;
+    std::set<std::pair<double, std::string>> order;
+    std::map<std::string, double> scores;
+    std::mt19937 rng(17);
+
+    auto same = [&] {
+        ASSERT_EQ(order.size(), zset.size());
+        std::vector<std::pair<double, std::string>> seen;
+        zset.range(0, zset.size(), false, [&](std::string_view m, double s) {
+            seen.emplace_back(s, std::string(m));
+        });
+        EXPECT_TRUE(std::equal(order.begin(), order.end(), seen.begin(), seen.end()));
+
+        std::vector<std::pair<double, std::string>> reversed;
+        zset.range(0, zset.size(), true, [&](std::string_view m, double s) {
+            reversed.emplace_back(s, std::string(m));
+        });
+        EXPECT_TRUE(std::equal(order.rbegin(), order.rend(), reversed.begin(), reversed.end()));
+    };
+
+    auto step = [&](int members) {
+        std::string member = "m" + std::to_string(rng() % members);
+        double score = static_cast<double>(rng() % 50) / 2;
+        if (rng() % 4 == 0) {
+            auto it = scores.find(member);
+            EXPECT_EQ(it != scores.end(), zset.erase(member));
+            if (it != scores.end()) {
+                order.erase({it->second, member});
+                scores.erase(it);
+            }
+            return;
+        }
+        auto it = scores.find(member);
+        EXPECT_EQ(it == scores.end(), zset.insert(member, score));
+        if (it != scores.end())
+            order.erase({it->second, member});
+        order.emplace(score, member);
+        scores[member] = score;
+    };
+
+    // Small: stays one sorted listpack
+    for (int i = 0; i < 1000; ++i)
+        step(60);
+    same();
+    EXPECT_TRUE(zset.isCompact());
+
+    // Past 128 members it becomes a skiplist
+    for (int i = 0; i < 20000; ++i)
+        step(3000);
+    same();
+    EXPECT_FALSE(zset.isCompact());
+
+    // Ranks and score bounds agree with the model
+    size_t r = 0;
+    for (const auto& [score, member] : order) {
+        size_t rank;
+        ASSERT_TRUE(zset.rank(member, rank));
+        EXPECT_EQ(r++, rank);
+    }
+    for (double bound : {-1.0, 0.0, 3.5, 12.0, 24.5, 30.0}) {
+        size_t below = std::count_if(order.begin(), order.end(),
+                                     [&](const auto& e) { return e.first < bound; });
+        size_t notAbove = std::count_if(order.begin(), order.end(),
+                                        [&](const auto& e) { return e.first <= bound; });
+        EXPECT_EQ(below, zset.countBelow(bound, true)) << bound;
+        EXPECT_EQ(notAbove, zset.countBelow(bound, false)) << bound;
+    }
+
+    // Copies are deep; erasing a rank range leaves the rest in order
+    ZSet copy = zset;
+    size_t removed = copy.eraseRange(10, 500);
+    EXPECT_EQ(490u, removed);
+    auto first = std::next(order.begin(), 10);
+    order.erase(first, std::next(first, 490));
+    std::swap(zset, copy);
+    same();
+    EXPECT_EQ(copy.size(), zset.size() + 490);
+}
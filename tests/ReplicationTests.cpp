@@ -0,0 +1,224 @@
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <map>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/commands/CommandHandler.hpp"
+#include "../src/db/RedisStore.hpp"
+#include "../src/replication/ReplicationBacklog.hpp"
+#include "../src/replication/ReplicationManager.hpp"
+#include "TestHelpers.hpp"
+
+namespace {
+
+// Everything the replica wrote to its master link so far.
+std::string drain(int fd) {
+    std::string out;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) > 0)
+        out.append(buf, static_cast<size_t>(n));
+    return out;
+}
+
+struct Link {
+    int replicaEnd = -1;
+    int masterEnd = -1;
+
+    Link() {
+        int sv[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+        replicaEnd = sv[0];
+        masterEnd = sv[1];
+        ::fcntl(masterEnd, F_SETFL, O_NONBLOCK);
+    }
+    ~Link() { ::close(masterEnd); }
+};
+
+// Master + replica wired in memory; the replica's requests are read from
+// a socketpair and answered by the master handler on client fd `fd`.
+struct Pair {
+    RedisStore masterStore;
+    CommandHandler master{masterStore};
+    ReplicationManager masterRepl{masterStore};
+    std::map<int, std::string> out;   // master output per client fd
+
+    RedisStore replicaStore;
+    CommandHandler replica{replicaStore};
+    ReplicationManager replicaRepl{replicaStore};
+
+    Pair() {
+        masterRepl.setSender([this](int fd, std::string_view d) { out[fd].append(d); },
+                             [](int) {});
+        master.setReplication(&masterRepl);
+        replica.setReplication(&replicaRepl);
+        replicaRepl.replicaOf("127.0.0.1", 6379);   // never connects: no cron()
+    }
+
+    // Runs the handshake over `link` and returns what PSYNC answered.
+    std::string handshake(Link& link, int fd) {
+        replicaRepl.attachMasterLink(link.replicaEnd);
+        EXPECT_EQ("*1\r\n$4\r\nPING\r\n", drain(link.masterEnd));
+
+        replicaRepl.processMasterData("+PONG\r\n", replica);
+        replicaRepl.processMasterData("+OK\r\n", replica);
+        replicaRepl.processMasterData("+OK\r\n", replica);
+
+        std::string sent = drain(link.masterEnd);
+        size_t psync = sent.find("*3\r\n$5\r\nPSYNC");
+        EXPECT_NE(std::string::npos, psync);
+
+        size_t pos = psync;
+        bool malformed = false;
+        auto args = RESPParser::parseNext(sent, pos, malformed);
+        std::string reply = master.execute(args, fd).reply;
+
+        replicaRepl.processMasterData(reply, replica);
+        return reply;
+    }
+
+    std::string replicaGet(const char* key) {
+        return replica.execute(makeArgs({"GET", key}).views, 99).reply;
+    }
+};
+
+} // namespace
+
+TEST(ReplicationBacklogTest, WrapsAndServesOnlyRetainedOffsets) {
+    ReplicationBacklog backlog(16);
+
+    backlog.feed("0123456789");
+    backlog.feed("abcdefghij");   // 20 bytes into 16, "0123" fell off
+
+    EXPECT_EQ(20u, backlog.masterOffset());
+    EXPECT_EQ(16u, backlog.historyLength());
+    EXPECT_EQ(5u, backlog.startOffset());
+
+    std::string out;
+    ASSERT_TRUE(backlog.copyFrom(5, out));
+    EXPECT_EQ("456789abcdefghij", out);
+
+    ASSERT_TRUE(backlog.copyFrom(18, out));
+    EXPECT_EQ("hij", out);
+
+    ASSERT_TRUE(backlog.copyFrom(21, out));   // fully caught up
+    EXPECT_EQ("", out);
+
+    EXPECT_FALSE(backlog.copyFrom(4, out));
+    EXPECT_FALSE(backlog.copyFrom(22, out));
+}
+
+TEST(ReplicationTest, FullSyncThenLiveStream) {
+    Pair p;
+    p.master.execute(makeArgs({"SET", "before", "1"}).views, 1);
+    p.master.execute(makeArgs({"RPUSH", "jobs", "a", "b"}).views, 1);
+
+    Link link;
+    std::string reply = p.handshake(link, 10);
+    EXPECT_EQ(0u, reply.rfind("+FULLRESYNC " + p.masterRepl.replicationId(), 0));
+
+    EXPECT_TRUE(p.replicaRepl.masterLinkUp());
+    EXPECT_EQ("$1\r\n1\r\n", p.replicaGet("before"));
+    EXPECT_EQ(p.masterRepl.offset(), p.replicaRepl.offset());
+
+    // Writes after the sync reach the replica through the stream
+    p.master.execute(makeArgs({"SET", "after", "2", "PX", "100000"}).views, 1);
+    p.master.execute(makeArgs({"LPOP", "jobs"}).views, 1);
+    p.replicaRepl.processMasterData(p.out[10], p.replica);
+
+    EXPECT_EQ("$1\r\n2\r\n", p.replicaGet("after"));
+    EXPECT_EQ(":1\r\n", p.replica.execute(makeArgs({"LLEN", "jobs"}).views, 99).reply);
+    EXPECT_EQ(p.masterRepl.offset(), p.replicaRepl.offset());
+
+    // Regular clients cannot write to a replica
+    EXPECT_EQ(0u, p.replica.execute(makeArgs({"SET", "x", "y"}).views, 99)
+                      .reply.rfind("-READONLY", 0));
+}
+
+TEST(ReplicationTest, PartialResyncSendsOnlyMissedBytes) {
+    Pair p;
+    p.master.execute(makeArgs({"SET", "k", "v1"}).views, 1);
+
+    {
+        Link first;
+        p.handshake(first, 10);
+    }
+    ASSERT_EQ("$2\r\nv1\r\n", p.replicaGet("k"));
+
+    // Link is gone; the master keeps writing
+    p.masterRepl.onClientDisconnected(10);
+    p.master.execute(makeArgs({"SET", "k", "v2"}).views, 1);
+    p.master.execute(makeArgs({"XADD", "s", "*", "f", "v"}).views, 1);
+
+    Link second;
+    std::string reply = p.handshake(second, 11);
+
+    EXPECT_EQ(0u, reply.rfind("+CONTINUE", 0));
+    EXPECT_EQ(std::string::npos, reply.find("$1\r\nk\r\n$2\r\nv1"));   // no snapshot
+    EXPECT_EQ("$2\r\nv2\r\n", p.replicaGet("k"));
+    EXPECT_EQ("+stream\r\n", p.replica.execute(makeArgs({"TYPE", "s"}).views, 99).reply);
+    EXPECT_EQ(p.masterRepl.offset(), p.replicaRepl.offset());
+}
+
+TEST(ReplicationTest, WaitUnblocksOnAck) {
+    Pair p;
+    Link link;
+    p.handshake(link, 10);
+    drain(link.masterEnd);
+
+    p.master.execute(makeArgs({"SET", "k", "v"}).views, 1);
+
+    ExecResult blocked = p.master.execute(makeArgs({"WAIT", "1", "0"}).views, 5);
+    EXPECT_TRUE(blocked.should_write);
+
+    // The stream carries the write and a GETACK; the replica answers it
+    uint64_t before_getack = 0;
+    {
+        std::string stream = p.out[10];
+        p.replicaRepl.processMasterData(stream, p.replica);
+        before_getack = p.replicaRepl.offset() -
+                        std::string("*3\r\n$8\r\nREPLCONF\r\n$6\r\nGETACK\r\n$1\r\n*\r\n").size();
+    }
+
+    std::string ack = drain(link.masterEnd);
+    std::string expected_offset = std::to_string(before_getack);
+    ASSERT_NE(std::string::npos, ack.find("ACK\r\n$" + std::to_string(expected_offset.size()) +
+                                          "\r\n" + expected_offset + "\r\n"));
+
+    p.master.execute(makeArgs({"REPLCONF", "ACK", expected_offset.c_str()}).views, 10);
+    EXPECT_EQ(":1\r\n", p.out[5]);
+
+    // Already satisfied → immediate answer
+    EXPECT_EQ(":1\r\n", p.master.execute(makeArgs({"WAIT", "1", "100"}).views, 5).reply);
+}
+
+TEST(ReplicationTest, WaitHoldsPipelinedCommands) {
+    Pair p;
+    Link link;
+    p.handshake(link, 10);
+    drain(link.masterEnd);
+    p.master.execute(makeArgs({"SET", "k", "v"}).views, 1);
+
+    // What the event loop does with one read of "WAIT 1 1000" + "PING"
+    std::vector<std::vector<std::string>> pipeline = {{"WAIT", "1", "1000"}, {"PING"}};
+    size_t next = 0;
+    auto process = [&] {
+        while (next < pipeline.size() && !p.master.isBlocked(5)) {
+            ExecResult r = p.master.execute(makeArgs(pipeline[next++]).views, 5);
+            p.out[5] += r.reply;
+        }
+    };
+
+    process();
+    EXPECT_TRUE(p.master.isBlocked(5));
+    EXPECT_EQ("", p.out[5]);
+
+    p.master.execute(makeArgs({"REPLCONF", "ACK", std::to_string(p.masterRepl.offset()).c_str()}).views, 10);
+    EXPECT_FALSE(p.master.isBlocked(5));
+    process();
+    EXPECT_EQ(":1\r\n+PONG\r\n", p.out[5]);
+}
@@ -1,9 +1,15 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <map>
+#include <random>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <unistd.h>
+
+#include "../src/db/RadixTree.hpp"
 #include "../src/db/Stream.hpp"
 
 TEST(StreamTest, ClassifiesStreamIdFormats) {
@@ -17,77 +23,526 @@ TEST(StreamTest, ClassifiesStreamIdFormats) {
 TEST(StreamTest, RejectsNonIncreasingIds) {
     Stream stream;
     std::string err;
-    std::vector<std::pair<std::string, std::string>> fields = {{"f", "1"}};
+    StreamFields fields = {{"f", "1"}};
 
-    EXPECT_TRUE(stream.validateId("1-0", err));
-    stream.addStream("1-0", fields);
+    EXPECT_TRUE(stream.validateId({1, 0}, err));
+    stream.addStream({1, 0}, fields);
 
-    EXPECT_FALSE(stream.validateId("1-0", err));
+    EXPECT_FALSE(stream.validateId({1, 0}, err));
     EXPECT_FALSE(err.empty());
+    EXPECT_FALSE(stream.validateId({0, 0}, err));
 }
 
 TEST(StreamTest, AutoSequenceFillsMissingSequence) {
     Stream stream;
     std::string err;
-    std::vector<std::pair<std::string, std::string>> fields = {{"f", "1"}};
+    StreamID id;
+
+    // 0-0 is reserved, so an empty stream starts millisecond 0 at seq 1
+    EXPECT_TRUE(stream.addSequenceToId(0, id, err));
+    EXPECT_EQ((StreamID{0, 1}), id);
 
-    stream.addStream("5-0", fields);
+    stream.addStream({5, 0}, StreamFields{{"f", "1"}});
 
-    std::string id = "5-*";
-    EXPECT_TRUE(stream.addSequenceToId(id, err));
-    EXPECT_EQ("5-1", id);
+    EXPECT_TRUE(stream.addSequenceToId(5, id, err));
+    EXPECT_EQ("5-1", id.toString());
+    EXPECT_FALSE(stream.addSequenceToId(4, id, err));
 }
 
 TEST(StreamTest, CreateUniqueIdIsMonotonic) {
     Stream stream;
     std::string err;
 
-    std::string id1 = "*";
+    StreamID id1;
     EXPECT_TRUE(stream.createUniqueId(id1, err));
-    stream.addStream(id1, {{"f", "x"}});
+    stream.addStream(id1, StreamFields{{"f", "x"}});
 
-    std::string id2 = "*";
+    StreamID id2;
     EXPECT_TRUE(stream.createUniqueId(id2, err));
+    EXPECT_LT(id1, id2);
+}
 
-    auto parse = [](const std::string& id) {
-        size_t pos = id.find('-');
-        long long ms = std::stoll(id.substr(0, pos));
-        long long seq = std::stoll(id.substr(pos + 1));
-        return std::pair<long long, long long>{ms, seq};
-    };
+TEST(StreamTest, IdsUseTheFullUnsignedRange) {
+    StreamID id;
+    EXPECT_TRUE(StreamID::parse("18446744073709551615-18446744073709551615", id));
+    EXPECT_EQ(StreamID::max(), id);
+    EXPECT_FALSE(StreamID::parse("18446744073709551616-0", id));
+    EXPECT_FALSE(StreamID::parse("-1-0", id));
+    EXPECT_FALSE(StreamID::parse("1-", id));
+
+    EXPECT_TRUE(StreamID::parse("7", id, UINT64_MAX));
+    EXPECT_EQ((StreamID{7, UINT64_MAX}), id);
 
-    auto [ms1, seq1] = parse(id1);
-    auto [ms2, seq2] = parse(id2);
+    // Incrementing carries the sequence into the millisecond part
+    EXPECT_TRUE(id.increment());
+    EXPECT_EQ("8-0", id.toString());
+    EXPECT_TRUE(id.decrement());
+    EXPECT_EQ((StreamID{7, UINT64_MAX}), id);
 
-    EXPECT_TRUE(ms2 > ms1 || (ms2 == ms1 && seq2 > seq1));
+    StreamID top = StreamID::max();
+    EXPECT_FALSE(top.increment());
+    EXPECT_LT((StreamID{1, 100}), (StreamID{2, 0}));
 }
 
 TEST(StreamTest, RangeQueriesReturnExpectedEntries) {
     Stream stream;
-    std::string err;
 
     auto fields = [](const std::string& v) {
-        return std::vector<std::pair<std::string, std::string>>{{"f", v}};
+        return StreamFields{{"f", v}};
     };
 
-    stream.addStream("1-0", fields("a"));
-    stream.addStream("2-0", fields("b"));
-    stream.addStream("3-0", fields("c"));
+    stream.addStream({1, 0}, fields("a"));
+    stream.addStream({2, 0}, fields("b"));
+    stream.addStream({3, 0}, fields("c"));
 
-    auto subset = stream.getPairsInRange(err, "1-0", "2-0");
-    ASSERT_TRUE(err.empty());
+    auto subset = stream.getPairsInRange({1, 0}, {2, 0});
     ASSERT_EQ(2u, subset.size());
-    EXPECT_EQ("1-0", subset[0].first);
-    EXPECT_EQ("2-0", subset[1].first);
+    EXPECT_EQ("1-0", subset[0].first.toString());
+    EXPECT_EQ("2-0", subset[1].first.toString());
     EXPECT_EQ("a", subset[0].second[0].second);
 
-    auto fromStart = stream.getPairsFromStartToId(err, "2-0");
-    ASSERT_TRUE(err.empty());
+    auto fromStart = stream.getPairsInRange(StreamID::min(), {2, 0});
     ASSERT_EQ(2u, fromStart.size());
 
-    auto toEnd = stream.getPairsFromIdToEnd(err, "2-0");
-    ASSERT_TRUE(err.empty());
+    auto toEnd = stream.getPairsInRange({2, 0}, StreamID::max());
     ASSERT_EQ(2u, toEnd.size());
-    EXPECT_EQ("2-0", toEnd[0].first);
-    EXPECT_EQ("3-0", toEnd[1].first);
+    EXPECT_EQ("2-0", toEnd[0].first.toString());
+    EXPECT_EQ("3-0", toEnd[1].first.toString());
+
+    EXPECT_TRUE(stream.getPairsInRange({3, 0}, {1, 0}).empty());
+}
+
+TEST(StreamTest, EntriesSpanPackedNodes) {
+    Stream stream;
+
+    // Mostly the same fields (stored as values only), with an odd entry
+    // every so often that spells its own fields out
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        if (i % 7 == 0)
+            stream.addStream({i, i}, StreamFields{{"other", std::to_string(i)}});
+        else
+            stream.addStream({i, i}, StreamFields{{"temp", std::to_string(i)},
+                                                  {"unit", "celsius"}});
+    }
+
+    EXPECT_EQ(1000u, stream.length());
+    EXPECT_GE(stream.nodeCount(), 1000u / Stream::kNodeMaxEntries);
+    EXPECT_EQ((StreamID{1000, 1000}), stream.getLastId());
+
+    // A range crossing node boundaries, starting between two IDs
+    auto range = stream.getPairsInRange({150, 0}, {420, 420});
+    ASSERT_EQ(271u, range.size());
+    for (size_t j = 0; j < range.size(); ++j) {
+        uint64_t i = 150 + j;
+        EXPECT_EQ((StreamID{i, i}), range[j].first);
+        if (i % 7 == 0) {
+            ASSERT_EQ(1u, range[j].second.size());
+            EXPECT_EQ("other", range[j].second[0].first);
+        } else {
+            ASSERT_EQ(2u, range[j].second.size());
+            EXPECT_EQ("temp", range[j].second[0].first);
+            EXPECT_EQ(std::to_string(i), range[j].second[0].second);
+            EXPECT_EQ("celsius", range[j].second[1].second);
+        }
+    }
+
+    // Reading only some fields of an entry still moves on correctly
+    Stream::Iterator it(stream, StreamID::min(), StreamID::max());
+    StreamID id;
+    uint64_t seen = 0;
+    while (it.next(id)) {
+        EXPECT_EQ(++seen, id.ms);
+        if (seen % 2 == 0) {
+            std::string_view field, value;
+            EXPECT_TRUE(it.nextField(field, value));
+        }
+    }
+    EXPECT_EQ(1000u, seen);
+
+    EXPECT_TRUE(stream.getPairsInRange({1000, 1001}, StreamID::max()).empty());
+}
+
+TEST(StreamTest, DeleteAndTrimMatchOrderedModel) {
+    Stream stream;
+    std::map<StreamID, std::string> model;
+    std::mt19937 rng(11);
+    uint64_t next_ms = 1;
+
+    auto live = [&] {
+        std::vector<StreamID> ids;
+        Stream::Iterator it(stream, StreamID::min(), StreamID::max());
+        StreamID id;
+        while (it.next(id))
+            ids.push_back(id);
+        return ids;
+    };
+
+    for (int step = 0; step < 4000; ++step) {
+        uint32_t op = rng() % 100;
+
+        if (op < 70) {
+            StreamID id{next_ms, rng() % 3};
+            next_ms += 1 + rng() % 2;
+            std::string v = std::to_string(step);
+            // Alternate field layouts so nodes hold both entry forms
+            if (rng() % 5 == 0)
+                stream.addStream(id, StreamFields{{"x", v}, {"y", "1"}});
+            else
+                stream.addStream(id, StreamFields{{"v", v}});
+            model[id] = v;
+        } else if (op < 90) {
+            // Existing, already deleted, or never added
+            StreamID id{rng() % (next_ms + 1), rng() % 3};
+            EXPECT_EQ(model.erase(id) == 1, stream.deleteEntry(id));
+        } else if (op < 95) {
+            uint64_t maxlen = model.size() * (rng() % 4) / 4;
+            bool approx = rng() % 2;
+            uint64_t before = model.size();
+            uint64_t removed = stream.trimByLength(maxlen, approx);
+            while (model.size() > before - removed)
+                model.erase(model.begin());
+            if (approx)
+                EXPECT_GE(model.size(), maxlen);
+            else
+                EXPECT_EQ(std::min<uint64_t>(before, maxlen), model.size());
+        } else {
+            StreamID minid{rng() % (next_ms + 1), 0};
+            bool approx = rng() % 2;
+            uint64_t removed = stream.trimByMinId(minid, approx);
+            for (uint64_t i = 0; i < removed; ++i) {
+                ASSERT_LT(model.begin()->first, minid);
+                model.erase(model.begin());
+            }
+            if (!approx && !model.empty()) {
+                EXPECT_GE(model.begin()->first, minid);
+            }
+        }
+
+        ASSERT_EQ(model.size(), stream.length());
+        if (step % 50 == 0) {
+            std::vector<StreamID> ids = live();
+            ASSERT_EQ(model.size(), ids.size());
+            size_t j = 0;
+            for (const auto &[id, v] : model)
+                ASSERT_EQ(id, ids[j++]);
+        }
+    }
+
+    // Trimmed and deleted IDs stay behind the last ID
+    StreamID last = stream.getLastId();
+    stream.trimByLength(0, false);
+    EXPECT_EQ(0u, stream.length());
+    EXPECT_EQ(0u, stream.nodeCount());
+    std::string err;
+    EXPECT_FALSE(stream.validateId(last, err));
+    StreamID first;
+    EXPECT_FALSE(stream.firstId(first));
+}
+
+TEST(StreamTest, ReverseIteratorMirrorsForwardOne) {
+    Stream stream;
+    std::map<StreamID, std::string> model;
+    std::mt19937 rng(5);
+
+    for (uint64_t ms = 1; ms <= 1000; ++ms) {
+        StreamID id{ms, ms % 2};
+        std::string v = std::to_string(ms);
+        if (ms % 7 == 0)
+            stream.addStream(id, StreamFields{{"a", v}, {"b", v}});
+        else
+            stream.addStream(id, StreamFields{{"v", v}});
+        model[id] = v;
+    }
+    for (int i = 0; i < 300; ++i) {
+        StreamID id{1 + rng() % 1000, 0};
+        id.seq = id.ms % 2;
+        stream.deleteEntry(id);
+        model.erase(id);
+    }
+
+    for (int round = 0; round < 50; ++round) {
+        StreamID lo{rng() % 1100, rng() % 2};
+        StreamID hi{lo.ms + rng() % 300, rng() % 2};
+
+        std::vector<std::pair<StreamID, std::string>> expected;
+        for (auto it = model.lower_bound(lo); it != model.end() && it->first <= hi; ++it)
+            expected.emplace_back(*it);
+        std::reverse(expected.begin(), expected.end());
+
+        Stream::Iterator it(stream, lo, hi, true);
+        StreamID id;
+        std::string_view field, value;
+        size_t j = 0;
+        while (it.next(id)) {
+            ASSERT_LT(j, expected.size());
+            EXPECT_EQ(expected[j].first, id);
+            ASSERT_TRUE(it.nextField(field, value));
+            EXPECT_EQ(expected[j].second, value);
+            ++j;    // the rest of the entry is left unread
+        }
+        EXPECT_EQ(expected.size(), j);
+    }
+}
+
+TEST(StreamTest, AggregateMatchesBruteForceAcrossCachedNodes) {
+    Stream stream;
+    std::mt19937 rng(3);
+
+    // ~10 entries per millisecond run, some without the field or numeric value
+    uint64_t ms = 1000;
+    for (int i = 0; i < 3000; ++i) {
+        ms += rng() % 3;
+        StreamID id{ms, static_cast<uint64_t>(i)};
+        std::string v = std::to_string(static_cast<int>(rng() % 2001) - 1000);
+        if (i % 17 == 0)
+            stream.addStream(id, StreamFields{{"other", v}});
+        else if (i % 23 == 0)
+            stream.addStream(id, StreamFields{{"t", "n/a"}});
+        else
+            stream.addStream(id, StreamFields{{"t", v}, {"unit", "c"}});
+    }
+
+    auto brute = [&](const StreamID &lo, const StreamID &hi, uint64_t bucket_ms) {
+        std::vector<StreamBucket> out;
+        for (const auto &[id, fields] : stream.getPairsInRange(lo, hi)) {
+            if (fields[0].first != "t" || fields[0].second == "n/a")
+                continue;
+            double x = std::stod(fields[0].second);
+            uint64_t b = id.ms - id.ms % bucket_ms;
+            if (out.empty() || out.back().start != b) {
+                out.push_back({b, 1, x, x, x, x, x});
+                continue;
+            }
+            StreamBucket &cur = out.back();
+            cur.min = std::min(cur.min, x);
+            cur.max = std::max(cur.max, x);
+            cur.sum += x;
+            cur.count++;
+            cur.last = x;
+        }
+        return out;
+    };
+
+    auto check = [&] {
+        for (int round = 0; round < 30; ++round) {
+            StreamID lo{1000 + rng() % 3000, rng() % 3000};
+            StreamID hi{lo.ms + rng() % 4000, rng() % 3000};
+            uint64_t bucket_ms = 1 + rng() % 500;
+
+            auto expected = brute(lo, hi, bucket_ms);
+            auto got = stream.aggregate(lo, hi, "t", bucket_ms);
+            ASSERT_EQ(expected.size(), got.size());
+            for (size_t i = 0; i < got.size(); ++i) {
+                EXPECT_EQ(expected[i].start, got[i].start);
+                EXPECT_EQ(expected[i].count, got[i].count);
+                EXPECT_EQ(expected[i].min, got[i].min);
+                EXPECT_EQ(expected[i].max, got[i].max);
+                EXPECT_EQ(expected[i].sum, got[i].sum);
+                EXPECT_EQ(expected[i].first, got[i].first);
+                EXPECT_EQ(expected[i].last, got[i].last);
+            }
+        }
+    };
+
+    check();
+    check();    // now served partly from node summaries
+
+    // Changed nodes must not answer from stale summaries
+    for (const auto &[id, fields] : stream.getPairsInRange(StreamID::min(), StreamID::max())) {
+        if (rng() % 4 == 0)
+            stream.deleteEntry(id);
+    }
+    stream.trimByLength(2000, false);
+    check();
+
+    EXPECT_TRUE(stream.aggregate(StreamID::min(), StreamID::max(), "missing", 10).empty());
+
+    // Querying many fields keeps summaries for the most recent ones only
+    for (int i = 0; i < 20; ++i)
+        stream.aggregate(StreamID::min(), StreamID::max(), "f" + std::to_string(i), 1000000);
+    EXPECT_EQ(Stream::kSummaryFields, stream.summarizedFields());
+    check();
+}
+
+TEST(StreamTest, ApproximateTrimDropsWholeNodesWithinLimit) {
+    Stream stream;
+    for (uint64_t i = 1; i <= 1000; ++i)
+        stream.addStream({i, 0}, StreamFields{{"f", "v"}});
+    size_t nodes = stream.nodeCount();
+
+    // 850 would split a node: only whole nodes go
+    EXPECT_EQ(Stream::kNodeMaxEntries, stream.trimByLength(850, true));
+    EXPECT_EQ(900u, stream.length());
+
+    // A limit smaller than a node stops before touching it
+    EXPECT_EQ(0u, stream.trimByLength(0, true, Stream::kNodeMaxEntries - 1));
+    EXPECT_EQ(Stream::kNodeMaxEntries, stream.trimByLength(0, true, Stream::kNodeMaxEntries));
+    EXPECT_EQ(nodes - 2, stream.nodeCount());
+
+    StreamID first;
+    ASSERT_TRUE(stream.firstId(first));
+    EXPECT_EQ((StreamID{1 + 2 * Stream::kNodeMaxEntries, 0}), first);
+}
+
+TEST(StreamTest, SpilledNodesReadAndChangeLikeResidentOnes) {
+    char tmpl[] = "/tmp/stream_tier_test_XXXXXX";
+    ASSERT_NE(nullptr, ::mkdtemp(tmpl));
+    std::string dir = tmpl;
+
+    // Same entries in a memory-only stream and in a tiered one
+    Stream reference;
+    auto fill = [](Stream &s) {
+        for (uint64_t i = 1; i <= 5000; ++i)
+            s.addStream({1000 + i / 4, i % 4}, StreamFields{{"t", std::to_string(i % 97)}});
+    };
+    fill(reference);
+
+    Stream::SetTiering(dir, 500, 32 * 1024);
+    Stream stream;
+    fill(stream);
+
+    EXPECT_GT(stream.spilledBytes(), 0u);
+    EXPECT_LE(stream.residentBytes(), 32u * 1024 + Stream::kNodeMaxBytes);
+
+    auto ids = [](const Stream &s, bool reverse) {
+        std::vector<std::pair<StreamID, std::string>> out;
+        Stream::Iterator it(s, StreamID::min(), StreamID::max(), reverse);
+        StreamID id;
+        std::string_view field, value;
+        while (it.next(id))
+            while (it.nextField(field, value))
+                out.emplace_back(id, std::string(value));
+        return out;
+    };
+    auto same = [&] {
+        ASSERT_EQ(reference.length(), stream.length());
+        EXPECT_EQ(ids(reference, false), ids(stream, false));
+        EXPECT_EQ(ids(reference, true), ids(stream, true));
+
+        auto a = reference.aggregate({1100, 0}, {1900, 0}, "t", 50);
+        auto b = stream.aggregate({1100, 0}, {1900, 0}, "t", 50);
+        ASSERT_EQ(a.size(), b.size());
+        for (size_t i = 0; i < a.size(); ++i) {
+            EXPECT_EQ(a[i].count, b[i].count);
+            EXPECT_EQ(a[i].sum, b[i].sum);
+        }
+    };
+    same();
+
+    // Deleting and trimming inside cold nodes copies them back
+    uint64_t cold = stream.spilledBytes();
+    for (uint64_t i = 10; i < 4000; i += 7) {
+        StreamID id{1000 + i / 4, i % 4};
+        EXPECT_EQ(reference.deleteEntry(id), stream.deleteEntry(id));
+    }
+    EXPECT_LT(stream.spilledBytes(), cold);
+    same();
+
+    EXPECT_EQ(reference.trimByMinId({1300, 2}, false), stream.trimByMinId({1300, 2}, false));
+    EXPECT_EQ(reference.trimByLength(2500, true), stream.trimByLength(2500, true));
+    same();
+
+    // Segment files are unlinked once mapped
+    Stream::SetTiering("", 100000, 64ULL * 1024 * 1024);
+    EXPECT_EQ(0, ::rmdir(dir.c_str()));
+
+    stream.trimByLength(0, false);
+    EXPECT_EQ(0u, stream.spilledBytes());
+    EXPECT_EQ(0u, stream.residentBytes());
+}
+
+TEST(StreamGroupTest, PendingEntriesStayIndexedByIdAndConsumer) {
+    StreamGroup group;
+    bool created;
+    StreamConsumer &alice = group.consumer("alice", created);
+    EXPECT_TRUE(created);
+    StreamConsumer &bob = group.consumer("bob", created);
+
+    for (uint64_t i = 1; i <= 5; ++i)
+        group.addPending(StreamID{i, 0}, alice, 100);
+    EXPECT_EQ(5u, group.pel().size());
+    EXPECT_EQ(5u, alice.pending.size());
+
+    // Claiming moves the entry between the consumer indexes only
+    StreamPendingEntry *entry = group.findPending(StreamID{2, 0});
+    ASSERT_NE(nullptr, entry);
+    group.transfer(StreamID{2, 0}, *entry, bob);
+    EXPECT_EQ(&bob, entry->consumer);
+    EXPECT_EQ(4u, alice.pending.size());
+    EXPECT_EQ(1u, bob.pending.count(StreamID{2, 0}));
+
+    // Redelivery to another consumer restarts the entry
+    group.addPending(StreamID{3, 0}, bob, 200);
+    EXPECT_EQ(1u, group.findPending(StreamID{3, 0})->deliveryCount);
+    EXPECT_EQ(200u, group.findPending(StreamID{3, 0})->deliveryTime);
+    EXPECT_EQ(2u, bob.pending.size());
+
+    EXPECT_TRUE(group.ack(StreamID{2, 0}));
+    EXPECT_FALSE(group.ack(StreamID{2, 0}));
+    EXPECT_EQ(0u, bob.pending.count(StreamID{2, 0}));
+    EXPECT_EQ(4u, group.pel().size());
+
+    EXPECT_EQ(3, group.deleteConsumer("alice"));
+    EXPECT_EQ(-1, group.deleteConsumer("alice"));
+    EXPECT_EQ(1u, group.pel().size());
+    EXPECT_EQ(&bob, group.pel().begin()->second.consumer);
+}
+
+TEST(RadixTreeTest, MatchesOrderedMap) {
+    using Tree = RadixTree<int, 4>;
+    Tree tree;
+    std::map<Tree::Key, int> model;
+
+    std::mt19937 rng(7);
+    // Few distinct bytes, so keys share prefixes and edges get split
+    auto randomKey = [&] {
+        Tree::Key k;
+        for (auto &b : k)
+            b = static_cast<unsigned char>(rng() % 4 * 60);
+        return k;
+    };
+
+    for (int step = 0; step < 5000; ++step) {
+        Tree::Key k = randomKey();
+        switch (rng() % 4) {
+            case 0:
+            case 1:
+                tree.insert(k, step);
+                model[k] = step;
+                break;
+            case 2:
+                EXPECT_EQ(model.erase(k) == 1, tree.erase(k));
+                break;
+            default: {
+                Tree::Key found;
+                int *ge = tree.seekGE(k, &found);
+                auto it = model.lower_bound(k);
+                ASSERT_EQ(it != model.end(), ge != nullptr);
+                if (ge) {
+                    EXPECT_EQ(it->first, found);
+                    EXPECT_EQ(it->second, *ge);
+                }
+
+                int *le = tree.seekLE(k, &found);
+                auto up = model.upper_bound(k);
+                ASSERT_EQ(up != model.begin(), le != nullptr);
+                if (le) {
+                    EXPECT_EQ(std::prev(up)->first, found);
+                }
+
+                int *f = tree.find(k);
+                EXPECT_EQ(model.count(k) == 1, f != nullptr);
+                break;
+            }
+        }
+        ASSERT_EQ(model.size(), tree.size());
+    }
+
+    Tree::Key k;
+    if (!model.empty()) {
+        ASSERT_NE(nullptr, tree.first(&k));
+        EXPECT_EQ(model.begin()->first, k);
+        ASSERT_NE(nullptr, tree.last(&k));
+        EXPECT_EQ(model.rbegin()->first, k);
+    }
 }